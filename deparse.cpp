@@ -37,6 +37,7 @@
 extern "C"
 {
 #include "access/htup_details.h"
+#include "access/stratnum.h"
 #include "access/sysattr.h"
 #include "access/table.h"
 #include "catalog/pg_aggregate.h"
@@ -62,6 +63,9 @@ extern "C"
 #include "optimizer/tlist.h"
 #include "parser/parsetree.h"
 #include "postgres.h"
+#include "utils/array.h"
+#include "utils/builtins.h"
+#include "utils/datum.h"
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
 #include "utils/syscache.h"
@@ -112,8 +116,26 @@ typedef struct deparse_expr_cxt
 	StringInfo	buf;			/* output buffer to append to */
 	bool		has_arrow;		/* True if expression contain arrow operators */
 	List	  **attrs_list;		/* List of attributes */
+	List	  **params_list;	/* exprs that will become remote Params */
+	const char *index_name;		/* secondary index to read, NULL to read
+								 * the table */
 } deparse_expr_cxt;
 
+/*
+ * Context for building the condition expressions of a counting Query or Scan
+ * request.  Attribute names and values are sent as "#n<i>" and ":v<i>"
+ * placeholders, numbered by their position in attr_names and params_list.
+ */
+typedef struct count_request_cxt
+{
+	PlannerInfo *root;			/* global planner state */
+	RelOptInfo *scanrel;		/* the foreign table counted */
+	List	  **attr_names;		/* String list of the attribute names */
+	List	  **params_list;	/* Consts holding the values */
+	int			null_type;		/* index of the "NULL" type name in
+								 * params_list, -1 until needed */
+} count_request_cxt;
+
 /*
  * Struct to pull out attribute name
  */
@@ -161,6 +183,9 @@ static const char *jsonOpName[] =
 static bool dynamodb_foreign_expr_walker(Node *node,
 								foreign_glob_cxt *glob_cxt,
 								foreign_loc_cxt *outer_cxt);
+static bool dynamodb_contain_mutable_functions_walker(Node *node, void *context);
+static bool dynamodb_mutable_func_checker(Oid func_id, void *context);
+static bool dynamodb_contain_param_expr_walker(Node *node, void *context);
 
 /*
  * Functions to construct string representation of a node tree.
@@ -189,8 +214,10 @@ static void dynamodb_deparse_scalar_array_op_expr(ScalarArrayOpExpr *node,
 static void dynamodb_deparse_array_expr(ArrayExpr *node, deparse_expr_cxt *context);
 static void dynamodb_deparse_bool_expr(BoolExpr *node, deparse_expr_cxt *context);
 static void dynamodb_deparse_null_test(NullTest *node, deparse_expr_cxt *context);
+static void dynamodb_append_quoted_name(StringInfo buf, const char *name);
 static void dynamodb_deparse_from_expr_for_rel(StringInfo buf, PlannerInfo *root,
-											RelOptInfo *foreignrel);
+											RelOptInfo *foreignrel,
+											const char *index_name);
 static void dynamodb_deparse_returning_list(StringInfo buf, RangeTblEntry *rte,
 											Index rtindex, Relation rel,
 											bool trig_after_row,
@@ -201,13 +228,25 @@ static void dynamodb_deparse_returning_list(StringInfo buf, RangeTblEntry *rte,
 static void dynamodb_deparse_from_expr(List *quals, deparse_expr_cxt *context);
 static void dynamodb_deparse_select(List *tlist, List **retrieved_attrs, deparse_expr_cxt *context);
 static void dynamodb_append_conditions(List *exprs, deparse_expr_cxt *context);
+static void dynamodb_append_order_by_clause(List *pathkeys, deparse_expr_cxt *context);
+static Expr *dynamodb_find_em_expr_for_rel(EquivalenceClass *ec, RelOptInfo *rel);
 Form_pg_operator dynamodb_get_operator_expression(Oid oid);
 static char *dynamodb_replace_operator(char *in);
+static bool dynamodb_count_comparison(Expr *expr, Index relid, Var **var,
+									  Const **value, const char **opname);
+static bool dynamodb_count_operand_type(Oid type);
+static bool dynamodb_append_count_condition(StringInfo buf, Expr *expr,
+											count_request_cxt *context);
+static void dynamodb_append_count_comparison(StringInfo buf, Var *var, const char *opname,
+											 Const *value, count_request_cxt *context);
+static void dynamodb_append_count_not_null(StringInfo buf, Var *var, bool is_null,
+										   count_request_cxt *context);
+static int	dynamodb_count_attr_name(Var *var, count_request_cxt *context);
+static int	dynamodb_count_value(Const *value, count_request_cxt *context);
 DynamoDBOperatorsSupport dynamodb_validate_operator_name(Form_pg_operator opform);
 static void dynamodb_store_attr_info(const char *col_name, int varno, List **retrieved_attr);
 static void dynamodb_pull_attribute_name_walker(Node *node, pull_attribute_name_context *context);
 static char *dynamodb_get_attribute_name(Node *node, PlannerInfo *root);
-static char *dynamodb_get_column_name(Oid relid, int varattno);
 void dynamodb_get_document_path(StringInfo buf, PlannerInfo *root, RelOptInfo *rel, Expr *expr);
 
 /*
@@ -347,6 +386,13 @@ dynamodb_is_foreign_expr(PlannerInfo *root,
 	if (!dynamodb_foreign_expr_walker((Node *) expr, &glob_cxt, &loc_cxt))
 		return false;
 
+	/*
+	 * An expression computed locally as a whole would be sent as a bare "?",
+	 * which is no condition DynamoDB accepts.
+	 */
+	if (dynamodb_is_param_expr((Node *) expr))
+		return false;
+
 	/*
 	 * If the expression has a valid collation that does not arise from a
 	 * foreign var, the expression can not be sent over.
@@ -360,14 +406,103 @@ dynamodb_is_foreign_expr(PlannerInfo *root,
 	 * side could cause confusion from clock offsets.  Future versions might
 	 * be able to make this choice with more granularity.  (We check this last
 	 * because it requires a lot of expensive catalog lookups.)
+	 *
+	 * The functions of the expressions sent as parameters don't count: they
+	 * are evaluated locally, once per scan.
 	 */
-	if (contain_mutable_functions((Node *) expr))
+	if (dynamodb_contain_mutable_functions_walker((Node *) expr, NULL))
 		return false;
 
 	/* OK to evaluate on the remote server */
 	return true;
 }
 
+/*
+ * dynamodb_is_param_expr
+ *
+ * Returns true if given expr is computed locally, once per scan, and sent
+ * to the remote server as the value of a "?" parameter.
+ *
+ * That's the case of a Param, e.g. of a prepared statement, and of any
+ * expression whose value cannot change during the scan: it references no
+ * column of the current query level, and calls no volatile function, so
+ * that stable functions such as now() qualify.  Constants are deparsed as
+ * literals instead, and the columns of other relations are sent by
+ * dynamodb_deparse_var.  Arrays are not taken as a whole, so that the
+ * elements of an IN list are sent one by one.
+ */
+bool
+dynamodb_is_param_expr(Node *node)
+{
+	if (node == NULL ||
+		IsA(node, Const) ||
+		IsA(node, Var) ||
+		IsA(node, ArrayExpr) ||
+		IsA(node, List))
+		return false;
+
+	if (IsA(node, Param) && ((Param *) node)->paramkind == PARAM_MULTIEXPR)
+		return false;
+
+	return !contain_var_clause(node) &&
+		!contain_volatile_functions(node) &&
+		!contain_subplans(node);
+}
+
+/*
+ * dynamodb_contain_param_expr
+ *
+ * Returns true if given expr has a subexpression which would be sent as a
+ * parameter.
+ */
+bool
+dynamodb_contain_param_expr(Node *node)
+{
+	return dynamodb_contain_param_expr_walker(node, NULL);
+}
+
+static bool
+dynamodb_contain_param_expr_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+	if (dynamodb_is_param_expr(node))
+		return true;
+#if PG_VERSION_NUM >= 160000
+	return expression_tree_walker(node, dynamodb_contain_param_expr_walker, context);
+#else
+	return expression_tree_walker(node, (bool (*) ()) dynamodb_contain_param_expr_walker, context);
+#endif
+}
+
+/*
+ * dynamodb_contain_mutable_functions_walker
+ *
+ * Same as contain_mutable_functions(), except that the expressions which
+ * are sent as parameters are skipped.
+ */
+static bool
+dynamodb_contain_mutable_functions_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+	if (dynamodb_is_param_expr(node))
+		return false;
+	if (check_functions_in_node(node, dynamodb_mutable_func_checker, context))
+		return true;
+#if PG_VERSION_NUM >= 160000
+	return expression_tree_walker(node, dynamodb_contain_mutable_functions_walker, context);
+#else
+	return expression_tree_walker(node, (bool (*) ()) dynamodb_contain_mutable_functions_walker, context);
+#endif
+}
+
+static bool
+dynamodb_mutable_func_checker(Oid func_id, void *context)
+{
+	return (func_volatile(func_id) != PROVOLATILE_IMMUTABLE);
+}
+
 /*
  * dynamodb_foreign_expr_walker
  *
@@ -382,6 +517,9 @@ dynamodb_is_foreign_expr(PlannerInfo *root,
  * assign_collations_walker() in parse_collate.c, though we can assume here
  * that the given expression is valid.  Note function mutability is not
  * currently considered here.
+ *
+ * An expression which is sent as a parameter is checked as a whole, like a
+ * Param, since it is not deparsed.
  */
 static bool
 dynamodb_foreign_expr_walker(Node *node,
@@ -393,6 +531,7 @@ dynamodb_foreign_expr_walker(Node *node,
 	foreign_loc_cxt inner_cxt;
 	Oid			collation;
 	FDWCollateState state;
+	NodeTag		tag;
 
 	/* Need do nothing for empty subexpressions */
 	if (node == NULL)
@@ -405,7 +544,14 @@ dynamodb_foreign_expr_walker(Node *node,
 	inner_cxt.collation = InvalidOid;
 	inner_cxt.state = FDW_COLLATE_NONE;
 
-	switch (nodeTag(node))
+	if (dynamodb_is_param_expr(node))
+		tag = T_Param;
+	else if (IsA(node, Param))
+		return false;
+	else
+		tag = nodeTag(node);
+
+	switch (tag)
 	{
 		case T_Var:
 			{
@@ -531,6 +677,19 @@ dynamodb_foreign_expr_walker(Node *node,
 					state = FDW_COLLATE_UNSAFE;
 			}
 			break;
+		case T_Param:
+			{
+				/*
+				 * Collation rule is same as for Consts and non-foreign Vars.
+				 */
+				collation = exprCollation(node);
+				if (collation == InvalidOid ||
+					collation == DEFAULT_COLLATION_OID)
+					state = FDW_COLLATE_NONE;
+				else
+					state = FDW_COLLATE_UNSAFE;
+			}
+			break;
 		case T_FuncExpr:
 			{
 				FuncExpr	*fe = (FuncExpr *) node;
@@ -648,15 +807,18 @@ dynamodb_foreign_expr_walker(Node *node,
 					Expr   *left = (Expr *)lfirst(list_head(oe->args));
 					Expr   *right = (Expr *)lfirst(list_tail(oe->args));
 					Expr   *expr = NULL;
-					Const  *c;
+					Oid		consttype;
 					bool	has_const = false;
 
-					if (nodeTag(left) == T_Const)
+					/* A parameter is subject to the same rules as a constant */
+					if (nodeTag(left) == T_Const ||
+						dynamodb_is_param_expr((Node *) left))
 					{
 						expr = left;
 						has_const = true;
 					}
-					else if (nodeTag(right) == T_Const)
+					else if (nodeTag(right) == T_Const ||
+							 dynamodb_is_param_expr((Node *) right))
 					{
 						expr = right;
 						has_const = true;
@@ -664,28 +826,28 @@ dynamodb_foreign_expr_walker(Node *node,
 
 					if (has_const)
 					{
-						c = (Const *) expr;
+						consttype = exprType((Node *) expr);
 
 						/* Do not push down when comparing with array */
-						if (c->consttype == INT2ARRAYOID ||
-							c->consttype == INT4ARRAYOID ||
-							c->consttype == INT8ARRAYOID ||
-							c->consttype == FLOAT4ARRAYOID ||
-							c->consttype == FLOAT8ARRAYOID ||
-							c->consttype == NUMERICARRAYOID ||
-							c->consttype == VARCHARARRAYOID ||
-							c->consttype == TEXTARRAYOID ||
-							c->consttype == BPCHARARRAYOID ||
-							c->consttype == NAMEARRAYOID)
+						if (consttype == INT2ARRAYOID ||
+							consttype == INT4ARRAYOID ||
+							consttype == INT8ARRAYOID ||
+							consttype == FLOAT4ARRAYOID ||
+							consttype == FLOAT8ARRAYOID ||
+							consttype == NUMERICARRAYOID ||
+							consttype == VARCHARARRAYOID ||
+							consttype == TEXTARRAYOID ||
+							consttype == BPCHARARRAYOID ||
+							consttype == NAMEARRAYOID)
 							return false;
 
 						/* Do not push down when comparing text using <, >, <=, >= */
-						if ((c->consttype == TEXTOID ||
-							c->consttype == VARCHAROID ||
-							c->consttype == BPCHAROID ||
-							c->consttype == NAMEOID ||
-							c->consttype == JSONBOID ||
-							c->consttype == JSONOID) &&
+						if ((consttype == TEXTOID ||
+							consttype == VARCHAROID ||
+							consttype == BPCHAROID ||
+							consttype == NAMEOID ||
+							consttype == JSONBOID ||
+							consttype == JSONOID) &&
 							((strcmp(opname, "<") == 0 ||
 							strcmp(opname, "<=") == 0 ||
 							strcmp(opname, ">") == 0 ||
@@ -754,6 +916,13 @@ dynamodb_foreign_expr_walker(Node *node,
 				arg1 = (Expr *) linitial(oe->args);
 				arg2 = (Expr *) lsecond(oe->args);
 
+				/*
+				 * An array sent as a single parameter can't be expanded into
+				 * the IN list.  Example: c1 = ANY($1)
+				 */
+				if (dynamodb_is_param_expr((Node *) arg2))
+					return false;
+
 				/*
 				 * Do not push down when the first argument exist
 				 * in the array because DynamoDB does not support it
@@ -796,12 +965,14 @@ dynamodb_foreign_expr_walker(Node *node,
 				ListCell   *lc;
 
 				/*
-				 * DynamoDB does not support the case only column as operand.
-				 * Example: WHERE NOT c1; WHERE c1 OR condition
+				 * DynamoDB does not support the case only column, or only
+				 * parameter, as operand.
+				 * Example: WHERE NOT c1; WHERE c1 OR condition; WHERE $1 OR c1 = 1
 				 */
 				foreach(lc, l)
 				{
-					if (nodeTag(lfirst(lc)) == T_Var)
+					if (nodeTag(lfirst(lc)) == T_Var ||
+						dynamodb_is_param_expr((Node *) lfirst(lc)))
 						return false;
 				}
 
@@ -964,15 +1135,20 @@ dynamodb_foreign_expr_walker(Node *node,
  *
  * pathkeys is the list of pathkeys to order the result by.
  *
+ * index_name is the secondary index to read, or NULL to read the table.
+ *
  * is_subquery is the flag to indicate whether to deparse the specified
  * relation as a subquery.
  *
- * List of columns selected is returned in retrieved_attrs.
+ * List of columns selected is returned in retrieved_attrs.  The outer
+ * expressions of a parameterized scan are printed as "?" placeholders and
+ * returned in *params_list, in the order of the placeholders.
  */
 void
 dynamodb_deparse_select_stmt_for_rel(StringInfo buf, PlannerInfo *root, RelOptInfo *rel,
 									List *tlist, List *remote_conds, List *pathkeys,
-									List **retrieved_attrs)
+									const char *index_name,
+									List **retrieved_attrs, List **params_list)
 {
     deparse_expr_cxt context;
 	List	   *quals;
@@ -984,6 +1160,8 @@ dynamodb_deparse_select_stmt_for_rel(StringInfo buf, PlannerInfo *root, RelOptIn
 	context.scanrel = rel;
 	context.has_arrow = false;
 	context.attrs_list = retrieved_attrs;
+	context.params_list = params_list;
+	context.index_name = index_name;
 
 	/* Construct SELECT clause */
 	dynamodb_deparse_select(tlist, retrieved_attrs, &context);
@@ -995,6 +1173,10 @@ dynamodb_deparse_select_stmt_for_rel(StringInfo buf, PlannerInfo *root, RelOptIn
 
 	/* Construct FROM and WHERE clauses */
 	dynamodb_deparse_from_expr(quals, &context);
+
+	/* Add ORDER BY clause if we found any useful pathkeys */
+	if (pathkeys)
+		dynamodb_append_order_by_clause(pathkeys, &context);
 }
 
 /*
@@ -1277,7 +1459,8 @@ dynamodb_deparse_from_expr(List *quals, deparse_expr_cxt *context)
 
 	/* Construct FROM clause */
 	appendStringInfoString(buf, " FROM ");
-	dynamodb_deparse_from_expr_for_rel(buf, context->root, scanrel);
+	dynamodb_deparse_from_expr_for_rel(buf, context->root, scanrel,
+									   context->index_name);
 
 	/* Construct WHERE clause */
 	if (quals != NIL)
@@ -1471,6 +1654,68 @@ dynamodb_append_conditions(List *exprs, deparse_expr_cxt *context)
 	dynamodb_reset_transmission_modes(nestlevel);
 }
 
+/*
+ * dynamodb_append_order_by_clause
+ *
+ * Deparse ORDER BY clause according to the given pathkeys for given base
+ * relation.  DynamoDB only accepts the sort key of the table there, which is
+ * the only column sorted paths are made for.
+ */
+static void
+dynamodb_append_order_by_clause(List *pathkeys, deparse_expr_cxt *context)
+{
+	ListCell   *lcell;
+	const char *delim = " ";
+	StringInfo	buf = context->buf;
+
+	appendStringInfoString(buf, " ORDER BY");
+	foreach(lcell, pathkeys)
+	{
+		PathKey    *pathkey = (PathKey *) lfirst(lcell);
+		Expr	   *em_expr;
+
+		em_expr = dynamodb_find_em_expr_for_rel(pathkey->pk_eclass, context->scanrel);
+		if (em_expr == NULL)
+			elog(ERROR, "dynamodb_fdw: could not find pathkey item to sort");
+
+		appendStringInfoString(buf, delim);
+		dynamodb_deparse_expr(em_expr, context);
+		if (pathkey->pk_strategy == BTLessStrategyNumber)
+			appendStringInfoString(buf, " ASC");
+		else
+			appendStringInfoString(buf, " DESC");
+
+		delim = ", ";
+	}
+}
+
+/*
+ * dynamodb_find_em_expr_for_rel
+ *
+ * Find an equivalence class member expression which is a column of the
+ * given relation, or return NULL if there is none.
+ */
+static Expr *
+dynamodb_find_em_expr_for_rel(EquivalenceClass *ec, RelOptInfo *rel)
+{
+	ListCell   *lc;
+
+	foreach(lc, ec->ec_members)
+	{
+		EquivalenceMember *em = (EquivalenceMember *) lfirst(lc);
+		Expr	   *expr = em->em_expr;
+
+		while (IsA(expr, RelabelType))
+			expr = ((RelabelType *) expr)->arg;
+
+		if (IsA(expr, Var) && bms_equal(em->em_relids, rel->relids) &&
+			((Var *) expr)->varlevelsup == 0)
+			return expr;
+	}
+
+	return NULL;
+}
+
 /*
  * dynamodb_deparse_from_expr_for_rel
  *
@@ -1479,6 +1724,9 @@ dynamodb_append_conditions(List *exprs, deparse_expr_cxt *context)
  * For a base relation it just returns schema-qualified tablename, 
  * with the appropriate alias if so requested.
  *
+ * When index_name is given, the secondary index of the table is read
+ * instead, which PartiQL names as "table"."index", both names quoted.
+ *
  * 'ignore_rel' is either zero or the RT index of a target relation.  In the
  * latter case the function constructs FROM clause of UPDATE or USING clause
  * of DELETE; it deparses the join relation as if the relation never contained
@@ -1486,7 +1734,8 @@ dynamodb_append_conditions(List *exprs, deparse_expr_cxt *context)
  * the top-level WHERE clause, which is returned to *ignore_conds.
  */
 static void
-dynamodb_deparse_from_expr_for_rel(StringInfo buf, PlannerInfo *root, RelOptInfo *foreignrel)
+dynamodb_deparse_from_expr_for_rel(StringInfo buf, PlannerInfo *root, RelOptInfo *foreignrel,
+								   const char *index_name)
 {
     RangeTblEntry *rte = planner_rt_fetch(foreignrel->relid, root);
 
@@ -1496,11 +1745,38 @@ dynamodb_deparse_from_expr_for_rel(StringInfo buf, PlannerInfo *root, RelOptInfo
 	 */
     Relation	rel = table_open(rte->relid, NoLock);
 
-    dynamodb_deparse_relation(buf, rel);
+    if (index_name != NULL)
+    {
+        dynamodb_append_quoted_name(buf, dynamodb_get_table_name(RelationGetRelid(rel)));
+        appendStringInfoChar(buf, '.');
+        dynamodb_append_quoted_name(buf, index_name);
+    }
+    else
+        dynamodb_deparse_relation(buf, rel);
 
     table_close(rel, NoLock);
 }
 
+/*
+ * dynamodb_append_quoted_name
+ *
+ * Append a name to buf, always double-quoted, with embedded quotes doubled.
+ */
+static void
+dynamodb_append_quoted_name(StringInfo buf, const char *name)
+{
+	const char *ptr;
+
+	appendStringInfoChar(buf, '"');
+	for (ptr = name; *ptr; ptr++)
+	{
+		if (*ptr == '"')
+			appendStringInfoChar(buf, '"');
+		appendStringInfoChar(buf, *ptr);
+	}
+	appendStringInfoChar(buf, '"');
+}
+
 /*
  * dynamodb_deparse_column_ref
  *
@@ -1528,18 +1804,29 @@ dynamodb_deparse_column_ref(StringInfo buf, int varno, int varattno, RangeTblEnt
  * dynamodb_deparse_relation
  *
  * Append remote name of specified foreign table to buf.
- * Use value of table_name FDW option (if any) instead of relation's name.
- * Similarly, schema_name FDW option overrides schema name.
  */
 static void
 dynamodb_deparse_relation(StringInfo buf, Relation rel)
+{
+	appendStringInfo(buf, "%s",
+					 dynamodb_quote_identifier(dynamodb_get_table_name(RelationGetRelid(rel))));
+}
+
+/*
+ * dynamodb_get_table_name
+ *
+ * Get the remote name of specified foreign table.
+ * Use value of table_name FDW option (if any) instead of relation's name.
+ */
+char *
+dynamodb_get_table_name(Oid relid)
 {
 	ForeignTable *table;
-	const char *relname = NULL;
+	char	   *relname = NULL;
 	ListCell   *lc;
 
 	/* obtain additional catalog information. */
-	table = GetForeignTable(RelationGetRelid(rel));
+	table = GetForeignTable(relid);
 
 	/*
 	 * Use value of FDW options if any, instead of the name of object itself.
@@ -1552,15 +1839,10 @@ dynamodb_deparse_relation(StringInfo buf, Relation rel)
 			relname = defGetString(def);
 	}
 
-	/*
-	 * Note: we could skip printing the schema name if it's pg_catalog, but
-	 * that doesn't seem worth the trouble.
-	 */
 	if (relname == NULL)
-		relname = RelationGetRelationName(rel);
+		relname = get_rel_name(relid);
 
-	appendStringInfo(buf, "%s",
-					 dynamodb_quote_identifier(relname));
+	return relname;
 }
 
 /*
@@ -1603,6 +1885,17 @@ dynamodb_deparse_expr(Expr *node, deparse_expr_cxt *context)
 	if (node == NULL)
 		return;
 
+	/*
+	 * An expression computed locally is sent as a parameter.  As for the
+	 * Vars of other relations, each occurrence gets its own "?".
+	 */
+	if (context->params_list && dynamodb_is_param_expr((Node *) node))
+	{
+		*context->params_list = lappend(*context->params_list, node);
+		appendStringInfoChar(context->buf, '?');
+		return;
+	}
+
 	switch (nodeTag(node))
 	{
 		case T_Var:
@@ -1642,8 +1935,8 @@ dynamodb_deparse_expr(Expr *node, deparse_expr_cxt *context)
  *
  * If the Var belongs to the foreign relation, just print its remote name.
  * Otherwise, it's effectively a Param (and will in fact be a Param at
- * run time).  Handle it the same way we handle plain Params --- see
- * deparseParam for comments.
+ * run time).  PartiQL placeholders are positional, so each occurrence gets
+ * its own "?" and its own entry in params_list.
  */
 static void
 dynamodb_deparse_var(Var *node, deparse_expr_cxt *context)
@@ -1654,6 +1947,11 @@ dynamodb_deparse_var(Var *node, deparse_expr_cxt *context)
 		dynamodb_deparse_column_ref(context->buf, node->varno, node->varattno,
 						 planner_rt_fetch(node->varno, context->root),
 						 context->attrs_list, false);
+	else if (context->params_list)
+	{
+		*context->params_list = lappend(*context->params_list, node);
+		appendStringInfoChar(context->buf, '?');
+	}
 	else
 	{
 		/* Does not reach here. */
@@ -2401,6 +2699,616 @@ dynamodb_deparse_update(StringInfo buf, RangeTblEntry *rte,
 									NIL, returningList, retrieved_attrs, false);
 }
 
+/*
+ * dynamodb_deparse_direct_update_sql
+ *
+ * Deparse an UPDATE statement which modifies the item pinned down by
+ * remote_conds in a single request, for dynamodbPlanDirectModify.
+ *
+ * targetlist holds the TargetEntries of the new values of the columns in
+ * targetAttrs.  The values are sent as parameters: their expressions are
+ * returned in *params_list, to be evaluated at execution time.  The old item
+ * is returned by DynamoDB, so that the caller can count the updated rows.
+ */
+void
+dynamodb_deparse_direct_update_sql(StringInfo buf, PlannerInfo *root,
+								   Index rtindex, Relation rel,
+								   RelOptInfo *foreignrel,
+								   List *targetlist,
+								   List *targetAttrs,
+								   List *remote_conds,
+								   List **params_list)
+{
+	deparse_expr_cxt context;
+	RangeTblEntry *rte = planner_rt_fetch(rtindex, root);
+	ListCell   *lc,
+			   *lc2;
+
+	/* Set up context struct for recursion */
+	context.root = root;
+	context.foreignrel = foreignrel;
+	context.scanrel = foreignrel;
+	context.buf = buf;
+	context.has_arrow = false;
+	context.attrs_list = NULL;
+	context.params_list = params_list;
+	context.index_name = NULL;
+
+	appendStringInfoString(buf, "UPDATE ");
+	dynamodb_deparse_relation(buf, rel);
+
+	forboth(lc, targetlist, lc2, targetAttrs)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+		int			attnum = lfirst_int(lc2);
+
+		appendStringInfoString(buf, " SET ");
+		dynamodb_deparse_column_ref(buf, rtindex, attnum, rte, NULL, false);
+		appendStringInfoString(buf, " = ?");
+		*params_list = lappend(*params_list, tle->expr);
+	}
+
+	appendStringInfoString(buf, " WHERE ");
+	dynamodb_append_conditions(remote_conds, &context);
+
+	appendStringInfoString(buf, " RETURNING ALL OLD *");
+}
+
+/*
+ * dynamodb_deparse_direct_delete_sql
+ *
+ * Deparse a DELETE statement which removes the item pinned down by
+ * remote_conds in a single request, for dynamodbPlanDirectModify.  As for
+ * UPDATE, the old item is returned to count the deleted rows.
+ */
+void
+dynamodb_deparse_direct_delete_sql(StringInfo buf, PlannerInfo *root,
+								   Index rtindex, Relation rel,
+								   RelOptInfo *foreignrel,
+								   List *remote_conds)
+{
+	deparse_expr_cxt context;
+
+	/* Set up context struct for recursion */
+	context.root = root;
+	context.foreignrel = foreignrel;
+	context.scanrel = foreignrel;
+	context.buf = buf;
+	context.has_arrow = false;
+	context.attrs_list = NULL;
+	context.params_list = NULL;
+	context.index_name = NULL;
+
+	appendStringInfoString(buf, "DELETE FROM ");
+	dynamodb_deparse_relation(buf, rel);
+
+	appendStringInfoString(buf, " WHERE ");
+	dynamodb_append_conditions(remote_conds, &context);
+
+	appendStringInfoString(buf, " RETURNING ALL OLD *");
+}
+
+/*
+ * dynamodb_deparse_count_request
+ *
+ * Build the condition expressions of a Query or Scan request which counts the
+ * items of a foreign table satisfying remote_conds, with Select=COUNT.  When
+ * count_var is given, only the items where this column is not null are
+ * counted.
+ *
+ * When remote_conds give the partition key with "=", and at most a range of
+ * the sort key, a Query is sent with those in key_condition.  Otherwise the
+ * table is read by a Scan, and key_condition is left empty.  The other
+ * conditions go into filter.  Attribute names and values are returned in
+ * *attr_names and *params_list, and a readable description of the request,
+ * for EXPLAIN and error reports, in buf.
+ *
+ * Returns false if some condition cannot be written as a condition
+ * expression: only comparisons between a column and a constant, IN lists of
+ * constants and IS [NOT] NULL are, combined with AND and OR.
+ */
+bool
+dynamodb_deparse_count_request(StringInfo buf, PlannerInfo *root, RelOptInfo *baserel,
+							   List *remote_conds, Var *count_var,
+							   StringInfo key_condition, StringInfo filter,
+							   List **attr_names, List **params_list)
+{
+	DynamoDBFdwRelationInfo *fpinfo = (DynamoDBFdwRelationInfo *) baserel->fdw_private;
+	RangeTblEntry *rte = planner_rt_fetch(baserel->relid, root);
+	const char *partition_key = fpinfo->options->svr_partition_key;
+	const char *sort_key = fpinfo->options->svr_sort_key;
+	count_request_cxt context;
+	deparse_expr_cxt display;
+	List	   *conds = NIL;
+	Expr	   *partition_cond = NULL;
+	List	   *sort_conds = NIL;
+	bool		use_query = true;
+	bool		first = true;
+	ListCell   *lc;
+
+	context.root = root;
+	context.scanrel = baserel;
+	context.attr_names = attr_names;
+	context.params_list = params_list;
+	context.null_type = -1;
+
+	/* Find the conditions on the primary key which a Query can take */
+	foreach(lc, remote_conds)
+	{
+		Expr	   *expr = (Expr *) lfirst(lc);
+		Var		   *var;
+		Const	   *value;
+		const char *opname;
+		Bitmapset  *attrs = NULL;
+		int			attno = -1;
+
+		/* Extract clause from RestrictInfo, if required */
+		if (IsA(expr, RestrictInfo))
+			expr = ((RestrictInfo *) expr)->clause;
+		conds = lappend(conds, expr);
+
+		if (dynamodb_count_comparison(expr, baserel->relid, &var, &value, &opname))
+		{
+			char	   *attname = get_attname(rte->relid, var->varattno, false);
+
+			if (IS_KEY_COLUMN(attname, partition_key) && strcmp(opname, "=") == 0 &&
+				partition_cond == NULL)
+			{
+				partition_cond = expr;
+				continue;
+			}
+			if (IS_KEY_COLUMN(attname, sort_key) && strcmp(opname, "<>") != 0)
+			{
+				sort_conds = lappend(sort_conds, expr);
+				continue;
+			}
+		}
+
+		/* The filter of a Query cannot refer to the primary key */
+		pull_varattnos((Node *) expr, baserel->relid, &attrs);
+		while ((attno = bms_next_member(attrs, attno)) >= 0)
+		{
+			AttrNumber	attnum = attno + FirstLowInvalidHeapAttributeNumber;
+			char	   *attname;
+
+			if (attnum <= 0)
+				continue;
+			attname = get_attname(rte->relid, attnum, false);
+			if (IS_KEY_COLUMN(attname, partition_key) || IS_KEY_COLUMN(attname, sort_key))
+				use_query = false;
+		}
+	}
+
+	/*
+	 * A key condition takes a single condition on the sort key, or a range
+	 * which can be written with BETWEEN.
+	 */
+	if (partition_cond == NULL || list_length(sort_conds) > 2)
+		use_query = false;
+	else if (list_length(sort_conds) == 2)
+	{
+		Var		   *var;
+		Const	   *lower;
+		Const	   *upper;
+		const char *lower_op;
+		const char *upper_op;
+
+		(void) dynamodb_count_comparison((Expr *) linitial(sort_conds), baserel->relid,
+										 &var, &lower, &lower_op);
+		(void) dynamodb_count_comparison((Expr *) lsecond(sort_conds), baserel->relid,
+										 &var, &upper, &upper_op);
+		if (strcmp(lower_op, "<=") == 0 && strcmp(upper_op, ">=") == 0)
+		{
+			sort_conds = list_make2(lsecond(sort_conds), linitial(sort_conds));
+			(void) dynamodb_count_comparison((Expr *) linitial(sort_conds), baserel->relid,
+											 &var, &lower, &lower_op);
+			(void) dynamodb_count_comparison((Expr *) lsecond(sort_conds), baserel->relid,
+											 &var, &upper, &upper_op);
+		}
+		if (strcmp(lower_op, ">=") != 0 || strcmp(upper_op, "<=") != 0)
+			use_query = false;
+	}
+
+	if (use_query)
+	{
+		Var		   *var;
+		Const	   *value;
+		const char *opname;
+
+		(void) dynamodb_count_comparison(partition_cond, baserel->relid, &var, &value, &opname);
+		dynamodb_append_count_comparison(key_condition, var, opname, value, &context);
+
+		if (list_length(sort_conds) == 1)
+		{
+			(void) dynamodb_count_comparison((Expr *) linitial(sort_conds), baserel->relid,
+											 &var, &value, &opname);
+			appendStringInfoString(key_condition, " AND ");
+			dynamodb_append_count_comparison(key_condition, var, opname, value, &context);
+		}
+		else if (list_length(sort_conds) == 2)
+		{
+			Const	   *upper;
+
+			(void) dynamodb_count_comparison((Expr *) linitial(sort_conds), baserel->relid,
+											 &var, &value, &opname);
+			(void) dynamodb_count_comparison((Expr *) lsecond(sort_conds), baserel->relid,
+											 &var, &upper, &opname);
+			appendStringInfo(key_condition, " AND #n%d BETWEEN :v%d AND :v%d",
+							 dynamodb_count_attr_name(var, &context),
+							 dynamodb_count_value(value, &context),
+							 dynamodb_count_value(upper, &context));
+		}
+	}
+
+	/* The other conditions are checked by the filter */
+	foreach(lc, conds)
+	{
+		Expr	   *expr = (Expr *) lfirst(lc);
+
+		if (use_query && (expr == partition_cond || list_member_ptr(sort_conds, expr)))
+			continue;
+
+		if (!first)
+			appendStringInfoString(filter, " AND ");
+		if (!dynamodb_append_count_condition(filter, expr, &context))
+			return false;
+		first = false;
+	}
+
+	/* The primary key is always there, any other column may be null */
+	if (count_var != NULL)
+	{
+		char	   *attname = get_attname(rte->relid, count_var->varattno, false);
+
+		if (!IS_KEY_COLUMN(attname, partition_key) && !IS_KEY_COLUMN(attname, sort_key))
+		{
+			NullTest   *ntest = makeNode(NullTest);
+
+			if (!first)
+				appendStringInfoString(filter, " AND ");
+			dynamodb_append_count_not_null(filter, count_var, false, &context);
+
+			ntest->arg = (Expr *) count_var;
+			ntest->nulltesttype = IS_NOT_NULL;
+			ntest->argisrow = false;
+			ntest->location = -1;
+			conds = lappend(conds, ntest);
+		}
+	}
+
+	/* Describe the request */
+	display.root = root;
+	display.foreignrel = baserel;
+	display.scanrel = baserel;
+	display.buf = buf;
+	display.has_arrow = false;
+	display.attrs_list = NULL;
+	display.params_list = NULL;
+	display.index_name = NULL;
+
+	appendStringInfoString(buf, use_query ? "Query " : "Scan ");
+	dynamodb_deparse_from_expr_for_rel(buf, root, baserel, NULL);
+	if (conds != NIL)
+	{
+		appendStringInfoString(buf, " WHERE ");
+		dynamodb_append_conditions(conds, &display);
+	}
+
+	return true;
+}
+
+/*
+ * dynamodb_count_comparison
+ *
+ * Is expr a comparison between a column of the relation and a constant, as
+ * a counting request can send it?  If so, return the column, the constant
+ * and the operator, commuted so that the column comes first.
+ */
+static bool
+dynamodb_count_comparison(Expr *expr, Index relid, Var **var, Const **value,
+						  const char **opname)
+{
+	OpExpr	   *op;
+	Form_pg_operator form;
+	Expr	   *left;
+	Expr	   *right;
+	bool		commuted = false;
+
+	if (!IsA(expr, OpExpr) || list_length(((OpExpr *) expr)->args) != 2)
+		return false;
+	op = (OpExpr *) expr;
+	if (!dynamodb_is_builtin(op->opno))
+		return false;
+
+	form = dynamodb_get_operator_expression(op->opno);
+	if (dynamodb_validate_operator_name(form) != OP_CONDITIONAL)
+		return false;
+
+	left = (Expr *) linitial(op->args);
+	right = (Expr *) lsecond(op->args);
+	if (IsA(left, RelabelType))
+		left = ((RelabelType *) left)->arg;
+	if (IsA(right, RelabelType))
+		right = ((RelabelType *) right)->arg;
+	if (IsA(left, Const) && IsA(right, Var))
+	{
+		Expr	   *tmp = left;
+
+		left = right;
+		right = tmp;
+		commuted = true;
+	}
+
+	if (!IsA(left, Var) || !IsA(right, Const))
+		return false;
+	*var = (Var *) left;
+	*value = (Const *) right;
+	if ((*var)->varno != relid || (*var)->varlevelsup != 0 || (*var)->varattno <= 0 ||
+		(*value)->constisnull ||
+		!dynamodb_count_operand_type((*var)->vartype) ||
+		!dynamodb_count_operand_type((*value)->consttype))
+		return false;
+
+	*opname = dynamodb_replace_operator(NameStr(form->oprname));
+
+	/* Booleans only compare for equality */
+	if ((*var)->vartype == BOOLOID &&
+		strcmp(*opname, "=") != 0 && strcmp(*opname, "<>") != 0)
+		return false;
+
+	if (commuted)
+	{
+		if (strcmp(*opname, "<") == 0)
+			*opname = ">";
+		else if (strcmp(*opname, ">") == 0)
+			*opname = "<";
+		else if (strcmp(*opname, "<=") == 0)
+			*opname = ">=";
+		else if (strcmp(*opname, ">=") == 0)
+			*opname = "<=";
+	}
+
+	return true;
+}
+
+/*
+ * dynamodb_count_operand_type
+ *
+ * Can the values of this type be compared by a condition expression as
+ * PostgreSQL compares them?
+ */
+static bool
+dynamodb_count_operand_type(Oid type)
+{
+	switch (type)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case FLOAT4OID:
+		case FLOAT8OID:
+		case NUMERICOID:
+		case TEXTOID:
+		case VARCHAROID:
+		case BOOLOID:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+ * dynamodb_append_count_condition
+ *
+ * Append a condition of a counting request to buf, or return false if it
+ * cannot be written as a condition expression.
+ *
+ * DynamoDB does not know about nulls: a comparison with a missing attribute
+ * is false, where PostgreSQL finds it null.  Both reject the item in the end,
+ * as long as no NOT applies to the comparison, so NOT is not supported.
+ */
+static bool
+dynamodb_append_count_condition(StringInfo buf, Expr *expr, count_request_cxt *context)
+{
+	Var		   *var;
+	Const	   *value;
+	const char *opname;
+
+	if (dynamodb_count_comparison(expr, context->scanrel->relid, &var, &value, &opname))
+	{
+		dynamodb_append_count_comparison(buf, var, opname, value, context);
+		return true;
+	}
+
+	if (IsA(expr, BoolExpr))
+	{
+		BoolExpr   *bexpr = (BoolExpr *) expr;
+		ListCell   *lc;
+		bool		first = true;
+
+		if (bexpr->boolop == NOT_EXPR)
+			return false;
+
+		appendStringInfoChar(buf, '(');
+		foreach(lc, bexpr->args)
+		{
+			if (!first)
+				appendStringInfoString(buf, bexpr->boolop == AND_EXPR ? " AND " : " OR ");
+			if (!dynamodb_append_count_condition(buf, (Expr *) lfirst(lc), context))
+				return false;
+			first = false;
+		}
+		appendStringInfoChar(buf, ')');
+		return true;
+	}
+
+	if (IsA(expr, NullTest))
+	{
+		NullTest   *ntest = (NullTest *) expr;
+		Expr	   *arg = ntest->arg;
+
+		if (IsA(arg, RelabelType))
+			arg = ((RelabelType *) arg)->arg;
+		if (ntest->argisrow || !IsA(arg, Var))
+			return false;
+		var = (Var *) arg;
+		if (var->varno != context->scanrel->relid || var->varlevelsup != 0 ||
+			var->varattno <= 0)
+			return false;
+
+		dynamodb_append_count_not_null(buf, var, ntest->nulltesttype == IS_NULL, context);
+		return true;
+	}
+
+	/* "column IN (constant, ...)", with up to 100 values */
+	if (IsA(expr, ScalarArrayOpExpr))
+	{
+		ScalarArrayOpExpr *saop = (ScalarArrayOpExpr *) expr;
+		Expr	   *left = (Expr *) linitial(saop->args);
+		Const	   *array = (Const *) lsecond(saop->args);
+		Oid			elmtype;
+		int16		elmlen;
+		bool		elmbyval;
+		char		elmalign;
+		Datum	   *elems;
+		bool	   *nulls;
+		int			nelems;
+		int			i;
+
+		if (IsA(left, RelabelType))
+			left = ((RelabelType *) left)->arg;
+		if (!saop->useOr || !dynamodb_is_builtin(saop->opno) || !IsA(left, Var) ||
+			!IsA(array, Const) || array->constisnull)
+			return false;
+		if (strcmp(NameStr(dynamodb_get_operator_expression(saop->opno)->oprname), "=") != 0)
+			return false;
+		var = (Var *) left;
+		elmtype = get_element_type(array->consttype);
+		if (var->varno != context->scanrel->relid || var->varlevelsup != 0 ||
+			var->varattno <= 0 || !OidIsValid(elmtype) ||
+			!dynamodb_count_operand_type(var->vartype) ||
+			!dynamodb_count_operand_type(elmtype))
+			return false;
+
+		get_typlenbyvalalign(elmtype, &elmlen, &elmbyval, &elmalign);
+		deconstruct_array(DatumGetArrayTypeP(array->constvalue), elmtype,
+						  elmlen, elmbyval, elmalign, &elems, &nulls, &nelems);
+		if (nelems == 0 || nelems > 100)
+			return false;
+		for (i = 0; i < nelems; i++)
+		{
+			if (nulls[i])
+				return false;
+		}
+
+		appendStringInfo(buf, "#n%d IN (", dynamodb_count_attr_name(var, context));
+		for (i = 0; i < nelems; i++)
+		{
+			Const	   *elem = makeConst(elmtype, -1, array->constcollid, elmlen,
+										 datumCopy(elems[i], elmbyval, elmlen),
+										 false, elmbyval);
+
+			if (i > 0)
+				appendStringInfoString(buf, ", ");
+			appendStringInfo(buf, ":v%d", dynamodb_count_value(elem, context));
+		}
+		appendStringInfoChar(buf, ')');
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * dynamodb_append_count_comparison
+ *
+ * Append "column op value" to buf.  DynamoDB finds an attribute holding a
+ * NULL, or no attribute at all, different from any value, so "<>" also makes
+ * sure that the column is not null.
+ */
+static void
+dynamodb_append_count_comparison(StringInfo buf, Var *var, const char *opname,
+								 Const *value, count_request_cxt *context)
+{
+	if (strcmp(opname, "<>") == 0)
+	{
+		appendStringInfoChar(buf, '(');
+		dynamodb_append_count_not_null(buf, var, false, context);
+		appendStringInfoString(buf, " AND ");
+	}
+
+	appendStringInfo(buf, "#n%d %s :v%d",
+					 dynamodb_count_attr_name(var, context), opname,
+					 dynamodb_count_value(value, context));
+
+	if (strcmp(opname, "<>") == 0)
+		appendStringInfoChar(buf, ')');
+}
+
+/*
+ * dynamodb_append_count_not_null
+ *
+ * Append a test of whether a column is null, as PostgreSQL sees it: the
+ * attribute is missing or holds a NULL.
+ */
+static void
+dynamodb_append_count_not_null(StringInfo buf, Var *var, bool is_null,
+							   count_request_cxt *context)
+{
+	int			name = dynamodb_count_attr_name(var, context);
+
+	if (context->null_type < 0)
+	{
+		Const	   *null_type = makeConst(TEXTOID, -1, DEFAULT_COLLATION_OID, -1,
+										  CStringGetTextDatum("NULL"), false, false);
+
+		context->null_type = dynamodb_count_value(null_type, context);
+	}
+
+	if (is_null)
+		appendStringInfo(buf, "(attribute_not_exists(#n%d) OR attribute_type(#n%d, :v%d))",
+						 name, name, context->null_type);
+	else
+		appendStringInfo(buf, "(attribute_exists(#n%d) AND NOT attribute_type(#n%d, :v%d))",
+						 name, name, context->null_type);
+}
+
+/*
+ * dynamodb_count_attr_name
+ *
+ * Get the number of the placeholder of a column's attribute name.
+ */
+static int
+dynamodb_count_attr_name(Var *var, count_request_cxt *context)
+{
+	RangeTblEntry *rte = planner_rt_fetch(context->scanrel->relid, context->root);
+	char	   *colname = dynamodb_get_column_name(rte->relid, var->varattno);
+	ListCell   *lc;
+	int			i = 0;
+
+	foreach(lc, *context->attr_names)
+	{
+		if (strcmp(strVal(lfirst(lc)), colname) == 0)
+			return i;
+		i++;
+	}
+
+	*context->attr_names = lappend(*context->attr_names, makeString(colname));
+	return i;
+}
+
+/*
+ * dynamodb_count_value
+ *
+ * Get the number of the placeholder of a value.
+ */
+static int
+dynamodb_count_value(Const *value, count_request_cxt *context)
+{
+	*context->params_list = lappend(*context->params_list, value);
+	return list_length(*context->params_list) - 1;
+}
+
 /*
  * dynamodb_validate_operator_name.
  *
@@ -2526,7 +3434,7 @@ dynamodb_store_attr_info(const char *col_name, int varno, List **retrieved_attr)
  *
  * Get column name using column_name option or attribute_name
  */
-static char *
+char *
 dynamodb_get_column_name(Oid relid, int varattno)
 {
 	char	   *colname = NULL;
@@ -2576,6 +3484,8 @@ void dynamodb_get_document_path(StringInfo buf, PlannerInfo *root, RelOptInfo *r
 	context.scanrel = rel;
 	context.has_arrow = false;
 	context.attrs_list = &attrs_list;
+	context.params_list = NULL;
+	context.index_name = NULL;
 
 	dynamodb_deparse_expr(expr, &context);
 }
\ No newline at end of file
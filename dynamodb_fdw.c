@@ -15,6 +15,7 @@
 #include <limits.h>
 
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "access/sysattr.h"
 #include "access/table.h"
 #include "catalog/pg_class.h"
@@ -69,10 +70,35 @@ extern ForeignScan *dynamodbGetForeignPlan(PlannerInfo *root,
 										   List *tlist,
 										   List *scan_clauses,
 										   Plan *outer_plan);
+extern void dynamodbGetForeignUpperPaths(PlannerInfo *root,
+										 UpperRelationKind stage,
+										 RelOptInfo *input_rel,
+										 RelOptInfo *output_rel,
+										 void *extra);
 extern void dynamodbBeginForeignScan(ForeignScanState *node, int eflags);
 extern TupleTableSlot *dynamodbIterateForeignScan(ForeignScanState *node);
 extern void dynamodbReScanForeignScan(ForeignScanState *node);
 extern void dynamodbEndForeignScan(ForeignScanState *node);
+extern bool dynamodbIsForeignScanParallelSafe(PlannerInfo *root,
+											  RelOptInfo *rel,
+											  RangeTblEntry *rte);
+extern Size dynamodbEstimateDSMForeignScan(ForeignScanState *node,
+										   ParallelContext *pcxt);
+extern void dynamodbInitializeDSMForeignScan(ForeignScanState *node,
+											 ParallelContext *pcxt,
+											 void *coordinate);
+extern void dynamodbReInitializeDSMForeignScan(ForeignScanState *node,
+											   ParallelContext *pcxt,
+											   void *coordinate);
+extern void dynamodbInitializeWorkerForeignScan(ForeignScanState *node,
+												shm_toc *toc,
+												void *coordinate);
+#if PG_VERSION_NUM >= 140000
+extern bool dynamodbIsForeignPathAsyncCapable(ForeignPath *path);
+extern void dynamodbForeignAsyncRequest(AsyncRequest *areq);
+extern void dynamodbForeignAsyncConfigureWait(AsyncRequest *areq);
+extern void dynamodbForeignAsyncNotify(AsyncRequest *areq);
+#endif
 extern void dynamodbAddForeignUpdateTargets(
 #if (PG_VERSION_NUM >= 140000)
 											PlannerInfo *root,
@@ -100,6 +126,14 @@ extern TupleTableSlot *dynamodbExecForeignInsert(EState *estate,
 												 ResultRelInfo *resultRelInfo,
 												 TupleTableSlot *slot,
 												 TupleTableSlot *planSlot);
+#if PG_VERSION_NUM >= 140000
+extern TupleTableSlot **dynamodbExecForeignBatchInsert(EState *estate,
+													   ResultRelInfo *resultRelInfo,
+													   TupleTableSlot **slots,
+													   TupleTableSlot **planSlots,
+													   int *numSlots);
+extern int	dynamodbGetForeignModifyBatchSize(ResultRelInfo *resultRelInfo);
+#endif
 extern TupleTableSlot *dynamodbExecForeignUpdate(EState *estate,
 												 ResultRelInfo *resultRelInfo,
 												 TupleTableSlot *slot,
@@ -110,6 +144,13 @@ extern TupleTableSlot *dynamodbExecForeignDelete(EState *estate,
 												 TupleTableSlot *planSlot);
 extern void dynamodbEndForeignModify(EState *estate,
 									 ResultRelInfo *resultRelInfo);
+extern bool dynamodbPlanDirectModify(PlannerInfo *root,
+									 ModifyTable *plan,
+									 Index resultRelation,
+									 int subplan_index);
+extern void dynamodbBeginDirectModify(ForeignScanState *node, int eflags);
+extern TupleTableSlot *dynamodbIterateDirectModify(ForeignScanState *node);
+extern void dynamodbEndDirectModify(ForeignScanState *node);
 
 extern void dynamodbExplainForeignScan(ForeignScanState *node,
 									   ExplainState *es);
@@ -118,10 +159,15 @@ extern void dynamodbExplainForeignModify(ModifyTableState *mtstate,
 										List *fdw_private,
 										int subplan_index,
 										ExplainState *es);
+extern void dynamodbExplainDirectModify(ForeignScanState *node,
+										ExplainState *es);
 extern void dynamodbBeginForeignInsert(ModifyTableState *mtstate,
 									   ResultRelInfo *resultRelInfo);
 extern void dynamodbEndForeignInsert(EState *estate,
 									 ResultRelInfo *resultRelInfo);
+extern bool dynamodbAnalyzeForeignTable(Relation relation,
+										AcquireSampleRowsFunc *func,
+										BlockNumber *totalpages);
 
 void
 _PG_init(void)
@@ -159,20 +205,50 @@ dynamodb_fdw_handler(PG_FUNCTION_ARGS)
 	routine->ReScanForeignScan = dynamodbReScanForeignScan;
 	routine->EndForeignScan = dynamodbEndForeignScan;
 
+	/* Support functions for parallel scans */
+	routine->IsForeignScanParallelSafe = dynamodbIsForeignScanParallelSafe;
+	routine->EstimateDSMForeignScan = dynamodbEstimateDSMForeignScan;
+	routine->InitializeDSMForeignScan = dynamodbInitializeDSMForeignScan;
+	routine->ReInitializeDSMForeignScan = dynamodbReInitializeDSMForeignScan;
+	routine->InitializeWorkerForeignScan = dynamodbInitializeWorkerForeignScan;
+
 	/* Functions for updating foreign tables */
 	routine->AddForeignUpdateTargets = dynamodbAddForeignUpdateTargets;
 	routine->PlanForeignModify = dynamodbPlanForeignModify;
 	routine->BeginForeignModify = dynamodbBeginForeignModify;
 	routine->ExecForeignInsert = dynamodbExecForeignInsert;
+#if PG_VERSION_NUM >= 140000
+	routine->ExecForeignBatchInsert = dynamodbExecForeignBatchInsert;
+	routine->GetForeignModifyBatchSize = dynamodbGetForeignModifyBatchSize;
+#endif
 	routine->ExecForeignUpdate = dynamodbExecForeignUpdate;
 	routine->ExecForeignDelete = dynamodbExecForeignDelete;
 	routine->EndForeignModify = dynamodbEndForeignModify;
 	routine->BeginForeignInsert = dynamodbBeginForeignInsert;
 	routine->EndForeignInsert = dynamodbEndForeignInsert;
+	routine->PlanDirectModify = dynamodbPlanDirectModify;
+	routine->BeginDirectModify = dynamodbBeginDirectModify;
+	routine->IterateDirectModify = dynamodbIterateDirectModify;
+	routine->EndDirectModify = dynamodbEndDirectModify;
 
 	/* Support functions for EXPLAIN */
 	routine->ExplainForeignScan = dynamodbExplainForeignScan;
 	routine->ExplainForeignModify = dynamodbExplainForeignModify;
+	routine->ExplainDirectModify = dynamodbExplainDirectModify;
+
+	/* Support functions for ANALYZE */
+	routine->AnalyzeForeignTable = dynamodbAnalyzeForeignTable;
+
+	/* Support functions for upper relation push-down */
+	routine->GetForeignUpperPaths = dynamodbGetForeignUpperPaths;
+
+#if PG_VERSION_NUM >= 140000
+	/* Support functions for asynchronous execution */
+	routine->IsForeignPathAsyncCapable = dynamodbIsForeignPathAsyncCapable;
+	routine->ForeignAsyncRequest = dynamodbForeignAsyncRequest;
+	routine->ForeignAsyncConfigureWait = dynamodbForeignAsyncConfigureWait;
+	routine->ForeignAsyncNotify = dynamodbForeignAsyncNotify;
+#endif
 
 	PG_RETURN_POINTER(routine);
 }
@@ -20,6 +20,48 @@
 #include "catalog/pg_operator.h"
 #define CODE_VERSION 10400
 
+/* Attributes projected into a secondary index */
+typedef enum DynamoDBIndexProjection
+{
+	DYNAMODB_PROJECTION_ALL,		/* all the attributes of the items */
+	DYNAMODB_PROJECTION_KEYS_ONLY,	/* the keys of the index and of the table */
+	DYNAMODB_PROJECTION_INCLUDE		/* the keys, and include_attrs */
+} DynamoDBIndexProjection;
+
+/*
+ * A global or local secondary index of the table, as declared by the
+ * "indexes" option.
+ */
+typedef struct DynamoDBIndex
+{
+	char	   *name;			/* name of the index */
+	char	   *partition_key;	/* partition key of the index */
+	char	   *sort_key;		/* sort key of the index, NULL if none */
+	DynamoDBIndexProjection projection;
+	List	   *include_attrs;	/* String list of the non-key attributes of
+								 * an INCLUDE projection */
+} DynamoDBIndex;
+
+/* Size of a secondary index, as given by DescribeTable */
+typedef struct DynamoDBIndexStats
+{
+	char	   *name;			/* name of the index */
+	double		item_count;		/* number of items in the index */
+	double		size_bytes;		/* total size of the items of the index */
+} DynamoDBIndexStats;
+
+/*
+ * Size of a DynamoDB table and of its secondary indexes, as given by
+ * DescribeTable.  DynamoDB updates these about every six hours.
+ */
+typedef struct DynamoDBTableStats
+{
+	double		item_count;		/* number of items in the table */
+	double		size_bytes;		/* total size of the items of the table */
+	int			nindexes;		/* number of secondary indexes */
+	DynamoDBIndexStats *indexes;	/* array of nindexes entries */
+} DynamoDBTableStats;
+
 /*
  * Options structure to store the dynamodb
  * server information
@@ -31,6 +73,18 @@ typedef struct dynamodb_opt
 	char	   *svr_password;		/* dynamodb password */
 	char	   *svr_partition_key;	/* dynamodb partition_key */
 	char	   *svr_sort_key;		/* dynamodb sort_key */
+	int			prefetch_depth;		/* number of pages fetched ahead, 0 to
+									 * disable prefetching */
+	int			prefetch_memory_limit;	/* upper limit of prefetched data, in
+										 * kilobytes */
+	int			parallel_workers;	/* number of workers of a parallel scan,
+									 * -1 to let the planner decide */
+	bool		async_capable;	/* can scans run asynchronously? */
+	List	   *indexes;		/* secondary indexes, as DynamoDBIndex */
+	bool		use_remote_estimate;	/* size unanalyzed tables with
+										 * DescribeTable? */
+	int			remote_estimate_ttl;	/* seconds for which the result of
+										 * DescribeTable is reused */
 } dynamodb_opt;
 
 /*
@@ -56,6 +110,9 @@ typedef struct DynamoDBFdwRelationInfo
 	List	   *remote_conds;
 	List	   *local_conds;
 
+	/* Actual remote restriction clauses for scan (sans RestrictInfos) */
+	List	   *final_remote_exprs;
+
 	/* Bitmap of attr numbers we need to fetch from the remote server. */
 	Bitmapset  *attrs_used;
 
@@ -78,6 +135,27 @@ typedef struct DynamoDBFdwRelationInfo
 	Cost		rel_startup_cost;
 	Cost		rel_total_cost;
 
+	/*
+	 * Number of rows that the LIMIT and OFFSET of the query need from the
+	 * scan, 0 if it needs them all.  Set by dynamodbGetForeignUpperPaths.
+	 */
+	int64		limit_tuples;
+
+	/* Size of the remote table, NULL if not known */
+	DynamoDBTableStats *remote_stats;
+
+	/*
+	 * For an upper relation counting or aggregating the items of a foreign
+	 * table, the relation read.  A count made by DynamoDB has its count()
+	 * aggregate; aggregates computed by the scan have its scan tlist, and
+	 * the description of its columns kept in the FdwScanPrivateAggregates
+	 * item of the plan.
+	 */
+	RelOptInfo *outerrel;
+	Aggref	   *count_agg;
+	List	   *agg_tlist;
+	List	   *aggregates;
+
 	/* Options extracted from catalogs. */
 	Cost		fdw_startup_cost;
 	Cost		fdw_tuple_cost;
@@ -86,6 +164,8 @@ typedef struct DynamoDBFdwRelationInfo
 	/* Cached catalog information. */
 	ForeignTable *table;
 	ForeignServer *server;
+	dynamodb_opt *options;		/* options of the table, its server and
+								 * user mapping */
 
 } DynamoDBFdwRelationInfo;
 
@@ -102,6 +182,8 @@ extern void dynamodb_reset_transmission_modes(int nestlevel);
 
 /* in option.c */
 extern dynamodb_opt *dynamodb_get_options(Oid foreigntableid, Oid userid);
+extern int	dynamodb_get_batch_size_option(Oid foreigntableid);
+extern List *dynamodb_parse_indexes(const char *value);
 
 /* in deparse.cpp */
 extern void dynamodb_classify_conditions(PlannerInfo *root,
@@ -112,6 +194,8 @@ extern void dynamodb_classify_conditions(PlannerInfo *root,
 extern bool dynamodb_is_foreign_expr(PlannerInfo *root,
 							RelOptInfo *baserel,
 							Expr *expr);
+extern bool dynamodb_is_param_expr(Node *node);
+extern bool dynamodb_contain_param_expr(Node *node);
 extern void dynamodb_deparse_insert(StringInfo buf, RangeTblEntry *rte,
 				 		Index rtindex, Relation rel,
 						List *targetAttrs, List **retrieved_attrs);
@@ -124,14 +208,33 @@ extern void dynamodb_deparse_update(StringInfo buf, RangeTblEntry *rte,
 							 List *targetAttrs,
 							 List *withCheckOptionList, List *returningList,
 							 List **retrieved_attrs, List *attnums);
+extern void dynamodb_deparse_direct_update_sql(StringInfo buf, PlannerInfo *root,
+											   Index rtindex, Relation rel,
+											   RelOptInfo *foreignrel,
+											   List *targetlist,
+											   List *targetAttrs,
+											   List *remote_conds,
+											   List **params_list);
+extern void dynamodb_deparse_direct_delete_sql(StringInfo buf, PlannerInfo *root,
+											   Index rtindex, Relation rel,
+											   RelOptInfo *foreignrel,
+											   List *remote_conds);
 extern void dynamodb_deparse_select_stmt_for_rel(StringInfo buf, PlannerInfo *root,
 												RelOptInfo *foreignrel, List *tlist,
 												List *remote_conds, List *pathkeys,
-												List **retrieved_attrs);
+												const char *index_name,
+												List **retrieved_attrs, List **params_list);
+extern bool dynamodb_deparse_count_request(StringInfo buf, PlannerInfo *root,
+										   RelOptInfo *baserel, List *remote_conds,
+										   Var *count_var, StringInfo key_condition,
+										   StringInfo filter, List **attr_names,
+										   List **params_list);
 extern bool dynamodb_tlist_has_json_arrow_op(PlannerInfo *root, RelOptInfo *baserel, List *tlist);
 extern Form_pg_operator dynamodb_get_operator_expression(Oid oid);
 extern DynamoDBOperatorsSupport dynamodb_validate_operator_name(Form_pg_operator opform);
 extern void dynamodb_get_document_path(StringInfo buf, PlannerInfo *root, RelOptInfo *rel, Expr *expr);
+extern char *dynamodb_get_table_name(Oid relid);
+extern char *dynamodb_get_column_name(Oid relid, int varattno);
 /* in shippable.c */
 extern bool dynamodb_is_builtin(Oid objectId);
 extern bool dynamodb_is_shippable(Oid objectId, Oid classId, DynamoDBFdwRelationInfo *fpinfo);
@@ -0,0 +1,636 @@
+/*-------------------------------------------------------------------------
+ *
+ * dynamodb_fetch.cpp
+ *		  Page sources and background page prefetching for dynamodb_fdw
+ *
+ * Nothing in this file may call into PostgreSQL: the prefetch worker runs
+ * outside the backend's main thread.  Errors are handed back to the consumer,
+ * which reports them from the main thread.
+ *
+ * Portions Copyright (c) 2021, TOSHIBA CORPORATION
+ *
+ * IDENTIFICATION
+ *		  contrib/dynamodb_fdw/dynamodb_fetch.cpp
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <exception>
+#include <fcntl.h>
+#include <iterator>
+#include <pthread.h>
+#include <signal.h>
+#include <system_error>
+#include <unistd.h>
+
+#include <aws/core/utils/StringUtils.h>
+
+#include "dynamodb_fetch.hpp"
+
+#define DYNAMODB_ALLOCATION_TAG "DYNAMODB_ALLOCATION_TAG"
+
+/*
+ * Keys which BatchGetItem leaves unprocessed without reading anything are
+ * sent again after an exponential backoff, at most this many times in a row.
+ */
+#define DYNAMODB_READ_MAX_RETRIES		10
+#define DYNAMODB_READ_RETRY_BASE_MS		50
+
+using namespace Aws::DynamoDB;
+
+static void dynamodb_build_projection(const Aws::Vector<Aws::String> &attr_names,
+									  Aws::String &projection,
+									  Aws::Map<Aws::String, Aws::String> &names);
+static size_t dynamodb_estimate_value_size(const Model::AttributeValue &val);
+
+DynamoDBStatementSource::DynamoDBStatementSource(DynamoDBClient *conn, const char *query,
+												 const Aws::Vector<Model::AttributeValue> &parameters,
+												 int limit, bool limit_reads)
+	: conn(conn), query(query), parameters(parameters), limit(limit),
+	  limit_reads(limit_reads), returned(0)
+{
+}
+
+bool
+DynamoDBStatementSource::fetch_page(std::shared_ptr<const DynamoDBItems> &page,
+									bool &more, Aws::String &error)
+{
+	Model::ExecuteStatementRequest req;
+	Model::ExecuteStatementOutcome outcome;
+	std::shared_ptr<Model::ExecuteStatementResult> result;
+
+	req.SetStatement(query);
+	if (!parameters.empty())
+		req.SetParameters(parameters);
+
+	/* Only set next token if it is not empty */
+	if (!next_token.empty())
+		req.SetNextToken(next_token);
+
+	/*
+	 * DynamoDB applies the Limit to the items it reads, before any filter,
+	 * so it is only sent when the key conditions alone select the items.
+	 */
+	if (limit > 0 && limit_reads)
+		req.SetLimit(limit - returned);
+
+	outcome = conn->ExecuteStatement(req);
+	if (!outcome.IsSuccess())
+	{
+		error = outcome.GetError().GetMessage();
+		return false;
+	}
+
+	result = Aws::MakeShared<Model::ExecuteStatementResult>(DYNAMODB_ALLOCATION_TAG,
+															outcome.GetResultWithOwnership());
+	next_token = result->GetNextToken();
+	returned += (int) result->GetItems().size();
+	more = !next_token.empty() && (limit == 0 || returned < limit);
+
+	/* The page shares the ownership of the whole response */
+	page = std::shared_ptr<const DynamoDBItems>(result, &result->GetItems());
+	return true;
+}
+
+/*
+ * The Scan API has no PartiQL WHERE clause, so the segment only restricts
+ * the attributes read.
+ */
+DynamoDBSegmentSource::DynamoDBSegmentSource(DynamoDBClient *conn, const char *table_name,
+											 const Aws::Vector<Aws::String> &attr_names,
+											 int segment, int total_segments)
+	: conn(conn)
+{
+	req.SetTableName(table_name);
+	req.SetSegment(segment);
+	req.SetTotalSegments(total_segments);
+
+	if (!attr_names.empty())
+	{
+		Aws::String projection;
+		Aws::Map<Aws::String, Aws::String> names;
+
+		dynamodb_build_projection(attr_names, projection, names);
+		req.SetProjectionExpression(projection);
+		req.SetExpressionAttributeNames(names);
+	}
+}
+
+bool
+DynamoDBSegmentSource::fetch_page(std::shared_ptr<const DynamoDBItems> &page,
+								  bool &more, Aws::String &error)
+{
+	Model::ScanOutcome outcome;
+	std::shared_ptr<Model::ScanResult> result;
+
+	outcome = conn->Scan(req);
+	if (!outcome.IsSuccess())
+	{
+		error = outcome.GetError().GetMessage();
+		return false;
+	}
+
+	result = Aws::MakeShared<Model::ScanResult>(DYNAMODB_ALLOCATION_TAG,
+												outcome.GetResultWithOwnership());
+
+	/* The segment is over when no LastEvaluatedKey is returned */
+	more = !result->GetLastEvaluatedKey().empty();
+	if (more)
+		req.SetExclusiveStartKey(result->GetLastEvaluatedKey());
+
+	page = std::shared_ptr<const DynamoDBItems>(result, &result->GetItems());
+	return true;
+}
+
+DynamoDBKeySource::DynamoDBKeySource(DynamoDBClient *conn, const char *table_name,
+									 const Aws::Vector<Aws::String> &attr_names,
+									 DynamoDBItems &&lookup_keys)
+	: conn(conn), table_name(table_name),
+	  keys(std::make_move_iterator(lookup_keys.begin()),
+		   std::make_move_iterator(lookup_keys.end())),
+	  throttled(0), delay_ms(DYNAMODB_READ_RETRY_BASE_MS)
+{
+	if (!attr_names.empty())
+		dynamodb_build_projection(attr_names, projection, names);
+}
+
+bool
+DynamoDBKeySource::fetch_page(std::shared_ptr<const DynamoDBItems> &page,
+							  bool &more, Aws::String &error)
+{
+	bool		ok;
+
+	if (keys.empty())
+	{
+		/* Nothing to read, e.g. all the values of an IN list were NULL */
+		page = Aws::MakeShared<DynamoDBItems>(DYNAMODB_ALLOCATION_TAG);
+		more = false;
+		return true;
+	}
+
+	if (keys.size() == 1 && throttled == 0)
+		ok = get_item(page, error);
+	else
+		ok = batch_get_item(page, error);
+
+	more = !keys.empty();
+	return ok;
+}
+
+/*
+ * get_item
+ *
+ * Read the only key with GetItem.  The page holds the item, if it exists.
+ */
+bool
+DynamoDBKeySource::get_item(std::shared_ptr<const DynamoDBItems> &page,
+							Aws::String &error)
+{
+	Model::GetItemRequest req;
+	Model::GetItemOutcome outcome;
+	Model::GetItemResult result;
+	std::shared_ptr<DynamoDBItems> items;
+
+	req.SetTableName(table_name);
+	req.SetKey(keys.front());
+	if (!projection.empty())
+	{
+		req.SetProjectionExpression(projection);
+		req.SetExpressionAttributeNames(names);
+	}
+
+	outcome = conn->GetItem(req);
+	if (!outcome.IsSuccess())
+	{
+		error = outcome.GetError().GetMessage();
+		return false;
+	}
+	keys.pop_front();
+
+	/*
+	 * The result is owned here, so its item is moved into the page rather
+	 * than copied; the SDK only has a const getter for it.
+	 */
+	result = outcome.GetResultWithOwnership();
+	items = Aws::MakeShared<DynamoDBItems>(DYNAMODB_ALLOCATION_TAG);
+	if (!result.GetItem().empty())
+		items->push_back(std::move(const_cast<DynamoDBItem &>(result.GetItem())));
+
+	page = std::move(items);
+	return true;
+}
+
+/*
+ * batch_get_item
+ *
+ * Read the next keys with one BatchGetItem request.  DynamoDB returns the
+ * items in no particular order, and may leave some keys unprocessed when
+ * the response is too large or the table is throttled: they are put back
+ * to be read by a later request.  When a request reads nothing at all, the
+ * next one is delayed.
+ */
+bool
+DynamoDBKeySource::batch_get_item(std::shared_ptr<const DynamoDBItems> &page,
+								  Aws::String &error)
+{
+	Model::BatchGetItemRequest req;
+	Model::BatchGetItemOutcome outcome;
+	std::shared_ptr<Model::BatchGetItemResult> result;
+	Model::KeysAndAttributes request_keys;
+	Aws::Vector<DynamoDBItem> batch;
+
+	if (throttled > 0)
+	{
+		if (throttled > DYNAMODB_READ_MAX_RETRIES)
+		{
+			error = "could not read " +
+				Aws::Utils::StringUtils::to_string(keys.size()) +
+				" items after " + Aws::Utils::StringUtils::to_string(throttled) +
+				" attempts, the provisioned read capacity of the table may be too low";
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+		delay_ms *= 2;
+	}
+
+	while (!keys.empty() && batch.size() < DYNAMODB_MAX_BATCH_GET_KEYS)
+	{
+		batch.push_back(std::move(keys.front()));
+		keys.pop_front();
+	}
+
+	request_keys.SetKeys(batch);
+	if (!projection.empty())
+	{
+		request_keys.SetProjectionExpression(projection);
+		request_keys.SetExpressionAttributeNames(names);
+	}
+	req.AddRequestItems(table_name, request_keys);
+
+	outcome = conn->BatchGetItem(req);
+	if (!outcome.IsSuccess())
+	{
+		error = outcome.GetError().GetMessage();
+		return false;
+	}
+
+	result = Aws::MakeShared<Model::BatchGetItemResult>(DYNAMODB_ALLOCATION_TAG,
+														outcome.GetResultWithOwnership());
+
+	const auto &responses = result->GetResponses();
+	const auto response = responses.find(table_name);
+
+	/* The page shares the ownership of the whole response */
+	if (response != responses.end())
+		page = std::shared_ptr<const DynamoDBItems>(result, &response->second);
+	else
+		page = Aws::MakeShared<DynamoDBItems>(DYNAMODB_ALLOCATION_TAG);
+
+	const auto &unprocessed = result->GetUnprocessedKeys();
+	const auto retry = unprocessed.find(table_name);
+
+	if (retry != unprocessed.end() && !retry->second.GetKeys().empty())
+	{
+		for (const auto &key : retry->second.GetKeys())
+			keys.push_back(key);
+
+		if (page->empty())
+			throttled++;
+		else
+		{
+			throttled = 0;
+			delay_ms = DYNAMODB_READ_RETRY_BASE_MS;
+		}
+	}
+	else
+	{
+		throttled = 0;
+		delay_ms = DYNAMODB_READ_RETRY_BASE_MS;
+	}
+
+	return true;
+}
+
+bool
+DynamoDBCachedSource::fetch_page(std::shared_ptr<const DynamoDBItems> &page,
+								 bool &more, Aws::String &error)
+{
+	page = this->page;
+	more = false;
+	return true;
+}
+
+DynamoDBPrefetcher::DynamoDBPrefetcher(DynamoDBPageSource *source, int depth,
+									   size_t memory_limit)
+	: source(source), depth(depth), memory_limit(memory_limit),
+	  buffered_bytes(0), finished(false), failed(false), cancelled(false),
+	  final_consumed(false)
+{
+	notify_fds[0] = -1;
+	notify_fds[1] = -1;
+}
+
+/*
+ * Stop the worker.  A request which is already in flight is waited for,
+ * so that the worker never outlives the connection it uses.
+ */
+DynamoDBPrefetcher::~DynamoDBPrefetcher()
+{
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+
+		cancelled = true;
+	}
+	not_full.notify_all();
+
+	if (worker.joinable())
+		worker.join();
+
+	if (notify_fds[0] >= 0)
+		close(notify_fds[0]);
+	if (notify_fds[1] >= 0)
+		close(notify_fds[1]);
+}
+
+/*
+ * Launch the worker thread.  May throw std::system_error.
+ */
+void
+DynamoDBPrefetcher::start()
+{
+	if (pipe(notify_fds) != 0)
+		throw std::system_error(errno, std::generic_category(), "could not create pipe");
+
+	/* Neither end may ever block; the pipe holds far fewer bytes than its capacity */
+	for (int i = 0; i < 2; i++)
+	{
+		if (fcntl(notify_fds[i], F_SETFL, O_NONBLOCK) == -1 ||
+			fcntl(notify_fds[i], F_SETFD, FD_CLOEXEC) == -1)
+			throw std::system_error(errno, std::generic_category(), "could not set up pipe");
+	}
+
+	worker = std::thread(&DynamoDBPrefetcher::worker_main, this);
+}
+
+/*
+ * notify / consume_notification
+ *
+ * Keep the pipe readable exactly while a page or the final status is
+ * waiting to be returned.  Both are called with the mutex held.
+ */
+void
+DynamoDBPrefetcher::notify()
+{
+	char		c = 0;
+	ssize_t		rc;
+
+	do
+		rc = write(notify_fds[1], &c, 1);
+	while (rc < 0 && errno == EINTR);
+}
+
+void
+DynamoDBPrefetcher::consume_notification()
+{
+	char		c;
+	ssize_t		rc;
+
+	do
+		rc = read(notify_fds[0], &c, 1);
+	while (rc < 0 && errno == EINTR);
+}
+
+/*
+ * wait_page
+ *
+ * Wait up to timeout_ms for the next page.  Pages fetched before a failure
+ * are still returned before the error is.
+ */
+DynamoDBPrefetchStatus
+DynamoDBPrefetcher::wait_page(std::shared_ptr<const DynamoDBItems> &page,
+							  Aws::String &message, long timeout_ms)
+{
+	std::unique_lock<std::mutex> guard(mutex);
+
+	if (!not_empty.wait_for(guard, std::chrono::milliseconds(timeout_ms),
+							[this] { return !pages.empty() || finished; }))
+		return DYNAMODB_PREFETCH_PENDING;
+
+	if (!pages.empty())
+	{
+		page = std::move(pages.front());
+		pages.pop_front();
+		buffered_bytes -= page_sizes.front();
+		page_sizes.pop_front();
+		consume_notification();
+
+		guard.unlock();
+		not_full.notify_one();
+		return DYNAMODB_PREFETCH_PAGE;
+	}
+
+	if (!final_consumed)
+	{
+		consume_notification();
+		final_consumed = true;
+	}
+
+	if (failed)
+	{
+		message = error;
+		return DYNAMODB_PREFETCH_ERROR;
+	}
+
+	return DYNAMODB_PREFETCH_DONE;
+}
+
+void
+DynamoDBPrefetcher::worker_main()
+{
+	sigset_t	sigs;
+
+	/* Signals must only be handled by the backend's main thread. */
+	sigfillset(&sigs);
+	pthread_sigmask(SIG_BLOCK, &sigs, NULL);
+
+	for (;;)
+	{
+		std::shared_ptr<const DynamoDBItems> page;
+		Aws::String message;
+		size_t		page_size = 0;
+		bool		ok;
+		bool		more = false;
+
+		/* Wait until the queue has room for one more page. */
+		{
+			std::unique_lock<std::mutex> guard(mutex);
+
+			not_full.wait(guard, [this] {
+				return cancelled ||
+					(pages.size() < depth && buffered_bytes < memory_limit);
+			});
+			if (cancelled)
+				return;
+		}
+
+		/*
+		 * An exception must not escape the thread, which would terminate the
+		 * whole backend: it fails the fetch like a failed request does.
+		 */
+		try
+		{
+			ok = source->fetch_page(page, more, message);
+			if (ok)
+				page_size = dynamodb_estimate_page_size(*page);
+		}
+		catch (const std::exception &e)
+		{
+			ok = false;
+			message = e.what();
+		}
+		catch (...)
+		{
+			ok = false;
+			message = "unexpected exception while fetching a page";
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+
+			if (ok)
+			{
+				try
+				{
+					pages.push_back(std::move(page));
+					page_sizes.push_back(page_size);
+					buffered_bytes += page_size;
+
+					notify();
+
+					if (!more)
+						finished = true;
+				}
+				catch (const std::exception &e)
+				{
+					ok = false;
+					message = e.what();
+				}
+				catch (...)
+				{
+					ok = false;
+					message = "unexpected exception while fetching a page";
+				}
+			}
+
+			if (!ok)
+			{
+				/* Drop a page whose size could not be queued with it */
+				if (pages.size() > page_sizes.size())
+					pages.pop_back();
+
+				error = message;
+				failed = true;
+				finished = true;
+			}
+
+			if (finished)
+				notify();
+		}
+		not_empty.notify_one();
+
+		if (finished)
+			return;
+	}
+}
+
+/*
+ * dynamodb_estimate_page_size
+ *
+ * Rough number of bytes held by the items of a page.  It is only used to
+ * bound the amount of memory kept in the prefetch queue and in the lookup
+ * memo.
+ */
+size_t
+dynamodb_estimate_page_size(const DynamoDBItems &page)
+{
+	size_t		size = 0;
+
+	for (const auto &item : page)
+		for (const auto &column : item)
+			size += column.first.size() + dynamodb_estimate_value_size(column.second);
+
+	return size;
+}
+
+/*
+ * dynamodb_estimate_value_size
+ *
+ * Rough number of bytes held by an attribute value.
+ */
+static size_t
+dynamodb_estimate_value_size(const Model::AttributeValue &val)
+{
+	size_t		size = sizeof(Model::AttributeValue);
+
+	switch (val.GetType())
+	{
+		case Model::ValueType::STRING:
+			size += val.GetS().size();
+			break;
+		case Model::ValueType::NUMBER:
+			size += val.GetN().size();
+			break;
+		case Model::ValueType::BYTEBUFFER:
+			size += val.GetB().GetLength();
+			break;
+		case Model::ValueType::STRING_SET:
+			for (const auto &item : val.GetSS())
+				size += item.size();
+			break;
+		case Model::ValueType::NUMBER_SET:
+			for (const auto &item : val.GetNS())
+				size += item.size();
+			break;
+		case Model::ValueType::BYTEBUFFER_SET:
+			for (const auto &item : val.GetBS())
+				size += item.GetLength();
+			break;
+		case Model::ValueType::ATTRIBUTE_MAP:
+			for (const auto &item : val.GetM())
+				size += item.first.size() + dynamodb_estimate_value_size(*item.second);
+			break;
+		case Model::ValueType::ATTRIBUTE_LIST:
+			for (const auto &item : val.GetL())
+				size += dynamodb_estimate_value_size(*item);
+			break;
+		default:
+			break;
+	}
+
+	return size;
+}
+
+/*
+ * dynamodb_build_projection
+ *
+ * Build a projection expression reading the given attributes.  Attribute
+ * names go through placeholders, as they may be reserved words or contain
+ * dots.
+ */
+static void
+dynamodb_build_projection(const Aws::Vector<Aws::String> &attr_names,
+						  Aws::String &projection,
+						  Aws::Map<Aws::String, Aws::String> &names)
+{
+	for (size_t i = 0; i < attr_names.size(); i++)
+	{
+		Aws::String placeholder = "#a" + Aws::Utils::StringUtils::to_string(i);
+
+		if (i > 0)
+			projection += ", ";
+		projection += placeholder;
+		names[placeholder] = attr_names[i];
+	}
+}
@@ -0,0 +1,216 @@
+/*-------------------------------------------------------------------------
+ *
+ * dynamodb_fetch.hpp
+ *		  Page sources and background page prefetching for dynamodb_fdw
+ *
+ * Portions Copyright (c) 2021, TOSHIBA CORPORATION
+ *
+ * IDENTIFICATION
+ *		  contrib/dynamodb_fdw/dynamodb_fetch.hpp
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __DYNAMODB_FETCH_HPP__
+#define __DYNAMODB_FETCH_HPP__
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <aws/core/Aws.h>
+#include <aws/dynamodb/DynamoDBClient.h>
+#include <aws/dynamodb/model/BatchGetItemRequest.h>
+#include <aws/dynamodb/model/ExecuteStatementRequest.h>
+#include <aws/dynamodb/model/GetItemRequest.h>
+#include <aws/dynamodb/model/ScanRequest.h>
+
+/* An item, and a page of items, as returned by DynamoDB */
+typedef Aws::Map<Aws::String, Aws::DynamoDB::Model::AttributeValue> DynamoDBItem;
+typedef Aws::Vector<DynamoDBItem> DynamoDBItems;
+
+/* Maximum number of keys in a BatchGetItem request */
+#define DYNAMODB_MAX_BATCH_GET_KEYS	100
+
+/*
+ * DynamoDBPageSource
+ *
+ * A remote read which returns its items one page at a time.  The pages
+ * keep the response they come from alive, so they can be handed over
+ * without copying the items.
+ *
+ * Sources only use AWS SDK objects, so that they can be driven by the
+ * prefetch worker thread as well as by the backend.
+ */
+class DynamoDBPageSource
+{
+public:
+	virtual ~DynamoDBPageSource() {}
+
+	/*
+	 * Send the request for the next page.  On success, "page" is set and
+	 * "more" tells whether another page follows.  On failure, false is
+	 * returned and "error" is set.
+	 */
+	virtual bool fetch_page(std::shared_ptr<const DynamoDBItems> &page,
+							bool &more, Aws::String &error) = 0;
+};
+
+/*
+ * Pages of a PartiQL statement, following the NextToken chain.  The
+ * parameters, if any, are bound to the statement's placeholders in order.
+ *
+ * With a limit, no more pages are requested once that many items have been
+ * returned.  If limit_reads, i.e. the statement has no filter besides its key
+ * conditions, each request also asks DynamoDB to read no more items than are
+ * still missing; with a filter DynamoDB would apply that Limit before it, and
+ * return many nearly empty pages.
+ */
+class DynamoDBStatementSource : public DynamoDBPageSource
+{
+public:
+	DynamoDBStatementSource(Aws::DynamoDB::DynamoDBClient *conn, const char *query,
+							const Aws::Vector<Aws::DynamoDB::Model::AttributeValue> &parameters,
+							int limit, bool limit_reads);
+
+	bool		fetch_page(std::shared_ptr<const DynamoDBItems> &page,
+						   bool &more, Aws::String &error) override;
+
+private:
+	Aws::DynamoDB::DynamoDBClient *conn;
+	Aws::String query;
+	Aws::Vector<Aws::DynamoDB::Model::AttributeValue> parameters;
+	Aws::String next_token;
+	int			limit;			/* items to return at most, 0 for all */
+	bool		limit_reads;	/* send the limit as the Limit of requests? */
+	int			returned;		/* items returned so far */
+};
+
+/* Pages of one segment of a parallel Scan, following LastEvaluatedKey */
+class DynamoDBSegmentSource : public DynamoDBPageSource
+{
+public:
+	DynamoDBSegmentSource(Aws::DynamoDB::DynamoDBClient *conn, const char *table_name,
+						  const Aws::Vector<Aws::String> &attr_names,
+						  int segment, int total_segments);
+
+	bool		fetch_page(std::shared_ptr<const DynamoDBItems> &page,
+						   bool &more, Aws::String &error) override;
+
+private:
+	Aws::DynamoDB::DynamoDBClient *conn;
+	Aws::DynamoDB::Model::ScanRequest req;
+};
+
+/*
+ * Items read by primary key: a single key is read with GetItem, several
+ * keys with BatchGetItem requests of up to DYNAMODB_MAX_BATCH_GET_KEYS keys.
+ * Each key is an item holding only the key attributes.  The keys which
+ * DynamoDB leaves unprocessed are sent again with a later request.
+ */
+class DynamoDBKeySource : public DynamoDBPageSource
+{
+public:
+	DynamoDBKeySource(Aws::DynamoDB::DynamoDBClient *conn, const char *table_name,
+					  const Aws::Vector<Aws::String> &attr_names,
+					  DynamoDBItems &&lookup_keys);
+
+	bool		fetch_page(std::shared_ptr<const DynamoDBItems> &page,
+						   bool &more, Aws::String &error) override;
+
+private:
+	bool		get_item(std::shared_ptr<const DynamoDBItems> &page,
+						 Aws::String &error);
+	bool		batch_get_item(std::shared_ptr<const DynamoDBItems> &page,
+							   Aws::String &error);
+
+	Aws::DynamoDB::DynamoDBClient *conn;
+	Aws::String table_name;
+	Aws::String projection;		/* empty to read whole items */
+	Aws::Map<Aws::String, Aws::String> names;	/* placeholders of the
+												 * projection */
+	std::deque<DynamoDBItem> keys;	/* keys not read yet */
+	int			throttled;		/* consecutive requests which read nothing
+								 * but left keys unprocessed */
+	long		delay_ms;		/* backoff before the next such request */
+};
+
+/* A page which has already been read, returned once more */
+class DynamoDBCachedSource : public DynamoDBPageSource
+{
+public:
+	DynamoDBCachedSource(std::shared_ptr<const DynamoDBItems> page) : page(std::move(page)) {}
+
+	bool		fetch_page(std::shared_ptr<const DynamoDBItems> &page,
+						   bool &more, Aws::String &error) override;
+
+private:
+	std::shared_ptr<const DynamoDBItems> page;
+};
+
+extern size_t dynamodb_estimate_page_size(const DynamoDBItems &page);
+
+/* Result of waiting for a prefetched page */
+typedef enum DynamoDBPrefetchStatus
+{
+	DYNAMODB_PREFETCH_PAGE,			/* a page has been returned */
+	DYNAMODB_PREFETCH_PENDING,		/* timed out, no page available yet */
+	DYNAMODB_PREFETCH_DONE,			/* all pages have been returned */
+	DYNAMODB_PREFETCH_ERROR			/* the remote request failed */
+} DynamoDBPrefetchStatus;
+
+/*
+ * DynamoDBPrefetcher
+ *
+ * Fetch the pages of a source in a worker thread, so that the request for
+ * page N+1 is in flight while the backend converts the items of page N.
+ *
+ * At most "depth" pages, and at most about "memory_limit" bytes of item
+ * data, are kept in the queue.  The worker thread only touches AWS SDK
+ * objects; it must never call into the backend (palloc, elog, ...).  The
+ * source must outlive the prefetcher.
+ *
+ * The read end of a pipe, wait_fd(), becomes readable whenever wait_page()
+ * would not block, so that the backend can wait for a page in a
+ * WaitEventSet together with other events.
+ */
+class DynamoDBPrefetcher
+{
+public:
+	DynamoDBPrefetcher(DynamoDBPageSource *source, int depth, size_t memory_limit);
+	~DynamoDBPrefetcher();
+
+	void		start();
+	DynamoDBPrefetchStatus wait_page(std::shared_ptr<const DynamoDBItems> &page,
+									 Aws::String &message, long timeout_ms);
+	int			wait_fd() const { return notify_fds[0]; }
+
+private:
+	void		worker_main();
+	void		notify();
+	void		consume_notification();
+
+	DynamoDBPageSource *source;
+	size_t		depth;
+	size_t		memory_limit;
+
+	std::mutex	mutex;
+	std::condition_variable not_full;	/* signalled when a page is consumed */
+	std::condition_variable not_empty;	/* signalled when a page is queued */
+	std::deque<std::shared_ptr<const DynamoDBItems>> pages;
+	std::deque<size_t> page_sizes;		/* estimated size of each queued page */
+	size_t		buffered_bytes;
+	bool		finished;				/* no more requests will be sent */
+	bool		failed;					/* the last request failed */
+	bool		cancelled;				/* the consumer has gone away */
+	bool		final_consumed;			/* DONE or ERROR has been returned */
+	Aws::String error;
+
+	/* one byte per queued page, plus one once finished */
+	int			notify_fds[2];
+
+	std::thread	worker;
+};
+
+#endif /* __DYNAMODB_FETCH_HPP__ */
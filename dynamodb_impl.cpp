@@ -11,24 +11,42 @@
  *-------------------------------------------------------------------------
  */
 
+#include "dynamodb_fetch.hpp"
 #include "dynamodb_fdw.hpp"
 #include "dynamodb_query.hpp"
+#include "dynamodb_write.hpp"
 #include <aws/core/Aws.h>
+#include <aws/core/utils/json/JsonSerializer.h>
 #include <aws/dynamodb/DynamoDBClient.h>
 #include <aws/dynamodb/model/AttributeValue.h>
+#include <aws/dynamodb/DynamoDBErrors.h>
+#include <aws/dynamodb/model/DescribeTableRequest.h>
 #include <aws/dynamodb/model/ExecuteStatementRequest.h>
+#include <aws/dynamodb/model/QueryRequest.h>
+#include <aws/dynamodb/model/ScanRequest.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 extern "C"
 {
 #include "postgres.h"
 
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "access/sysattr.h"
 #include "access/table.h"
+#include "catalog/pg_aggregate.h"
 #include "catalog/pg_class.h"
+#include "catalog/pg_collation.h"
 #include "commands/defrem.h"
 #include "commands/explain.h"
 #include "commands/vacuum.h"
+#include "common/hashfn.h"
+#include "common/int.h"
+#if PG_VERSION_NUM >= 140000
+#include "executor/execAsync.h"
+#endif
 #include "foreign/fdwapi.h"
 #include "funcapi.h"
 #include "miscadmin.h"
@@ -49,10 +67,14 @@ extern "C"
 #include "optimizer/restrictinfo.h"
 #include "optimizer/tlist.h"
 #include "parser/parsetree.h"
+#include "port/atomics.h"
+#include "storage/latch.h"
 #if PG_VERSION_NUM >= 160000
 #include "parser/parse_relation.h"
 #endif
+#include "utils/array.h"
 #include "utils/builtins.h"
+#include "utils/datum.h"
 #include "utils/float.h"
 #include "utils/guc.h"
 #include "utils/lsyscache.h"
@@ -61,6 +83,8 @@ extern "C"
 #include "utils/sampling.h"
 #include "utils/selfuncs.h"
 #include "utils/syscache.h"
+#include "utils/timestamp.h"
+#include "utils/typcache.h"
 #include "nodes/print.h"
 }
 
@@ -81,6 +105,41 @@ using namespace Aws::DynamoDB;
 
 #define DYNAMODB_ALLOCATION_TAG "DYNAMODB_ALLOCATION_TAG"
 
+/* How long to wait for a prefetched page before checking for interrupts */
+#define DYNAMODB_PREFETCH_WAIT_MS	100
+
+/*
+ * Number of Scan segments per participant of a parallel scan.  Having more
+ * segments than participants lets the faster ones take over more segments.
+ */
+#define DYNAMODB_SEGMENTS_PER_WORKER	4
+
+/* Bytes of items kept by the lookup memo of a parameterized scan */
+#define DYNAMODB_LOOKUP_MEMO_LIMIT	(8 * 1024 * 1024)
+
+/* Number of BatchExecuteStatement requests of an insert in flight at once */
+#define DYNAMODB_WRITE_BATCHES_IN_FLIGHT	4
+
+/* How long to wait for the batch writer before checking for interrupts */
+#define DYNAMODB_WRITE_WAIT_MS	100
+
+/*
+ * Number of Scan segments that ANALYZE reads at once.  The table is split
+ * into segments of about targrows / DYNAMODB_ANALYZE_SEGMENTS_IN_FLIGHT
+ * items, so that the sample is usually complete after the first round.
+ */
+#define DYNAMODB_ANALYZE_SEGMENTS_IN_FLIGHT	4
+
+/*
+ * Fewest segments that ANALYZE splits a table into.  DynamoDB refreshes the
+ * item count about every six hours, so it may be zero or far too small, and
+ * the sample must then still stop before the whole table is read.
+ */
+#define DYNAMODB_ANALYZE_MIN_SEGMENTS	64
+
+/* Largest number of segments that a Scan accepts */
+#define DYNAMODB_MAX_TOTAL_SEGMENTS	1000000
+
 /*
  * Indexes of FDW-private information stored in fdw_private lists.
  *
@@ -94,6 +153,44 @@ enum FdwScanPrivateIndex
 	FdwScanPrivateSelectSql,
 	/* Integer list of attribute numbers retrieved by the SELECT */
 	FdwScanPrivateRetrievedAttrs,
+	/* Remote table name (as a String node) */
+	FdwScanPrivateTableName,
+	/* Number of Scan segments of a parallel scan, 0 if not parallel */
+	FdwScanPrivateTotalSegments,
+	/* Key values to read with GetItem/BatchGetItem, NIL to run the query */
+	FdwScanPrivateLookupKeys,
+	/* Number of rows the query needs at most (as an Integer), 0 for all */
+	FdwScanPrivateLimit,
+	/*
+	 * 1 if DynamoDB may be asked to read no more items than the limit, i.e.
+	 * the query has no filter besides its key conditions, else 0 (as an
+	 * Integer)
+	 */
+	FdwScanPrivateLimitReads,
+	/*
+	 * Key condition (as a String node, empty for a Scan), filter (as a
+	 * String node) and String list of attribute names of a request counting
+	 * the items, NIL for a scan returning rows
+	 */
+	FdwScanPrivateCount,
+	/*
+	 * For a scan computing aggregates, the number of the GROUP BY column of
+	 * the table (as an Integer, 0 for no GROUP BY), then a list describing
+	 * each column of the scan tuple as an Integer list of its DynamoDBAggKind
+	 * and of the column of the table it is computed from (0 for count(*));
+	 * NIL for a scan returning rows
+	 */
+	FdwScanPrivateAggregates,
+};
+
+/*
+ * This enum describes what's kept in the fdw_private list of a ForeignPath
+ * of a base relation.  The list is NIL for a path which reads the table.
+ */
+enum FdwPathPrivateIndex
+{
+	/* Name of the secondary index to read (as a String node) */
+	FdwPathPrivateSecondaryIndex,
 };
 
 /*
@@ -118,6 +215,21 @@ enum FdwModifyPrivateIndex
 	FdwModifyPrivateRetrievedAttrs,
 };
 
+/*
+ * Similarly, this enum describes what's kept in the fdw_private list for
+ * a ForeignScan node that modifies a foreign table directly.  We store:
+ *
+ * 1) UPDATE/DELETE statement text to be sent to the remote server
+ * 2) Boolean flag showing if we set the command es_processed
+ */
+enum FdwDirectModifyPrivateIndex
+{
+	/* SQL statement to execute remotely (as a String node) */
+	FdwDirectModifyPrivateUpdateSql,
+	/* set-processed flag (as a Boolean node) */
+	FdwDirectModifyPrivateSetProcessed,
+};
+
 /* Struct for extra information passed to estimate_path_cost_size() */
 typedef struct
 {
@@ -127,6 +239,140 @@ typedef struct
 	int64		offset_est;
 } DynamoDBFdwPathExtraData;
 
+/*
+ * Hash of an attribute name, using the same function as dynahash.
+ */
+struct DynamoDBAttrNameHash
+{
+	size_t operator()(const Aws::String &name) const
+	{
+		return hash_bytes((const unsigned char *) name.data(), (int) name.size());
+	}
+};
+
+/*
+ * Map from the name of an attribute returned by DynamoDB to the (0-based)
+ * numbers of the tuple columns which take its value.  It is built once per
+ * scan from retrieved_attrs, so that each attribute of an item is routed to
+ * its column with a single lookup.
+ */
+typedef std::unordered_multimap<Aws::String, int, DynamoDBAttrNameHash> DynamoDBAttrMap;
+
+/*
+ * Pages read by the single-key lookups of a parameterized scan, by key.  A
+ * nested loop looks up the same key again for every outer row which gives
+ * it; the item, or its absence, is then only read once per scan.  Pages are
+ * kept until about DYNAMODB_LOOKUP_MEMO_LIMIT bytes of items are held.
+ */
+typedef struct DynamoDBLookupMemo
+{
+	std::unordered_map<Aws::String, std::shared_ptr<const DynamoDBItems>,
+					   DynamoDBAttrNameHash> pages;
+	size_t		memory_used = 0;
+	Aws::String pending_key;	/* key of the lookup being read, empty if its
+								 * page is not to be kept */
+} DynamoDBLookupMemo;
+
+/*
+ * How a column of the scan tuple of an aggregating scan is computed from the
+ * items read.
+ */
+typedef enum DynamoDBAggKind
+{
+	DYNAMODB_AGG_GROUP_KEY,		/* value of the GROUP BY column */
+	DYNAMODB_AGG_COUNT,
+	DYNAMODB_AGG_SUM,
+	DYNAMODB_AGG_AVG,
+	DYNAMODB_AGG_MIN,
+	DYNAMODB_AGG_MAX
+} DynamoDBAggKind;
+
+/* A column of the scan tuple of an aggregating scan */
+typedef struct DynamoDBAggColumn
+{
+	DynamoDBAggKind kind;
+	int			attnum;			/* (0-based) column of the table, -1 for
+								 * count(*) */
+	Oid			input_type;		/* type of the column of the table */
+	Oid			collation;		/* collation of min() and max() */
+	FmgrInfo   *cmp_proc;		/* comparison function of min() and max() */
+	int16		typlen;			/* of the result */
+	bool		typbyval;
+} DynamoDBAggColumn;
+
+/*
+ * Transition value of an aggregate for one group.  Integers are summed in
+ * int_sum until it would overflow, then carried over to the numeric sum held
+ * in value.  value also holds the sum of numeric inputs, and the current
+ * result of min() and max().
+ */
+typedef struct DynamoDBAggValue
+{
+	int64		count;			/* number of non-null inputs */
+	int64		int_sum;
+	double		float_sum;
+	Datum		value;
+	bool		has_value;		/* is value set? */
+} DynamoDBAggValue;
+
+/* A group of items, and the transition values of its aggregates */
+typedef struct DynamoDBAggGroup
+{
+	Datum		key;			/* value of the GROUP BY column */
+	bool		key_isnull;
+	DynamoDBAggValue *values;	/* by column of the scan tuple */
+} DynamoDBAggGroup;
+
+/*
+ * Execution state of an aggregating scan.  The groups are kept in the order
+ * they are found, and found again by the hash of their key.
+ */
+typedef struct DynamoDBAggState
+{
+	int			ncolumns;
+	DynamoDBAggColumn *columns;	/* columns of the scan tuple */
+	int			group_attnum;	/* (0-based) GROUP BY column of the table, -1
+								 * if there is a single group */
+	Oid			group_collation;
+	FmgrInfo   *group_hash_proc;
+	FmgrInfo   *group_eq_proc;
+	int16		group_typlen;
+	bool		group_typbyval;
+	int			natts;			/* number of columns of the table */
+	bool	   *needed;			/* columns of the table to decode */
+	Datum	   *values;			/* decoded columns of the current item */
+	bool	   *nulls;
+	std::vector<DynamoDBAggGroup> groups;
+	std::unordered_multimap<uint32, size_t> groups_by_hash;
+	size_t		next_group;		/* next group to return */
+	bool		done;			/* have all the items been aggregated? */
+	MemoryContext agg_cxt;		/* holds the groups and their values */
+} DynamoDBAggState;
+
+/*
+ * Result of DescribeTable for a foreign table, cached by the backend.  The
+ * strings and the index array are allocated in CacheMemoryContext.
+ */
+typedef struct DynamoDBStatsCacheEntry
+{
+	Oid			relid;			/* hash key (must be first) */
+	char	   *table_name;		/* remote table described, NULL if the entry
+								 * is not valid */
+	TimestampTz fetched_at;		/* when DescribeTable was called */
+	DynamoDBTableStats stats;
+} DynamoDBStatsCacheEntry;
+
+static HTAB *DynamoDBStatsCache = NULL;
+
+/*
+ * Shared memory state of a parallel scan.  The participants claim the Scan
+ * segments one by one until all of them have been read.
+ */
+typedef struct DynamoDBParallelScanState
+{
+	pg_atomic_uint32 next_segment;	/* next segment to be claimed */
+} DynamoDBParallelScanState;
+
 /*
  * Execution state of a foreign scan using dynamodb_fdw.
  */
@@ -139,28 +385,64 @@ typedef struct DynamoDBFdwScanState
 	/* extracted fdw_private data */
 	char	   *query;			/* text of SELECT command */
 	List	   *retrieved_attrs;	/* list of retrieved attribute numbers */
+	char	   *table_name;		/* remote table name */
+	int			total_segments;	/* number of Scan segments, 0 to run the
+								 * query as a single PartiQL statement */
+	List	   *lookup_keys;	/* key values to read by key, NIL to run the
+								 * query */
+	int			limit;			/* rows the query needs at most, 0 for all */
+	bool		limit_reads;	/* may DynamoDB read no more items than that? */
+	List	   *count_request;	/* request counting the items, NIL to return
+								 * rows */
+	bool		count_done;		/* has the count been returned? */
+	DynamoDBAggState *agg;		/* aggregates computed by the scan, NULL to
+								 * return rows */
+	DynamoDBAttrMap *attr_map;	/* retrieved attributes by name */
+	DynamoDBColumnConverter *converters;	/* conversion of the retrieved
+											 * columns, by column number */
 
 	/* for remote query execution */
 	Aws::DynamoDB::DynamoDBClient	   *conn;			/* connection for the scan */
 	bool		cursor_exists;	/* have we created the cursor? */
-
-	/* for storing result tuples */
-	HeapTuple		tuples;			/* array of currently-retrieved tuples */
+	bool		async_capable;	/* run by an async-aware Append? */
+	List	   *param_exprs;	/* executable expressions for param values */
+	List	   *param_types;	/* type OIDs of param values */
+	/* param values of the current scan, bound in the order of param_exprs */
+	Aws::Vector<Aws::DynamoDB::Model::AttributeValue> *param_values;
+	bool		recheck_remote_conds;	/* must the rows be checked against
+										 * the remote conditions locally? */
+	DynamoDBLookupMemo *memo;	/* pages read by key, NULL unless the keys
+								 * are given by parameters */
 
 	/* batch-level state, for optimizing rewinds and avoiding useless fetch */
 	bool		eof_reached;	/* true if last fetch reached EOF */
 
 	/* working memory contexts */
-	MemoryContext batch_cxt;	/* context holding current batch of tuples */
+	MemoryContext batch_cxt;	/* context holding the column values of the
+								 * rows of the current page */
 	MemoryContext temp_cxt;		/* context for per-tuple temporary data */
 
 	/* fetch more data */
-	char	   	   *next_token;			/* next token for next request to retrieve more data */
 	bool			next_fetch_ready;	/* true if DynamoDB FDW ready for next fetch */
 	unsigned int	row_index;			/* the index of current processing item in the result set */
-	bool			first_fetch;		/* true if the first time data is fetched */
 	unsigned int	num_rows;			/* number of rows in data set */
-	std::shared_ptr<Aws::DynamoDB::Model::ExecuteStatementResult> result;	/* contains the result of query */
+	std::shared_ptr<const DynamoDBItems> items;	/* items of the current page */
+
+	/* remote read in progress */
+	DynamoDBPageSource *source;		/* NULL if no source is open */
+	bool		source_done;		/* true if the source has no more page */
+	bool		scan_done;			/* true if no more source will be opened */
+	MemoryContextCallback release_cb;	/* frees C++ objects on abort */
+
+	/* parallel scan */
+	DynamoDBParallelScanState *pstate;	/* shared state, NULL if the scan
+										 * is not run by a Gather */
+	uint32		local_next_segment;	/* next segment to read without pstate */
+
+	/* asynchronous prefetch of the next pages */
+	int			prefetch_depth;		/* max number of pages fetched ahead */
+	size_t		prefetch_memory_limit;	/* max bytes of prefetched pages */
+	DynamoDBPrefetcher *prefetcher;	/* NULL if prefetch is disabled */
 } DynamoDBFdwScanState;
 
 /*
@@ -179,6 +461,16 @@ typedef struct DynamoDBFdwModifyState
 	List	   *target_attrs;	/* list of target attribute numbers */
 	bool		has_returning;	/* is there a RETURNING clause? */
 	List	   *retrieved_attrs;	/* attr numbers retrieved by RETURNING */
+	int			batch_size;		/* value of FDW option "batch_size" */
+	DynamoDBBatchWriter *writer;	/* sends batched rows, NULL until the
+									 * first one */
+	bool		defer_writes;	/* are single rows batched too, until the end
+								 * of the insert? */
+	DynamoDBAttrMap *attr_map;	/* attributes retrieved by RETURNING, by
+								 * name */
+	DynamoDBColumnConverter *converters;	/* conversion of the retrieved
+											 * columns, by column number */
+	MemoryContextCallback release_cb;	/* frees C++ objects on abort */
 
 	/* working memory context */
 	MemoryContext temp_cxt;		/* context for per-tuple temporary data */
@@ -189,6 +481,60 @@ typedef struct DynamoDBFdwModifyState
 	AttrNumber *junk_idx;		/* indexes of key columns */
 } DynamoDBFdwModifyState;
 
+/*
+ * Execution state of a foreign scan that modifies a foreign table directly.
+ */
+typedef struct DynamoDBFdwDirectModifyState
+{
+	Relation	rel;			/* relcache entry for the foreign table */
+
+	/* extracted fdw_private data */
+	char	   *query;			/* text of UPDATE/DELETE command */
+	bool		set_processed;	/* do we set the command es_processed? */
+
+	/* for remote query execution */
+	Aws::DynamoDB::DynamoDBClient *conn;	/* connection for the update */
+	List	   *param_exprs;	/* executable expressions for param values */
+	List	   *param_types;	/* type OIDs of param values */
+
+	/* for storing result tuples */
+	int			num_tuples;		/* # of result tuples, -1 until the statement
+								 * is executed */
+
+	/* working memory context */
+	MemoryContext temp_cxt;		/* context for per-tuple temporary data */
+} DynamoDBFdwDirectModifyState;
+
+
+/*
+ * Work state for dynamodbAcquireSampleRowsFunc.
+ */
+typedef struct DynamoDBAnalyzeState
+{
+	Relation	rel;			/* relcache entry for the foreign table */
+	DynamoDBAttrMap *attr_map;	/* columns of the sample rows, by attribute
+								 * name */
+	DynamoDBColumnConverter *converters;	/* conversion of the columns */
+
+	/* segments being read, slot i holding the i-th one modulo the array size */
+	DynamoDBPageSource *sources[DYNAMODB_ANALYZE_SEGMENTS_IN_FLIGHT];
+	DynamoDBPrefetcher *prefetchers[DYNAMODB_ANALYZE_SEGMENTS_IN_FLIGHT];
+	MemoryContextCallback release_cb;	/* frees C++ objects on abort */
+
+	/* collected sample rows */
+	HeapTuple  *rows;			/* array of size targrows */
+	int			targrows;		/* target # of sample rows */
+	int			numrows;		/* # of sample rows collected */
+
+	/* for random sampling */
+	double		samplerows;		/* # of items read */
+	double		rowstoskip;		/* # of items to skip before next sample */
+	ReservoirStateData rstate;	/* state for reservoir sampling */
+
+	/* working memory contexts */
+	MemoryContext anl_cxt;		/* context for per-analyze lifespan data */
+	MemoryContext temp_cxt;		/* context for per-tuple temporary data */
+} DynamoDBAnalyzeState;
 
 /*
  * Helper functions
@@ -200,7 +546,85 @@ static void dynamodb_estimate_path_cost_size(PlannerInfo *root,
 									DynamoDBFdwPathExtraData *fpextra,
 									double *p_rows, int *p_width,
 									Cost *p_startup_cost, Cost *p_total_cost);
+static DynamoDBTableStats *dynamodb_get_remote_stats(Oid foreigntableid, UserMapping *user,
+													 int ttl);
+static void dynamodb_describe_table(DynamoDBStatsCacheEntry *entry, UserMapping *user,
+									const char *table_name);
+static DynamoDBIndexStats *dynamodb_find_index_stats(DynamoDBTableStats *stats,
+													 const char *index_name);
+static void dynamodb_add_parameterized_paths(PlannerInfo *root, RelOptInfo *baserel,
+											 Oid foreigntableid);
+static void dynamodb_add_index_paths(PlannerInfo *root, RelOptInfo *baserel,
+									 Oid foreigntableid);
+static bool dynamodb_conds_give_key(Oid foreigntableid, Index relid, List *conds,
+									const char *key, bool allow_in);
+static void dynamodb_add_sorted_paths(PlannerInfo *root, RelOptInfo *baserel,
+									  Oid foreigntableid);
+static bool dynamodb_index_covers_attrs(Oid foreigntableid, DynamoDBIndex *index,
+										dynamodb_opt *options, Bitmapset *attrs);
+static bool dynamodb_ec_member_is_column(PlannerInfo *root, RelOptInfo *rel,
+										 EquivalenceClass *ec, EquivalenceMember *em,
+										 void *arg);
+static AttrNumber dynamodb_join_clause_key_attno(Index relid, Expr *clause);
+static List *dynamodb_get_lookup_keys(Oid foreigntableid, Index relid, List *conds,
+									  List *params_list,
+									  const char *partition_key, const char *sort_key);
+static bool dynamodb_key_cond_values(Expr *expr, Index relid, List *params_list,
+									 Var **var, List **values);
+static bool dynamodb_is_key_type(Oid type);
+static Node *dynamodb_key_param(Node *expr, List *params_list);
+static DynamoDBItems dynamodb_build_lookup_keys(List *lookup_keys,
+												const Aws::Vector<Aws::DynamoDB::Model::AttributeValue> &params,
+												const char *query);
+static void dynamodb_bind_key_values(List *values,
+									 const Aws::Vector<Aws::DynamoDB::Model::AttributeValue> &params,
+									 const char *query,
+									 Aws::Vector<Aws::DynamoDB::Model::AttributeValue> &result);
+static bool dynamodb_conds_use_partition_key(RelOptInfo *baserel, Oid foreigntableid,
+											 List *conds, const char *partition_key);
+static bool dynamodb_conds_are_key_conditions(Oid foreigntableid, Index relid, List *conds,
+											  const char *partition_key,
+											  const char *sort_key);
+static ForeignScan *dynamodb_get_count_plan(PlannerInfo *root, RelOptInfo *foreignrel,
+											List *tlist, Plan *outer_plan);
+static bool dynamodb_is_count_agg(Aggref *agg, RelOptInfo *rel);
+static bool dynamodb_add_count_path(PlannerInfo *root, RelOptInfo *input_rel,
+									RelOptInfo *grouped_rel, GroupPathExtraData *extra);
+static ForeignScan *dynamodb_get_agg_plan(PlannerInfo *root, RelOptInfo *foreignrel,
+										  List *tlist, Plan *outer_plan);
+static bool dynamodb_get_agg_kind(Aggref *agg, RelOptInfo *rel, DynamoDBAggKind *kind,
+								  AttrNumber *attnum);
+static void dynamodb_add_agg_path(PlannerInfo *root, RelOptInfo *input_rel,
+								  RelOptInfo *grouped_rel, GroupPathExtraData *extra);
 static void create_cursor(ForeignScanState *node);
+static int64 dynamodb_count_items(DynamoDBFdwScanState *fsstate);
+static DynamoDBAggState *dynamodb_init_agg_state(List *aggregates, TupleDesc tupdesc,
+												 TupleDesc input_tupdesc,
+												 MemoryContext agg_cxt);
+static void dynamodb_aggregate_items(DynamoDBFdwScanState *fsstate);
+static void dynamodb_aggregate_item(DynamoDBFdwScanState *fsstate, const DynamoDBItem &item);
+static DynamoDBAggGroup *dynamodb_find_agg_group(DynamoDBAggState *agg);
+static void dynamodb_advance_agg(DynamoDBAggState *agg, DynamoDBAggColumn *column,
+								 DynamoDBAggValue *value, Datum input);
+static void dynamodb_add_agg_numeric(DynamoDBAggState *agg, DynamoDBAggValue *value,
+									 Datum num);
+static Datum dynamodb_finalize_agg(DynamoDBAggColumn *column, DynamoDBAggValue *value,
+								   bool *isnull);
+static void dynamodb_reset_agg_state(DynamoDBAggState *agg);
+static bool dynamodb_open_page_source(DynamoDBFdwScanState *fsstate);
+static Aws::Vector<Aws::String> dynamodb_get_retrieved_attr_names(List *retrieved_attrs);
+static void dynamodb_close_page_source(void *arg);
+static void dynamodb_release_scan_state(void *arg);
+static void dynamodb_release_modify_state(void *arg);
+static DynamoDBAttrMap *dynamodb_build_attr_map(List *retrieved_attrs);
+static DynamoDBColumnConverter *dynamodb_build_converters(TupleDesc tupdesc,
+														  List *retrieved_attrs);
+static void dynamodb_start_prefetch(DynamoDBFdwScanState *fsstate);
+static Aws::String dynamodb_lookup_memo_key(const DynamoDBItem &key);
+static void dynamodb_remember_lookup(DynamoDBFdwScanState *fsstate,
+									 const std::shared_ptr<const DynamoDBItems> &page);
+static std::shared_ptr<const DynamoDBItems> dynamodb_fetch_next_page(DynamoDBFdwScanState *fsstate,
+																	  bool *pending);
 extern DynamoDBFdwModifyState *dynamodb_create_foreign_modify(EState *estate,
 											   RangeTblEntry *rte,
 											   ResultRelInfo *resultRelInfo,
@@ -210,16 +634,55 @@ extern DynamoDBFdwModifyState *dynamodb_create_foreign_modify(EState *estate,
 											   List *target_attrs,
 											   bool has_returning,
 											   List *retrieved_attrs);
-static void fetch_more_data(ForeignScanState *node);
-static HeapTuple make_tuple_from_result_row(std::shared_ptr<Aws::DynamoDB::Model::ExecuteStatementResult> result,
+static bool fetch_more_data(ForeignScanState *node);
+static void dynamodb_bind_target_attrs(DynamoDBFdwModifyState *fmstate,
+									   TupleTableSlot *slot,
+									   Aws::Vector<Aws::DynamoDB::Model::AttributeValue> &values);
+static void dynamodb_batch_insert_row(DynamoDBFdwModifyState *fmstate,
+									  TupleTableSlot *slot);
+static void dynamodb_finish_batch_insert(DynamoDBFdwModifyState *fmstate);
+static void dynamodb_decode_result_row(const DynamoDBItems &items,
+									  unsigned int *row_index,
+									  const DynamoDBAttrMap *attr_map,
+									  const DynamoDBColumnConverter *converters,
+									  int natts, Datum *values, bool *nulls);
+static HeapTuple make_tuple_from_result_row(const DynamoDBItems &items,
 											unsigned int *row_index,
 											Relation rel,
-											List *retrieved_attrs,
+											const DynamoDBAttrMap *attr_map,
+											const DynamoDBColumnConverter *converters,
 											ForeignScanState *fsstate,
 											MemoryContext temp_context);
 static void dynamodb_store_returning_result(DynamoDBFdwModifyState *fmstate,
 											TupleTableSlot *slot,
-											std::shared_ptr<Aws::DynamoDB::Model::ExecuteStatementResult> result);
+											const Aws::DynamoDB::Model::ExecuteStatementResult &result);
+static int	dynamodbAcquireSampleRowsFunc(Relation relation, int elevel,
+										  HeapTuple *rows, int targrows,
+										  double *totalrows,
+										  double *totaldeadrows);
+static List *dynamodb_get_analyzed_attrs(Relation relation);
+static bool dynamodb_column_is_analyzed(Relation relation, Form_pg_attribute attr);
+static void dynamodb_open_analyze_segment(DynamoDBAnalyzeState *astate,
+										  Aws::DynamoDB::DynamoDBClient *conn,
+										  const char *table_name,
+										  const Aws::Vector<Aws::String> &attr_names,
+										  int slot, int segment, int total_segments,
+										  int prefetch_depth, size_t prefetch_memory_limit);
+static void dynamodb_close_analyze_segment(DynamoDBAnalyzeState *astate, int slot);
+static void dynamodb_release_analyze_state(void *arg);
+static void analyze_row_processor(const DynamoDBItems &items,
+								  unsigned int *row_index,
+								  DynamoDBAnalyzeState *astate);
+static double dynamodb_analyze_random_fract(DynamoDBAnalyzeState *astate);
+#if PG_VERSION_NUM >= 140000
+static ForeignScan *find_modifytable_subplan(PlannerInfo *root,
+											 ModifyTable *plan,
+											 Index rtindex,
+											 int subplan_index);
+#endif
+static bool dynamodb_conds_pin_item(Oid foreigntableid, Index relid, List *conds,
+									const char *partition_key, const char *sort_key);
+static void dynamodb_execute_dml_stmt(ForeignScanState *node);
 static List *dynamodb_get_key_names(TupleDesc tupdesc, Oid foreignTableId, char *partition_key,
 											char *sort_key);
 /*
@@ -250,6 +713,8 @@ dynamodbGetForeignRelSize(PlannerInfo *root,
 	/* Look up foreign-table catalog info. */
 	fpinfo->table = GetForeignTable(foreigntableid);
 	fpinfo->server = GetForeignServer(fpinfo->table->serverid);
+	fpinfo->options = dynamodb_get_options(foreigntableid,
+										   OidIsValid(baserel->userid) ? baserel->userid : GetUserId());
 
 	/*
 	 * Extract user-settable option values.
@@ -308,11 +773,12 @@ dynamodbGetForeignRelSize(PlannerInfo *root,
 
 	/*
 	 * If the foreign table has never been ANALYZEd, it will have
-	 * reltuples < 0, meaning "unknown".  We can't do much if we're not
-	 * allowed to consult the remote server, but we can use a hack similar
-	 * to plancat.c's treatment of empty relations: use a minimum size
-	 * estimate of 10 pages, and divide by the column-datatype-based width
-	 * estimate to get the corresponding number of tuples.
+	 * reltuples < 0, meaning "unknown".  With use_remote_estimate, take the
+	 * number of items and the size of the table from DescribeTable, unless
+	 * DynamoDB has not counted any item yet.  Otherwise we can use a hack
+	 * similar to plancat.c's treatment of empty relations: use a minimum
+	 * size estimate of 10 pages, and divide by the column-datatype-based
+	 * width estimate to get the corresponding number of tuples.
 	 */
 #if (PG_VERSION_NUM >= 140000)
 	if (baserel->tuples < 0)
@@ -320,15 +786,65 @@ dynamodbGetForeignRelSize(PlannerInfo *root,
 	if (baserel->pages == 0 && baserel->tuples == 0)
 #endif
 	{
-		baserel->pages = 10;
-		baserel->tuples =
-			(10 * BLCKSZ) / (baserel->reltarget->width +
-								MAXALIGN(SizeofHeapTupleHeader));
+		if (fpinfo->options->use_remote_estimate)
+		{
+			Oid			userid = OidIsValid(baserel->userid) ? baserel->userid : GetUserId();
+
+			fpinfo->remote_stats =
+				dynamodb_get_remote_stats(foreigntableid,
+										  GetUserMapping(userid, fpinfo->server->serverid),
+										  fpinfo->options->remote_estimate_ttl);
+			if (fpinfo->remote_stats->item_count <= 0)
+				fpinfo->remote_stats = NULL;
+		}
+
+		if (fpinfo->remote_stats != NULL)
+		{
+			baserel->tuples = fpinfo->remote_stats->item_count;
+			baserel->pages = Max(ceil(fpinfo->remote_stats->size_bytes / BLCKSZ), 1);
+		}
+		else
+		{
+			baserel->pages = 10;
+			baserel->tuples =
+				(10 * BLCKSZ) / (baserel->reltarget->width +
+									MAXALIGN(SizeofHeapTupleHeader));
+		}
 	}
 
 	/* Estimate baserel size as best we can with local statistics. */
 	set_baserel_size_estimates(root, baserel);
 
+	/*
+	 * The average size of the items is known from the remote statistics.
+	 * Assume that the columns retrieved take their share of it.
+	 */
+	if (fpinfo->remote_stats != NULL && baserel->max_attr > 0)
+	{
+		double		item_width = fpinfo->remote_stats->size_bytes /
+			fpinfo->remote_stats->item_count;
+		int			nattrs = 0;
+		int			col = -1;
+
+		while ((col = bms_next_member(fpinfo->attrs_used, col)) >= 0)
+		{
+			/* bit numbers are offset by FirstLowInvalidHeapAttributeNumber */
+			AttrNumber	attno = col + FirstLowInvalidHeapAttributeNumber;
+
+			/* A whole-row reference retrieves all the attributes */
+			if (attno == InvalidAttrNumber)
+			{
+				nattrs = baserel->max_attr;
+				break;
+			}
+			if (attno > InvalidAttrNumber)
+				nattrs++;
+		}
+
+		baserel->reltarget->width =
+			(int) Max(rint(item_width * nattrs / baserel->max_attr), 1);
+	}
+
 	/* Fill in basically-bogus cost estimates for use later. */
 	dynamodb_estimate_path_cost_size(root, baserel, NIL, NIL, NULL,
 							&fpinfo->rows, &fpinfo->width,
@@ -371,10 +887,24 @@ dynamodb_estimate_path_cost_size(PlannerInfo *root,
 	Assert(foreignrel->reltarget);
 
 	/*
-	 * We don't support join conditions in this mode (hence, no
-	 * parameterized paths can be made).
+	 * A parameterized scan is only made for a join clause on the partition
+	 * key, so that it reads the items of one partition, or a single item,
+	 * per outer row.  Cost it by the rows it returns rather than as a
+	 * seqscan of the whole table.
 	 */
-	Assert(param_join_conds == NIL);
+	if (param_join_conds != NIL)
+	{
+		rows = get_parameterized_baserel_size(root, foreignrel, param_join_conds);
+		width = foreignrel->reltarget->width;
+
+		retrieved_rows = clamp_row_est(rows / fpinfo->local_conds_sel);
+		retrieved_rows = Min(retrieved_rows, foreignrel->tuples);
+
+		startup_cost = foreignrel->baserestrictcost.startup +
+			foreignrel->reltarget->cost.startup;
+		run_cost = (cpu_tuple_cost + foreignrel->baserestrictcost.per_tuple) * retrieved_rows;
+		run_cost += foreignrel->reltarget->cost.per_tuple * rows;
+	}
 
 	/*
 	 * We will come here again and again with different set of pathkeys or
@@ -383,7 +913,7 @@ dynamodb_estimate_path_cost_size(PlannerInfo *root,
 	 * underlying scan, join, or grouping each time.  Instead, use those
 	 * estimates if we have cached them already.
 	 */
-	if (fpinfo->rel_startup_cost >= 0 && fpinfo->rel_total_cost >= 0)
+	else if (fpinfo->rel_startup_cost >= 0 && fpinfo->rel_total_cost >= 0)
 	{
 #if PG_VERSION_NUM >= 140000
 		Assert(fpinfo->retrieved_rows >= 0);
@@ -520,1375 +1050,6035 @@ dynamodbGetForeignPaths(PlannerInfo *root,
 								   NIL);	/* no fdw_private list */
 	add_path(baserel, (Path *) path);
 
-}
-
-/*
- * dynamodbGetForeignPlan
- *		Create ForeignScan plan node which implements selected best path
- */
-extern "C" ForeignScan *
-dynamodbGetForeignPlan(PlannerInfo *root,
-					   RelOptInfo *foreignrel,
-					   Oid foreigntableid,
-					   ForeignPath *best_path,
-					   List *tlist,
-					   List *scan_clauses,
-					   Plan *outer_plan)
-{
-	DynamoDBFdwRelationInfo *fpinfo = (DynamoDBFdwRelationInfo *) foreignrel->fdw_private;
-	Index		scan_relid;
-	List	   *fdw_private;
-	List	   *remote_exprs = NIL;
-	List	   *local_exprs = NIL;
-	List	   *fdw_scan_tlist = NIL;
-	List	   *fdw_recheck_quals = NIL;
-	List	   *retrieved_attrs = NIL;
-	StringInfoData sql;
-	bool		tlist_has_json_arrow_op;
-	ListCell   *lc;
-
-	/* DynamoDB FDW only support simple relation */
-	Assert(IS_SIMPLE_REL(foreignrel));
+	/* Consider parameterized paths for nested-loop joins on the partition key */
+	dynamodb_add_parameterized_paths(root, baserel, foreigntableid);
 
-	/* Decide to execute Json arrow operator support in the target list. */
-	tlist_has_json_arrow_op = dynamodb_tlist_has_json_arrow_op(root, foreignrel, tlist);
+	/* Consider returning the items of one partition in sort key order */
+	dynamodb_add_sorted_paths(root, baserel, foreigntableid);
 
-	/*
-	 * For base relations, set scan_relid as the relid of the relation.
-	 */
-	scan_relid = foreignrel->relid;
+	/* Consider reading a secondary index whose partition key is given */
+	dynamodb_add_index_paths(root, baserel, foreigntableid);
 
 	/*
-	 * In a base-relation scan, we must apply the given scan_clauses.
-	 *
-	 * Separate the scan_clauses into those that can be executed remotely
-	 * and those that can't.  baserestrictinfo clauses that were
-	 * previously determined to be safe or unsafe by classifyConditions
-	 * are found in fpinfo->remote_conds and fpinfo->local_conds.
-	 *
-	 * This code must match "extract_actual_clauses(scan_clauses, false)"
-	 * except for the additional decision about remote versus local
-	 * execution.
+	 * Consider a parallel scan, where each participant reads the segments of
+	 * a DynamoDB Scan that it claims from shared memory.  The Scan API cannot
+	 * run the PartiQL WHERE clause, so all conditions are then checked
+	 * locally.  That only pays off if the conditions would not restrict the
+	 * remote read to a partition anyway.
 	 */
-	foreach(lc, scan_clauses)
+	if (baserel->consider_parallel && baserel->lateral_relids == NULL &&
+		!dynamodb_conds_use_partition_key(baserel, foreigntableid, fpinfo->remote_conds,
+										  fpinfo->options->svr_partition_key))
 	{
-		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
-
-		/* Ignore any pseudoconstants, they're dealt with elsewhere */
-		if (rinfo->pseudoconstant)
-			continue;
+		int			parallel_workers;
 
-		if (list_member_ptr(fpinfo->remote_conds, rinfo))
-			remote_exprs = lappend(remote_exprs, rinfo->clause);
-		else if (list_member_ptr(fpinfo->local_conds, rinfo))
-			local_exprs = lappend(local_exprs, rinfo->clause);
-		else if (dynamodb_is_foreign_expr(root, foreignrel, rinfo->clause))
-			remote_exprs = lappend(remote_exprs, rinfo->clause);
+		if (fpinfo->options->parallel_workers >= 0)
+			parallel_workers = Min(fpinfo->options->parallel_workers,
+								   max_parallel_workers_per_gather);
 		else
-			local_exprs = lappend(local_exprs, rinfo->clause);
+			parallel_workers = compute_parallel_worker(baserel, baserel->pages, -1,
+													   max_parallel_workers_per_gather);
+
+		if (parallel_workers > 0)
+		{
+			double		parallel_divisor = parallel_workers;
+			Cost		run_cost = fpinfo->total_cost - fpinfo->startup_cost;
+
+			/* Same as get_parallel_divisor() of costsize.c */
+			if (parallel_leader_participation)
+			{
+				double		leader_contribution;
+
+				leader_contribution = 1.0 - (0.3 * parallel_workers);
+				if (leader_contribution > 0)
+					parallel_divisor += leader_contribution;
+			}
+
+			path = create_foreignscan_path(root, baserel,
+										   NULL,	/* default pathtarget */
+										   clamp_row_est(fpinfo->rows / parallel_divisor),
+										   fpinfo->startup_cost,
+										   fpinfo->startup_cost + run_cost / parallel_divisor,
+										   NIL, /* no pathkeys */
+										   NULL,	/* no outer rel either */
+										   NULL,	/* no extra plan */
+#if PG_VERSION_NUM >= 170000
+										   NIL, /* no fdw_restrictinfo list */
+#endif
+										   NIL);	/* no fdw_private list */
+			path->path.parallel_aware = true;
+			path->path.parallel_workers = parallel_workers;
+			add_partial_path(baserel, (Path *) path);
+		}
 	}
+}
 
-	/*
-	 * For a base-relation scan, we have to support EPQ recheck, which
-	 * should recheck all the remote quals.
-	 */
-	fdw_recheck_quals = remote_exprs;
+/*
+ * dynamodb_get_remote_stats
+ *		Get the size of the remote table of a foreign table, and of its
+ *		secondary indexes, with DescribeTable.
+ *
+ * DynamoDB only updates these figures every six hours or so, so the result
+ * is reused by the backend for ttl seconds.  Returns a copy allocated in the
+ * current memory context.
+ */
+static DynamoDBTableStats *
+dynamodb_get_remote_stats(Oid foreigntableid, UserMapping *user, int ttl)
+{
+	DynamoDBStatsCacheEntry *entry;
+	DynamoDBTableStats *stats;
+	char	   *table_name = dynamodb_get_table_name(foreigntableid);
+	bool		found;
+	int			i;
 
-	/*
-	 * Build the list of columns that contain Jsonb arrow operator
-	 * to be fetched from the foreign server.
-	 */
-	if (tlist_has_json_arrow_op == true)
+	if (DynamoDBStatsCache == NULL)
 	{
-		List	 *document_path_list = NIL;
+		HASHCTL		ctl;
+
+		MemSet(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(Oid);
+		ctl.entrysize = sizeof(DynamoDBStatsCacheEntry);
+		ctl.hcxt = CacheMemoryContext;
+		DynamoDBStatsCache = hash_create("dynamodb_fdw remote statistics", 8, &ctl,
+										 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
 
-		if (tlist)
-			fdw_scan_tlist = list_copy(tlist);
-		else
-			fdw_scan_tlist = add_to_flat_tlist(fdw_scan_tlist, foreignrel->reltarget->exprs);
+	entry = (DynamoDBStatsCacheEntry *) hash_search(DynamoDBStatsCache, &foreigntableid,
+													HASH_ENTER, &found);
+	if (!found)
+	{
+		entry->table_name = NULL;
+		entry->stats.nindexes = 0;
+		entry->stats.indexes = NULL;
+	}
 
-		foreach(lc, local_exprs)
-		{
-			Node *node = (Node *)lfirst(lc);
+	/* Describe the table again if it was renamed, or the result is too old */
+	if (entry->table_name == NULL || strcmp(entry->table_name, table_name) != 0 ||
+		TimestampDifferenceExceeds(entry->fetched_at, GetCurrentTimestamp(),
+								   Min(ttl, INT_MAX / 1000) * 1000))
+		dynamodb_describe_table(entry, user, table_name);
 
-			fdw_scan_tlist = add_to_flat_tlist(fdw_scan_tlist,
-												pull_var_clause((Node *) node,
-																PVC_RECURSE_PLACEHOLDERS));
-		}
-		foreach(lc, remote_exprs)
+	stats = (DynamoDBTableStats *) palloc(sizeof(DynamoDBTableStats));
+	*stats = entry->stats;
+	if (stats->nindexes > 0)
+	{
+		stats->indexes = (DynamoDBIndexStats *) palloc(sizeof(DynamoDBIndexStats) * stats->nindexes);
+		for (i = 0; i < stats->nindexes; i++)
 		{
-			Node *node = (Node *)lfirst(lc);
-
-			fdw_scan_tlist = add_to_flat_tlist(fdw_scan_tlist,
-												pull_var_clause((Node *) node,
-																PVC_RECURSE_PLACEHOLDERS));
+			stats->indexes[i] = entry->stats.indexes[i];
+			stats->indexes[i].name = pstrdup(entry->stats.indexes[i].name);
 		}
+	}
 
-		/*
-		 * DynamoDB does not support overlap document path.
-		 * For example: SELECT friends.login.lastsignin, friends.login, friends.
-		 * Therefore, do not push down arrow operators in that case.
-		 */
-		foreach(lc, fdw_scan_tlist)
-		{
-			StringInfoData document_path;
-			Expr *expr = ((TargetEntry *)lfirst(lc))->expr;
-			ListCell *attlc;
+	return stats;
+}
 
-			initStringInfo(&document_path);
-			dynamodb_get_document_path(&document_path, root, foreignrel, expr);
+/*
+ * dynamodb_describe_table
+ *		Fill the cache entry with the result of DescribeTable.
+ */
+static void
+dynamodb_describe_table(DynamoDBStatsCacheEntry *entry, UserMapping *user,
+						const char *table_name)
+{
+	Aws::DynamoDB::DynamoDBClient *conn = dynamodb_get_connection(user);
+	Model::DescribeTableRequest req;
+	Model::DescribeTableOutcome outcome;
+	MemoryContext oldcontext;
+	int			nindexes;
+	int			i;
 
-			foreach(attlc, document_path_list)
-			{
-				char *target_name = strVal(lfirst(attlc));
+	req.SetTableName(table_name);
+	outcome = conn->DescribeTable(req);
+	if (!outcome.IsSuccess())
+		ereport(ERROR,
+				(errcode(ERRCODE_FDW_ERROR),
+				 errmsg("dynamodb_fdw: could not describe table \"%s\": %s",
+						table_name, outcome.GetError().GetMessage().c_str())));
+
+	const Model::TableDescription &table = outcome.GetResult().GetTable();
+
+	/* Forget the previous result, the entry is not valid until filled */
+	if (entry->table_name != NULL)
+		pfree(entry->table_name);
+	entry->table_name = NULL;
+	for (i = 0; i < entry->stats.nindexes; i++)
+		pfree(entry->stats.indexes[i].name);
+	if (entry->stats.indexes != NULL)
+		pfree(entry->stats.indexes);
+	entry->stats.nindexes = 0;
+	entry->stats.indexes = NULL;
+
+	oldcontext = MemoryContextSwitchTo(CacheMemoryContext);
+
+	nindexes = (int) (table.GetGlobalSecondaryIndexes().size() +
+					  table.GetLocalSecondaryIndexes().size());
+	if (nindexes > 0)
+		entry->stats.indexes = (DynamoDBIndexStats *) palloc(sizeof(DynamoDBIndexStats) * nindexes);
+
+	for (const auto &index : table.GetGlobalSecondaryIndexes())
+	{
+		DynamoDBIndexStats *istats = &entry->stats.indexes[entry->stats.nindexes++];
 
-				if (strstr(target_name, document_path.data) != NULL ||
-					strstr(document_path.data, target_name) != NULL)
-				{
-					fdw_scan_tlist = NULL;
-					tlist_has_json_arrow_op = false;
-					break;
-				}
-			}
-			document_path_list = lappend(document_path_list, makeString(document_path.data));
-		}
+		istats->name = pstrdup(index.GetIndexName().c_str());
+		istats->item_count = (double) index.GetItemCount();
+		istats->size_bytes = (double) index.GetIndexSizeBytes();
 	}
+	for (const auto &index : table.GetLocalSecondaryIndexes())
+	{
+		DynamoDBIndexStats *istats = &entry->stats.indexes[entry->stats.nindexes++];
 
-	/*
-	 * Build the query string to be sent for execution, and identify
-	 * expressions to be sent as parameters.
-	 */
-	initStringInfo(&sql);
-	dynamodb_deparse_select_stmt_for_rel(&sql, root, foreignrel, fdw_scan_tlist,
-							remote_exprs, best_path->path.pathkeys,
-							&retrieved_attrs);
+		istats->name = pstrdup(index.GetIndexName().c_str());
+		istats->item_count = (double) index.GetItemCount();
+		istats->size_bytes = (double) index.GetIndexSizeBytes();
+	}
 
-	/*
-	 * Build the fdw_private list that will be available to the executor.
-	 * Items in the list must match order in enum FdwScanPrivateIndex.
-	 */
-	fdw_private = list_make2(makeString(sql.data),
-							 retrieved_attrs);
+	entry->stats.item_count = (double) table.GetItemCount();
+	entry->stats.size_bytes = (double) table.GetTableSizeBytes();
+	entry->fetched_at = GetCurrentTimestamp();
+	entry->table_name = pstrdup(table_name);
 
-	/*
-	 * Create the ForeignScan node for the given relation.
-	 *
-	 * Note that the remote parameter expressions are stored in the fdw_exprs
-	 * field of the finished plan node; we can't keep them in private state
-	 * because then they wouldn't be subject to later planner processing.
-	 */
-	return make_foreignscan(tlist,
-							local_exprs,
-							scan_relid,
-							NULL,
-							fdw_private,
-							fdw_scan_tlist,
-							fdw_recheck_quals,
-							outer_plan);
+	MemoryContextSwitchTo(oldcontext);
 }
 
-#if PG_VERSION_NUM >= 140000
 /*
- * Construct a tuple descriptor for the scan tuples handled by a foreign join.
+ * dynamodb_find_index_stats
+ *		Find the size of a secondary index in the statistics of its table,
+ *		or return NULL if it is not known.
  */
-static TupleDesc
-dynamodb_get_tupdesc_for_join_scan_tuples(ForeignScanState *node)
+static DynamoDBIndexStats *
+dynamodb_find_index_stats(DynamoDBTableStats *stats, const char *index_name)
 {
-	ForeignScan *fsplan = (ForeignScan *) node->ss.ps.plan;
-	EState	   *estate = node->ss.ps.state;
-	TupleDesc	tupdesc;
-
-	/*
-	 * The core code has already set up a scan tuple slot based on
-	 * fsplan->fdw_scan_tlist, and this slot's tupdesc is mostly good enough,
-	 * but there's one case where it isn't.  If we have any whole-row row
-	 * identifier Vars, they may have vartype RECORD, and we need to replace
-	 * that with the associated table's actual composite type.  This ensures
-	 * that when we read those ROW() expression values from the remote server,
-	 * we can convert them to a composite type the local server knows.
-	 */
-	tupdesc = CreateTupleDescCopy(node->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
-	for (int i = 0; i < tupdesc->natts; i++)
-	{
-		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
-		Var		   *var;
-		RangeTblEntry *rte;
-		Oid			reltype;
+	int			i;
 
-		/* Nothing to do if it's not a generic RECORD attribute */
-		if (att->atttypid != RECORDOID || att->atttypmod >= 0)
-			continue;
+	if (stats == NULL)
+		return NULL;
 
-		/*
-		 * If we can't identify the referenced table, do nothing.  This'll
-		 * likely lead to failure later, but perhaps we can muddle through.
-		 */
-		var = (Var *) list_nth_node(TargetEntry, fsplan->fdw_scan_tlist,
-									i)->expr;
-		if (!IsA(var, Var) || var->varattno != 0)
-			continue;
-		rte = (RangeTblEntry *) list_nth(estate->es_range_table, var->varno - 1);
-		if (rte->rtekind != RTE_RELATION)
-			continue;
-		reltype = get_rel_type_id(rte->relid);
-		if (!OidIsValid(reltype))
-			continue;
-		att->atttypid = reltype;
-		/* shouldn't need to change anything else */
+	for (i = 0; i < stats->nindexes; i++)
+	{
+		if (strcmp(stats->indexes[i].name, index_name) == 0)
+			return &stats->indexes[i];
 	}
-	return tupdesc;
+
+	return NULL;
 }
-#endif
 
 /*
- * dynamodbBeginForeignScan
- *		Initiate an executor scan of a foreign DynamoDB table.
+ * dynamodb_add_parameterized_paths
+ *		Create paths which only read the items of the partition key value
+ *		given by the current outer row of a nested loop.
+ *
+ * The join clause "partition_key = outer column" is sent in the PartiQL
+ * WHERE clause with the outer value as a parameter, so that DynamoDB reads
+ * one partition instead of scanning the table for each outer row.  When a
+ * join clause gives the sort key too, the item is read with GetItem.
  */
-extern "C" void
-dynamodbBeginForeignScan(ForeignScanState *node, int eflags)
+static void
+dynamodb_add_parameterized_paths(PlannerInfo *root, RelOptInfo *baserel,
+								 Oid foreigntableid)
 {
-	ForeignScan *fsplan = (ForeignScan *) node->ss.ps.plan;
-	EState	   *estate = node->ss.ps.state;
-	DynamoDBFdwScanState *fsstate;
-	RangeTblEntry *rte;
-	Oid			userid;
-	ForeignTable *table;
-	UserMapping *user;
-	int			rtindex;
+	DynamoDBFdwRelationInfo *fpinfo = (DynamoDBFdwRelationInfo *) baserel->fdw_private;
+	const char *partition_key = fpinfo->options->svr_partition_key;
+	List	   *candidates = NIL;
+	List	   *ppi_list = NIL;
+	ListCell   *lc;
 
-	/*
-	 * Do nothing in EXPLAIN (no ANALYZE) case.  node->fdw_state stays NULL.
-	 */
-	if (eflags & EXEC_FLAG_EXPLAIN_ONLY)
+	if (IS_KEY_EMPTY(partition_key))
 		return;
 
-	/*
-	 * We'll save private state in node->fdw_state.
-	 */
-	fsstate = (DynamoDBFdwScanState *) palloc0(sizeof(DynamoDBFdwScanState));
-	node->fdw_state = (void *) fsstate;
-#if (PG_VERSION_NUM >= 160000)
-	/*
-	 * Identify which user to do the remote access as.  This should match what
-	 * ExecCheckPermissions() does.
-	 */
-	userid = OidIsValid(fsplan->checkAsUser) ? fsplan->checkAsUser : GetUserId();
-	if (fsplan->scan.scanrelid > 0)
-		rtindex = fsplan->scan.scanrelid;
-	else
-		rtindex = bms_next_member(fsplan->fs_base_relids, -1);
-	rte = exec_rt_fetch(rtindex, estate);
-#else
-	/*
-	 * Identify which user to do the remote access as.  This should match what
-	 * ExecCheckRTEPerms() does.  In case of a join or aggregate, use the
-	 * lowest-numbered member RTE as a representative; we would get the same
-	 * result from any.
-	 */
-	if (fsplan->scan.scanrelid > 0)
-		rtindex = fsplan->scan.scanrelid;
-	else
-		rtindex = bms_next_member(fsplan->fs_relids, -1);
-	rte = exec_rt_fetch(rtindex, estate);
-	userid = rte->checkAsUser ? rte->checkAsUser : GetUserId();
-#endif
-	/* Get info about foreign table. */
-	table = GetForeignTable(rte->relid);
-	user = GetUserMapping(userid, table->serverid);
+	/* Join clauses which are not part of an equivalence class */
+	foreach(lc, baserel->joininfo)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
 
-	/*
-	 * Get connection to the foreign server.  Connection manager will
-	 * establish new connection if necessary.
-	 */
-	fsstate->conn = dynamodb_get_connection(user);
+		if (join_clause_is_movable_to(rinfo, baserel))
+			candidates = lappend(candidates, rinfo);
+	}
 
-	/* Init data for cursor_exists as false */
-	fsstate->cursor_exists = false;
+	/* Equalities of the partition key implied by equivalence classes */
+	if (baserel->has_eclass_joins)
+	{
+		AttrNumber	attno = get_attnum(foreigntableid, partition_key);
+
+		if (attno != InvalidAttrNumber)
+			candidates = list_concat(candidates,
+									 generate_implied_equalities_for_column(root,
+																			baserel,
+																			dynamodb_ec_member_is_column,
+																			(void *) &attno,
+																			baserel->lateral_referencers));
+	}
 
-	/* Get private info created by planner functions. */
-	fsstate->query = strVal(list_nth(fsplan->fdw_private,
-									 FdwScanPrivateSelectSql));
-	fsstate->retrieved_attrs = (List *) list_nth(fsplan->fdw_private,
-												 FdwScanPrivateRetrievedAttrs);
+	/* Collect the parameterizations given by the partition key clauses */
+	foreach(lc, candidates)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+		AttrNumber	attno;
+		Relids		required_outer;
 
-	/* Create contexts for batches of tuples and per-tuple temp workspace. */
-	fsstate->batch_cxt = AllocSetContextCreate(estate->es_query_cxt,
-											   "dynamodb_fdw tuple data",
-											   ALLOCSET_DEFAULT_SIZES);
-	fsstate->temp_cxt = AllocSetContextCreate(estate->es_query_cxt,
-											  "dynamodb_fdw temporary data",
-											  ALLOCSET_SMALL_SIZES);
+		attno = dynamodb_join_clause_key_attno(baserel->relid, rinfo->clause);
+		if (attno == InvalidAttrNumber ||
+			!IS_KEY_COLUMN(get_attname(foreigntableid, attno, false), partition_key))
+			continue;
 
-	/*
-	 * Get info we'll need for converting data fetched from the foreign server
-	 * into local representation and error reporting during that process.
-	 */
-	if (fsplan->scan.scanrelid > 0)
-	{
-		fsstate->rel = node->ss.ss_currentRelation;
-		fsstate->tupdesc = RelationGetDescr(fsstate->rel);
+		required_outer = bms_union(rinfo->clause_relids, baserel->lateral_relids);
+		required_outer = bms_del_member(required_outer, baserel->relid);
+		if (bms_is_empty(required_outer))
+			continue;
+
+		ppi_list = list_append_unique_ptr(ppi_list,
+										  get_baserel_parampathinfo(root, baserel,
+																	required_outer));
 	}
-	else
+
+	foreach(lc, ppi_list)
 	{
-		fsstate->rel = NULL;
-#if (PG_VERSION_NUM >= 140000)
-		fsstate->tupdesc = dynamodb_get_tupdesc_for_join_scan_tuples(node);
-#else
-		fsstate->tupdesc = node->ss.ss_ScanTupleSlot->tts_tupleDescriptor;
+		ParamPathInfo *param_info = (ParamPathInfo *) lfirst(lc);
+		ForeignPath *path;
+		double		rows;
+		int			width;
+		Cost		startup_cost;
+		Cost		total_cost;
+
+		dynamodb_estimate_path_cost_size(root, baserel, param_info->ppi_clauses, NIL, NULL,
+										 &rows, &width, &startup_cost, &total_cost);
+
+		path = create_foreignscan_path(root, baserel,
+									   NULL,	/* default pathtarget */
+									   param_info->ppi_rows,
+									   startup_cost,
+									   total_cost,
+									   NIL, /* no pathkeys */
+									   param_info->ppi_req_outer,
+									   NULL,	/* no extra plan */
+#if PG_VERSION_NUM >= 170000
+									   NIL, /* no fdw_restrictinfo list */
 #endif
+									   NIL);	/* no fdw_private list */
+		add_path(baserel, (Path *) path);
 	}
-
 }
 
 /*
- * dynamodbIterateForeignScan
- *		Retrieve next row from the result set, or clear tuple slot to indicate
- *		EOF.
+ * dynamodb_add_sorted_paths
+ *		Add paths which return the items ordered by the sort key of the table.
+ *
+ * When the partition key is given by an equality, DynamoDB reads a single
+ * partition, whose items it returns in sort key order, forwards or backwards
+ * as the ORDER BY of the PartiQL statement asks, at no extra cost.  Merge
+ * joins and ORDER BY ... LIMIT can then do without a local sort.
+ *
+ * DynamoDB compares numbers by value, and strings and binaries byte by byte,
+ * so a text sort key must use the "C" collation to be ordered the same way.
  */
-extern "C" TupleTableSlot *
-dynamodbIterateForeignScan(ForeignScanState *node)
+static void
+dynamodb_add_sorted_paths(PlannerInfo *root, RelOptInfo *baserel,
+						  Oid foreigntableid)
 {
-	DynamoDBFdwScanState *fsstate = (DynamoDBFdwScanState *) node->fdw_state;
-	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+	DynamoDBFdwRelationInfo *fpinfo = (DynamoDBFdwRelationInfo *) baserel->fdw_private;
+	dynamodb_opt *options = fpinfo->options;
+	AttrNumber	attno;
+	Oid			type;
+	int32		typmod;
+	Oid			collid;
+	Var		   *var;
+	TypeCacheEntry *typentry;
+	int			i;
 
-	/*
-	 * If this is the first call after Begin or ReScan, we need to create the
-	 * cursor on the remote side.
-	 */
-	if (!fsstate->cursor_exists)
-		create_cursor(node);
+	/* Nothing to do if no ordering can be useful */
+	if (root->query_pathkeys == NIL && !baserel->has_eclass_joins)
+		return;
 
-	fsstate->tuples = NULL;
+	if (IS_KEY_EMPTY(options->svr_sort_key) ||
+		!dynamodb_conds_give_key(foreigntableid, baserel->relid, fpinfo->remote_conds,
+								 options->svr_partition_key, false))
+		return;
 
-	/* No point in another fetch if we already detected EOF, though. */
-	if (!fsstate->eof_reached)
-		fetch_more_data(node);
-	/* If we didn't get any tuples, must be end of data. */
-	if (fsstate->tuples == NULL)
-		return ExecClearTuple(slot);
+	attno = get_attnum(foreigntableid, options->svr_sort_key);
+	if (attno == InvalidAttrNumber)
+		return;
 
-	/*
-	 * Return the next tuple.
-	 */
-	ExecStoreHeapTuple(fsstate->tuples, slot, false);
+	get_atttypetypmodcoll(foreigntableid, attno, &type, &typmod, &collid);
+	if (!dynamodb_is_key_type(type) ||
+		((type == TEXTOID || type == VARCHAROID) && collid != C_COLLATION_OID))
+		return;
 
-	return slot;
-}
+	var = makeVar(baserel->relid, attno, type, typmod, collid, 0);
+	typentry = lookup_type_cache(type, TYPECACHE_LT_OPR | TYPECACHE_GT_OPR);
 
-/*
- * dynamodbReScanForeignScan
- *		Restart the scan.
- */
-extern "C" void
-dynamodbReScanForeignScan(ForeignScanState *node)
-{
-	DynamoDBFdwScanState *fsstate = (DynamoDBFdwScanState *) node->fdw_state;
+	/* Ascending, then descending order */
+	for (i = 0; i < 2; i++)
+	{
+		Oid			opno = (i == 0) ? typentry->lt_opr : typentry->gt_opr;
+		List	   *pathkeys;
+		ForeignPath *path;
 
-	/* If we haven't created the cursor yet, nothing to do. */
-	if (!fsstate->cursor_exists)
-		return;
+		if (!OidIsValid(opno))
+			continue;
 
-	/* Now force a fresh FETCH. */
-	fsstate->tuples = NULL;
-	fsstate->eof_reached = false;
-	fsstate->first_fetch = true;
-	fsstate->next_token = NULL;
-	fsstate->next_fetch_ready = true;
-	fsstate->row_index = 0;
-}
+#if PG_VERSION_NUM >= 160000
+		pathkeys = build_expression_pathkey(root, (Expr *) var, opno,
+											baserel->relids, false);
+#else
+		pathkeys = build_expression_pathkey(root, (Expr *) var, NULL, opno,
+											baserel->relids, false);
+#endif
+		pathkeys = truncate_useless_pathkeys(root, baserel, pathkeys);
+		if (pathkeys == NIL)
+			continue;
 
+		path = create_foreignscan_path(root, baserel,
+									   NULL,	/* default pathtarget */
+									   fpinfo->rows,
+									   fpinfo->startup_cost,
+									   fpinfo->total_cost,
+									   pathkeys,
+									   baserel->lateral_relids,
+									   NULL,	/* no extra plan */
+#if PG_VERSION_NUM >= 170000
+									   NIL, /* no fdw_restrictinfo list */
+#endif
+									   NIL);	/* no fdw_private list */
+		add_path(baserel, (Path *) path);
+	}
+}
 
 /*
- * dynamodbEndForeignScan
- * Finish scanning foreign table and dispose objects used for this scan
+ * dynamodb_add_index_paths
+ *		Add paths which read a secondary index of the table instead of the
+ *		table itself.
+ *
+ * When the remote conditions give the partition key of a secondary index,
+ * but not the one of the table, DynamoDB reads one partition of the index
+ * rather than scanning the whole table.  The index can only be read if the
+ * attributes projected into it cover all the columns the query needs.
  */
-extern "C" void
-dynamodbEndForeignScan(ForeignScanState *node)
+static void
+dynamodb_add_index_paths(PlannerInfo *root, RelOptInfo *baserel,
+						 Oid foreigntableid)
 {
-	DynamoDBFdwScanState *fsstate = (DynamoDBFdwScanState *) node->fdw_state;
+	DynamoDBFdwRelationInfo *fpinfo = (DynamoDBFdwRelationInfo *) baserel->fdw_private;
+	dynamodb_opt *options = fpinfo->options;
+	Bitmapset  *attrs = NULL;
+	ListCell   *lc;
 
-	/* if fsstate is NULL, we are in EXPLAIN; nothing to do */
-	if (fsstate == NULL)
+	if (options->indexes == NIL || fpinfo->remote_conds == NIL)
 		return;
 
-	/* Release remote connection */
-	dynamodb_release_connection(fsstate->conn);
+	/* A condition on the partition key of the table reads one partition already */
+	if (dynamodb_conds_give_key(foreigntableid, baserel->relid, fpinfo->remote_conds,
+								options->svr_partition_key, true))
+		return;
+
+	/* The columns which are retrieved, and the ones the remote conditions use */
+	attrs = bms_copy(fpinfo->attrs_used);
+	foreach(lc, fpinfo->remote_conds)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+
+		pull_varattnos((Node *) rinfo->clause, baserel->relid, &attrs);
+	}
+
+	foreach(lc, options->indexes)
+	{
+		DynamoDBIndex *index = (DynamoDBIndex *) lfirst(lc);
+		DynamoDBIndexStats *istats;
+		ForeignPath *path;
+		double		retrieved_rows;
+		double		pages;
+		Cost		startup_cost;
+		Cost		run_cost;
+
+		if (!dynamodb_conds_give_key(foreigntableid, baserel->relid, fpinfo->remote_conds,
+									 index->partition_key, true) ||
+			!dynamodb_index_covers_attrs(foreigntableid, index, options, attrs))
+			continue;
+
+		/*
+		 * Only the items of the partitions given by the conditions are read,
+		 * so cost the pages holding the retrieved rows rather than the whole
+		 * table.
+		 */
+		retrieved_rows = clamp_row_est(baserel->rows / fpinfo->local_conds_sel);
+		retrieved_rows = Min(retrieved_rows, baserel->tuples);
+
+		/*
+		 * A global secondary index only holds the items which have its key,
+		 * and projects fewer attributes than the table.  Use its own size if
+		 * DescribeTable gave it.
+		 */
+		istats = dynamodb_find_index_stats(fpinfo->remote_stats, index->name);
+		if (istats != NULL && istats->item_count > 0)
+		{
+			retrieved_rows = clamp_row_est(Min(retrieved_rows, istats->item_count));
+			pages = ceil(istats->size_bytes / BLCKSZ * retrieved_rows / istats->item_count);
+		}
+		else if (baserel->tuples > 0)
+			pages = ceil(baserel->pages * retrieved_rows / baserel->tuples);
+		else
+			pages = 1;
+
+		startup_cost = baserel->baserestrictcost.startup +
+			baserel->reltarget->cost.startup;
+		run_cost = seq_page_cost * pages;
+		run_cost += (cpu_tuple_cost + baserel->baserestrictcost.per_tuple) * retrieved_rows;
+		run_cost += baserel->reltarget->cost.per_tuple * baserel->rows;
+
+		/* Same network and local overheads as the other scans */
+		startup_cost += fpinfo->fdw_startup_cost;
+		run_cost += fpinfo->fdw_tuple_cost * retrieved_rows;
+		run_cost += cpu_tuple_cost * retrieved_rows;
+
+		path = create_foreignscan_path(root, baserel,
+									   NULL,	/* default pathtarget */
+									   baserel->rows,
+									   startup_cost,
+									   startup_cost + run_cost,
+									   NIL, /* no pathkeys */
+									   baserel->lateral_relids,
+									   NULL,	/* no extra plan */
+#if PG_VERSION_NUM >= 170000
+									   NIL, /* no fdw_restrictinfo list */
+#endif
+									   list_make1(makeString(index->name)));
+		add_path(baserel, (Path *) path);
+	}
+}
+
+/*
+ * dynamodb_conds_give_key
+ *		Check whether one of the given conditions gives the values of the
+ *		key column, as "key = expression" or, if allow_in, "key IN (...)",
+ *		where the expression does not use any column of the relation.
+ */
+static bool
+dynamodb_conds_give_key(Oid foreigntableid, Index relid, List *conds,
+						const char *key, bool allow_in)
+{
+	ListCell   *lc;
+
+	if (IS_KEY_EMPTY(key))
+		return false;
+
+	foreach(lc, conds)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+		List	   *args;
+		bool		scalar_array;
+		int			i;
+
+		if (IsA(rinfo->clause, OpExpr))
+		{
+			OpExpr	   *op = (OpExpr *) rinfo->clause;
+
+			if (strcmp(get_opname(op->opno), "=") != 0)
+				continue;
+			args = op->args;
+			scalar_array = false;
+		}
+		else if (IsA(rinfo->clause, ScalarArrayOpExpr))
+		{
+			ScalarArrayOpExpr *saop = (ScalarArrayOpExpr *) rinfo->clause;
+
+			if (!allow_in || !saop->useOr || strcmp(get_opname(saop->opno), "=") != 0)
+				continue;
+			args = saop->args;
+			scalar_array = true;
+		}
+		else
+			continue;
+
+		if (list_length(args) != 2)
+			continue;
+
+		/* The column may be on either side of "=", but only left of IN */
+		for (i = 0; i < (scalar_array ? 1 : 2); i++)
+		{
+			Node	   *node = (Node *) list_nth(args, i);
+			Node	   *other = (Node *) list_nth(args, 1 - i);
+			Var		   *var;
+
+			while (IsA(node, RelabelType))
+				node = (Node *) ((RelabelType *) node)->arg;
+			if (!IsA(node, Var))
+				continue;
+
+			var = (Var *) node;
+			if (var->varno == relid && var->varlevelsup == 0 &&
+				var->varattno > InvalidAttrNumber &&
+				IS_KEY_COLUMN(get_attname(foreigntableid, var->varattno, false), key) &&
+				!contain_var_clause(other))
+				return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * dynamodb_conds_are_key_conditions
+ *		Check whether DynamoDB evaluates all the given conditions as the key
+ *		conditions of a Query, with no filter: they compare the partition key
+ *		with "=", or the sort key with "=", "<", "<=", ">" or ">=", to an
+ *		expression which does not use any column of the relation, and the
+ *		partition key is given.  No condition at all is not a filter either.
+ *
+ * The conditions are bare clauses, as in remote_exprs.
+ */
+static bool
+dynamodb_conds_are_key_conditions(Oid foreigntableid, Index relid, List *conds,
+								  const char *partition_key, const char *sort_key)
+{
+	bool		has_partition_key = false;
+	ListCell   *lc;
+
+	foreach(lc, conds)
+	{
+		Expr	   *expr = (Expr *) lfirst(lc);
+		OpExpr	   *op;
+		const char *opname;
+		bool		is_key_cond = false;
+		int			i;
+
+		if (!IsA(expr, OpExpr))
+			return false;
+		op = (OpExpr *) expr;
+		if (list_length(op->args) != 2)
+			return false;
+		opname = get_opname(op->opno);
+		if (opname == NULL)
+			return false;
+
+		for (i = 0; i < 2 && !is_key_cond; i++)
+		{
+			Node	   *node = (Node *) list_nth(op->args, i);
+			Node	   *other = (Node *) list_nth(op->args, 1 - i);
+			Var		   *var;
+			char	   *attname;
+
+			while (IsA(node, RelabelType))
+				node = (Node *) ((RelabelType *) node)->arg;
+			if (!IsA(node, Var))
+				continue;
+
+			var = (Var *) node;
+			if (var->varno != relid || var->varlevelsup != 0 ||
+				var->varattno <= InvalidAttrNumber || contain_var_clause(other))
+				continue;
+
+			attname = get_attname(foreigntableid, var->varattno, false);
+			if (IS_KEY_COLUMN(attname, partition_key) && strcmp(opname, "=") == 0)
+			{
+				has_partition_key = true;
+				is_key_cond = true;
+			}
+			else if (IS_KEY_COLUMN(attname, sort_key) &&
+					 (strcmp(opname, "=") == 0 ||
+					  strcmp(opname, "<") == 0 || strcmp(opname, "<=") == 0 ||
+					  strcmp(opname, ">") == 0 || strcmp(opname, ">=") == 0))
+				is_key_cond = true;
+		}
+
+		if (!is_key_cond)
+			return false;
+	}
+
+	return conds == NIL || has_partition_key;
+}
+
+/*
+ * dynamodb_index_covers_attrs
+ *		Check whether the attributes projected into the secondary index
+ *		include all the given columns.
+ *
+ * The keys of the table are projected into every index.  A whole-row
+ * reference needs all the attributes.
+ */
+static bool
+dynamodb_index_covers_attrs(Oid foreigntableid, DynamoDBIndex *index,
+							dynamodb_opt *options, Bitmapset *attrs)
+{
+	int			col = -1;
+
+	if (index->projection == DYNAMODB_PROJECTION_ALL)
+		return true;
+
+	while ((col = bms_next_member(attrs, col)) >= 0)
+	{
+		/* bit numbers are offset by FirstLowInvalidHeapAttributeNumber */
+		AttrNumber	attno = col + FirstLowInvalidHeapAttributeNumber;
+		char	   *attname;
+		bool		covered = false;
+		ListCell   *lc;
+
+		if (attno <= InvalidAttrNumber)
+			return false;
+
+		attname = get_attname(foreigntableid, attno, false);
+		if (IS_KEY_COLUMN(attname, index->partition_key) ||
+			IS_KEY_COLUMN(attname, index->sort_key) ||
+			IS_KEY_COLUMN(attname, options->svr_partition_key) ||
+			IS_KEY_COLUMN(attname, options->svr_sort_key))
+			continue;
+
+		if (index->projection == DYNAMODB_PROJECTION_INCLUDE)
+		{
+			foreach(lc, index->include_attrs)
+			{
+				if (strcmp(strVal(lfirst(lc)), attname) == 0)
+				{
+					covered = true;
+					break;
+				}
+			}
+		}
+
+		if (!covered)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * dynamodb_ec_member_is_column
+ *		Callback for generate_implied_equalities_for_column: is the member of
+ *		the equivalence class the given column of the relation?
+ */
+static bool
+dynamodb_ec_member_is_column(PlannerInfo *root, RelOptInfo *rel,
+							 EquivalenceClass *ec, EquivalenceMember *em,
+							 void *arg)
+{
+	Var		   *var = (Var *) em->em_expr;
+
+	return IsA(var, Var) && var->varno == rel->relid &&
+		var->varlevelsup == 0 && var->varattno == *(AttrNumber *) arg;
+}
+
+/*
+ * dynamodb_join_clause_key_attno
+ *		Check whether the join clause compares a column of the relation with
+ *		a column of another relation, as "column = outer column", in a way
+ *		that a parameterized scan can send.
+ *
+ * The outer value is bound as a parameter, so its type must be one that a
+ * key attribute can take, and it must not use a non-default collation.
+ *
+ * Returns the attribute number of the column of the relation, or
+ * InvalidAttrNumber if the clause does not qualify.
+ */
+static AttrNumber
+dynamodb_join_clause_key_attno(Index relid, Expr *clause)
+{
+	OpExpr	   *op;
+	Var		   *var;
+	Var		   *outer_var;
+
+	if (!IsA(clause, OpExpr))
+		return InvalidAttrNumber;
+
+	op = (OpExpr *) clause;
+	if (list_length(op->args) != 2 ||
+		strcmp(get_opname(op->opno), "=") != 0 ||
+		(OidIsValid(op->inputcollid) && op->inputcollid != DEFAULT_COLLATION_OID))
+		return InvalidAttrNumber;
+
+	var = (Var *) linitial(op->args);
+	outer_var = (Var *) lsecond(op->args);
+	if (!IsA(var, Var) || !IsA(outer_var, Var))
+		return InvalidAttrNumber;
+
+	/* The outer column may come first, if the clause can be commuted */
+	if (var->varno != relid)
+	{
+		Var		   *tmp = var;
+
+		if (!OidIsValid(get_commutator(op->opno)))
+			return InvalidAttrNumber;
+
+		var = outer_var;
+		outer_var = tmp;
+	}
+
+	if (var->varno != relid || var->varlevelsup != 0 ||
+		var->varattno <= InvalidAttrNumber ||
+		outer_var->varno == relid || outer_var->varlevelsup != 0)
+		return InvalidAttrNumber;
+
+	if (!dynamodb_is_key_type(var->vartype) ||
+		!dynamodb_is_key_type(outer_var->vartype))
+		return InvalidAttrNumber;
+
+	return var->varattno;
+}
+
+/*
+ * dynamodb_conds_use_partition_key
+ *		Check whether any of the given conditions refers to the partition key.
+ *
+ * Without a partition_key option, any column might be the partition key.
+ */
+static bool
+dynamodb_conds_use_partition_key(RelOptInfo *baserel, Oid foreigntableid,
+								 List *conds, const char *partition_key)
+{
+	Bitmapset  *attrs_used = NULL;
+	int			col = -1;
+	ListCell   *lc;
+
+	foreach(lc, conds)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+
+		pull_varattnos((Node *) rinfo->clause, baserel->relid, &attrs_used);
+	}
+
+	if (attrs_used == NULL)
+		return false;
+
+	if (IS_KEY_EMPTY(partition_key))
+		return true;
+
+	while ((col = bms_next_member(attrs_used, col)) >= 0)
+	{
+		/* bit numbers are offset by FirstLowInvalidHeapAttributeNumber */
+		AttrNumber	attno = col + FirstLowInvalidHeapAttributeNumber;
+
+		/* A whole-row reference covers the partition key too */
+		if (attno <= InvalidAttrNumber)
+			return true;
+
+		if (IS_KEY_COLUMN(get_attname(foreigntableid, attno, false), partition_key))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * dynamodb_get_lookup_keys
+ *		Get the values of the primary key given by the conditions, if that is
+ *		all they restrict.
+ *
+ * Every condition must compare the partition key or the sort key with a
+ * constant or a parameter, or a list of them, and each key column must be
+ * compared exactly once, so that the items can be read by key.
+ *
+ * Returns NIL if the conditions do not qualify.  Otherwise, returns the
+ * remote name of the partition key and the list of its values, followed by
+ * the same for the sort key if the table has one.
+ */
+static List *
+dynamodb_get_lookup_keys(Oid foreigntableid, Index relid, List *conds,
+						 List *params_list,
+						 const char *partition_key, const char *sort_key)
+{
+	Var		   *partition_var = NULL;
+	Var		   *sort_var = NULL;
+	List	   *partition_values = NIL;
+	List	   *sort_values = NIL;
+	List	   *lookup_keys;
+	ListCell   *lc;
+
+	if (IS_KEY_EMPTY(partition_key))
+		return NIL;
+
+	foreach(lc, conds)
+	{
+		Var		   *var;
+		List	   *values;
+		char	   *colname;
+
+		if (!dynamodb_key_cond_values((Expr *) lfirst(lc), relid, params_list,
+									  &var, &values))
+			return NIL;
+
+		colname = get_attname(foreigntableid, var->varattno, false);
+		if (IS_KEY_COLUMN(colname, partition_key) && partition_var == NULL)
+		{
+			partition_var = var;
+			partition_values = values;
+		}
+		else if (IS_KEY_COLUMN(colname, sort_key) && sort_var == NULL)
+		{
+			sort_var = var;
+			sort_values = values;
+		}
+		else
+			return NIL;
+	}
+
+	if (partition_var == NULL ||
+		(!IS_KEY_EMPTY(sort_key) && sort_var == NULL))
+		return NIL;
+
+	lookup_keys = list_make2(makeString(dynamodb_get_column_name(foreigntableid,
+																 partition_var->varattno)),
+							 partition_values);
+	if (sort_var != NULL)
+	{
+		lookup_keys = lappend(lookup_keys,
+							  makeString(dynamodb_get_column_name(foreigntableid,
+																  sort_var->varattno)));
+		lookup_keys = lappend(lookup_keys, sort_values);
+	}
+
+	return lookup_keys;
+}
+
+/*
+ * dynamodb_key_cond_values
+ *		Check whether the condition compares a column of the relation with
+ *		constants, as "column = constant" or "column IN (constants)", or with
+ *		values sent as parameters, such as an outer column or a Param.
+ *
+ * If so, the column is returned in *var, and the distinct non-null constants
+ * in *values: NULL never equals a key.  A parameter is given by its index in
+ * params_list, as an Integer.
+ */
+static bool
+dynamodb_key_cond_values(Expr *expr, Index relid, List *params_list,
+						 Var **var, List **values)
+{
+	Node	   *left;
+	Node	   *right;
+	Const	   *c;
+	Node	   *param;
+
+	*values = NIL;
+
+	if (IsA(expr, OpExpr))
+	{
+		OpExpr	   *op = (OpExpr *) expr;
+
+		if (list_length(op->args) != 2 ||
+			strcmp(get_opname(op->opno), "=") != 0)
+			return false;
+
+		left = (Node *) linitial(op->args);
+		right = (Node *) lsecond(op->args);
+
+		/* The constant, or the parameter, may come first */
+		if (IsA(left, Const) ||
+			(IsA(left, Var) && ((Var *) left)->varno != relid) ||
+			dynamodb_is_param_expr(left))
+		{
+			Node	   *tmp = left;
+
+			left = right;
+			right = tmp;
+		}
+	}
+	else if (IsA(expr, ScalarArrayOpExpr))
+	{
+		ScalarArrayOpExpr *saop = (ScalarArrayOpExpr *) expr;
+
+		if (!saop->useOr || strcmp(get_opname(saop->opno), "=") != 0)
+			return false;
+
+		left = (Node *) linitial(saop->args);
+		right = (Node *) lsecond(saop->args);
+	}
+	else
+		return false;
+
+	/* The column may be relabeled, e.g. a varchar compared as text */
+	if (IsA(left, RelabelType))
+		left = (Node *) ((RelabelType *) left)->arg;
+
+	if (!IsA(left, Var))
+		return false;
+
+	*var = (Var *) left;
+	if ((*var)->varno != relid || (*var)->varlevelsup != 0 ||
+		(*var)->varattno <= InvalidAttrNumber)
+		return false;
+
+	if (IsA(expr, OpExpr) && !IsA(right, Const))
+	{
+		if (!dynamodb_is_key_type(exprType(right)) ||
+			(param = dynamodb_key_param(right, params_list)) == NULL)
+			return false;
+
+		*values = list_make1(param);
+		return true;
+	}
+
+	/* "column IN (...)" with parameters in the list */
+	if (IsA(right, ArrayExpr))
+	{
+		ArrayExpr  *a = (ArrayExpr *) right;
+		ListCell   *lc;
+
+		if (!dynamodb_is_key_type(a->element_typeid))
+			return false;
+
+		foreach(lc, a->elements)
+		{
+			Node	   *elem = (Node *) lfirst(lc);
+
+			if (!IsA(elem, Const))
+			{
+				if ((param = dynamodb_key_param(elem, params_list)) == NULL)
+					return false;
+				*values = lappend(*values, param);
+			}
+			else if (!((Const *) elem)->constisnull)
+				*values = lappend(*values, elem);
+		}
+		return true;
+	}
+
+	if (!IsA(right, Const))
+		return false;
+
+	c = (Const *) right;
+	if (IsA(expr, OpExpr))
+	{
+		if (!dynamodb_is_key_type(c->consttype))
+			return false;
+
+		if (!c->constisnull)
+			*values = list_make1(c);
+	}
+	else if (!c->constisnull)
+	{
+		ArrayType  *arr = DatumGetArrayTypeP(c->constvalue);
+		Oid			elmtype = ARR_ELEMTYPE(arr);
+		int16		elmlen;
+		bool		elmbyval;
+		char		elmalign;
+		Datum	   *elems;
+		bool	   *nulls;
+		int			nelems;
+
+		if (!dynamodb_is_key_type(elmtype))
+			return false;
+
+		get_typlenbyvalalign(elmtype, &elmlen, &elmbyval, &elmalign);
+		deconstruct_array(arr, elmtype, elmlen, elmbyval, elmalign,
+						  &elems, &nulls, &nelems);
+
+		for (int i = 0; i < nelems; i++)
+		{
+			bool		duplicate = false;
+			ListCell   *lc;
+
+			if (nulls[i])
+				continue;
+
+			foreach(lc, *values)
+			{
+				if (datumIsEqual(((Const *) lfirst(lc))->constvalue, elems[i],
+								 elmbyval, elmlen))
+				{
+					duplicate = true;
+					break;
+				}
+			}
+
+			if (!duplicate)
+				*values = lappend(*values, makeConst(elmtype, -1, c->constcollid,
+													 elmlen, elems[i], false,
+													 elmbyval));
+		}
+	}
+
+	return true;
+}
+
+/*
+ * dynamodb_key_param
+ *		Return the index in params_list of the parameter which the deparser
+ *		has made of the expression, as an Integer node, or NULL if there is
+ *		none.
+ */
+static Node *
+dynamodb_key_param(Node *expr, List *params_list)
+{
+	int			paramno = 0;
+	ListCell   *lc;
+
+	foreach(lc, params_list)
+	{
+		if (lfirst(lc) == expr)
+			return (Node *) makeInteger(paramno);
+		paramno++;
+	}
+
+	return NULL;
+}
+
+/*
+ * dynamodb_is_key_type
+ *		Can values of the type be bound as a key attribute, which is a
+ *		string, a number or a binary?
+ */
+static bool
+dynamodb_is_key_type(Oid type)
+{
+	switch (type)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case FLOAT4OID:
+		case FLOAT8OID:
+		case NUMERICOID:
+		case TEXTOID:
+		case VARCHAROID:
+		case BYTEAOID:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+ * dynamodbGetForeignPlan
+ *		Create ForeignScan plan node which implements selected best path
+ */
+extern "C" ForeignScan *
+dynamodbGetForeignPlan(PlannerInfo *root,
+					   RelOptInfo *foreignrel,
+					   Oid foreigntableid,
+					   ForeignPath *best_path,
+					   List *tlist,
+					   List *scan_clauses,
+					   Plan *outer_plan)
+{
+	DynamoDBFdwRelationInfo *fpinfo = (DynamoDBFdwRelationInfo *) foreignrel->fdw_private;
+	Index		scan_relid;
+	List	   *fdw_private;
+	List	   *remote_exprs = NIL;
+	List	   *local_exprs = NIL;
+	List	   *fdw_scan_tlist = NIL;
+	List	   *fdw_recheck_quals = NIL;
+	List	   *retrieved_attrs = NIL;
+	List	   *params_list = NIL;
+	List	   *lookup_keys = NIL;
+	StringInfoData sql;
+	bool		tlist_has_json_arrow_op;
+	bool		parallel_scan = best_path->path.parallel_aware;
+	bool		parameterized = best_path->path.param_info != NULL;
+	char	   *index_name = NULL;
+	int			total_segments = 0;
+	int			limit = 0;
+	bool		limit_reads = false;
+	ListCell   *lc;
+
+	/* An upper relation counts or aggregates the items of a foreign table */
+	if (IS_UPPER_REL(foreignrel))
+	{
+		if (fpinfo->count_agg != NULL)
+			return dynamodb_get_count_plan(root, foreignrel, tlist, outer_plan);
+		return dynamodb_get_agg_plan(root, foreignrel, tlist, outer_plan);
+	}
+
+	/* DynamoDB FDW only support simple relation */
+	Assert(IS_SIMPLE_REL(foreignrel));
+
+	/* A path made by dynamodb_add_index_paths reads a secondary index */
+	if (best_path->fdw_private != NIL)
+		index_name = strVal(list_nth(best_path->fdw_private,
+									 FdwPathPrivateSecondaryIndex));
+
+	/*
+	 * Decide to execute Json arrow operator support in the target list.
+	 * A parallel scan uses the Scan API, which only reads whole attributes.
+	 * The scan tlist of a parameterized scan must not take in outer columns.
+	 */
+	if (parallel_scan || parameterized)
+		tlist_has_json_arrow_op = false;
+	else
+		tlist_has_json_arrow_op = dynamodb_tlist_has_json_arrow_op(root, foreignrel, tlist);
+
+	/*
+	 * For base relations, set scan_relid as the relid of the relation.
+	 */
+	scan_relid = foreignrel->relid;
+
+	/*
+	 * In a base-relation scan, we must apply the given scan_clauses.
+	 *
+	 * Separate the scan_clauses into those that can be executed remotely
+	 * and those that can't.  baserestrictinfo clauses that were
+	 * previously determined to be safe or unsafe by classifyConditions
+	 * are found in fpinfo->remote_conds and fpinfo->local_conds.
+	 *
+	 * This code must match "extract_actual_clauses(scan_clauses, false)"
+	 * except for the additional decision about remote versus local
+	 * execution.
+	 */
+	foreach(lc, scan_clauses)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+
+		/* Ignore any pseudoconstants, they're dealt with elsewhere */
+		if (rinfo->pseudoconstant)
+			continue;
+
+		/* The Scan segments of a parallel scan are not filtered remotely */
+		if (parallel_scan)
+			local_exprs = lappend(local_exprs, rinfo->clause);
+		else if (list_member_ptr(fpinfo->remote_conds, rinfo))
+			remote_exprs = lappend(remote_exprs, rinfo->clause);
+		else if (list_member_ptr(fpinfo->local_conds, rinfo))
+			local_exprs = lappend(local_exprs, rinfo->clause);
+		else if (parameterized &&
+				 dynamodb_join_clause_key_attno(scan_relid, rinfo->clause) != InvalidAttrNumber)
+		{
+			OpExpr	   *op = (OpExpr *) rinfo->clause;
+
+			/* Send it as "column = ?", which is how DynamoDB finds the key */
+			if (((Var *) linitial(op->args))->varno != scan_relid)
+			{
+				op = (OpExpr *) copyObject(op);
+				CommuteOpExpr(op);
+			}
+			remote_exprs = lappend(remote_exprs, op);
+		}
+		else if (dynamodb_is_foreign_expr(root, foreignrel, rinfo->clause))
+			remote_exprs = lappend(remote_exprs, rinfo->clause);
+		else
+			local_exprs = lappend(local_exprs, rinfo->clause);
+	}
+
+	/*
+	 * For a base-relation scan, we have to support EPQ recheck, which
+	 * should recheck all the remote quals.
+	 */
+	fdw_recheck_quals = remote_exprs;
+
+	/* Remember remote_exprs for possible use by dynamodbPlanDirectModify */
+	fpinfo->final_remote_exprs = remote_exprs;
+
+	/*
+	 * Build the list of columns that contain Jsonb arrow operator
+	 * to be fetched from the foreign server.
+	 */
+	if (tlist_has_json_arrow_op == true)
+	{
+		List	 *document_path_list = NIL;
+
+		if (tlist)
+			fdw_scan_tlist = list_copy(tlist);
+		else
+			fdw_scan_tlist = add_to_flat_tlist(fdw_scan_tlist, foreignrel->reltarget->exprs);
+
+		foreach(lc, local_exprs)
+		{
+			Node *node = (Node *)lfirst(lc);
+
+			fdw_scan_tlist = add_to_flat_tlist(fdw_scan_tlist,
+												pull_var_clause((Node *) node,
+																PVC_RECURSE_PLACEHOLDERS));
+		}
+		foreach(lc, remote_exprs)
+		{
+			Node *node = (Node *)lfirst(lc);
+
+			fdw_scan_tlist = add_to_flat_tlist(fdw_scan_tlist,
+												pull_var_clause((Node *) node,
+																PVC_RECURSE_PLACEHOLDERS));
+		}
+
+		/*
+		 * DynamoDB does not support overlap document path.
+		 * For example: SELECT friends.login.lastsignin, friends.login, friends.
+		 * Therefore, do not push down arrow operators in that case.
+		 */
+		foreach(lc, fdw_scan_tlist)
+		{
+			StringInfoData document_path;
+			Expr *expr = ((TargetEntry *)lfirst(lc))->expr;
+			ListCell *attlc;
+
+			initStringInfo(&document_path);
+			dynamodb_get_document_path(&document_path, root, foreignrel, expr);
+
+			foreach(attlc, document_path_list)
+			{
+				char *target_name = strVal(lfirst(attlc));
+
+				if (strstr(target_name, document_path.data) != NULL ||
+					strstr(document_path.data, target_name) != NULL)
+				{
+					fdw_scan_tlist = NULL;
+					tlist_has_json_arrow_op = false;
+					break;
+				}
+			}
+			document_path_list = lappend(document_path_list, makeString(document_path.data));
+		}
+	}
+
+	/*
+	 * The columns used by the conditions which have been moved to the local
+	 * side must be retrieved as well.  The PartiQL query of a parallel scan
+	 * is only kept for EXPLAIN and error reports.
+	 */
+	if (parallel_scan)
+	{
+		foreach(lc, fpinfo->remote_conds)
+		{
+			RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+
+			pull_varattnos((Node *) rinfo->clause, foreignrel->relid,
+						   &fpinfo->attrs_used);
+		}
+		total_segments = (best_path->path.parallel_workers + 1) * DYNAMODB_SEGMENTS_PER_WORKER;
+	}
+
+	/*
+	 * Build the query string to be sent for execution, and identify
+	 * expressions to be sent as parameters.
+	 */
+	initStringInfo(&sql);
+	dynamodb_deparse_select_stmt_for_rel(&sql, root, foreignrel, fdw_scan_tlist,
+							remote_exprs, best_path->path.pathkeys, index_name,
+							&retrieved_attrs, &params_list);
+
+	/*
+	 * When the conditions only give the values of the primary key, read the
+	 * items with GetItem/BatchGetItem instead of running the query.  Those
+	 * requests read whole attributes only, and return the items in no
+	 * particular order.  The query is kept for EXPLAIN and error reports.
+	 */
+	if (!parallel_scan && !tlist_has_json_arrow_op && index_name == NULL &&
+		best_path->path.pathkeys == NIL)
+		lookup_keys = dynamodb_get_lookup_keys(foreigntableid, scan_relid, remote_exprs,
+											   params_list,
+											   fpinfo->options->svr_partition_key,
+											   fpinfo->options->svr_sort_key);
+
+	/*
+	 * The query may stop reading after the rows its LIMIT needs, if the scan
+	 * returns exactly the rows the LIMIT sees: all the conditions must be
+	 * checked remotely, and the rows must come in the order of the query.
+	 */
+	if (fpinfo->limit_tuples > 0 && !parallel_scan && !parameterized &&
+		lookup_keys == NIL && local_exprs == NIL &&
+		pathkeys_contained_in(root->sort_pathkeys, best_path->path.pathkeys))
+	{
+		limit = (int) fpinfo->limit_tuples;
+
+		/*
+		 * DynamoDB applies the Limit of a request to the items it reads,
+		 * before any filter, so with a filter a small Limit would only split
+		 * the scan into many small requests.  It is then left to DynamoDB's
+		 * own page size, and the scan just stops after enough rows.
+		 */
+		limit_reads = index_name == NULL &&
+			dynamodb_conds_are_key_conditions(foreigntableid, scan_relid, remote_exprs,
+											  fpinfo->options->svr_partition_key,
+											  fpinfo->options->svr_sort_key);
+	}
+
+	/*
+	 * Build the fdw_private list that will be available to the executor.
+	 * Items in the list must match order in enum FdwScanPrivateIndex.
+	 */
+	fdw_private = list_make4(makeString(sql.data),
+							 retrieved_attrs,
+							 makeString(dynamodb_get_table_name(foreigntableid)),
+							 makeInteger(total_segments));
+	fdw_private = lappend(fdw_private, lookup_keys);
+	fdw_private = lappend(fdw_private, makeInteger(limit));
+	fdw_private = lappend(fdw_private, makeInteger(limit_reads ? 1 : 0));
+	fdw_private = lappend(fdw_private, NIL);
+	fdw_private = lappend(fdw_private, NIL);
+
+	/*
+	 * Create the ForeignScan node for the given relation.
+	 *
+	 * Note that the remote parameter expressions are stored in the fdw_exprs
+	 * field of the finished plan node; we can't keep them in private state
+	 * because then they wouldn't be subject to later planner processing.
+	 */
+	return make_foreignscan(tlist,
+							local_exprs,
+							scan_relid,
+							params_list,
+							fdw_private,
+							fdw_scan_tlist,
+							fdw_recheck_quals,
+							outer_plan);
+}
+
+/*
+ * dynamodb_get_count_plan
+ *		Create the ForeignScan plan node of a path made by
+ *		dynamodb_add_count_path
+ *
+ * The scan returns a single row holding the count, computed by the Query or
+ * Scan request built by dynamodb_deparse_count_request.  The values of its
+ * conditions are sent as the parameters of the scan.
+ */
+static ForeignScan *
+dynamodb_get_count_plan(PlannerInfo *root, RelOptInfo *foreignrel, List *tlist,
+						Plan *outer_plan)
+{
+	DynamoDBFdwRelationInfo *fpinfo = (DynamoDBFdwRelationInfo *) foreignrel->fdw_private;
+	RelOptInfo *baserel = fpinfo->outerrel;
+	DynamoDBFdwRelationInfo *ofpinfo = (DynamoDBFdwRelationInfo *) baserel->fdw_private;
+	Aggref	   *agg = fpinfo->count_agg;
+	Var		   *count_var = NULL;
+	List	   *fdw_private;
+	List	   *fdw_scan_tlist;
+	List	   *attr_names = NIL;
+	List	   *params_list = NIL;
+	StringInfoData desc;
+	StringInfoData key_condition;
+	StringInfoData filter;
+
+	if (!agg->aggstar)
+	{
+		Expr	   *arg = ((TargetEntry *) linitial(agg->args))->expr;
+
+		if (IsA(arg, RelabelType))
+			arg = ((RelabelType *) arg)->arg;
+		count_var = (Var *) arg;
+	}
+
+	initStringInfo(&desc);
+	initStringInfo(&key_condition);
+	initStringInfo(&filter);
+	if (!dynamodb_deparse_count_request(&desc, root, baserel, ofpinfo->remote_conds,
+										count_var, &key_condition, &filter,
+										&attr_names, &params_list))
+		elog(ERROR, "dynamodb_fdw: could not build the request counting the items");
+
+	/* The scan returns the count as its only column */
+	fdw_scan_tlist = list_make1(makeTargetEntry((Expr *) agg, 1, NULL, false));
+
+	/*
+	 * Build the fdw_private list that will be available to the executor.
+	 * Items in the list must match order in enum FdwScanPrivateIndex.
+	 */
+	fdw_private = list_make4(makeString(desc.data),
+							 NIL,
+							 makeString(dynamodb_get_table_name(ofpinfo->table->relid)),
+							 makeInteger(0));
+	fdw_private = lappend(fdw_private, NIL);
+	fdw_private = lappend(fdw_private, makeInteger(0));
+	fdw_private = lappend(fdw_private, makeInteger(0));
+	fdw_private = lappend(fdw_private, list_make3(makeString(key_condition.data),
+												  makeString(filter.data),
+												  attr_names));
+	fdw_private = lappend(fdw_private, NIL);
+
+	return make_foreignscan(tlist,
+							NIL,
+							0,
+							params_list,
+							fdw_private,
+							fdw_scan_tlist,
+							NIL,
+							outer_plan);
+}
+
+/*
+ * dynamodb_is_count_agg
+ *		Is this count(*), or count() of a column of the relation, with no
+ *		DISTINCT, ORDER BY or FILTER?
+ */
+static bool
+dynamodb_is_count_agg(Aggref *agg, RelOptInfo *rel)
+{
+	Expr	   *arg;
+	Var		   *var;
+
+	if (!dynamodb_is_builtin(agg->aggfnoid) ||
+		strcmp(get_func_name(agg->aggfnoid), "count") != 0)
+		return false;
+
+	if (agg->aggkind != AGGKIND_NORMAL || agg->agglevelsup != 0 ||
+		agg->aggsplit != AGGSPLIT_SIMPLE || agg->aggdistinct != NIL ||
+		agg->aggorder != NIL || agg->aggfilter != NULL)
+		return false;
+
+	if (agg->aggstar)
+		return true;
+
+	if (list_length(agg->args) != 1)
+		return false;
+	arg = ((TargetEntry *) linitial(agg->args))->expr;
+	if (IsA(arg, RelabelType))
+		arg = ((RelabelType *) arg)->arg;
+	if (!IsA(arg, Var))
+		return false;
+	var = (Var *) arg;
+
+	return var->varno == rel->relid && var->varlevelsup == 0 && var->varattno > 0;
+}
+
+/*
+ * dynamodb_add_count_path
+ *		Add a path counting the items of the foreign table remotely
+ *
+ * A query which only computes count(*), or count() of one column, over the
+ * rows of one foreign table, with no GROUP BY or HAVING, is run as a Query or
+ * Scan request with Select=COUNT: DynamoDB counts the items and no item is
+ * transferred.  All the conditions of the table must be expressible as
+ * condition expressions.
+ */
+static bool
+dynamodb_add_count_path(PlannerInfo *root, RelOptInfo *input_rel,
+						RelOptInfo *grouped_rel, GroupPathExtraData *extra)
+{
+	Query	   *parse = root->parse;
+	DynamoDBFdwRelationInfo *ifpinfo = (DynamoDBFdwRelationInfo *) input_rel->fdw_private;
+	DynamoDBFdwRelationInfo *fpinfo;
+	PathTarget *grouping_target = grouped_rel->reltarget;
+	Aggref	   *count_agg = NULL;
+	Var		   *count_var = NULL;
+	List	   *attr_names = NIL;
+	List	   *params_list = NIL;
+	StringInfoData desc;
+	StringInfoData key_condition;
+	StringInfoData filter;
+	ForeignPath *grouppath;
+	double		rows;
+	Cost		startup_cost;
+	Cost		total_cost;
+	ListCell   *lc;
+
+	/* Nothing to be done, if there is no grouping or aggregation required. */
+	if (!parse->groupClause && !parse->groupingSets && !parse->hasAggs &&
+		!root->hasHavingQual)
+		return false;
+
+	/* The aggregate must be computed over the rows of one foreign table */
+	if (input_rel->reloptkind != RELOPT_BASEREL || ifpinfo == NULL ||
+		grouped_rel->fdw_private != NULL)
+		return false;
+
+	/* There is a single group, and all its rows are counted */
+	if (parse->groupClause != NIL || parse->groupingSets != NIL ||
+		root->hasHavingQual || extra->patype != PARTITIONWISE_AGGREGATE_NONE)
+		return false;
+
+	/* Each condition must be checked by the request, none locally */
+	if (ifpinfo->local_conds != NIL || root->hasPseudoConstantQuals)
+		return false;
+
+	/*
+	 * The output may compute expressions of the count, but it must not need
+	 * anything else from the rows.
+	 */
+	foreach(lc, pull_var_clause((Node *) grouping_target->exprs,
+								PVC_INCLUDE_AGGREGATES | PVC_INCLUDE_PLACEHOLDERS))
+	{
+		Node	   *node = (Node *) lfirst(lc);
+
+		if (!IsA(node, Aggref))
+			return false;
+		if (count_agg == NULL)
+		{
+			if (!dynamodb_is_count_agg((Aggref *) node, input_rel))
+				return false;
+			count_agg = (Aggref *) node;
+		}
+		else if (!equal(node, count_agg))
+			return false;
+	}
+	if (count_agg == NULL)
+		return false;
+
+	if (!count_agg->aggstar)
+	{
+		Expr	   *arg = ((TargetEntry *) linitial(count_agg->args))->expr;
+
+		if (IsA(arg, RelabelType))
+			arg = ((RelabelType *) arg)->arg;
+		count_var = (Var *) arg;
+	}
+
+	/* Make sure the conditions can all be sent */
+	initStringInfo(&desc);
+	initStringInfo(&key_condition);
+	initStringInfo(&filter);
+	if (!dynamodb_deparse_count_request(&desc, root, input_rel, ifpinfo->remote_conds,
+										count_var, &key_condition, &filter,
+										&attr_names, &params_list))
+		return false;
+
+	/*
+	 * Create the upper relation's fpinfo, with the table and options of the
+	 * relation counted.
+	 */
+	fpinfo = (DynamoDBFdwRelationInfo *) palloc0(sizeof(DynamoDBFdwRelationInfo));
+	fpinfo->pushdown_safe = true;
+	fpinfo->outerrel = input_rel;
+	fpinfo->count_agg = count_agg;
+	fpinfo->table = ifpinfo->table;
+	fpinfo->server = ifpinfo->server;
+	fpinfo->options = ifpinfo->options;
+	fpinfo->fdw_startup_cost = ifpinfo->fdw_startup_cost;
+	fpinfo->fdw_tuple_cost = ifpinfo->fdw_tuple_cost;
+	fpinfo->shippable_extensions = ifpinfo->shippable_extensions;
+	grouped_rel->fdw_private = fpinfo;
+
+	/* Make sure the cost of reading the table has been estimated */
+	if (ifpinfo->rel_total_cost < 0)
+	{
+		double		scan_rows;
+		int			scan_width;
+		Cost		scan_startup_cost;
+		Cost		scan_total_cost;
+
+		dynamodb_estimate_path_cost_size(root, input_rel, NIL, NIL, NULL,
+										 &scan_rows, &scan_width,
+										 &scan_startup_cost, &scan_total_cost);
+	}
+
+	/*
+	 * DynamoDB still reads the items, but only the count comes back: one
+	 * row, after all the items have been counted.
+	 */
+	rows = 1;
+	startup_cost = ifpinfo->rel_total_cost + ifpinfo->fdw_startup_cost +
+		cpu_operator_cost * ifpinfo->retrieved_rows;
+	total_cost = startup_cost + ifpinfo->fdw_tuple_cost + cpu_tuple_cost;
+
+	fpinfo->rows = rows;
+	fpinfo->width = grouping_target->width;
+	fpinfo->startup_cost = startup_cost;
+	fpinfo->total_cost = total_cost;
+
+	grouppath = create_foreign_upper_path(root,
+										  grouped_rel,
+										  grouping_target,
+										  rows,
+										  startup_cost,
+										  total_cost,
+										  NIL,	/* no pathkeys */
+										  NULL,
+#if PG_VERSION_NUM >= 170000
+										  NIL,	/* no fdw_restrictinfo list */
+#endif
+										  NIL);	/* no fdw_private */
+
+	add_path(grouped_rel, (Path *) grouppath);
+
+	return true;
+}
+
+/*
+ * dynamodb_get_agg_plan
+ *		Create the ForeignScan plan node of a path made by
+ *		dynamodb_add_agg_path
+ *
+ * The items are read by the PartiQL statement of a scan of the table, and
+ * aggregated by the scan as they are decoded.
+ */
+static ForeignScan *
+dynamodb_get_agg_plan(PlannerInfo *root, RelOptInfo *foreignrel, List *tlist,
+					  Plan *outer_plan)
+{
+	DynamoDBFdwRelationInfo *fpinfo = (DynamoDBFdwRelationInfo *) foreignrel->fdw_private;
+	RelOptInfo *baserel = fpinfo->outerrel;
+	DynamoDBFdwRelationInfo *ofpinfo = (DynamoDBFdwRelationInfo *) baserel->fdw_private;
+	List	   *remote_exprs;
+	List	   *retrieved_attrs = NIL;
+	List	   *params_list = NIL;
+	List	   *fdw_private;
+	StringInfoData sql;
+
+	/* All the conditions of the table are checked by the statement */
+	remote_exprs = extract_actual_clauses(ofpinfo->remote_conds, false);
+
+	initStringInfo(&sql);
+	dynamodb_deparse_select_stmt_for_rel(&sql, root, baserel, NIL, remote_exprs, NIL,
+										 NULL, &retrieved_attrs, &params_list);
+
+	/*
+	 * Build the fdw_private list that will be available to the executor.
+	 * Items in the list must match order in enum FdwScanPrivateIndex.
+	 */
+	fdw_private = list_make4(makeString(sql.data),
+							 retrieved_attrs,
+							 makeString(dynamodb_get_table_name(ofpinfo->table->relid)),
+							 makeInteger(0));
+	fdw_private = lappend(fdw_private, NIL);
+	fdw_private = lappend(fdw_private, makeInteger(0));
+	fdw_private = lappend(fdw_private, makeInteger(0));
+	fdw_private = lappend(fdw_private, NIL);
+	fdw_private = lappend(fdw_private, fpinfo->aggregates);
+
+	return make_foreignscan(tlist,
+							NIL,
+							0,
+							params_list,
+							fdw_private,
+							fpinfo->agg_tlist,
+							NIL,
+							outer_plan);
+}
+
+/*
+ * dynamodb_get_agg_kind
+ *		Find out whether the scan can compute this aggregate, and how.
+ *
+ * count(), sum(), avg(), min() and max() of a column of the relation are
+ * computed, with no DISTINCT, ORDER BY or FILTER.  sum() and avg() take
+ * numbers, and their result must have the type the built-in aggregate gives
+ * for the type of the column; min() and max() take any type with a btree
+ * comparison function.  *attnum is set to the column, 0 for count(*).
+ */
+static bool
+dynamodb_get_agg_kind(Aggref *agg, RelOptInfo *rel, DynamoDBAggKind *kind,
+					  AttrNumber *attnum)
+{
+	char	   *name;
+	Expr	   *arg;
+	Var		   *var;
+	Oid			type;
+	Oid			result_type;
+
+	if (!dynamodb_is_builtin(agg->aggfnoid))
+		return false;
+
+	if (agg->aggkind != AGGKIND_NORMAL || agg->agglevelsup != 0 ||
+		agg->aggsplit != AGGSPLIT_SIMPLE || agg->aggdistinct != NIL ||
+		agg->aggorder != NIL || agg->aggfilter != NULL)
+		return false;
+
+	name = get_func_name(agg->aggfnoid);
+	if (strcmp(name, "count") == 0)
+		*kind = DYNAMODB_AGG_COUNT;
+	else if (strcmp(name, "sum") == 0)
+		*kind = DYNAMODB_AGG_SUM;
+	else if (strcmp(name, "avg") == 0)
+		*kind = DYNAMODB_AGG_AVG;
+	else if (strcmp(name, "min") == 0)
+		*kind = DYNAMODB_AGG_MIN;
+	else if (strcmp(name, "max") == 0)
+		*kind = DYNAMODB_AGG_MAX;
+	else
+		return false;
+
+	if (agg->aggstar)
+	{
+		*attnum = 0;
+		return *kind == DYNAMODB_AGG_COUNT;
+	}
+
+	if (list_length(agg->args) != 1)
+		return false;
+	arg = ((TargetEntry *) linitial(agg->args))->expr;
+	type = exprType((Node *) arg);
+	if (IsA(arg, RelabelType))
+		arg = ((RelabelType *) arg)->arg;
+	if (!IsA(arg, Var))
+		return false;
+	var = (Var *) arg;
+	if (var->varno != rel->relid || var->varlevelsup != 0 || var->varattno <= 0)
+		return false;
+	*attnum = var->varattno;
+
+	switch (*kind)
+	{
+		case DYNAMODB_AGG_COUNT:
+			return true;
+
+		case DYNAMODB_AGG_MIN:
+		case DYNAMODB_AGG_MAX:
+			{
+				TypeCacheEntry *typentry = lookup_type_cache(type, TYPECACHE_CMP_PROC);
+
+				return OidIsValid(typentry->cmp_proc) && agg->aggtype == type;
+			}
+
+		default:
+			break;
+	}
+
+	/* sum() and avg() are computed for the type of the column */
+	if (type != var->vartype)
+		return false;
+
+	switch (type)
+	{
+		case INT2OID:
+		case INT4OID:
+			result_type = (*kind == DYNAMODB_AGG_SUM) ? INT8OID : NUMERICOID;
+			break;
+		case INT8OID:
+		case NUMERICOID:
+			result_type = NUMERICOID;
+			break;
+		case FLOAT4OID:
+			result_type = (*kind == DYNAMODB_AGG_SUM) ? FLOAT4OID : FLOAT8OID;
+			break;
+		case FLOAT8OID:
+			result_type = FLOAT8OID;
+			break;
+		default:
+			return false;
+	}
+
+	return agg->aggtype == result_type;
+}
+
+/*
+ * dynamodb_add_agg_path
+ *		Add a path computing the aggregates of the query while the items of
+ *		the foreign table are decoded
+ *
+ * DynamoDB has no remote aggregation besides counting, so the items are
+ * still read, but the scan aggregates each item as it is decoded, instead of
+ * forming a tuple for the Agg node.  The query may group by one column, of a
+ * hashable type, and may have no HAVING.  All the conditions of the table
+ * must be checked by the PartiQL statement, with no parameter: a NULL
+ * parameter would need the rows to be checked locally.
+ */
+static void
+dynamodb_add_agg_path(PlannerInfo *root, RelOptInfo *input_rel,
+					  RelOptInfo *grouped_rel, GroupPathExtraData *extra)
+{
+	Query	   *parse = root->parse;
+	DynamoDBFdwRelationInfo *ifpinfo = (DynamoDBFdwRelationInfo *) input_rel->fdw_private;
+	DynamoDBFdwRelationInfo *fpinfo;
+	PathTarget *grouping_target = grouped_rel->reltarget;
+	Var		   *group_var = NULL;
+	List	   *agg_tlist = NIL;
+	List	   *columns = NIL;
+	int			naggs = 0;
+	ForeignPath *grouppath;
+	double		rows;
+	Cost		startup_cost;
+	Cost		total_cost;
+	ListCell   *lc;
+
+	/* Nothing to be done, if there is no grouping or aggregation required. */
+	if (!parse->groupClause && !parse->groupingSets && !parse->hasAggs &&
+		!root->hasHavingQual)
+		return;
+
+	/* The aggregates must be computed over the rows of one foreign table */
+	if (input_rel->reloptkind != RELOPT_BASEREL || ifpinfo == NULL ||
+		grouped_rel->fdw_private != NULL)
+		return;
+
+	if (parse->groupingSets != NIL || list_length(parse->groupClause) > 1 ||
+		root->hasHavingQual || extra->patype != PARTITIONWISE_AGGREGATE_NONE)
+		return;
+
+	/* Each condition must be checked by the statement, none locally */
+	if (ifpinfo->local_conds != NIL || root->hasPseudoConstantQuals)
+		return;
+	foreach(lc, ifpinfo->remote_conds)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+
+		if (dynamodb_contain_param_expr((Node *) rinfo->clause))
+			return;
+	}
+
+	/* The groups are found by the hash of the GROUP BY column */
+	if (parse->groupClause != NIL)
+	{
+		SortGroupClause *sgc = linitial_node(SortGroupClause, parse->groupClause);
+		Expr	   *expr = (Expr *) get_sortgroupclause_expr(sgc, parse->targetList);
+		TypeCacheEntry *typentry;
+
+		if (!IsA(expr, Var))
+			return;
+		group_var = (Var *) expr;
+		if (group_var->varno != input_rel->relid || group_var->varlevelsup != 0 ||
+			group_var->varattno <= 0)
+			return;
+
+		typentry = lookup_type_cache(group_var->vartype,
+									 TYPECACHE_EQ_OPR | TYPECACHE_HASH_PROC);
+		if (!OidIsValid(typentry->hash_proc) || sgc->eqop != typentry->eq_opr)
+			return;
+	}
+
+	/*
+	 * Each column of the scan tuple is either the GROUP BY column or an
+	 * aggregate computed by the scan.  The output may compute expressions of
+	 * them.
+	 */
+	foreach(lc, pull_var_clause((Node *) grouping_target->exprs,
+								PVC_INCLUDE_AGGREGATES | PVC_INCLUDE_PLACEHOLDERS))
+	{
+		Node	   *node = (Node *) lfirst(lc);
+		DynamoDBAggKind kind;
+		AttrNumber	attnum;
+
+		if (IsA(node, Var))
+		{
+			Var		   *var = (Var *) node;
+
+			if (group_var == NULL || var->varno != group_var->varno ||
+				var->varattno != group_var->varattno)
+				return;
+			kind = DYNAMODB_AGG_GROUP_KEY;
+			attnum = var->varattno;
+		}
+		else if (IsA(node, Aggref))
+		{
+			if (!dynamodb_get_agg_kind((Aggref *) node, input_rel, &kind, &attnum))
+				return;
+		}
+		else
+			return;
+
+		if (tlist_member((Expr *) node, agg_tlist) != NULL)
+			continue;
+
+		agg_tlist = lappend(agg_tlist, makeTargetEntry((Expr *) node,
+													   list_length(agg_tlist) + 1,
+													   NULL, false));
+		columns = lappend(columns, list_make2(makeInteger(kind), makeInteger(attnum)));
+		if (kind != DYNAMODB_AGG_GROUP_KEY)
+			naggs++;
+	}
+	if (naggs == 0)
+		return;
+
+	/*
+	 * Create the upper relation's fpinfo, with the table and options of the
+	 * relation aggregated.
+	 */
+	fpinfo = (DynamoDBFdwRelationInfo *) palloc0(sizeof(DynamoDBFdwRelationInfo));
+	fpinfo->pushdown_safe = true;
+	fpinfo->outerrel = input_rel;
+	fpinfo->agg_tlist = agg_tlist;
+	fpinfo->aggregates = list_make2(makeInteger(group_var != NULL ? group_var->varattno : 0),
+									columns);
+	fpinfo->table = ifpinfo->table;
+	fpinfo->server = ifpinfo->server;
+	fpinfo->options = ifpinfo->options;
+	fpinfo->fdw_startup_cost = ifpinfo->fdw_startup_cost;
+	fpinfo->fdw_tuple_cost = ifpinfo->fdw_tuple_cost;
+	fpinfo->shippable_extensions = ifpinfo->shippable_extensions;
+	grouped_rel->fdw_private = fpinfo;
+
+	/* Make sure the cost of reading the table has been estimated */
+	if (ifpinfo->rel_total_cost < 0)
+	{
+		double		scan_rows;
+		int			scan_width;
+		Cost		scan_startup_cost;
+		Cost		scan_total_cost;
+
+		dynamodb_estimate_path_cost_size(root, input_rel, NIL, NIL, NULL,
+										 &scan_rows, &scan_width,
+										 &scan_startup_cost, &scan_total_cost);
+	}
+
+	/* Number of groups, estimated as for the Agg node */
+	if (group_var != NULL)
+	{
+		List	   *group_exprs = get_sortgrouplist_exprs(parse->groupClause,
+														  parse->targetList);
+
+#if PG_VERSION_NUM >= 140000
+		rows = estimate_num_groups(root, group_exprs, input_rel->rows, NULL, NULL);
+#else
+		rows = estimate_num_groups(root, group_exprs, input_rel->rows, NULL);
+#endif
+	}
+	else
+		rows = 1;
+
+	/*
+	 * All the items are still transferred, but no tuple is formed for them:
+	 * each one only costs the evaluation of the aggregates, and the hashing
+	 * of its GROUP BY column.  The groups are returned once all the items
+	 * have been read.
+	 */
+	startup_cost = ifpinfo->rel_total_cost + ifpinfo->fdw_startup_cost;
+	startup_cost += ifpinfo->fdw_tuple_cost * ifpinfo->retrieved_rows;
+	startup_cost += cpu_operator_cost * (naggs + (group_var != NULL ? 1 : 0)) *
+		ifpinfo->retrieved_rows;
+	total_cost = startup_cost + cpu_tuple_cost * rows;
+
+	fpinfo->rows = rows;
+	fpinfo->width = grouping_target->width;
+	fpinfo->startup_cost = startup_cost;
+	fpinfo->total_cost = total_cost;
+
+	grouppath = create_foreign_upper_path(root,
+										  grouped_rel,
+										  grouping_target,
+										  rows,
+										  startup_cost,
+										  total_cost,
+										  NIL,	/* no pathkeys */
+										  NULL,
+#if PG_VERSION_NUM >= 170000
+										  NIL,	/* no fdw_restrictinfo list */
+#endif
+										  NIL);	/* no fdw_private */
+
+	add_path(grouped_rel, (Path *) grouppath);
+}
+
+/*
+ * dynamodbGetForeignUpperPaths
+ *		Add paths for post-join operations like aggregation, grouping etc. if
+ *		corresponding operations are safe to push down, and look for a LIMIT
+ *		that the scan of the foreign table can stop at
+ *
+ * When the query reads nothing but one foreign table and checks all of its
+ * conditions remotely, the scan can stop requesting pages once the rows
+ * needed by the LIMIT and OFFSET have been returned.  The limit is kept in
+ * the relation for dynamodbGetForeignPlan, which applies it if the chosen
+ * path returns the rows in the order of the query.  No upper path is added
+ * for the LIMIT.
+ */
+extern "C" void
+dynamodbGetForeignUpperPaths(PlannerInfo *root, UpperRelationKind stage,
+							 RelOptInfo *input_rel, RelOptInfo *output_rel,
+							 void *extra)
+{
+	Query	   *parse = root->parse;
+	FinalPathExtraData *fextra = (FinalPathExtraData *) extra;
+	DynamoDBFdwRelationInfo *fpinfo;
+	RelOptInfo *baserel;
+	int			relid;
+
+	if (stage == UPPERREL_GROUP_AGG)
+	{
+		if (!dynamodb_add_count_path(root, input_rel, output_rel,
+									 (GroupPathExtraData *) extra))
+			dynamodb_add_agg_path(root, input_rel, output_rel,
+								  (GroupPathExtraData *) extra);
+		return;
+	}
+
+	if (stage != UPPERREL_FINAL || !fextra->limit_needed)
+		return;
+
+	/* LIMIT and OFFSET must be constants */
+	if (fextra->count_est <= 0 || fextra->offset_est < 0 ||
+		fextra->count_est + fextra->offset_est > PG_INT32_MAX ||
+		parse->limitOption == LIMIT_OPTION_WITH_TIES)
+		return;
+
+	/* Nothing may change the number of rows between the scan and the LIMIT */
+	if (parse->commandType != CMD_SELECT || parse->hasAggs ||
+		parse->groupClause != NIL || parse->groupingSets != NIL ||
+		root->hasHavingQual || parse->hasWindowFuncs ||
+		parse->distinctClause != NIL || parse->hasTargetSRFs ||
+		parse->rowMarks != NIL || parse->setOperations != NULL)
+		return;
+
+	/* The query must scan a single foreign table of ours */
+	if (!bms_get_singleton_member(root->all_baserels, &relid))
+		return;
+
+	baserel = find_base_rel(root, relid);
+	fpinfo = (DynamoDBFdwRelationInfo *) baserel->fdw_private;
+	if (baserel->reloptkind != RELOPT_BASEREL ||
+		baserel->fdwroutine != input_rel->fdwroutine || fpinfo == NULL)
+		return;
+
+	if (fpinfo->local_conds != NIL)
+		return;
+
+	fpinfo->limit_tuples = fextra->count_est + fextra->offset_est;
+}
+
+#if PG_VERSION_NUM >= 140000
+/*
+ * Construct a tuple descriptor for the scan tuples handled by a foreign join.
+ */
+static TupleDesc
+dynamodb_get_tupdesc_for_join_scan_tuples(ForeignScanState *node)
+{
+	ForeignScan *fsplan = (ForeignScan *) node->ss.ps.plan;
+	EState	   *estate = node->ss.ps.state;
+	TupleDesc	tupdesc;
+
+	/*
+	 * The core code has already set up a scan tuple slot based on
+	 * fsplan->fdw_scan_tlist, and this slot's tupdesc is mostly good enough,
+	 * but there's one case where it isn't.  If we have any whole-row row
+	 * identifier Vars, they may have vartype RECORD, and we need to replace
+	 * that with the associated table's actual composite type.  This ensures
+	 * that when we read those ROW() expression values from the remote server,
+	 * we can convert them to a composite type the local server knows.
+	 */
+	tupdesc = CreateTupleDescCopy(node->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
+	for (int i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
+		Var		   *var;
+		RangeTblEntry *rte;
+		Oid			reltype;
+
+		/* Nothing to do if it's not a generic RECORD attribute */
+		if (att->atttypid != RECORDOID || att->atttypmod >= 0)
+			continue;
+
+		/*
+		 * If we can't identify the referenced table, do nothing.  This'll
+		 * likely lead to failure later, but perhaps we can muddle through.
+		 */
+		var = (Var *) list_nth_node(TargetEntry, fsplan->fdw_scan_tlist,
+									i)->expr;
+		if (!IsA(var, Var) || var->varattno != 0)
+			continue;
+		rte = (RangeTblEntry *) list_nth(estate->es_range_table, var->varno - 1);
+		if (rte->rtekind != RTE_RELATION)
+			continue;
+		reltype = get_rel_type_id(rte->relid);
+		if (!OidIsValid(reltype))
+			continue;
+		att->atttypid = reltype;
+		/* shouldn't need to change anything else */
+	}
+	return tupdesc;
+}
+#endif
+
+/*
+ * dynamodbBeginForeignScan
+ *		Initiate an executor scan of a foreign DynamoDB table.
+ */
+extern "C" void
+dynamodbBeginForeignScan(ForeignScanState *node, int eflags)
+{
+	ForeignScan *fsplan = (ForeignScan *) node->ss.ps.plan;
+	EState	   *estate = node->ss.ps.state;
+	DynamoDBFdwScanState *fsstate;
+	RangeTblEntry *rte;
+	Oid			userid;
+	ForeignTable *table;
+	UserMapping *user;
+	dynamodb_opt *opt;
+	int			rtindex;
+
+	/*
+	 * Do nothing in EXPLAIN (no ANALYZE) case.  node->fdw_state stays NULL.
+	 */
+	if (eflags & EXEC_FLAG_EXPLAIN_ONLY)
+		return;
+
+	/*
+	 * We'll save private state in node->fdw_state.
+	 */
+	fsstate = (DynamoDBFdwScanState *) palloc0(sizeof(DynamoDBFdwScanState));
+	node->fdw_state = (void *) fsstate;
+#if (PG_VERSION_NUM >= 160000)
+	/*
+	 * Identify which user to do the remote access as.  This should match what
+	 * ExecCheckPermissions() does.
+	 */
+	userid = OidIsValid(fsplan->checkAsUser) ? fsplan->checkAsUser : GetUserId();
+	if (fsplan->scan.scanrelid > 0)
+		rtindex = fsplan->scan.scanrelid;
+	else
+		rtindex = bms_next_member(fsplan->fs_base_relids, -1);
+	rte = exec_rt_fetch(rtindex, estate);
+#else
+	/*
+	 * Identify which user to do the remote access as.  This should match what
+	 * ExecCheckRTEPerms() does.  In case of a join or aggregate, use the
+	 * lowest-numbered member RTE as a representative; we would get the same
+	 * result from any.
+	 */
+	if (fsplan->scan.scanrelid > 0)
+		rtindex = fsplan->scan.scanrelid;
+	else
+		rtindex = bms_next_member(fsplan->fs_relids, -1);
+	rte = exec_rt_fetch(rtindex, estate);
+	userid = rte->checkAsUser ? rte->checkAsUser : GetUserId();
+#endif
+	/* Get info about foreign table. */
+	table = GetForeignTable(rte->relid);
+	user = GetUserMapping(userid, table->serverid);
+	opt = dynamodb_get_options(rte->relid, userid);
+
+	/*
+	 * Get connection to the foreign server.  Connection manager will
+	 * establish new connection if necessary.
+	 */
+	fsstate->conn = dynamodb_get_connection(user);
+
+	/*
+	 * Pages are fetched ahead by a worker thread if prefetch is enabled.
+	 * The page source, its worker and the attribute map must be released
+	 * even if the query fails, so tie them to the lifetime of the query
+	 * context.
+	 */
+	fsstate->prefetch_depth = opt->prefetch_depth;
+	fsstate->prefetch_memory_limit = (size_t) opt->prefetch_memory_limit * 1024;
+
+	/*
+	 * In async mode, the pages are always fetched by the worker thread, and
+	 * the backend waits for them along with the other subplans of the
+	 * Append.
+	 */
+#if PG_VERSION_NUM >= 140000
+	fsstate->async_capable = node->ss.ps.async_capable;
+#else
+	fsstate->async_capable = false;
+#endif
+	if (fsstate->async_capable && fsstate->prefetch_depth == 0)
+		fsstate->prefetch_depth = 1;
+	fsstate->prefetcher = NULL;
+	fsstate->source = NULL;
+	fsstate->attr_map = NULL;
+	fsstate->param_values = NULL;
+	fsstate->memo = NULL;
+	fsstate->release_cb.func = dynamodb_release_scan_state;
+	fsstate->release_cb.arg = (void *) fsstate;
+	MemoryContextRegisterResetCallback(estate->es_query_cxt,
+									   &fsstate->release_cb);
+
+	/* Init data for cursor_exists as false */
+	fsstate->cursor_exists = false;
+
+	/* Get private info created by planner functions. */
+	fsstate->query = strVal(list_nth(fsplan->fdw_private,
+									 FdwScanPrivateSelectSql));
+	fsstate->retrieved_attrs = (List *) list_nth(fsplan->fdw_private,
+												 FdwScanPrivateRetrievedAttrs);
+	fsstate->table_name = strVal(list_nth(fsplan->fdw_private,
+										  FdwScanPrivateTableName));
+	fsstate->total_segments = intVal(list_nth(fsplan->fdw_private,
+											  FdwScanPrivateTotalSegments));
+	fsstate->lookup_keys = (List *) list_nth(fsplan->fdw_private,
+											 FdwScanPrivateLookupKeys);
+	fsstate->limit = intVal(list_nth(fsplan->fdw_private,
+									 FdwScanPrivateLimit));
+	fsstate->limit_reads = intVal(list_nth(fsplan->fdw_private,
+										   FdwScanPrivateLimitReads)) != 0;
+	fsstate->count_request = (List *) list_nth(fsplan->fdw_private,
+											   FdwScanPrivateCount);
+	fsstate->count_done = false;
+	fsstate->agg = NULL;
+	fsstate->param_values = new Aws::Vector<Model::AttributeValue>();
+	fsstate->pstate = NULL;
+	fsstate->local_next_segment = 0;
+	fsstate->attr_map = dynamodb_build_attr_map(fsstate->retrieved_attrs);
+
+	/* Create contexts for batches of tuples and per-tuple temp workspace. */
+	fsstate->batch_cxt = AllocSetContextCreate(estate->es_query_cxt,
+											   "dynamodb_fdw tuple data",
+											   ALLOCSET_DEFAULT_SIZES);
+	fsstate->temp_cxt = AllocSetContextCreate(estate->es_query_cxt,
+											  "dynamodb_fdw temporary data",
+											  ALLOCSET_SMALL_SIZES);
+
+	/*
+	 * A scan computing aggregates decodes the columns of the table, which
+	 * are not the columns of its scan tuple.
+	 */
+	if (list_nth(fsplan->fdw_private, FdwScanPrivateAggregates) != NIL)
+	{
+		Relation	rel = table_open(rte->relid, NoLock);
+		TupleDesc	input_tupdesc = CreateTupleDescCopy(RelationGetDescr(rel));
+
+		table_close(rel, NoLock);
+		fsstate->converters = dynamodb_build_converters(input_tupdesc,
+														fsstate->retrieved_attrs);
+		fsstate->agg = dynamodb_init_agg_state((List *) list_nth(fsplan->fdw_private,
+																 FdwScanPrivateAggregates),
+											   node->ss.ss_ScanTupleSlot->tts_tupleDescriptor,
+											   input_tupdesc,
+											   AllocSetContextCreate(estate->es_query_cxt,
+																	 "dynamodb_fdw aggregate data",
+																	 ALLOCSET_DEFAULT_SIZES));
+	}
+	else
+		fsstate->converters =
+			dynamodb_build_converters(node->ss.ss_ScanTupleSlot->tts_tupleDescriptor,
+									  fsstate->retrieved_attrs);
+
+	/*
+	 * Get info we'll need for converting data fetched from the foreign server
+	 * into local representation and error reporting during that process.
+	 */
+	if (fsplan->scan.scanrelid > 0)
+	{
+		fsstate->rel = node->ss.ss_currentRelation;
+		fsstate->tupdesc = RelationGetDescr(fsstate->rel);
+	}
+	else
+	{
+		fsstate->rel = NULL;
+#if (PG_VERSION_NUM >= 140000)
+		fsstate->tupdesc = dynamodb_get_tupdesc_for_join_scan_tuples(node);
+#else
+		fsstate->tupdesc = node->ss.ss_ScanTupleSlot->tts_tupleDescriptor;
+#endif
+	}
+
+	/*
+	 * Prepare for processing of parameters used in remote query, if any.
+	 * A scan which reads by key with parameters remembers what it has read,
+	 * as it may be rescanned for every outer row.
+	 */
+	if (fsplan->fdw_exprs != NIL)
+	{
+		ListCell   *lc;
+
+		fsstate->param_exprs = ExecInitExprList(fsplan->fdw_exprs, (PlanState *) node);
+		fsstate->param_types = NIL;
+		foreach(lc, fsplan->fdw_exprs)
+			fsstate->param_types = lappend_oid(fsstate->param_types,
+											   exprType((Node *) lfirst(lc)));
+
+		if (fsstate->lookup_keys != NIL)
+			fsstate->memo = new DynamoDBLookupMemo();
+	}
+}
+
+/*
+ * dynamodbIterateForeignScan
+ *		Retrieve next row from the result set, or clear tuple slot to indicate
+ *		EOF.
+ */
+extern "C" TupleTableSlot *
+dynamodbIterateForeignScan(ForeignScanState *node)
+{
+	DynamoDBFdwScanState *fsstate = (DynamoDBFdwScanState *) node->fdw_state;
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+
+	/*
+	 * If this is the first call after Begin or ReScan, we need to create the
+	 * cursor on the remote side.
+	 */
+	if (!fsstate->cursor_exists)
+		create_cursor(node);
+
+	/* A count is returned as a single row */
+	if (fsstate->count_request != NIL)
+	{
+		int64		count;
+		MemoryContext oldcontext;
+
+		ExecClearTuple(slot);
+		if (fsstate->count_done)
+			return slot;
+
+		count = dynamodb_count_items(fsstate);
+		fsstate->count_done = true;
+
+		MemoryContextReset(fsstate->batch_cxt);
+		oldcontext = MemoryContextSwitchTo(fsstate->batch_cxt);
+		slot->tts_values[0] = Int64GetDatum(count);
+		slot->tts_isnull[0] = false;
+		MemoryContextSwitchTo(oldcontext);
+
+		return ExecStoreVirtualTuple(slot);
+	}
+
+	/* Aggregates are returned as a row per group, once all items are read */
+	if (fsstate->agg != NULL)
+	{
+		DynamoDBAggState *agg = fsstate->agg;
+		DynamoDBAggGroup *group;
+		MemoryContext oldcontext;
+
+		if (!agg->done)
+			dynamodb_aggregate_items(fsstate);
+
+		ExecClearTuple(slot);
+		if (agg->next_group >= agg->groups.size())
+			return slot;
+		group = &agg->groups[agg->next_group++];
+
+		MemoryContextReset(fsstate->batch_cxt);
+		oldcontext = MemoryContextSwitchTo(fsstate->batch_cxt);
+		for (int i = 0; i < agg->ncolumns; i++)
+		{
+			if (agg->columns[i].kind == DYNAMODB_AGG_GROUP_KEY)
+			{
+				slot->tts_values[i] = group->key;
+				slot->tts_isnull[i] = group->key_isnull;
+			}
+			else
+				slot->tts_values[i] = dynamodb_finalize_agg(&agg->columns[i],
+															&group->values[i],
+															&slot->tts_isnull[i]);
+		}
+		MemoryContextSwitchTo(oldcontext);
+
+		return ExecStoreVirtualTuple(slot);
+	}
+
+	for (;;)
+	{
+		/*
+		 * If we didn't get any row, must be end of data, or in async mode,
+		 * the next page has not arrived yet.  No point in another fetch if we
+		 * already detected EOF, though.
+		 */
+		if (fsstate->eof_reached || !fetch_more_data(node))
+			return ExecClearTuple(slot);
+
+		/*
+		 * Return the next tuple, unless the remote conditions could not be
+		 * relied upon and it does not satisfy them.
+		 */
+		if (!fsstate->recheck_remote_conds)
+			return slot;
+
+		econtext->ecxt_scantuple = slot;
+		if (ExecQual(node->fdw_recheck_quals, econtext))
+			return slot;
+
+		ResetExprContext(econtext);
+	}
+}
+
+/*
+ * dynamodbReScanForeignScan
+ *		Restart the scan.
+ */
+extern "C" void
+dynamodbReScanForeignScan(ForeignScanState *node)
+{
+	DynamoDBFdwScanState *fsstate = (DynamoDBFdwScanState *) node->fdw_state;
+
+	/* If we haven't created the cursor yet, nothing to do. */
+	if (!fsstate->cursor_exists)
+		return;
+
+	/*
+	 * Now force a fresh FETCH.  The shared segment counter of a parallel
+	 * scan is reset by dynamodbReInitializeDSMForeignScan.
+	 */
+	dynamodb_close_page_source(fsstate);
+	fsstate->eof_reached = false;
+	fsstate->scan_done = false;
+	fsstate->next_fetch_ready = true;
+	fsstate->row_index = 0;
+	fsstate->num_rows = 0;
+	fsstate->items = nullptr;
+	fsstate->local_next_segment = 0;
+	fsstate->count_done = false;
+	if (fsstate->agg != NULL)
+		dynamodb_reset_agg_state(fsstate->agg);
+
+	/*
+	 * If any internal parameters affecting this node have changed, the
+	 * parameter values must be computed again by create_cursor.
+	 */
+	if (node->ss.ps.chgParam != NULL)
+		fsstate->cursor_exists = false;
+}
+
+
+/*
+ * dynamodbEndForeignScan
+ * Finish scanning foreign table and dispose objects used for this scan
+ */
+extern "C" void
+dynamodbEndForeignScan(ForeignScanState *node)
+{
+	DynamoDBFdwScanState *fsstate = (DynamoDBFdwScanState *) node->fdw_state;
+
+	/* if fsstate is NULL, we are in EXPLAIN; nothing to do */
+	if (fsstate == NULL)
+		return;
+
+	/* Stop the prefetch worker before releasing the connection it uses */
+	dynamodb_release_scan_state(fsstate);
+
+	/* Release remote connection */
+	dynamodb_release_connection(fsstate->conn);
 	fsstate->conn = NULL;
 
-	/* MemoryContexts will be deleted automatically. */
-	
+	/* MemoryContexts will be deleted automatically. */
+	
+}
+
+/*
+ * dynamodbIsForeignScanParallelSafe
+ *		Foreign scans can run in parallel workers, which open their own
+ *		connection.
+ */
+extern "C" bool
+dynamodbIsForeignScanParallelSafe(PlannerInfo *root, RelOptInfo *rel,
+								  RangeTblEntry *rte)
+{
+	return true;
+}
+
+/*
+ * dynamodbEstimateDSMForeignScan
+ *		Size of the shared state of a parallel scan.
+ */
+extern "C" Size
+dynamodbEstimateDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt)
+{
+	return sizeof(DynamoDBParallelScanState);
+}
+
+/*
+ * dynamodbInitializeDSMForeignScan
+ *		Initialize the shared state of a parallel scan in the leader.
+ */
+extern "C" void
+dynamodbInitializeDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt,
+								 void *coordinate)
+{
+	DynamoDBFdwScanState *fsstate = (DynamoDBFdwScanState *) node->fdw_state;
+	DynamoDBParallelScanState *pstate = (DynamoDBParallelScanState *) coordinate;
+
+	pg_atomic_init_u32(&pstate->next_segment, 0);
+	fsstate->pstate = pstate;
+}
+
+/*
+ * dynamodbReInitializeDSMForeignScan
+ *		Reset the shared state of a parallel scan before it is rescanned.
+ */
+extern "C" void
+dynamodbReInitializeDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt,
+								   void *coordinate)
+{
+	DynamoDBParallelScanState *pstate = (DynamoDBParallelScanState *) coordinate;
+
+	pg_atomic_write_u32(&pstate->next_segment, 0);
+}
+
+/*
+ * dynamodbInitializeWorkerForeignScan
+ *		Attach a parallel worker to the shared state of a parallel scan.
+ */
+extern "C" void
+dynamodbInitializeWorkerForeignScan(ForeignScanState *node, shm_toc *toc,
+									void *coordinate)
+{
+	DynamoDBFdwScanState *fsstate = (DynamoDBFdwScanState *) node->fdw_state;
+
+	fsstate->pstate = (DynamoDBParallelScanState *) coordinate;
+}
+
+#if PG_VERSION_NUM >= 140000
+/*
+ * dynamodbIsForeignPathAsyncCapable
+ *		Check whether a given ForeignPath node is async-capable.
+ */
+extern "C" bool
+dynamodbIsForeignPathAsyncCapable(ForeignPath *path)
+{
+	RelOptInfo *rel = ((Path *) path)->parent;
+	DynamoDBFdwRelationInfo *fpinfo = (DynamoDBFdwRelationInfo *) rel->fdw_private;
+
+	/* A count is computed by a single request, without pages to wait for */
+	if (IS_UPPER_REL(rel))
+		return false;
+
+	return fpinfo->options->async_capable;
+}
+
+/*
+ * dynamodb_produce_tuple_asynchronously
+ *		Complete the request with the next tuple if one is available, or
+ *		leave it pending until the next page arrives.
+ */
+static void
+dynamodb_produce_tuple_asynchronously(AsyncRequest *areq)
+{
+	ForeignScanState *node = (ForeignScanState *) areq->requestee;
+	DynamoDBFdwScanState *fsstate = (DynamoDBFdwScanState *) node->fdw_state;
+	TupleTableSlot *result;
+
+	/* Get a tuple from the ForeignScan node; this never waits */
+	result = areq->requestee->ExecProcNodeReal(areq->requestee);
+
+	if (!TupIsNull(result))
+		ExecAsyncRequestDone(areq, result);
+	else if (fsstate->eof_reached)
+		ExecAsyncRequestDone(areq, NULL);
+	else
+		ExecAsyncRequestPending(areq);
+}
+
+/*
+ * dynamodbForeignAsyncRequest
+ *		Asynchronously request next tuple from a foreign DynamoDB table.
+ *
+ * The first request starts the prefetch worker, so the remote requests of
+ * all the async subplans of an Append are in flight at the same time.
+ */
+extern "C" void
+dynamodbForeignAsyncRequest(AsyncRequest *areq)
+{
+	dynamodb_produce_tuple_asynchronously(areq);
+}
+
+/*
+ * dynamodbForeignAsyncConfigureWait
+ *		Configure a file descriptor event for which we wish to wait.
+ */
+extern "C" void
+dynamodbForeignAsyncConfigureWait(AsyncRequest *areq)
+{
+	ForeignScanState *node = (ForeignScanState *) areq->requestee;
+	DynamoDBFdwScanState *fsstate = (DynamoDBFdwScanState *) node->fdw_state;
+	AppendState *requestor = (AppendState *) areq->requestor;
+
+	/* This should not be called unless callback_pending */
+	Assert(areq->callback_pending);
+
+	/* A pending request always waits for the prefetch worker */
+	Assert(fsstate->prefetcher != NULL);
+
+	AddWaitEventToSet(requestor->as_eventset, WL_SOCKET_READABLE,
+					  fsstate->prefetcher->wait_fd(), NULL, areq);
+}
+
+/*
+ * dynamodbForeignAsyncNotify
+ *		Fetch some more tuples from a file descriptor that becomes ready,
+ *		requesting next tuple.
+ */
+extern "C" void
+dynamodbForeignAsyncNotify(AsyncRequest *areq)
+{
+	dynamodb_produce_tuple_asynchronously(areq);
+}
+#endif
+
+extern "C" void
+dynamodbAddForeignUpdateTargets(
+#if (PG_VERSION_NUM >= 140000)
+								PlannerInfo *root,
+								Index rtindex,
+#else
+								Query *parsetree,
+#endif
+								RangeTblEntry *target_rte,
+								Relation target_relation)
+{
+	Oid				relid = RelationGetRelid(target_relation);
+	dynamodb_opt   *opt;
+	char		   *partition_key;
+	char		   *sort_key;
+	TupleDesc		tupdesc = target_relation->rd_att;
+	Oid				userid;
+
+#if PG_VERSION_NUM < 160000
+	userid = target_rte->checkAsUser ? target_rte->checkAsUser : GetUserId();
+#else
+	if (target_rte->perminfoindex != 0)
+	{
+		RTEPermissionInfo *perminfo = getRTEPermissionInfo(root->parse->rteperminfos, target_rte);
+
+		userid = (perminfo != NULL && OidIsValid(perminfo->checkAsUser))? perminfo->checkAsUser : GetUserId();
+	}
+	else
+		userid = GetUserId();
+#endif
+
+	opt = dynamodb_get_options(relid, userid);
+	partition_key = opt->svr_partition_key;
+	sort_key = opt -> svr_sort_key;
+
+	if (IS_KEY_EMPTY(partition_key))
+		elog(ERROR, "dynamodb_fdw: The partition_key option has not been set");
+
+	for (int i = 0; i < tupdesc->natts; ++i)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
+		Var		   *var;
+		char *attrname = NameStr(att->attname);
+
+		if (strcmp(partition_key, attrname) == 0 ||
+			(!IS_KEY_EMPTY(sort_key) && strcmp(sort_key, attrname) == 0))
+		{
+#if PG_VERSION_NUM < 140000
+			Index	rtindex = parsetree->resultRelation;
+			TargetEntry *tle;
+#endif
+			/* Make a Var representing the desired value */
+			var = makeVar(rtindex,
+							att->attnum,
+							att->atttypid,
+							att->atttypmod,
+							att->attcollation,
+							0);
+#if PG_VERSION_NUM >= 140000
+			/* Register it as a row-identity column needed by this target rel */
+			add_row_identity_var(root, var, rtindex, pstrdup(NameStr(att->attname)));
+#else
+			tle = makeTargetEntry((Expr *) var,
+								list_length(parsetree->targetList) + 1,
+								pstrdup(NameStr(att->attname)), true);
+
+			/* ... and add it to the query's targetlist */
+			parsetree->targetList = lappend(parsetree->targetList, tle);
+#endif
+		}
+	}
+}
+
+/*
+ * dynamodbPlanForeignModify
+ *		Plan an insert/update/delete operation on a foreign table
+ */
+extern "C" List *
+dynamodbPlanForeignModify(PlannerInfo *root, ModifyTable *plan, Index resultRelation, int subplan_index)
+{
+	CmdType		operation = plan->operation;
+	RangeTblEntry *rte = planner_rt_fetch(resultRelation, root);
+	Relation	rel;
+	StringInfoData sql;
+	List	   *targetAttrs = NIL;
+	List	   *withCheckOptionList = NIL; 
+	List	   *returningList = NIL; 
+	List	   *retrieved_attrs = NIL;
+	bool		trigger_update = false;
+	List	   *condAttr = NULL;
+	Oid			foreignTableId;
+	TupleDesc	tupdesc;
+	dynamodb_opt   *opt;
+	char		   *partition_key;
+	char		   *sort_key;
+	Oid				userid;
+
+	initStringInfo(&sql);
+
+	/*
+	 * Core code already has some lock on each rel being planned, so we can
+	 * use NoLock here.
+	 */
+	rel = table_open(rte->relid, NoLock);
+	foreignTableId = RelationGetRelid(rel);
+	tupdesc = RelationGetDescr(rel);
+
+	/*
+	 * For foreign update and delete PostgreSQL require a unique column to do that
+	 * operations. The postgres_fdw uses ctid to uniquely identify row to perform
+	 * foreign delete/update. But in mysql_fdw we don't have hidden column like
+	 * that so we make a requirement for first column to be unique. We are using
+	 * first column to uniquely identify the rows for UPDATE/DELETE operation.
+	 */
+#if PG_VERSION_NUM < 160000
+	userid = rte->checkAsUser ? rte->checkAsUser : GetUserId();
+#else
+	if (rte->perminfoindex != 0)
+	{
+		RTEPermissionInfo *perminfo = getRTEPermissionInfo(root->parse->rteperminfos, rte);
+
+		userid = (perminfo != NULL && OidIsValid(perminfo->checkAsUser))? perminfo->checkAsUser : GetUserId();
+	}
+	else
+		userid = GetUserId();
+#endif
+
+	opt = dynamodb_get_options(foreignTableId, userid);
+	partition_key = opt->svr_partition_key;
+	sort_key = opt -> svr_sort_key;
+
+	/*
+	 * In an INSERT, we transmit all columns that are defined in the foreign
+	 * table.  In an UPDATE, if there are BEFORE ROW UPDATE triggers on the
+	 * foreign table, we transmit all columns like INSERT; else we transmit
+	 * only columns that were explicitly targets of the UPDATE, so as to avoid
+	 * unnecessary data transmission.  (We can't do that for INSERT since we
+	 * would miss sending default values for columns not listed in the source
+	 * statement, and for UPDATE if there are BEFORE ROW UPDATE triggers since
+	 * those triggers might change values for non-target columns, in which
+	 * case we would miss sending changed values for those columns.)
+	 */
+	if (operation == CMD_UPDATE &&
+		 rel->trigdesc &&
+		 rel->trigdesc->trig_update_before_row)
+		 trigger_update = true;
+
+	if (operation == CMD_INSERT || trigger_update)
+	{
+		int			attnum;
+
+		for (attnum = 1; attnum <= tupdesc->natts; attnum++)
+		{
+			Form_pg_attribute attr = TupleDescAttr(tupdesc, attnum - 1);
+			char *attrname = NameStr(attr->attname);
+
+			/*
+			 * DynamoDB does not allow to update key columns. Therefore, skip key column when
+			 * updating.
+			 */
+			if (trigger_update &&
+				((!IS_KEY_EMPTY(partition_key) && strcmp(partition_key, attrname) == 0) ||
+				 (!IS_KEY_EMPTY(sort_key) && strcmp(sort_key, attrname) == 0)))
+				continue;
+
+			if (!attr->attisdropped)
+				targetAttrs = lappend_int(targetAttrs, attnum);
+		}
+	}
+	else if (operation == CMD_UPDATE)
+	{
+		int			col = -1;
+#if (PG_VERSION_NUM >= 130010 && PG_VERSION_NUM < 140000) || (PG_VERSION_NUM >= 140007 && PG_VERSION_NUM < 150000) || (PG_VERSION_NUM >= 150003)
+		RelOptInfo *rel = find_base_rel(root, resultRelation);
+		Bitmapset  *allUpdatedCols = get_rel_all_updated_cols(root, rel);
+#else
+		Bitmapset  *allUpdatedCols = bms_union(rte->updatedCols, rte->extraUpdatedCols);
+#endif
+		ListCell   *lc;
+
+		/*
+		 * DynamoDB only support updating column
+		 */
+		foreach(lc, root->parse->targetList)
+		{
+			TargetEntry *tle = (TargetEntry *) lfirst(lc);
+			Node		*node = (Node *) tle->expr;
+
+			if (nodeTag(node) == T_SubscriptingRef)
+				elog(ERROR, "dynamodb_fdw: unsupported updating target");
+		}
+
+		while ((col = bms_next_member(allUpdatedCols, col)) >= 0)
+		{
+			/* bit numbers are offset by FirstLowInvalidHeapAttributeNumber */
+			AttrNumber	attno = col + FirstLowInvalidHeapAttributeNumber;
+
+			if (attno <= InvalidAttrNumber) /* shouldn't happen */
+				elog(ERROR, "dynamodb_fdw: system-column update is not supported");
+			targetAttrs = lappend_int(targetAttrs, attno);
+		}
+	}
+
+	/*
+	 * Raise error if there is WITH CHECK OPTION
+	 */
+	if (plan->withCheckOptionLists)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_FDW_UNABLE_TO_CREATE_EXECUTION),
+				 errmsg("dynamodb_fdw: unsupported feature WITH CHECK OPTION")));
+	}
+		
+	/*
+	 *  Raise error if there is RETURNING
+	 */
+	if (plan->returningLists && operation == CMD_INSERT)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_FDW_UNABLE_TO_CREATE_EXECUTION),
+				 errmsg("dynamodb_fdw: unsupported RETURNING in INSERT operation")));
+	}
+
+	/*
+	 * Extract the relevant RETURNING list if any.
+	 */
+	if (plan->returningLists)
+		returningList = (List *) list_nth(plan->returningLists, subplan_index);
+
+	/*
+	 * Raise error if there ON CONFLICT
+	 */
+	if (plan->onConflictAction != ONCONFLICT_NONE)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_FDW_UNABLE_TO_CREATE_EXECUTION),
+				 errmsg("dynamodb_fdw: unsupported feature ON CONFLICT")));
+	}
+
+	/*
+	 * Construct the SQL command string.
+	 */
+	switch (operation)
+	{
+		case CMD_INSERT:
+			dynamodb_deparse_insert(&sql, rte, resultRelation, rel, targetAttrs,
+									&retrieved_attrs);
+			break;
+		case CMD_UPDATE:
+		{
+			condAttr = dynamodb_get_key_names(tupdesc, foreignTableId, partition_key, sort_key);
+			dynamodb_deparse_update(&sql, rte, resultRelation, rel, targetAttrs,
+									withCheckOptionList, returningList, &retrieved_attrs, condAttr);
+			break;
+		}
+		case CMD_DELETE:
+		{
+			condAttr = dynamodb_get_key_names(tupdesc, foreignTableId, partition_key, sort_key);
+			dynamodb_deparse_delete(&sql, rte, resultRelation, rel, returningList,
+									&retrieved_attrs, condAttr);
+			break;
+		}
+		default:
+			ereport(ERROR,
+				(errcode(ERRCODE_FDW_UNABLE_TO_CREATE_EXECUTION),
+				 errmsg("dynamodb_fdw: unexpected operation")));
+			break;
+	}
+
+	table_close(rel, NoLock);
+
+	/*
+	 * Build the fdw_private list that will be available to the executor.
+	 * Items in the list must match enum FdwModifyPrivateIndex, above.
+	 */
+	return list_make4(makeString(sql.data),
+					  targetAttrs,
+#if PG_VERSION_NUM >= 150000
+					  makeBoolean((retrieved_attrs != NIL)),
+#else
+					  makeInteger((retrieved_attrs != NIL)),
+#endif
+					  retrieved_attrs);	
+}
+
+/*
+ * dynamodbExplainForeignScan
+ *		Produce extra output for EXPLAIN of a ForeignScan on a foreign table
+ */
+extern "C" void
+dynamodbExplainForeignScan(ForeignScanState *node, ExplainState *es)
+{
+	ForeignScan *plan = castNode(ForeignScan, node->ss.ps.plan);
+	List	   *fdw_private = plan->fdw_private;
+
+	/*
+	 * Add remote query, when VERBOSE option is specified.
+	 */
+	if (es->verbose)
+	{
+		char	   *sql;
+
+		sql = strVal(list_nth(fdw_private, FdwScanPrivateSelectSql));
+		if (list_nth(fdw_private, FdwScanPrivateCount) != NIL)
+		{
+			/* A count is not computed by the PartiQL statement */
+			ExplainPropertyText("Remote Count", sql, es);
+			return;
+		}
+		ExplainPropertyText("Remote SQL", sql, es);
+
+		if (intVal(list_nth(fdw_private, FdwScanPrivateTotalSegments)) > 0)
+			ExplainPropertyInteger("Remote Scan Segments", NULL,
+								   intVal(list_nth(fdw_private, FdwScanPrivateTotalSegments)),
+								   es);
+
+		if (list_nth(fdw_private, FdwScanPrivateLookupKeys) != NIL)
+		{
+			List	   *lookup_keys = (List *) list_nth(fdw_private, FdwScanPrivateLookupKeys);
+			int64		nkeys = list_length((List *) lsecond(lookup_keys));
+
+			/* With a sort key, every pair of values is a key */
+			if (list_length(lookup_keys) > 2)
+				nkeys *= list_length((List *) lfourth(lookup_keys));
+
+			ExplainPropertyInteger("Remote Lookup Keys", NULL, nkeys, es);
+		}
+
+		if (intVal(list_nth(fdw_private, FdwScanPrivateLimit)) > 0)
+			ExplainPropertyInteger("Remote Limit", NULL,
+								   intVal(list_nth(fdw_private, FdwScanPrivateLimit)),
+								   es);
+	}
+}
+
+/*
+ * dynamodbExplainForeignModify
+ *		Produce extra output for EXPLAIN of a ModifyTable on a foreign table
+ */
+extern "C" void
+dynamodbExplainForeignModify(ModifyTableState *mtstate,
+							 ResultRelInfo *rinfo,
+							 List *fdw_private,
+							 int subplan_index,
+							 ExplainState *es)
+{
+	if (es->verbose)
+	{
+		char	   *sql = strVal(list_nth(fdw_private, 0));
+
+		ExplainPropertyText("Remote SQL", sql, es);
+
+#if PG_VERSION_NUM >= 140000
+		/* Only INSERT is batched, and only show the batch size if it is used */
+		if (rinfo->ri_BatchSize > 1)
+			ExplainPropertyInteger("Batch Size", NULL, rinfo->ri_BatchSize, es);
+#endif
+	}
+}
+
+/*
+ * dynamodbExplainDirectModify
+ *		Produce extra output for EXPLAIN of a ForeignScan that modifies a
+ *		foreign table directly
+ */
+extern "C" void
+dynamodbExplainDirectModify(ForeignScanState *node, ExplainState *es)
+{
+	List	   *fdw_private;
+	char	   *sql;
+
+	if (es->verbose)
+	{
+		fdw_private = ((ForeignScan *) node->ss.ps.plan)->fdw_private;
+		sql = strVal(list_nth(fdw_private, FdwDirectModifyPrivateUpdateSql));
+		ExplainPropertyText("Remote SQL", sql, es);
+	}
+}
+
+/*
+ * dynamodbBeginForeignModify
+ *
+ * Begin an insert/update/delete operation on a foreign table
+ */
+extern "C" void
+dynamodbBeginForeignModify(ModifyTableState *mtstate,
+						   ResultRelInfo *resultRelInfo,
+						   List *fdw_private,
+						   int subplan_index,
+						   int eflags)
+{
+	DynamoDBFdwModifyState *fmstate;
+	char	   *query;
+	List	   *target_attrs;
+	bool		has_returning;
+	List	   *retrieved_attrs;
+	RangeTblEntry *rte;
+
+	/*
+	 * Do nothing in EXPLAIN (no ANALYZE) case.  resultRelInfo->ri_FdwState
+	 * stays NULL.
+	 */
+	if (eflags & EXEC_FLAG_EXPLAIN_ONLY)
+		return;
+
+	/* Deconstruct fdw_private data. */
+	query = strVal(list_nth(fdw_private, FdwModifyPrivateUpdateSql));
+	target_attrs = (List *) list_nth(fdw_private, FdwModifyPrivateTargetAttnums);
+#if PG_VERSION_NUM >= 150000
+	has_returning = boolVal(list_nth(fdw_private, FdwModifyPrivateHasReturning));
+#else
+	has_returning = intVal(list_nth(fdw_private, FdwModifyPrivateHasReturning));
+#endif
+	retrieved_attrs = (List *) list_nth(fdw_private, FdwModifyPrivateRetrievedAttrs);
+
+	/* Find RTE. */
+	rte = exec_rt_fetch(resultRelInfo->ri_RangeTableIndex,
+						mtstate->ps.state);
+
+	/* Construct an execution state. */
+	fmstate = dynamodb_create_foreign_modify(mtstate->ps.state,
+									rte,
+									resultRelInfo,
+									mtstate->operation,
+#if (PG_VERSION_NUM >= 140000)
+									outerPlanState(mtstate)->plan,
+#else
+									mtstate->mt_plans[subplan_index]->plan,
+#endif
+									query,
+									target_attrs,
+									has_returning,
+									retrieved_attrs);
+
+	resultRelInfo->ri_FdwState = fmstate;
+}
+
+/*
+ * Create cursor for node's query with current parameter values.
+ */
+static void
+create_cursor(ForeignScanState *node)
+{
+	DynamoDBFdwScanState *fsstate = (DynamoDBFdwScanState *) node->fdw_state;
+
+	/*
+	 * Mark the cursor as created, and show no tuples have been retrieved.
+	 * The remote read itself is only started by the first fetch.
+	 */
+	fsstate->cursor_exists = true;
+	fsstate->eof_reached = false;
+	fsstate->scan_done = false;
+	fsstate->next_fetch_ready = true;
+	fsstate->row_index = 0;
+	fsstate->num_rows = 0;
+
+	/*
+	 * Compute the values of the parameters, i.e. the outer columns of a
+	 * parameterized scan and the expressions computed locally, for this
+	 * scan.
+	 *
+	 * DynamoDB does not compare with NULL as PostgreSQL does: a NULL
+	 * parameter may let through rows for which the condition is not true.
+	 * In that case, the remote conditions are checked again locally.
+	 */
+	fsstate->param_values->clear();
+	fsstate->recheck_remote_conds = false;
+	if (fsstate->param_exprs != NIL)
+	{
+		ExprContext *econtext = node->ss.ps.ps_ExprContext;
+		MemoryContext oldcontext;
+		ListCell   *lc,
+				   *lc2;
+
+		oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+		forboth(lc, fsstate->param_exprs, lc2, fsstate->param_types)
+		{
+			ExprState  *expr_state = (ExprState *) lfirst(lc);
+			Oid			type = lfirst_oid(lc2);
+			Datum		value;
+			bool		isnull;
+
+			value = ExecEvalExpr(expr_state, econtext, &isnull);
+			fsstate->param_values->push_back(dynamodb_bind_param(type, value,
+																 fsstate->query, isnull));
+			if (isnull)
+				fsstate->recheck_remote_conds = true;
+		}
+		MemoryContextSwitchTo(oldcontext);
+	}
+}
+
+/*
+ * dynamodb_count_items
+ *		Count the items with the Query or Scan request of the scan.
+ *
+ * DynamoDB counts the items of up to 1 MB of data per request, so the
+ * requests follow LastEvaluatedKey until the whole table or partition has
+ * been counted.
+ */
+static int64
+dynamodb_count_items(DynamoDBFdwScanState *fsstate)
+{
+	const char *key_condition = strVal(linitial(fsstate->count_request));
+	const char *filter = strVal(lsecond(fsstate->count_request));
+	List	   *attr_names = (List *) lthird(fsstate->count_request);
+	Aws::Map<Aws::String, Aws::String> names;
+	Aws::Map<Aws::String, Model::AttributeValue> values;
+	Aws::Map<Aws::String, Model::AttributeValue> start_key;
+	int64		count = 0;
+	char		placeholder[32];
+	ListCell   *lc;
+	int			i = 0;
+
+	foreach(lc, attr_names)
+	{
+		snprintf(placeholder, sizeof(placeholder), "#n%d", i++);
+		names[placeholder] = strVal(lfirst(lc));
+	}
+	for (i = 0; i < (int) fsstate->param_values->size(); i++)
+	{
+		snprintf(placeholder, sizeof(placeholder), ":v%d", i);
+		values[placeholder] = (*fsstate->param_values)[i];
+	}
+
+	do
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		if (key_condition[0] != '\0')
+		{
+			Model::QueryRequest req;
+			Model::QueryOutcome outcome;
+
+			req.SetTableName(fsstate->table_name);
+			req.SetSelect(Model::Select::COUNT);
+			req.SetKeyConditionExpression(key_condition);
+			if (filter[0] != '\0')
+				req.SetFilterExpression(filter);
+			req.SetExpressionAttributeNames(names);
+			req.SetExpressionAttributeValues(values);
+			if (!start_key.empty())
+				req.SetExclusiveStartKey(start_key);
+
+			outcome = fsstate->conn->Query(req);
+			if (!outcome.IsSuccess())
+				dynamodb_report_error(ERROR, outcome.GetError().GetMessage(), fsstate->query);
+			count += outcome.GetResult().GetCount();
+			start_key = outcome.GetResult().GetLastEvaluatedKey();
+		}
+		else
+		{
+			Model::ScanRequest req;
+			Model::ScanOutcome outcome;
+
+			req.SetTableName(fsstate->table_name);
+			req.SetSelect(Model::Select::COUNT);
+			if (filter[0] != '\0')
+			{
+				req.SetFilterExpression(filter);
+				req.SetExpressionAttributeNames(names);
+				req.SetExpressionAttributeValues(values);
+			}
+			if (!start_key.empty())
+				req.SetExclusiveStartKey(start_key);
+
+			outcome = fsstate->conn->Scan(req);
+			if (!outcome.IsSuccess())
+				dynamodb_report_error(ERROR, outcome.GetError().GetMessage(), fsstate->query);
+			count += outcome.GetResult().GetCount();
+			start_key = outcome.GetResult().GetLastEvaluatedKey();
+		}
+	} while (!start_key.empty());
+
+	return count;
+}
+
+/*
+ * dynamodb_init_agg_state
+ *		Set up the computation of the aggregates of a scan.
+ *
+ * tupdesc describes the scan tuple, and input_tupdesc the table whose
+ * columns are decoded.  The groups are kept in agg_cxt.
+ */
+static DynamoDBAggState *
+dynamodb_init_agg_state(List *aggregates, TupleDesc tupdesc, TupleDesc input_tupdesc,
+						MemoryContext agg_cxt)
+{
+	DynamoDBAggState *agg = new DynamoDBAggState();
+	List	   *columns = (List *) lsecond(aggregates);
+	ListCell   *lc;
+	int			i = 0;
+
+	agg->ncolumns = list_length(columns);
+	agg->columns = (DynamoDBAggColumn *) palloc0(agg->ncolumns * sizeof(DynamoDBAggColumn));
+	agg->natts = input_tupdesc->natts;
+	agg->needed = (bool *) palloc0(agg->natts * sizeof(bool));
+	agg->values = (Datum *) palloc0(agg->natts * sizeof(Datum));
+	agg->nulls = (bool *) palloc(agg->natts * sizeof(bool));
+	agg->agg_cxt = agg_cxt;
+	agg->next_group = 0;
+	agg->done = false;
+
+	foreach(lc, columns)
+	{
+		List	   *desc = (List *) lfirst(lc);
+		DynamoDBAggColumn *column = &agg->columns[i];
+		Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
+
+		column->kind = (DynamoDBAggKind) intVal(linitial(desc));
+		column->attnum = intVal(lsecond(desc)) - 1;
+		column->collation = attr->attcollation;
+		column->typlen = attr->attlen;
+		column->typbyval = attr->attbyval;
+		if (column->attnum >= 0)
+		{
+			column->input_type = TupleDescAttr(input_tupdesc, column->attnum)->atttypid;
+			agg->needed[column->attnum] = true;
+		}
+		if (column->kind == DYNAMODB_AGG_MIN || column->kind == DYNAMODB_AGG_MAX)
+		{
+			TypeCacheEntry *typentry = lookup_type_cache(attr->atttypid,
+														 TYPECACHE_CMP_PROC_FINFO);
+
+			column->cmp_proc = &typentry->cmp_proc_finfo;
+		}
+		i++;
+	}
+
+	agg->group_attnum = intVal(linitial(aggregates)) - 1;
+	if (agg->group_attnum >= 0)
+	{
+		Form_pg_attribute attr = TupleDescAttr(input_tupdesc, agg->group_attnum);
+		TypeCacheEntry *typentry = lookup_type_cache(attr->atttypid,
+													 TYPECACHE_HASH_PROC_FINFO |
+													 TYPECACHE_EQ_OPR_FINFO);
+
+		agg->group_collation = attr->attcollation;
+		agg->group_hash_proc = &typentry->hash_proc_finfo;
+		agg->group_eq_proc = &typentry->eq_opr_finfo;
+		agg->group_typlen = attr->attlen;
+		agg->group_typbyval = attr->attbyval;
+		agg->needed[agg->group_attnum] = true;
+	}
+
+	return agg;
+}
+
+/*
+ * dynamodb_reset_agg_state
+ *		Forget the groups of a scan which is restarted.
+ */
+static void
+dynamodb_reset_agg_state(DynamoDBAggState *agg)
+{
+	agg->groups.clear();
+	agg->groups_by_hash.clear();
+	MemoryContextReset(agg->agg_cxt);
+	agg->next_group = 0;
+	agg->done = false;
+}
+
+/*
+ * dynamodb_aggregate_items
+ *		Read all the items of the scan, and aggregate them into their groups.
+ */
+static void
+dynamodb_aggregate_items(DynamoDBFdwScanState *fsstate)
+{
+	DynamoDBAggState *agg = fsstate->agg;
+
+	for (;;)
+	{
+		std::shared_ptr<const DynamoDBItems> page;
+		bool		pending;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* The scan is never run in async mode */
+		page = dynamodb_fetch_next_page(fsstate, &pending);
+		Assert(!pending);
+		if (page == nullptr)
+			break;
+
+		for (const auto &item : *page)
+			dynamodb_aggregate_item(fsstate, item);
+	}
+
+	/* Without GROUP BY, there is a row even if no item has been read */
+	if (agg->group_attnum < 0 && agg->groups.empty())
+		(void) dynamodb_find_agg_group(agg);
+
+	agg->done = true;
+}
+
+/*
+ * dynamodb_aggregate_item
+ *		Decode the columns of an item which the aggregates need, and advance
+ *		the aggregates of its group.
+ *
+ * No tuple is formed for the item: its values only live until the next
+ * item, in the per-tuple context of the scan.
+ */
+static void
+dynamodb_aggregate_item(DynamoDBFdwScanState *fsstate, const DynamoDBItem &item)
+{
+	DynamoDBAggState *agg = fsstate->agg;
+	DynamoDBAggGroup *group;
+	MemoryContext oldcontext;
+
+	oldcontext = MemoryContextSwitchTo(fsstate->temp_cxt);
+
+	memset(agg->nulls, true, agg->natts * sizeof(bool));
+	for (const auto &column : item)
+	{
+		if (column.second.GetType() == Aws::DynamoDB::Model::ValueType::NULLVALUE)
+			continue;
+
+		auto		range = fsstate->attr_map->equal_range(column.first);
+
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			int			attnum = it->second;
+
+			if (!agg->needed[attnum])
+				continue;
+			agg->nulls[attnum] = false;
+			agg->values[attnum] = dynamodb_convert_to_pg(&fsstate->converters[attnum],
+														 column.second);
+		}
+	}
+
+	group = dynamodb_find_agg_group(agg);
+
+	for (int i = 0; i < agg->ncolumns; i++)
+	{
+		DynamoDBAggColumn *column = &agg->columns[i];
+
+		if (column->kind == DYNAMODB_AGG_GROUP_KEY)
+			continue;
+
+		/* count(*) counts every item, the other aggregates skip nulls */
+		if (column->attnum < 0)
+			group->values[i].count++;
+		else if (!agg->nulls[column->attnum])
+			dynamodb_advance_agg(agg, column, &group->values[i],
+								 agg->values[column->attnum]);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+	MemoryContextReset(fsstate->temp_cxt);
+}
+
+/*
+ * dynamodb_find_agg_group
+ *		Find the group of the current item, creating it if it is new.
+ */
+static DynamoDBAggGroup *
+dynamodb_find_agg_group(DynamoDBAggState *agg)
+{
+	DynamoDBAggGroup group;
+	Datum		key = (Datum) 0;
+	bool		key_isnull = true;
+	uint32		hash = 0;
+	MemoryContext oldcontext;
+
+	if (agg->group_attnum >= 0)
+	{
+		key = agg->values[agg->group_attnum];
+		key_isnull = agg->nulls[agg->group_attnum];
+		if (!key_isnull)
+			hash = DatumGetUInt32(FunctionCall1Coll(agg->group_hash_proc,
+													agg->group_collation, key));
+
+		auto		range = agg->groups_by_hash.equal_range(hash);
+
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			DynamoDBAggGroup *candidate = &agg->groups[it->second];
+
+			if (candidate->key_isnull != key_isnull)
+				continue;
+			if (key_isnull ||
+				DatumGetBool(FunctionCall2Coll(agg->group_eq_proc, agg->group_collation,
+											   candidate->key, key)))
+				return candidate;
+		}
+	}
+	else if (!agg->groups.empty())
+		return &agg->groups[0];
+
+	/* A new group */
+	oldcontext = MemoryContextSwitchTo(agg->agg_cxt);
+	group.key_isnull = key_isnull;
+	group.key = key_isnull ? (Datum) 0 :
+		datumCopy(key, agg->group_typbyval, agg->group_typlen);
+	group.values = (DynamoDBAggValue *) palloc0(agg->ncolumns * sizeof(DynamoDBAggValue));
+	MemoryContextSwitchTo(oldcontext);
+
+	agg->groups.push_back(group);
+	agg->groups_by_hash.emplace(hash, agg->groups.size() - 1);
+
+	return &agg->groups.back();
+}
+
+/*
+ * dynamodb_advance_agg
+ *		Add a non-null input to the transition value of an aggregate.
+ *
+ * The results are the ones of the built-in aggregates: min() and max() keep
+ * the later of equal values, sum() of a float starts from its first input,
+ * and sums of integers are exact.
+ */
+static void
+dynamodb_advance_agg(DynamoDBAggState *agg, DynamoDBAggColumn *column,
+					 DynamoDBAggValue *value, Datum input)
+{
+	MemoryContext oldcontext;
+
+	switch (column->kind)
+	{
+		case DYNAMODB_AGG_COUNT:
+			value->count++;
+			break;
+
+		case DYNAMODB_AGG_SUM:
+		case DYNAMODB_AGG_AVG:
+			value->count++;
+			switch (column->input_type)
+			{
+				case INT2OID:
+					value->int_sum += DatumGetInt16(input);
+					break;
+				case INT4OID:
+					value->int_sum += DatumGetInt32(input);
+					break;
+				case INT8OID:
+					{
+						int64		sum = value->int_sum;
+
+						/* Carry the sum so far over to the numeric sum */
+						if (pg_add_s64_overflow(sum, DatumGetInt64(input), &value->int_sum))
+						{
+							dynamodb_add_agg_numeric(agg, value,
+													 DirectFunctionCall1(int8_numeric,
+																		 Int64GetDatum(sum)));
+							value->int_sum = DatumGetInt64(input);
+						}
+					}
+					break;
+				case FLOAT4OID:
+					if (column->kind == DYNAMODB_AGG_AVG)
+						value->float_sum = float8_pl(value->float_sum,
+													 (float8) DatumGetFloat4(input));
+					else if (value->count == 1)
+						value->float_sum = DatumGetFloat4(input);
+					else
+						value->float_sum = float4_pl((float4) value->float_sum,
+													 DatumGetFloat4(input));
+					break;
+				case FLOAT8OID:
+					if (column->kind == DYNAMODB_AGG_SUM && value->count == 1)
+						value->float_sum = DatumGetFloat8(input);
+					else
+						value->float_sum = float8_pl(value->float_sum,
+													 DatumGetFloat8(input));
+					break;
+				case NUMERICOID:
+					dynamodb_add_agg_numeric(agg, value, input);
+					break;
+				default:
+					elog(ERROR, "dynamodb_fdw: unexpected input type %u of aggregate",
+						 column->input_type);
+			}
+			break;
+
+		case DYNAMODB_AGG_MIN:
+		case DYNAMODB_AGG_MAX:
+			if (value->has_value)
+			{
+				int32		cmp = DatumGetInt32(FunctionCall2Coll(column->cmp_proc,
+																  column->collation,
+																  value->value, input));
+
+				if (column->kind == DYNAMODB_AGG_MIN ? cmp < 0 : cmp > 0)
+					break;
+				if (!column->typbyval)
+					pfree(DatumGetPointer(value->value));
+			}
+			oldcontext = MemoryContextSwitchTo(agg->agg_cxt);
+			value->value = datumCopy(input, column->typbyval, column->typlen);
+			MemoryContextSwitchTo(oldcontext);
+			value->has_value = true;
+			break;
+
+		default:
+			elog(ERROR, "dynamodb_fdw: unexpected aggregate kind %d", (int) column->kind);
+	}
+}
+
+/*
+ * dynamodb_add_agg_numeric
+ *		Add a numeric to the numeric sum of a transition value.
+ *
+ * The sum is computed in the current context, and only the result is kept
+ * in the context of the groups.
+ */
+static void
+dynamodb_add_agg_numeric(DynamoDBAggState *agg, DynamoDBAggValue *value, Datum num)
+{
+	MemoryContext oldcontext;
+
+	if (value->has_value)
+	{
+		num = DirectFunctionCall2(numeric_add, value->value, num);
+		pfree(DatumGetPointer(value->value));
+	}
+
+	oldcontext = MemoryContextSwitchTo(agg->agg_cxt);
+	value->value = datumCopy(num, false, -1);
+	MemoryContextSwitchTo(oldcontext);
+	value->has_value = true;
+}
+
+/*
+ * dynamodb_finalize_agg
+ *		Compute the result of an aggregate from its transition value.
+ */
+static Datum
+dynamodb_finalize_agg(DynamoDBAggColumn *column, DynamoDBAggValue *value, bool *isnull)
+{
+	Datum		sum;
+
+	*isnull = false;
+	switch (column->kind)
+	{
+		case DYNAMODB_AGG_COUNT:
+			return Int64GetDatum(value->count);
+		case DYNAMODB_AGG_MIN:
+		case DYNAMODB_AGG_MAX:
+			*isnull = !value->has_value;
+			return value->value;
+		default:
+			break;
+	}
+
+	/* sum() and avg() of no input are null */
+	if (value->count == 0)
+	{
+		*isnull = true;
+		return (Datum) 0;
+	}
+
+	switch (column->input_type)
+	{
+		case INT2OID:
+		case INT4OID:
+			if (column->kind == DYNAMODB_AGG_SUM)
+				return Int64GetDatum(value->int_sum);
+			sum = DirectFunctionCall1(int8_numeric, Int64GetDatum(value->int_sum));
+			break;
+		case INT8OID:
+			sum = DirectFunctionCall1(int8_numeric, Int64GetDatum(value->int_sum));
+			if (value->has_value)
+				sum = DirectFunctionCall2(numeric_add, value->value, sum);
+			if (column->kind == DYNAMODB_AGG_SUM)
+				return sum;
+			break;
+		case FLOAT4OID:
+			if (column->kind == DYNAMODB_AGG_SUM)
+				return Float4GetDatum((float4) value->float_sum);
+			return Float8GetDatum(value->float_sum / (float8) value->count);
+		case FLOAT8OID:
+			if (column->kind == DYNAMODB_AGG_SUM)
+				return Float8GetDatum(value->float_sum);
+			return Float8GetDatum(value->float_sum / (float8) value->count);
+		case NUMERICOID:
+			sum = value->value;
+			if (column->kind == DYNAMODB_AGG_SUM)
+				return sum;
+			break;
+		default:
+			elog(ERROR, "dynamodb_fdw: unexpected input type %u of aggregate",
+				 column->input_type);
+			return (Datum) 0;	/* keep compiler quiet */
+	}
+
+	/* avg() of integers and numerics is the numeric quotient */
+	return DirectFunctionCall2(numeric_div, sum,
+							   DirectFunctionCall1(int8_numeric,
+												   Int64GetDatum(value->count)));
+}
+
+/*
+ * dynamodb_open_page_source
+ *		Open the next remote read of the scan.
+ *
+ * A plain scan runs its PartiQL statement once.  A parallel scan reads one
+ * Scan segment after the other, claiming each from shared memory so that
+ * every segment is read by exactly one participant.  Returns false if there
+ * is nothing left to read.
+ *
+ * A single key which a parameterized scan has already read is taken from
+ * its memo.
+ */
+static bool
+dynamodb_open_page_source(DynamoDBFdwScanState *fsstate)
+{
+	bool		cached = false;
+
+	Assert(fsstate->source == NULL);
+
+	if (fsstate->scan_done)
+		return false;
+
+	if (fsstate->lookup_keys != NIL)
+	{
+		DynamoDBItems keys = dynamodb_build_lookup_keys(fsstate->lookup_keys,
+														*fsstate->param_values,
+														fsstate->query);
+
+		if (fsstate->memo != NULL)
+		{
+			fsstate->memo->pending_key.clear();
+			if (keys.size() == 1)
+			{
+				Aws::String memo_key = dynamodb_lookup_memo_key(keys.front());
+				auto		hit = fsstate->memo->pages.find(memo_key);
+
+				if (hit != fsstate->memo->pages.end())
+				{
+					fsstate->source = new DynamoDBCachedSource(hit->second);
+					cached = true;
+				}
+				else
+					fsstate->memo->pending_key = std::move(memo_key);
+			}
+		}
+
+		if (!cached)
+			fsstate->source = new DynamoDBKeySource(fsstate->conn, fsstate->table_name,
+													dynamodb_get_retrieved_attr_names(fsstate->retrieved_attrs),
+													std::move(keys));
+
+		/* The keys are all read by the one source */
+		fsstate->scan_done = true;
+	}
+	else if (fsstate->total_segments == 0)
+	{
+		/* Rows rechecked locally may be rejected, so then read them all */
+		fsstate->source = new DynamoDBStatementSource(fsstate->conn, fsstate->query,
+													  *fsstate->param_values,
+													  fsstate->recheck_remote_conds ? 0 : fsstate->limit,
+													  fsstate->limit_reads);
+
+		/* The statement returns all the rows */
+		fsstate->scan_done = true;
+	}
+	else
+	{
+		uint32		segment;
+
+		if (fsstate->pstate != NULL)
+			segment = pg_atomic_fetch_add_u32(&fsstate->pstate->next_segment, 1);
+		else
+			segment = fsstate->local_next_segment++;
+
+		if (segment >= (uint32) fsstate->total_segments)
+		{
+			fsstate->scan_done = true;
+			return false;
+		}
+
+		fsstate->source = new DynamoDBSegmentSource(fsstate->conn, fsstate->table_name,
+													dynamodb_get_retrieved_attr_names(fsstate->retrieved_attrs),
+													(int) segment, fsstate->total_segments);
+	}
+	fsstate->source_done = false;
+
+	/* A page from the memo is at hand already */
+	if (fsstate->prefetch_depth > 0 && !cached)
+		dynamodb_start_prefetch(fsstate);
+
+	return true;
+}
+
+/*
+ * dynamodb_get_retrieved_attr_names
+ *		Get the names of the attributes to read, for the requests which
+ *		take a projection instead of a PartiQL statement.
+ */
+static Aws::Vector<Aws::String>
+dynamodb_get_retrieved_attr_names(List *retrieved_attrs)
+{
+	Aws::Vector<Aws::String> attr_names;
+	ListCell   *lc;
+
+	/* retrieved_attrs is a list of attribute name and number pairs */
+	for (lc = list_head(retrieved_attrs); lc != NULL;
+		 lc = lnext(retrieved_attrs, lnext(retrieved_attrs, lc)))
+		attr_names.push_back(strVal(lfirst(lc)));
+
+	return attr_names;
+}
+
+/*
+ * dynamodb_build_lookup_keys
+ *		Build the keys to read from the key values chosen by the planner.
+ *
+ * With a sort key, every pair of a partition key value and a sort key value
+ * is a key.  params holds the values of the parameters of the scan.
+ */
+static DynamoDBItems
+dynamodb_build_lookup_keys(List *lookup_keys,
+						   const Aws::Vector<Model::AttributeValue> &params,
+						   const char *query)
+{
+	DynamoDBItems keys;
+	Aws::Vector<Model::AttributeValue> partition_values;
+	Aws::Vector<Model::AttributeValue> sort_values;
+	Aws::String partition_key = strVal(linitial(lookup_keys));
+	Aws::String sort_key;
+
+	dynamodb_bind_key_values((List *) lsecond(lookup_keys), params, query,
+							 partition_values);
+	if (list_length(lookup_keys) > 2)
+	{
+		sort_key = strVal(lthird(lookup_keys));
+		dynamodb_bind_key_values((List *) lfourth(lookup_keys), params, query,
+								 sort_values);
+	}
+
+	keys.reserve(partition_values.size() * Max(sort_values.size(), 1));
+	for (const auto &partition_value : partition_values)
+	{
+		if (sort_key.empty())
+		{
+			DynamoDBItem key;
+
+			key[partition_key] = partition_value;
+			keys.push_back(std::move(key));
+			continue;
+		}
+
+		for (const auto &sort_value : sort_values)
+		{
+			DynamoDBItem key;
+
+			key[partition_key] = partition_value;
+			key[sort_key] = sort_value;
+			keys.push_back(std::move(key));
+		}
+	}
+
+	return keys;
+}
+
+/*
+ * dynamodb_bind_key_values
+ *		Convert the values of a key column into DynamoDB values.
+ *
+ * A value is either a Const, or the Integer index of a parameter; a NULL
+ * parameter never equals a key.  BatchGetItem refuses duplicate keys, so the
+ * values which become the same DynamoDB value, e.g. numerics which only
+ * differ by their scale, are only used once.
+ */
+static void
+dynamodb_bind_key_values(List *values, const Aws::Vector<Model::AttributeValue> &params,
+						 const char *query, Aws::Vector<Model::AttributeValue> &result)
+{
+	std::unordered_set<Aws::String, DynamoDBAttrNameHash> seen;
+	ListCell   *lc;
+
+	foreach(lc, values)
+	{
+		Model::AttributeValue value;
+
+		if (IsA(lfirst(lc), Integer))
+		{
+			value = params.at(intVal(lfirst(lc)));
+			if (value.GetType() == Model::ValueType::NULLVALUE)
+				continue;
+		}
+		else
+		{
+			Const	   *c = lfirst_node(Const, lc);
+
+			value = dynamodb_bind_sql_var(c->consttype, 0, c->constvalue, query, false);
+		}
+
+		if (seen.insert(value.Jsonize().View().WriteCompact()).second)
+			result.push_back(std::move(value));
+	}
+}
+
+/*
+ * dynamodb_close_page_source
+ *		Stop the prefetch worker of a scan and release its page source.
+ *
+ * This is also the reset callback of the query context, so that the worker
+ * does not survive an aborted query.
+ */
+static void
+dynamodb_close_page_source(void *arg)
+{
+	DynamoDBFdwScanState *fsstate = (DynamoDBFdwScanState *) arg;
+
+	/* The worker uses the source, so stop it first */
+	if (fsstate->prefetcher != NULL)
+	{
+		delete fsstate->prefetcher;
+		fsstate->prefetcher = NULL;
+	}
+
+	if (fsstate->source != NULL)
+	{
+		delete fsstate->source;
+		fsstate->source = NULL;
+	}
+
+	/* The rows of the current page have all been returned by now */
+	fsstate->items = nullptr;
+}
+
+/*
+ * dynamodb_release_scan_state
+ *		Free the C++ objects of a scan.
+ *
+ * This is also the reset callback of the query context, so that nothing
+ * survives an aborted query.
+ */
+static void
+dynamodb_release_scan_state(void *arg)
+{
+	DynamoDBFdwScanState *fsstate = (DynamoDBFdwScanState *) arg;
+
+	dynamodb_close_page_source(fsstate);
+
+	if (fsstate->attr_map != NULL)
+	{
+		delete fsstate->attr_map;
+		fsstate->attr_map = NULL;
+	}
+
+	if (fsstate->param_values != NULL)
+	{
+		delete fsstate->param_values;
+		fsstate->param_values = NULL;
+	}
+
+	if (fsstate->memo != NULL)
+	{
+		delete fsstate->memo;
+		fsstate->memo = NULL;
+	}
+
+	if (fsstate->agg != NULL)
+	{
+		delete fsstate->agg;
+		fsstate->agg = NULL;
+	}
+}
+
+/*
+ * dynamodb_release_modify_state
+ *		Free the C++ objects of a foreign insert/update/delete.
+ */
+static void
+dynamodb_release_modify_state(void *arg)
+{
+	DynamoDBFdwModifyState *fmstate = (DynamoDBFdwModifyState *) arg;
+
+	if (fmstate->writer != NULL)
+	{
+		delete fmstate->writer;
+		fmstate->writer = NULL;
+	}
+
+	if (fmstate->attr_map != NULL)
+	{
+		delete fmstate->attr_map;
+		fmstate->attr_map = NULL;
+	}
+}
+
+/*
+ * dynamodb_build_attr_map
+ *		Build the map from attribute names to column numbers.
+ *
+ * retrieved_attrs is a list of pairs: the name of the attribute, then the
+ * number of the column which takes its value.
+ */
+static DynamoDBAttrMap *
+dynamodb_build_attr_map(List *retrieved_attrs)
+{
+	DynamoDBAttrMap *attr_map = new DynamoDBAttrMap();
+	ListCell   *lc;
+
+	attr_map->reserve(list_length(retrieved_attrs) / 2);
+
+	for (lc = list_head(retrieved_attrs); lc != NULL;
+		 lc = lnext(retrieved_attrs, lnext(retrieved_attrs, lc)))
+	{
+		const char *attname = strVal(lfirst(lc));
+		int			attnum = intVal(lfirst(lnext(retrieved_attrs, lc)));
+
+		attr_map->emplace(Aws::String(attname), attnum - 1);
+	}
+
+	return attr_map;
+}
+
+/*
+ * dynamodb_build_converters
+ *		Select how to convert the values of the retrieved columns.
+ *
+ * The array is indexed by the (0-based) column number; the entries of the
+ * columns which are not retrieved are left unset.
+ */
+static DynamoDBColumnConverter *
+dynamodb_build_converters(TupleDesc tupdesc, List *retrieved_attrs)
+{
+	DynamoDBColumnConverter *converters;
+	ListCell   *lc;
+
+	converters = (DynamoDBColumnConverter *)
+		palloc0(tupdesc->natts * sizeof(DynamoDBColumnConverter));
+
+	for (lc = list_head(retrieved_attrs); lc != NULL;
+		 lc = lnext(retrieved_attrs, lnext(retrieved_attrs, lc)))
+	{
+		int			attnum = intVal(lfirst(lnext(retrieved_attrs, lc)));
+		Form_pg_attribute attr = TupleDescAttr(tupdesc, attnum - 1);
+
+		dynamodb_init_column_converter(&converters[attnum - 1], attr->atttypid,
+									   attr->atttypmod);
+	}
+
+	return converters;
+}
+
+/*
+ * dynamodb_start_prefetch
+ *		Launch a worker which fetches the pages of the source ahead of time.
+ */
+static void
+dynamodb_start_prefetch(DynamoDBFdwScanState *fsstate)
+{
+	char	   *failure = NULL;
+
+	Assert(fsstate->prefetcher == NULL);
+
+	fsstate->prefetcher = new DynamoDBPrefetcher(fsstate->source,
+												 fsstate->prefetch_depth,
+												 fsstate->prefetch_memory_limit);
+	try
+	{
+		fsstate->prefetcher->start();
+	}
+	catch (const std::exception &e)
+	{
+		failure = pstrdup(e.what());
+	}
+
+	/* Do not throw a PostgreSQL error from inside the catch block */
+	if (failure != NULL)
+	{
+		delete fsstate->prefetcher;
+		fsstate->prefetcher = NULL;
+		ereport(ERROR,
+				(errcode(ERRCODE_FDW_ERROR),
+				 errmsg("dynamodb_fdw: could not start prefetch worker: %s", failure)));
+	}
+}
+
+/*
+ * dynamodb_fetch_next_page
+ *
+ * Get the next page of the result set, either from the prefetch worker or
+ * by sending the request here.  Moves on to the next source when the
+ * current one is exhausted.  Returns nullptr when there is no more page.
+ *
+ * In async mode, this does not wait for the prefetch worker: if the next
+ * page has not arrived yet, *pending is set and nullptr is returned.
+ */
+static std::shared_ptr<const DynamoDBItems>
+dynamodb_fetch_next_page(DynamoDBFdwScanState *fsstate, bool *pending)
+{
+	*pending = false;
+
+	for (;;)
+	{
+		std::shared_ptr<const DynamoDBItems> page;
+		Aws::String message;
+
+		if (fsstate->source == NULL && !dynamodb_open_page_source(fsstate))
+			return nullptr;
+
+		if (fsstate->prefetcher != NULL)
+		{
+			DynamoDBPrefetchStatus status;
+
+			if (fsstate->async_capable)
+			{
+				status = fsstate->prefetcher->wait_page(page, message, 0);
+				if (status == DYNAMODB_PREFETCH_PENDING)
+				{
+					*pending = true;
+					return nullptr;
+				}
+			}
+
+			/* Wait in short slices so that the query can still be cancelled */
+			else
+			{
+				while ((status = fsstate->prefetcher->wait_page(page, message,
+																DYNAMODB_PREFETCH_WAIT_MS)) == DYNAMODB_PREFETCH_PENDING)
+					CHECK_FOR_INTERRUPTS();
+			}
+
+			if (status == DYNAMODB_PREFETCH_ERROR)
+				dynamodb_report_error(ERROR, message, fsstate->query);
+			if (status == DYNAMODB_PREFETCH_PAGE)
+			{
+				dynamodb_remember_lookup(fsstate, page);
+				return page;
+			}
+		}
+		else if (!fsstate->source_done)
+		{
+			bool		more;
+
+			if (!fsstate->source->fetch_page(page, more, message))
+				dynamodb_report_error(ERROR, message, fsstate->query);
+
+			fsstate->source_done = !more;
+			dynamodb_remember_lookup(fsstate, page);
+			return page;
+		}
+
+		/* This source is exhausted */
+		dynamodb_close_page_source(fsstate);
+	}
+}
+
+/*
+ * dynamodb_lookup_memo_key
+ *		Get the key of the lookup memo for the key of an item.
+ */
+static Aws::String
+dynamodb_lookup_memo_key(const DynamoDBItem &key)
+{
+	Aws::String memo_key;
+
+	/* The attributes of the key come in the order of their names */
+	for (const auto &attr : key)
+	{
+		memo_key += attr.first;
+		memo_key += '\0';
+		memo_key += attr.second.Jsonize().View().WriteCompact();
+		memo_key += '\0';
+	}
+
+	return memo_key;
+}
+
+/*
+ * dynamodb_remember_lookup
+ *		Keep the page of a single-key lookup in the memo of the scan, if it
+ *		is to be kept and there is room left.
+ */
+static void
+dynamodb_remember_lookup(DynamoDBFdwScanState *fsstate,
+						 const std::shared_ptr<const DynamoDBItems> &page)
+{
+	DynamoDBLookupMemo *memo = fsstate->memo;
+	size_t		size;
+
+	if (memo == NULL || memo->pending_key.empty())
+		return;
+
+	size = memo->pending_key.size() + dynamodb_estimate_page_size(*page);
+	if (memo->memory_used + size <= DYNAMODB_LOOKUP_MEMO_LIMIT)
+	{
+		memo->memory_used += size;
+		memo->pages.emplace(std::move(memo->pending_key), page);
+	}
+	memo->pending_key.clear();
+}
+
+/*
+ * Fetch the next row from the node's cursor into the scan tuple slot.
+ *
+ * The columns are converted straight into the slot's values and nulls
+ * arrays, and the slot is stored as a virtual tuple, so that no tuple has
+ * to be formed here and deformed again by the upper nodes.  The converted
+ * values live in batch_cxt, which is reset when the next page is taken.
+ * Returns false if no row was stored, at the end of the data or, in async
+ * mode, when the next page has not arrived yet.
+ */
+static bool
+fetch_more_data(ForeignScanState *node)
+{
+	DynamoDBFdwScanState *fsstate = (DynamoDBFdwScanState *) node->fdw_state;
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+	bool		has_more_rows = true;
+	MemoryContext oldcontext;
+
+	ExecClearTuple(slot);
+
+	if (fsstate->next_fetch_ready)
+	{
+		std::shared_ptr<const DynamoDBItems> items;
+		bool		pending;
+
+		/*
+		 * DynamoDB may return a page without items which is still followed
+		 * by more pages, so skip over empty pages.
+		 */
+		do
+		{
+			items = dynamodb_fetch_next_page(fsstate, &pending);
+		} while (items != nullptr && items->empty());
+
+		if (pending)
+		{
+			/* Async mode: no tuple for now, the caller will wait */
+			has_more_rows = false;
+		}
+		else if (items == nullptr)
+		{
+			has_more_rows = false;
+			fsstate->eof_reached = true;
+			fsstate->row_index = 0;
+			fsstate->num_rows = 0;
+			fsstate->items = nullptr;
+		}
+		else
+		{
+			fsstate->next_fetch_ready = false;
+			fsstate->row_index = 0;
+			fsstate->num_rows = items->size();
+			fsstate->items = std::move(items);
+		}
+
+		/* The rows of the previous page have all been returned */
+		if (!pending)
+			MemoryContextReset(fsstate->batch_cxt);
+	}
+
+	if (!has_more_rows)
+		return false;
+
+	/*
+	 * Get one row per iterate.  Any cruft the conversion leaks is released
+	 * with the values, along with the page.
+	 */
+	oldcontext = MemoryContextSwitchTo(fsstate->batch_cxt);
+	dynamodb_decode_result_row(*fsstate->items, &fsstate->row_index,
+							   fsstate->attr_map, fsstate->converters,
+							   slot->tts_tupleDescriptor->natts,
+							   slot->tts_values, slot->tts_isnull);
+	MemoryContextSwitchTo(oldcontext);
+
+	/*
+	 * Ready for next fetch if all rows has been processed.  The end of the
+	 * data is detected when the next page is asked for.
+	 */
+	if (fsstate->row_index == fsstate->num_rows)
+		fsstate->next_fetch_ready = true;
+
+	ExecStoreVirtualTuple(slot);
+	return true;
+}
+
+/*
+ * dynamodb_decode_result_row
+ *		Convert the item at *row_index into the given values and nulls
+ *		arrays of natts columns, and advance *row_index.
+ *
+ * The values are allocated in the current memory context.
+ */
+static void
+dynamodb_decode_result_row(const DynamoDBItems &items,
+						   unsigned int *row_index,
+						   const DynamoDBAttrMap *attr_map,
+						   const DynamoDBColumnConverter *converters,
+						   int natts, Datum *values, bool *nulls)
+{
+	Assert(*row_index < items.size());
+
+	/* Initialize to nulls for any columns not present in result */
+	memset(values, 0, natts * sizeof(Datum));
+	memset(nulls, true, natts * sizeof(bool));
+
+	/* Get the row based on row index, without copying the item */
+	const DynamoDBItem &row = items[*row_index];
+
+	/*
+	 * Route each attribute of the item to the columns which take its value.
+	 * Attributes which are not retrieved are skipped, and columns which are
+	 * not returned from DynamoDB are null by default.
+	 */
+	for (const auto& column : row)
+	{
+		if (column.second.GetType() == Aws::DynamoDB::Model::ValueType::NULLVALUE)
+			continue;
+
+		auto		range = attr_map->equal_range(column.first);
+
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			int			attnum = it->second;
+
+			nulls[attnum] = false;
+			values[attnum] = dynamodb_convert_to_pg(&converters[attnum],
+													column.second);
+		}
+	}
+
+	/* Increase row index to prepare for next fetch */
+	(*row_index)++;
+}
+
+static HeapTuple
+make_tuple_from_result_row(const DynamoDBItems &items,
+							unsigned int *row_index,
+							Relation rel,
+							const DynamoDBAttrMap *attr_map,
+							const DynamoDBColumnConverter *converters,
+							ForeignScanState *fsstate,
+							MemoryContext temp_context)
+{
+	HeapTuple	tuple;
+	TupleDesc	tupdesc;
+	Datum	   *values;
+	bool	   *nulls;
+	MemoryContext oldcontext;
+
+	Assert(*row_index < items.size());
+
+	/*
+	 * Do the following work in a temp context that we reset after each tuple.
+	 * This cleans up not only the data we have direct access to, but any
+	 * cruft the I/O functions might leak.
+	 */
+	oldcontext = MemoryContextSwitchTo(temp_context);
+
+	/*
+	 * Get the tuple descriptor for the row.  Use the rel's tupdesc if rel is
+	 * provided, otherwise look to the scan node's ScanTupleSlot.
+	 */
+	if (fsstate)
+		tupdesc = fsstate->ss.ss_ScanTupleSlot->tts_tupleDescriptor;
+	else
+		tupdesc = RelationGetDescr(rel);
+
+	values = (Datum *) palloc(tupdesc->natts * sizeof(Datum));
+	nulls = (bool *) palloc(tupdesc->natts * sizeof(bool));
+	dynamodb_decode_result_row(items, row_index, attr_map, converters,
+							   tupdesc->natts, values, nulls);
+
+	/*
+	 * Build the result tuple in caller's memory context.
+	 */
+	MemoryContextSwitchTo(oldcontext);
+
+	tuple = heap_form_tuple(tupdesc, values, nulls);
+
+	/* Clean up */
+	MemoryContextReset(temp_context);
+
+	return tuple;
+}
+
+/*
+ * dynamodb_create_foreign_modify
+ *
+ * Construct an execution state of a foreign insert/update/delete
+ * operation
+ */
+extern DynamoDBFdwModifyState *
+dynamodb_create_foreign_modify(EState *estate,
+					  RangeTblEntry *rte,
+					  ResultRelInfo *resultRelInfo,
+					  CmdType operation,
+					  Plan *subplan,
+					  char *query,
+					  List *target_attrs,
+					  bool has_returning,
+					  List *retrieved_attrs)
+{
+	DynamoDBFdwModifyState *fmstate;
+	Relation	rel = resultRelInfo->ri_RelationDesc;
+	Oid			userid;
+	ForeignTable *table;
+	UserMapping *user;
+	Oid			foreignTableId = RelationGetRelid(rel);
+	int			i;
+
+	/* Begin constructing DynamoDBFdwModifyState. */
+	fmstate = (DynamoDBFdwModifyState *) palloc0(sizeof(DynamoDBFdwModifyState));
+	fmstate->rel = rel;
+#if (PG_VERSION_NUM >= 160000)
+	/* Identify which user to do the remote access as. */
+	userid = ExecGetResultRelCheckAsUser(resultRelInfo, estate);
+#else
+	/*
+	 * Identify which user to do the remote access as.  This should match what
+	 * ExecCheckRTEPerms() does.
+	 */
+	userid = rte->checkAsUser ? rte->checkAsUser : GetUserId();
+#endif
+	/* Get info about foreign table. */
+	table = GetForeignTable(RelationGetRelid(rel));
+	user = GetUserMapping(userid, table->serverid);
+
+	/* Open connection; report that we'll create a prepared statement. */
+	fmstate->conn = dynamodb_get_connection(user);
+	fmstate->p_name = NULL;		/* prepared statement not made yet */
+
+	/* Set up remote query information. */
+	fmstate->query = query;
+	fmstate->target_attrs = target_attrs;
+	fmstate->has_returning = has_returning;
+	fmstate->retrieved_attrs = retrieved_attrs;
+	fmstate->batch_size = dynamodb_get_batch_size_option(foreignTableId);
+	fmstate->writer = NULL;
+	fmstate->defer_writes = false;
+	fmstate->attr_map = NULL;
+	fmstate->converters = NULL;
+	fmstate->release_cb.func = dynamodb_release_modify_state;
+	fmstate->release_cb.arg = (void *) fmstate;
+	MemoryContextRegisterResetCallback(estate->es_query_cxt,
+									   &fmstate->release_cb);
+	if (has_returning)
+	{
+		fmstate->attr_map = dynamodb_build_attr_map(retrieved_attrs);
+		fmstate->converters = dynamodb_build_converters(RelationGetDescr(rel),
+														retrieved_attrs);
+	}
+
+	/* Create context for per-tuple temp workspace. */
+	fmstate->temp_cxt = AllocSetContextCreate(estate->es_query_cxt,
+											  "dynamodb_fdw temporary data",
+											  ALLOCSET_SMALL_SIZES);
+
+	/* Initialize auxiliary state */
+	fmstate->aux_fmstate = NULL;
+
+	fmstate->junk_idx = (AttrNumber *) palloc0(RelationGetDescr(rel)->natts * sizeof(AttrNumber));
+	/* loop through table columns; there is no subplan for COPY and routing */
+	for (i = 0; subplan != NULL && i < RelationGetDescr(rel)->natts; ++i)
+	{
+		/*
+		 * for partition key and sort key columns, get the resjunk attribute number and store
+		 * it
+		 */
+		fmstate->junk_idx[i] =
+			ExecFindJunkAttributeInTlist(subplan->targetlist,
+										 get_attname(foreignTableId, i + 1, false));
+	}
+
+	return fmstate;
+}
+
+/*
+ * Force assorted GUC parameters to settings that ensure that we'll output
+ * data values in a form that is unambiguous to the remote server.
+ *
+ * This is rather expensive and annoying to do once per row, but there's
+ * little choice if we want to be sure values are transmitted accurately;
+ * we can't leave the settings in place between rows for fear of affecting
+ * user-visible computations.
+ *
+ * We use the equivalent of a function SET option to allow the settings to
+ * persist only until the caller calls reset_transmission_modes().  If an
+ * error is thrown in between, guc.c will take care of undoing the settings.
+ *
+ * The return value is the nestlevel that must be passed to
+ * reset_transmission_modes() to undo things.
+ */
+int
+dynamodb_set_transmission_modes(void)
+{
+	int			nestlevel = NewGUCNestLevel();
+
+	/*
+	 * The values set here should match what pg_dump does.  See also
+	 * configure_remote_session in connection.c.
+	 */
+	if (DateStyle != USE_ISO_DATES)
+		(void) set_config_option("datestyle", "ISO",
+								 PGC_USERSET, PGC_S_SESSION,
+								 GUC_ACTION_SAVE, true, 0, false);
+
+	if (IntervalStyle != INTSTYLE_POSTGRES)
+		(void) set_config_option("intervalstyle", "postgres",
+								 PGC_USERSET, PGC_S_SESSION,
+								 GUC_ACTION_SAVE, true, 0, false);
+	if (extra_float_digits < 3)
+		(void) set_config_option("extra_float_digits", "3",
+								 PGC_USERSET, PGC_S_SESSION,
+								 GUC_ACTION_SAVE, true, 0, false);
+
+	/*
+	 * In addition force restrictive search_path, in case there are any
+	 * regproc or similar constants to be printed.
+	 */
+	(void) set_config_option("search_path", "pg_catalog",
+							 PGC_USERSET, PGC_S_SESSION,
+							 GUC_ACTION_SAVE, true, 0, false);
+
+	return nestlevel;
 }
 
-extern "C" void
-dynamodbAddForeignUpdateTargets(
-#if (PG_VERSION_NUM >= 140000)
-								PlannerInfo *root,
-								Index rtindex,
+/*
+ * Undo the effects of set_transmission_modes().
+ */
+void
+dynamodb_reset_transmission_modes(int nestlevel)
+{
+	AtEOXact_GUC(true, nestlevel);
+}
+
+
+Aws::DynamoDB::Model::ExecuteStatementOutcome
+dynamodbOutcome(Aws::DynamoDB::DynamoDBClient *conn, 
+	const Aws::DynamoDB::Model::ExecuteStatementRequest &req)
+{
+	Aws::DynamoDB::Model::ExecuteStatementOutcome outcome;
+	outcome = conn->ExecuteStatement(req);
+	return outcome;
+}
+
+/*
+ * dynamodb_execute_foreign_modify
+ *
+ * Perform foreign-table modification as required, and fetch RETURNING
+ * result if any.  (This is the shared guts of dynamodbExecForeignInsert,
+ * dynamodbExecForeignUpdate, and dynamodbExecForeignDelete.)
+ */
+extern "C" TupleTableSlot *
+dynamodb_execute_foreign_modify(EState *estate,
+ 					   ResultRelInfo *resultRelInfo,
+ 					   CmdType operation,
+ 					   TupleTableSlot *slot,
+ 					   TupleTableSlot *planSlot)
+{
+ 	DynamoDBFdwModifyState *fmstate = (DynamoDBFdwModifyState *) resultRelInfo->ri_FdwState;
+	Datum		value = 0;
+	int			bindnum = 0;
+	Relation    rel = resultRelInfo->ri_RelationDesc;
+    Oid         foreignTableId = RelationGetRelid(rel);
+	Aws::DynamoDB::Model::ExecuteStatementRequest req;
+	Aws::Vector<Aws::DynamoDB::Model::AttributeValue> values;
+	Aws::DynamoDB::Model::AttributeValue bindval;
+	Aws::DynamoDB::Model::ExecuteStatementOutcome outcome;
+
+	Form_pg_attribute	att;
+	Oid					type;
+	Oid					userid;
+	dynamodb_opt	   *opt;
+	char			   *partition_key;
+	char			   *sort_key;
+
+#if PG_VERSION_NUM < 160000
+	RangeTblEntry  *rte;
+
+	rte = exec_rt_fetch(resultRelInfo->ri_RangeTableIndex, estate);
+	userid = rte->checkAsUser ? rte->checkAsUser : GetUserId();
 #else
-								Query *parsetree,
+	userid = ExecGetResultRelCheckAsUser(resultRelInfo, estate);
 #endif
-								RangeTblEntry *target_rte,
-								Relation target_relation)
+
+	opt = dynamodb_get_options(foreignTableId, userid);
+	partition_key = opt->svr_partition_key;
+	sort_key = opt -> svr_sort_key;
+
+	/* Binding values */
+	dynamodb_bind_target_attrs(fmstate, slot, values);
+	bindnum = values.size();
+
+	/* Bind where condition using junk column */
+ 	if (operation == CMD_UPDATE || operation == CMD_DELETE)
+ 	{
+		if (IS_KEY_EMPTY(partition_key))
+			elog(ERROR, "dynamodb_fdw: The partition_key option has not been set");
+		for (int i = 0; i < slot->tts_tupleDescriptor->natts ; i++)
+		{
+			att = TupleDescAttr(slot->tts_tupleDescriptor, i);
+			if (strcmp(opt->svr_partition_key, NameStr(att->attname)) == 0 ||
+				IS_KEY_COLUMN(NameStr(att->attname), sort_key))
+			{
+				bool 		isnull;
+
+				/* Get the id that was passed up as a resjunk column */
+				value = ExecGetJunkAttribute(planSlot, fmstate->junk_idx[i], &isnull);
+				type = att->atttypid;
+
+				bindval = dynamodb_bind_sql_var(type, bindnum, value, fmstate->query, isnull);
+				values.push_back(bindval);
+				bindnum++;
+			}
+		}
+	}
+
+	/* Execute the query */
+	req.SetStatement(fmstate->query);
+	req.SetParameters(values);
+	outcome = dynamodbOutcome(fmstate->conn, req);
+	if (!outcome.IsSuccess())
+		dynamodb_report_error(ERROR, outcome.GetError().GetMessage(), fmstate->query);
+
+	/* Check number of rows affected, and fetch RETURNING tuple if any */
+	if (fmstate->has_returning)
+		dynamodb_store_returning_result(fmstate, slot, outcome.GetResult());
+
+	MemoryContextReset(fmstate->temp_cxt);
+	return slot;
+}
+
+/*
+ * dynamodb_bind_target_attrs
+ *
+ * Bind the values of the target columns of an INSERT or UPDATE.
+ */
+static void
+dynamodb_bind_target_attrs(DynamoDBFdwModifyState *fmstate,
+						   TupleTableSlot *slot,
+						   Aws::Vector<Aws::DynamoDB::Model::AttributeValue> &values)
+{
+	ListCell   *lc;
+	int			bindnum = 0;
+
+	foreach(lc, fmstate->target_attrs)
+	{
+		int		attnum = lfirst_int(lc) - 1;
+		Oid		atttypid = TupleDescAttr(slot->tts_tupleDescriptor, attnum)->atttypid;
+		Datum	value;
+		bool	isnull;
+
+		value = slot_getattr(slot, attnum + 1, &isnull);
+		values.push_back(dynamodb_bind_sql_var(atttypid, bindnum, value, fmstate->query, isnull));
+		bindnum++;
+	}
+}
+
+/*
+ * dynamodb_batch_insert_row
+ *
+ * Hand a row over to the batch writer.  It is sent to DynamoDB along with
+ * other rows, in a BatchExecuteStatement request of INSERT statements, so
+ * that an item which already exists is still reported as an error as when
+ * the rows are inserted one at a time.
+ */
+static void
+dynamodb_batch_insert_row(DynamoDBFdwModifyState *fmstate, TupleTableSlot *slot)
+{
+	Aws::DynamoDB::Model::BatchStatementRequest statement;
+	Aws::Vector<Aws::DynamoDB::Model::AttributeValue> values;
+	Aws::String message;
+	DynamoDBWriteStatus status;
+
+	if (fmstate->writer == NULL)
+	{
+		char	   *failure = NULL;
+
+		fmstate->writer = new DynamoDBBatchWriter(fmstate->conn,
+												  DYNAMODB_WRITE_BATCHES_IN_FLIGHT);
+		try
+		{
+			fmstate->writer->start();
+		}
+		catch (const std::exception &e)
+		{
+			failure = pstrdup(e.what());
+		}
+
+		/* Do not throw a PostgreSQL error from inside the catch block */
+		if (failure != NULL)
+		{
+			delete fmstate->writer;
+			fmstate->writer = NULL;
+			ereport(ERROR,
+					(errcode(ERRCODE_FDW_ERROR),
+					 errmsg("dynamodb_fdw: could not start batch writer: %s", failure)));
+		}
+	}
+
+	dynamodb_bind_target_attrs(fmstate, slot, values);
+	statement.SetStatement(fmstate->query);
+	statement.SetParameters(values);
+
+	/* Do not let the queue of the writer grow without bound */
+	while ((status = fmstate->writer->wait_ready(message, DYNAMODB_WRITE_WAIT_MS)) == DYNAMODB_WRITE_PENDING)
+		CHECK_FOR_INTERRUPTS();
+	if (status == DYNAMODB_WRITE_ERROR)
+		dynamodb_report_error(ERROR, message, fmstate->query);
+
+	fmstate->writer->add(statement);
+}
+
+/*
+ * dynamodb_finish_batch_insert
+ *
+ * Send the rows still held by the batch writer, and wait until all the rows
+ * have been written.
+ */
+static void
+dynamodb_finish_batch_insert(DynamoDBFdwModifyState *fmstate)
+{
+	Aws::String message;
+	DynamoDBWriteStatus status;
+
+	if (fmstate->writer == NULL)
+		return;
+
+	fmstate->writer->flush();
+	while ((status = fmstate->writer->wait_done(message, DYNAMODB_WRITE_WAIT_MS)) == DYNAMODB_WRITE_PENDING)
+		CHECK_FOR_INTERRUPTS();
+	if (status == DYNAMODB_WRITE_ERROR)
+		dynamodb_report_error(ERROR, message, fmstate->query);
+}
+
+/*
+ * store_returning_result
+ *		Store the result of a RETURNING clause
+ *
+ * On error, be sure to release the PGresult on the way out.  Callers do not
+ * have PG_TRY blocks to ensure this happens.
+ */
+static void
+dynamodb_store_returning_result(DynamoDBFdwModifyState *fmstate,
+								TupleTableSlot *slot,
+								const Aws::DynamoDB::Model::ExecuteStatementResult &result)
+{
+	HeapTuple	newtup;
+	unsigned int index = 0;
+
+	newtup = make_tuple_from_result_row(result.GetItems(),
+										&index,
+										fmstate->rel,
+										fmstate->attr_map,
+										fmstate->converters,
+										NULL,
+										fmstate->temp_cxt);
+
+	/*
+	 * The returning slot will not necessarily be suitable to store
+	 * heaptuples directly, so allow for conversion.
+	 */
+	ExecForceStoreHeapTuple(newtup, slot, true);
+}
+
+/*
+ * dynamodbExecForeignInsert
+ *
+ * Insert one row into a foreign table
+ */
+extern "C" TupleTableSlot *
+dynamodbExecForeignInsert(EState *estate,
+						  ResultRelInfo *resultRelInfo,
+						  TupleTableSlot *slot,
+						  TupleTableSlot *planSlot)
+{
+	DynamoDBFdwModifyState *fmstate = (DynamoDBFdwModifyState *) resultRelInfo->ri_FdwState;
+	DynamoDBFdwModifyState *target = fmstate;
+	TupleTableSlot *rslot;
+
+	/*
+	 * If the fmstate has aux_fmstate set, use the aux_fmstate (see
+	 * dynamodbBeginForeignInsert())
+	 */
+	if (fmstate->aux_fmstate)
+	{
+		target = fmstate->aux_fmstate;
+		resultRelInfo->ri_FdwState = target;
+	}
+
+	/*
+	 * For COPY and tuple routing, rows are handed over to the batch writer,
+	 * and only waited for at the end of the insert.
+	 */
+	if (target->defer_writes)
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(target->temp_cxt);
+
+		dynamodb_batch_insert_row(target, slot);
+		MemoryContextSwitchTo(oldcontext);
+		MemoryContextReset(target->temp_cxt);
+		rslot = slot;
+	}
+	else
+		rslot = dynamodb_execute_foreign_modify(estate, resultRelInfo, CMD_INSERT, slot, planSlot);
+
+	/* Revert that change */
+	if (fmstate->aux_fmstate)
+		resultRelInfo->ri_FdwState = fmstate;
+
+	return rslot;
+}
+
+#if PG_VERSION_NUM >= 140000
+/*
+ * dynamodbExecForeignBatchInsert
+ *
+ * Insert multiple rows into a foreign table
+ */
+extern "C" TupleTableSlot **
+dynamodbExecForeignBatchInsert(EState *estate,
+							   ResultRelInfo *resultRelInfo,
+							   TupleTableSlot **slots,
+							   TupleTableSlot **planSlots,
+							   int *numSlots)
+{
+	DynamoDBFdwModifyState *fmstate = (DynamoDBFdwModifyState *) resultRelInfo->ri_FdwState;
+	MemoryContext oldcontext;
+
+	/*
+	 * If the fmstate has aux_fmstate set, use the aux_fmstate (see
+	 * dynamodbBeginForeignInsert())
+	 */
+	if (fmstate->aux_fmstate)
+		fmstate = fmstate->aux_fmstate;
+
+	/* The values bound are copied into the statements of the writer */
+	oldcontext = MemoryContextSwitchTo(fmstate->temp_cxt);
+	for (int i = 0; i < *numSlots; i++)
+		dynamodb_batch_insert_row(fmstate, slots[i]);
+
+	/* Rows are written before returning, unless the insert defers them */
+	if (!fmstate->defer_writes)
+		dynamodb_finish_batch_insert(fmstate);
+	MemoryContextSwitchTo(oldcontext);
+	MemoryContextReset(fmstate->temp_cxt);
+
+	return slots;
+}
+
+/*
+ * dynamodbGetForeignModifyBatchSize
+ *		Determine the maximum number of tuples that can be inserted in bulk
+ *
+ * Returns the batch size specified for server or table. When batching is not
+ * allowed (e.g. for tables with BEFORE/AFTER ROW triggers or with RETURNING
+ * clause), returns 1.
+ */
+extern "C" int
+dynamodbGetForeignModifyBatchSize(ResultRelInfo *resultRelInfo)
 {
-	Oid				relid = RelationGetRelid(target_relation);
-	dynamodb_opt   *opt;
-	char		   *partition_key;
-	char		   *sort_key;
-	TupleDesc		tupdesc = target_relation->rd_att;
-	Oid				userid;
+	int			batch_size;
+	DynamoDBFdwModifyState *fmstate = (DynamoDBFdwModifyState *) resultRelInfo->ri_FdwState;
 
-#if PG_VERSION_NUM < 160000
-	userid = target_rte->checkAsUser ? target_rte->checkAsUser : GetUserId();
-#else
-	if (target_rte->perminfoindex != 0)
-	{
-		RTEPermissionInfo *perminfo = getRTEPermissionInfo(root->parse->rteperminfos, target_rte);
+	/* should be called only once */
+	Assert(resultRelInfo->ri_BatchSize == 0);
 
-		userid = (perminfo != NULL && OidIsValid(perminfo->checkAsUser))? perminfo->checkAsUser : GetUserId();
-	}
+	/*
+	 * In EXPLAIN without ANALYZE, ri_FdwState is NULL, so we have to lookup
+	 * the option directly in server/table options. Otherwise just use the
+	 * value we determined earlier.
+	 */
+	if (fmstate)
+		batch_size = fmstate->batch_size;
 	else
-		userid = GetUserId();
-#endif
+		batch_size = dynamodb_get_batch_size_option(RelationGetRelid(resultRelInfo->ri_RelationDesc));
 
-	opt = dynamodb_get_options(relid, userid);
-	partition_key = opt->svr_partition_key;
-	sort_key = opt -> svr_sort_key;
+	/*
+	 * Disable batching when we have to use RETURNING, there are any
+	 * BEFORE/AFTER ROW INSERT triggers on the foreign table, or there are any
+	 * WITH CHECK OPTION constraints from parent views.
+	 */
+	if (resultRelInfo->ri_projectReturning != NULL ||
+		resultRelInfo->ri_WithCheckOptions != NIL ||
+		(resultRelInfo->ri_TrigDesc &&
+		 (resultRelInfo->ri_TrigDesc->trig_insert_before_row ||
+		  resultRelInfo->ri_TrigDesc->trig_insert_after_row)))
+		return 1;
+
+	return batch_size;
+}
+#endif
 
-	if (IS_KEY_EMPTY(partition_key))
-		elog(ERROR, "dynamodb_fdw: The partition_key option has not been set");
+extern "C" TupleTableSlot *
+dynamodbExecForeignUpdate(EState *estate,
+						  ResultRelInfo *resultRelInfo,
+						  TupleTableSlot *slot,
+						  TupleTableSlot *planSlot)
+{
+	return dynamodb_execute_foreign_modify(estate, resultRelInfo, CMD_UPDATE, slot, planSlot);
+}
 
-	for (int i = 0; i < tupdesc->natts; ++i)
-	{
-		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
-		Var		   *var;
-		char *attrname = NameStr(att->attname);
+/*
+ * dynamodbExecForeignDelete
+ *		Delete one row from a foreign table
+ */
+extern "C" TupleTableSlot *
+dynamodbExecForeignDelete(EState *estate,
+						  ResultRelInfo *resultRelInfo,
+						  TupleTableSlot *slot,
+						  TupleTableSlot *planSlot)
+{
+	return dynamodb_execute_foreign_modify(estate, resultRelInfo, CMD_DELETE,
+								  		   slot, planSlot);
+}
+/*
+ * dynamodbEndForeignModify
+ *		Finish an insert/update/delete operation on a foreign table
+ */
+extern "C" void
+dynamodbEndForeignModify(EState *estate,
+						 ResultRelInfo *resultRelInfo)
+{
+	DynamoDBFdwModifyState *fmstate = (DynamoDBFdwModifyState *) resultRelInfo->ri_FdwState;
 
-		if (strcmp(partition_key, attrname) == 0 ||
-			(!IS_KEY_EMPTY(sort_key) && strcmp(sort_key, attrname) == 0))
-		{
-#if PG_VERSION_NUM < 140000
-			Index	rtindex = parsetree->resultRelation;
-			TargetEntry *tle;
-#endif
-			/* Make a Var representing the desired value */
-			var = makeVar(rtindex,
-							att->attnum,
-							att->atttypid,
-							att->atttypmod,
-							att->attcollation,
-							0);
-#if PG_VERSION_NUM >= 140000
-			/* Register it as a row-identity column needed by this target rel */
-			add_row_identity_var(root, var, rtindex, pstrdup(NameStr(att->attname)));
-#else
-			tle = makeTargetEntry((Expr *) var,
-								list_length(parsetree->targetList) + 1,
-								pstrdup(NameStr(att->attname)), true);
+	/* If fmstate is NULL, we are in EXPLAIN; nothing to do */
+	if (fmstate == NULL)
+		return;
 
-			/* ... and add it to the query's targetlist */
-			parsetree->targetList = lappend(parsetree->targetList, tle);
-#endif
-		}
+	/* Destroy the execution state */
+	if (fmstate && fmstate->query)
+	{
+		fmstate->query = NULL;
 	}
+	dynamodb_release_modify_state(fmstate);
 }
 
 /*
- * dynamodbPlanForeignModify
- *		Plan an insert/update/delete operation on a foreign table
+ * dynamodbBeginForeignInsert
+ *		Begin an insert operation on a foreign table, for COPY FROM or for
+ *		rows routed to a foreign partition
  */
-extern "C" List *
-dynamodbPlanForeignModify(PlannerInfo *root, ModifyTable *plan, Index resultRelation, int subplan_index)
+extern "C" void
+dynamodbBeginForeignInsert(ModifyTableState *mtstate,
+						   ResultRelInfo *resultRelInfo)
 {
-	CmdType		operation = plan->operation;
-	RangeTblEntry *rte = planner_rt_fetch(resultRelation, root);
-	Relation	rel;
+	DynamoDBFdwModifyState *fmstate;
+	ModifyTable *plan = mtstate ? castNode(ModifyTable, mtstate->ps.plan) : NULL;
+	EState	   *estate = mtstate->ps.state;
+	Index		resultRelation;
+	Relation	rel = resultRelInfo->ri_RelationDesc;
+	RangeTblEntry *rte;
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	int			attnum;
 	StringInfoData sql;
 	List	   *targetAttrs = NIL;
-	List	   *withCheckOptionList = NIL; 
-	List	   *returningList = NIL; 
 	List	   *retrieved_attrs = NIL;
-	bool		trigger_update = false;
-	List	   *condAttr = NULL;
-	Oid			foreignTableId;
-	TupleDesc	tupdesc;
-	dynamodb_opt   *opt;
-	char		   *partition_key;
-	char		   *sort_key;
-	Oid				userid;
-
-	initStringInfo(&sql);
 
 	/*
-	 * Core code already has some lock on each rel being planned, so we can
-	 * use NoLock here.
+	 * If the foreign table we are about to insert routed rows into is also an
+	 * UPDATE subplan result rel that will be updated later, proceeding with
+	 * the INSERT will result in the later UPDATE incorrectly modifying those
+	 * routed rows, so prevent the INSERT --- it would be nice if we could
+	 * handle this case; but for now, throw an error for safety.
 	 */
-	rel = table_open(rte->relid, NoLock);
-	foreignTableId = RelationGetRelid(rel);
-	tupdesc = RelationGetDescr(rel);
+	if (plan && plan->operation == CMD_UPDATE &&
+		(resultRelInfo->ri_usesFdwDirectModify ||
+		 resultRelInfo->ri_FdwState))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("dynamodb_fdw: cannot route tuples into foreign table to be updated \"%s\"",
+						RelationGetRelationName(rel))));
+
+	/* The same restrictions as for a plain INSERT */
+	if (resultRelInfo->ri_WithCheckOptions != NIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FDW_UNABLE_TO_CREATE_EXECUTION),
+				 errmsg("dynamodb_fdw: unsupported feature WITH CHECK OPTION")));
+	if (resultRelInfo->ri_returningList != NIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FDW_UNABLE_TO_CREATE_EXECUTION),
+				 errmsg("dynamodb_fdw: unsupported RETURNING in INSERT operation")));
+	if (plan && plan->onConflictAction != ONCONFLICT_NONE)
+		ereport(ERROR,
+				(errcode(ERRCODE_FDW_UNABLE_TO_CREATE_EXECUTION),
+				 errmsg("dynamodb_fdw: unsupported feature ON CONFLICT")));
+
+	initStringInfo(&sql);
+
+	/* We transmit all columns that are defined in the foreign table. */
+	for (attnum = 1; attnum <= tupdesc->natts; attnum++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(tupdesc, attnum - 1);
+
+		if (!attr->attisdropped)
+			targetAttrs = lappend_int(targetAttrs, attnum);
+	}
 
 	/*
-	 * For foreign update and delete PostgreSQL require a unique column to do that
-	 * operations. The postgres_fdw uses ctid to uniquely identify row to perform
-	 * foreign delete/update. But in mysql_fdw we don't have hidden column like
-	 * that so we make a requirement for first column to be unique. We are using
-	 * first column to uniquely identify the rows for UPDATE/DELETE operation.
+	 * If the foreign table is a partition that doesn't have a corresponding
+	 * RTE entry, we need to create a new RTE describing the foreign table for
+	 * use by dynamodb_deparse_insert and dynamodb_create_foreign_modify()
+	 * below, after first copying the parent's RTE and modifying some fields
+	 * to describe the foreign partition to work on. However, if this is
+	 * invoked by UPDATE, the existing RTE may already correspond to this
+	 * partition if it is one of the UPDATE subplan target rels; in that case,
+	 * we can just use the existing RTE as-is.
 	 */
-#if PG_VERSION_NUM < 160000
-	userid = rte->checkAsUser ? rte->checkAsUser : GetUserId();
-#else
-	if (rte->perminfoindex != 0)
+#if PG_VERSION_NUM >= 140000
+	if (resultRelInfo->ri_RangeTableIndex == 0)
 	{
-		RTEPermissionInfo *perminfo = getRTEPermissionInfo(root->parse->rteperminfos, rte);
+		ResultRelInfo *rootResultRelInfo = resultRelInfo->ri_RootResultRelInfo;
 
-		userid = (perminfo != NULL && OidIsValid(perminfo->checkAsUser))? perminfo->checkAsUser : GetUserId();
+		rte = exec_rt_fetch(rootResultRelInfo->ri_RangeTableIndex, estate);
+		rte = (RangeTblEntry *) copyObject(rte);
+		rte->relid = RelationGetRelid(rel);
+		rte->relkind = RELKIND_FOREIGN_TABLE;
+
+		/*
+		 * For UPDATE, we must use the RT index of the first subplan target
+		 * rel's RTE, because the core code would have built expressions for
+		 * the partition, such as RETURNING, using that RT index as varno of
+		 * Vars contained in those expressions.
+		 */
+		if (plan && plan->operation == CMD_UPDATE &&
+			rootResultRelInfo->ri_RangeTableIndex == plan->rootRelation)
+			resultRelation = mtstate->resultRelInfo[0].ri_RangeTableIndex;
+		else
+			resultRelation = rootResultRelInfo->ri_RangeTableIndex;
 	}
 	else
-		userid = GetUserId();
+	{
+		resultRelation = resultRelInfo->ri_RangeTableIndex;
+		rte = exec_rt_fetch(resultRelation, estate);
+	}
+#else
+	resultRelation = resultRelInfo->ri_RangeTableIndex;
+	rte = exec_rt_fetch(resultRelation, estate);
+	if (rte->relid != RelationGetRelid(rel))
+	{
+		rte = (RangeTblEntry *) copyObject(rte);
+		rte->relid = RelationGetRelid(rel);
+		rte->relkind = RELKIND_FOREIGN_TABLE;
+
+		/* See above */
+		if (plan && plan->operation == CMD_UPDATE &&
+			resultRelation == plan->rootRelation)
+			resultRelation = mtstate->resultRelInfo[0].ri_RangeTableIndex;
+	}
 #endif
 
-	opt = dynamodb_get_options(foreignTableId, userid);
-	partition_key = opt->svr_partition_key;
-	sort_key = opt -> svr_sort_key;
+	/* Construct the SQL command string. */
+	dynamodb_deparse_insert(&sql, rte, resultRelation, rel, targetAttrs,
+							&retrieved_attrs);
+
+	/* Construct an execution state. */
+	fmstate = dynamodb_create_foreign_modify(mtstate->ps.state,
+											 rte,
+											 resultRelInfo,
+											 CMD_INSERT,
+											 NULL,
+											 sql.data,
+											 targetAttrs,
+											 false,
+											 NIL);
 
 	/*
-	 * In an INSERT, we transmit all columns that are defined in the foreign
-	 * table.  In an UPDATE, if there are BEFORE ROW UPDATE triggers on the
-	 * foreign table, we transmit all columns like INSERT; else we transmit
-	 * only columns that were explicitly targets of the UPDATE, so as to avoid
-	 * unnecessary data transmission.  (We can't do that for INSERT since we
-	 * would miss sending default values for columns not listed in the source
-	 * statement, and for UPDATE if there are BEFORE ROW UPDATE triggers since
-	 * those triggers might change values for non-target columns, in which
-	 * case we would miss sending changed values for those columns.)
+	 * Rows are handed over to the batch writer and only waited for at the
+	 * end of the insert, unless row triggers might look for them on the
+	 * remote side in the meantime.
 	 */
-	if (operation == CMD_UPDATE &&
-		 rel->trigdesc &&
-		 rel->trigdesc->trig_update_before_row)
-		 trigger_update = true;
+	fmstate->defer_writes = !(resultRelInfo->ri_TrigDesc &&
+							  (resultRelInfo->ri_TrigDesc->trig_insert_before_row ||
+							   resultRelInfo->ri_TrigDesc->trig_insert_after_row));
 
-	if (operation == CMD_INSERT || trigger_update)
+	/*
+	 * If the given resultRelInfo already has DynamoDBFdwModifyState set, it
+	 * means the foreign table is an UPDATE subplan result rel; in which case,
+	 * store the resulting state into the aux_fmstate of the
+	 * DynamoDBFdwModifyState.
+	 */
+	if (resultRelInfo->ri_FdwState)
 	{
-		int			attnum;
-
-		for (attnum = 1; attnum <= tupdesc->natts; attnum++)
-		{
-			Form_pg_attribute attr = TupleDescAttr(tupdesc, attnum - 1);
-			char *attrname = NameStr(attr->attname);
+		Assert(plan && plan->operation == CMD_UPDATE);
+		Assert(resultRelInfo->ri_usesFdwDirectModify == false);
+		((DynamoDBFdwModifyState *) resultRelInfo->ri_FdwState)->aux_fmstate = fmstate;
+	}
+	else
+		resultRelInfo->ri_FdwState = fmstate;
+}
 
-			/*
-			 * DynamoDB does not allow to update key columns. Therefore, skip key column when
-			 * updating.
-			 */
-			if (trigger_update &&
-				((!IS_KEY_EMPTY(partition_key) && strcmp(partition_key, attrname) == 0) ||
-				 (!IS_KEY_EMPTY(sort_key) && strcmp(sort_key, attrname) == 0)))
-				continue;
+/*
+ * dynamodbEndForeignInsert
+ *		Finish an insert operation on a foreign table
+ */
+extern "C" void
+dynamodbEndForeignInsert(EState *estate,
+						 ResultRelInfo *resultRelInfo)
+{
+	DynamoDBFdwModifyState *fmstate = (DynamoDBFdwModifyState *) resultRelInfo->ri_FdwState;
 
-			if (!attr->attisdropped)
-				targetAttrs = lappend_int(targetAttrs, attnum);
-		}
-	}
-	else if (operation == CMD_UPDATE)
-	{
-		int			col = -1;
-#if (PG_VERSION_NUM >= 130010 && PG_VERSION_NUM < 140000) || (PG_VERSION_NUM >= 140007 && PG_VERSION_NUM < 150000) || (PG_VERSION_NUM >= 150003)
-		RelOptInfo *rel = find_base_rel(root, resultRelation);
-		Bitmapset  *allUpdatedCols = get_rel_all_updated_cols(root, rel);
-#else
-		Bitmapset  *allUpdatedCols = bms_union(rte->updatedCols, rte->extraUpdatedCols);
-#endif
-		ListCell   *lc;
+	Assert(fmstate != NULL);
 
-		/*
-		 * DynamoDB only support updating column
-		 */
-		foreach(lc, root->parse->targetList)
-		{
-			TargetEntry *tle = (TargetEntry *) lfirst(lc);
-			Node		*node = (Node *) tle->expr;
+	/*
+	 * If the fmstate has aux_fmstate set, get the aux_fmstate (see
+	 * dynamodbBeginForeignInsert())
+	 */
+	if (fmstate->aux_fmstate)
+		fmstate = fmstate->aux_fmstate;
 
-			if (nodeTag(node) == T_SubscriptingRef)
-				elog(ERROR, "dynamodb_fdw: unsupported updating target");
-		}
+	/* Wait for the rows still being written */
+	dynamodb_finish_batch_insert(fmstate);
 
-		while ((col = bms_next_member(allUpdatedCols, col)) >= 0)
-		{
-			/* bit numbers are offset by FirstLowInvalidHeapAttributeNumber */
-			AttrNumber	attno = col + FirstLowInvalidHeapAttributeNumber;
+	/* Destroy the execution state */
+	dynamodb_release_modify_state(fmstate);
+}
 
-			if (attno <= InvalidAttrNumber) /* shouldn't happen */
-				elog(ERROR, "dynamodb_fdw: system-column update is not supported");
-			targetAttrs = lappend_int(targetAttrs, attno);
-		}
-	}
+/*
+ * dynamodbAnalyzeForeignTable
+ *		Test whether analyzing this foreign table is supported
+ */
+extern "C" bool
+dynamodbAnalyzeForeignTable(Relation relation,
+							AcquireSampleRowsFunc *func,
+							BlockNumber *totalpages)
+{
+	ForeignTable *table;
+	UserMapping *user;
+	DynamoDBTableStats *stats;
+	dynamodb_opt *opt;
+
+	/* Return the row-analysis function pointer */
+	*func = dynamodbAcquireSampleRowsFunc;
 
 	/*
-	 * Raise error if there is WITH CHECK OPTION
+	 * Now we have to get the number of pages.  It's annoying that the ANALYZE
+	 * API requires us to return that now, because it forces some duplication
+	 * of effort between this routine and dynamodbAcquireSampleRowsFunc.  But
+	 * it's probably not worth redefining that API at this point.
 	 */
-	if (plan->withCheckOptionLists)
-	{
-		ereport(ERROR,
-				(errcode(ERRCODE_FDW_UNABLE_TO_CREATE_EXECUTION),
-				 errmsg("dynamodb_fdw: unsupported feature WITH CHECK OPTION")));
-	}
-		
+
 	/*
-	 *  Raise error if there is RETURNING
+	 * Get the connection to use.  We do the remote access as the table's
+	 * owner, even if the ANALYZE was started by some other user.
 	 */
-	if (plan->returningLists && operation == CMD_INSERT)
-	{
-		ereport(ERROR,
-				(errcode(ERRCODE_FDW_UNABLE_TO_CREATE_EXECUTION),
-				 errmsg("dynamodb_fdw: unsupported RETURNING in INSERT operation")));
-	}
+	table = GetForeignTable(RelationGetRelid(relation));
+	user = GetUserMapping(relation->rd_rel->relowner, table->serverid);
+	opt = dynamodb_get_options(RelationGetRelid(relation), relation->rd_rel->relowner);
+
+	/* DynamoDB has no pages: derive them from the size of the table */
+	stats = dynamodb_get_remote_stats(RelationGetRelid(relation), user,
+									  opt->remote_estimate_ttl);
+	*totalpages = (BlockNumber) Max(ceil(stats->size_bytes / BLCKSZ), 1);
+
+	return true;
+}
+
+/*
+ * Acquire a random sample of rows from foreign table managed by dynamodb_fdw.
+ *
+ * DynamoDB spreads the items of a table over the segments of a parallel
+ * Scan by the hash of their partition key, so each segment already holds a
+ * random subset of the items.  Knowing the item count from DescribeTable,
+ * we split the table into segments of about targrows /
+ * DYNAMODB_ANALYZE_SEGMENTS_IN_FLIGHT items each, and read segments, from a
+ * random one on, until about targrows items have been read.  These segments
+ * are read concurrently, DYNAMODB_ANALYZE_SEGMENTS_IN_FLIGHT at a time, and
+ * only the columns which need statistics are projected.  The rows which are
+ * read are then sampled with Vitter's algorithm, as for a local table.
+ *
+ * The item count may be unknown or stale, so the table is always split into
+ * at least DYNAMODB_ANALYZE_MIN_SEGMENTS segments, and no more segments are
+ * read once enough items have been.
+ *
+ * We report estimates of the total number of items in the table as
+ * *totalrows; DynamoDB has no dead rows, so *totaldeadrows is zero.
+ */
+static int
+dynamodbAcquireSampleRowsFunc(Relation relation, int elevel,
+							  HeapTuple *rows, int targrows,
+							  double *totalrows,
+							  double *totaldeadrows)
+{
+	DynamoDBAnalyzeState *astate;
+	ForeignTable *table;
+	UserMapping *user;
+	dynamodb_opt *opt;
+	Aws::DynamoDB::DynamoDBClient *conn;
+	DynamoDBTableStats *stats;
+	char	   *table_name;
+	List	   *retrieved_attrs;
+	double		items_per_segment;
+	int			total_segments;
+	int			first_segment;
+	int			opened = 0;
+	int			consumed = 0;
+	int			prefetch_depth;
+	size_t		prefetch_memory_limit;
+	int			i;
+
+	/* Initialize workspace state */
+	astate = (DynamoDBAnalyzeState *) palloc0(sizeof(DynamoDBAnalyzeState));
+	astate->rel = relation;
+	astate->rows = rows;
+	astate->targrows = targrows;
+	astate->numrows = 0;
+	astate->samplerows = 0;
+	astate->rowstoskip = -1;	/* -1 means not set yet */
+	reservoir_init_selection_state(&astate->rstate, targrows);
+
+	/* Remember ANALYZE context, and create a per-tuple temp context */
+	astate->anl_cxt = CurrentMemoryContext;
+	astate->temp_cxt = AllocSetContextCreate(CurrentMemoryContext,
+											 "dynamodb_fdw temporary data",
+											 ALLOCSET_SMALL_SIZES);
 
 	/*
-	 * Extract the relevant RETURNING list if any.
+	 * The segments and their workers must be released even if ANALYZE
+	 * fails, so tie them to the lifetime of the ANALYZE context.
 	 */
-	if (plan->returningLists)
-		returningList = (List *) list_nth(plan->returningLists, subplan_index);
+	astate->release_cb.func = dynamodb_release_analyze_state;
+	astate->release_cb.arg = (void *) astate;
+	MemoryContextRegisterResetCallback(astate->anl_cxt, &astate->release_cb);
 
 	/*
-	 * Raise error if there ON CONFLICT
+	 * Get the connection to use.  We do the remote access as the table's
+	 * owner, even if the ANALYZE was started by some other user.
 	 */
-	if (plan->onConflictAction != ONCONFLICT_NONE)
-	{
-		ereport(ERROR,
-				(errcode(ERRCODE_FDW_UNABLE_TO_CREATE_EXECUTION),
-				 errmsg("dynamodb_fdw: unsupported feature ON CONFLICT")));
-	}
+	table = GetForeignTable(RelationGetRelid(relation));
+	user = GetUserMapping(relation->rd_rel->relowner, table->serverid);
+	opt = dynamodb_get_options(RelationGetRelid(relation), relation->rd_rel->relowner);
+	conn = dynamodb_get_connection(user);
+	table_name = dynamodb_get_table_name(RelationGetRelid(relation));
+
+	retrieved_attrs = dynamodb_get_analyzed_attrs(relation);
+	astate->attr_map = dynamodb_build_attr_map(retrieved_attrs);
+	astate->converters = dynamodb_build_converters(RelationGetDescr(relation),
+												   retrieved_attrs);
 
 	/*
-	 * Construct the SQL command string.
+	 * Choose the segments.  Each segment is a hash partition of the table, so
+	 * with as many segments as there are items, the sample is still made of
+	 * a random subset of the segments.
 	 */
-	switch (operation)
+	stats = dynamodb_get_remote_stats(RelationGetRelid(relation), user,
+									  opt->remote_estimate_ttl);
+	total_segments = DYNAMODB_ANALYZE_MIN_SEGMENTS;
+	if (stats->item_count > targrows)
+		total_segments = Max(total_segments,
+							 (int) Min(ceil(stats->item_count * DYNAMODB_ANALYZE_SEGMENTS_IN_FLIGHT / targrows),
+									   DYNAMODB_MAX_TOTAL_SEGMENTS));
+	items_per_segment = stats->item_count / total_segments;
+	first_segment = (int) (total_segments * dynamodb_analyze_random_fract(astate));
+	if (first_segment >= total_segments)
+		first_segment = total_segments - 1;
+
+	/* Each segment has its own worker, which stays at most one page ahead */
+	prefetch_depth = Max(opt->prefetch_depth, 1);
+	prefetch_memory_limit = (size_t) opt->prefetch_memory_limit * 1024 /
+		DYNAMODB_ANALYZE_SEGMENTS_IN_FLIGHT;
+
 	{
-		case CMD_INSERT:
-			dynamodb_deparse_insert(&sql, rte, resultRelation, rel, targetAttrs,
-									&retrieved_attrs);
-			break;
-		case CMD_UPDATE:
+		Aws::Vector<Aws::String> attr_names = dynamodb_get_retrieved_attr_names(retrieved_attrs);
+
+		for (i = 0; i < DYNAMODB_ANALYZE_SEGMENTS_IN_FLIGHT && opened < total_segments; i++)
 		{
-			condAttr = dynamodb_get_key_names(tupdesc, foreignTableId, partition_key, sort_key);
-			dynamodb_deparse_update(&sql, rte, resultRelation, rel, targetAttrs,
-									withCheckOptionList, returningList, &retrieved_attrs, condAttr);
-			break;
+			dynamodb_open_analyze_segment(astate, conn, table_name, attr_names, i,
+										  (first_segment + opened) % total_segments,
+										  total_segments, prefetch_depth,
+										  prefetch_memory_limit);
+			opened++;
 		}
-		case CMD_DELETE:
+
+		/* Read the segments in order, while the next ones are being fetched */
+		while (consumed < opened)
 		{
-			condAttr = dynamodb_get_key_names(tupdesc, foreignTableId, partition_key, sort_key);
-			dynamodb_deparse_delete(&sql, rte, resultRelation, rel, returningList,
-									&retrieved_attrs, condAttr);
-			break;
+			int			slot = consumed % DYNAMODB_ANALYZE_SEGMENTS_IN_FLIGHT;
+			DynamoDBPrefetcher *prefetcher = astate->prefetchers[slot];
+
+			for (;;)
+			{
+				std::shared_ptr<const DynamoDBItems> page;
+				Aws::String message;
+				DynamoDBPrefetchStatus status;
+				unsigned int row_index = 0;
+
+				/* Wait in short slices so that ANALYZE can still be cancelled */
+				while ((status = prefetcher->wait_page(page, message,
+													   DYNAMODB_PREFETCH_WAIT_MS)) == DYNAMODB_PREFETCH_PENDING)
+					CHECK_FOR_INTERRUPTS();
+
+				if (status == DYNAMODB_PREFETCH_ERROR)
+					ereport(ERROR,
+							(errcode(ERRCODE_FDW_ERROR),
+							 errmsg("dynamodb_fdw: could not scan table \"%s\": %s",
+									table_name, message.c_str())));
+				if (status == DYNAMODB_PREFETCH_DONE)
+					break;
+
+				while (row_index < page->size())
+				{
+					analyze_row_processor(*page, &row_index, astate);
+					vacuum_delay_point();
+				}
+			}
+
+			dynamodb_close_analyze_segment(astate, slot);
+			consumed++;
+
+			/* Read another segment unless those in flight complete the sample */
+			if (opened < total_segments &&
+				astate->samplerows + (opened - consumed) * items_per_segment < targrows)
+			{
+				dynamodb_open_analyze_segment(astate, conn, table_name, attr_names, slot,
+											  (first_segment + opened) % total_segments,
+											  total_segments, prefetch_depth,
+											  prefetch_memory_limit);
+				opened++;
+			}
 		}
-		default:
-			ereport(ERROR,
-				(errcode(ERRCODE_FDW_UNABLE_TO_CREATE_EXECUTION),
-				 errmsg("dynamodb_fdw: unexpected operation")));
-			break;
 	}
 
-	table_close(rel, NoLock);
+	dynamodb_release_analyze_state(astate);
+	MemoryContextDelete(astate->temp_cxt);
+
+	/* We assume that we have no dead tuple. */
+	*totaldeadrows = 0.0;
+
+	/* Extrapolate the items read to the segments which were not read */
+	*totalrows = astate->samplerows * total_segments / consumed;
 
 	/*
-	 * Build the fdw_private list that will be available to the executor.
-	 * Items in the list must match enum FdwModifyPrivateIndex, above.
+	 * Emit some interesting relation info
 	 */
-	return list_make4(makeString(sql.data),
-					  targetAttrs,
-#if PG_VERSION_NUM >= 150000
-					  makeBoolean((retrieved_attrs != NIL)),
+	ereport(elevel,
+			(errmsg("\"%s\": table contains about %.0f items, %.0f items read from %d of %d segments, %d rows in sample",
+					RelationGetRelationName(relation),
+					*totalrows, astate->samplerows, consumed, total_segments,
+					astate->numrows)));
+
+	return astate->numrows;
+}
+
+/*
+ * dynamodb_get_analyzed_attrs
+ *		Get the attributes to read for ANALYZE, as a list of attribute name
+ *		and column number pairs.
+ *
+ * The columns whose statistics target is zero are not analyzed, so they
+ * are left out, unless no column would be read at all.
+ */
+static List *
+dynamodb_get_analyzed_attrs(Relation relation)
+{
+	TupleDesc	tupdesc = RelationGetDescr(relation);
+	List	   *retrieved_attrs = NIL;
+	bool		analyzed_only = false;
+	int			i;
+
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
+
+		if (!attr->attisdropped && dynamodb_column_is_analyzed(relation, attr))
+		{
+			analyzed_only = true;
+			break;
+		}
+	}
+
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
+
+		if (attr->attisdropped)
+			continue;
+		if (analyzed_only && !dynamodb_column_is_analyzed(relation, attr))
+			continue;
+
+		retrieved_attrs = lappend(retrieved_attrs,
+								  makeString(dynamodb_get_column_name(RelationGetRelid(relation),
+																	  attr->attnum)));
+		retrieved_attrs = lappend(retrieved_attrs, makeInteger(attr->attnum));
+	}
+
+	return retrieved_attrs;
+}
+
+/*
+ * dynamodb_column_is_analyzed
+ *		Does ANALYZE compute statistics for this column?
+ */
+static bool
+dynamodb_column_is_analyzed(Relation relation, Form_pg_attribute attr)
+{
+#if PG_VERSION_NUM >= 170000
+	HeapTuple	atttuple;
+	Datum		dat;
+	bool		isnull;
+	int			attstattarget;
+
+	atttuple = SearchSysCache2(ATTNUM,
+							   ObjectIdGetDatum(RelationGetRelid(relation)),
+							   Int16GetDatum(attr->attnum));
+	if (!HeapTupleIsValid(atttuple))
+		elog(ERROR, "cache lookup failed for attribute %d of relation %u",
+			 attr->attnum, RelationGetRelid(relation));
+	dat = SysCacheGetAttr(ATTNUM, atttuple, Anum_pg_attribute_attstattarget, &isnull);
+	attstattarget = isnull ? -1 : DatumGetInt16(dat);
+	ReleaseSysCache(atttuple);
+
+	return attstattarget != 0;
 #else
-					  makeInteger((retrieved_attrs != NIL)),
+	return attr->attstattarget != 0;
 #endif
-					  retrieved_attrs);	
 }
 
 /*
- * dynamodbExplainForeignScan
- *		Produce extra output for EXPLAIN of a ForeignScan on a foreign table
+ * dynamodb_open_analyze_segment
+ *		Start reading a segment of the table into the given slot.
  */
-extern "C" void
-dynamodbExplainForeignScan(ForeignScanState *node, ExplainState *es)
+static void
+dynamodb_open_analyze_segment(DynamoDBAnalyzeState *astate,
+							  Aws::DynamoDB::DynamoDBClient *conn,
+							  const char *table_name,
+							  const Aws::Vector<Aws::String> &attr_names,
+							  int slot, int segment, int total_segments,
+							  int prefetch_depth, size_t prefetch_memory_limit)
 {
-	ForeignScan *plan = castNode(ForeignScan, node->ss.ps.plan);
-	List	   *fdw_private = plan->fdw_private;
+	char	   *failure = NULL;
 
-	/*
-	 * Add remote query, when VERBOSE option is specified.
-	 */
-	if (es->verbose)
+	Assert(astate->sources[slot] == NULL && astate->prefetchers[slot] == NULL);
+
+	astate->sources[slot] = new DynamoDBSegmentSource(conn, table_name, attr_names,
+													  segment, total_segments);
+	astate->prefetchers[slot] = new DynamoDBPrefetcher(astate->sources[slot],
+													   prefetch_depth,
+													   prefetch_memory_limit);
+	try
 	{
-		char	   *sql;
+		astate->prefetchers[slot]->start();
+	}
+	catch (const std::exception &e)
+	{
+		failure = pstrdup(e.what());
+	}
 
-		sql = strVal(list_nth(fdw_private, FdwScanPrivateSelectSql));
-		ExplainPropertyText("Remote SQL", sql, es);
+	/* Do not throw a PostgreSQL error from inside the catch block */
+	if (failure != NULL)
+	{
+		dynamodb_close_analyze_segment(astate, slot);
+		ereport(ERROR,
+				(errcode(ERRCODE_FDW_ERROR),
+				 errmsg("dynamodb_fdw: could not start prefetch worker: %s", failure)));
 	}
 }
 
 /*
- * dynamodbExplainForeignModify
- *		Produce extra output for EXPLAIN of a ModifyTable on a foreign table
+ * dynamodb_close_analyze_segment
+ *		Stop the worker of a slot and release its segment.
  */
-extern "C" void
-dynamodbExplainForeignModify(ModifyTableState *mtstate,
-							 ResultRelInfo *rinfo,
-							 List *fdw_private,
-							 int subplan_index,
-							 ExplainState *es)
+static void
+dynamodb_close_analyze_segment(DynamoDBAnalyzeState *astate, int slot)
 {
-	if (es->verbose)
+	/* The worker uses the source, so stop it first */
+	if (astate->prefetchers[slot] != NULL)
 	{
-		char	   *sql = strVal(list_nth(fdw_private, 0));
+		delete astate->prefetchers[slot];
+		astate->prefetchers[slot] = NULL;
+	}
 
-		ExplainPropertyText("Remote SQL", sql, es);
+	if (astate->sources[slot] != NULL)
+	{
+		delete astate->sources[slot];
+		astate->sources[slot] = NULL;
 	}
 }
 
 /*
- * dynamodbBeginForeignModify
+ * dynamodb_release_analyze_state
+ *		Free the C++ objects of ANALYZE.
  *
- * Begin an insert/update/delete operation on a foreign table
+ * This is also the reset callback of the ANALYZE context, so that nothing
+ * survives an aborted ANALYZE.
  */
-extern "C" void
-dynamodbBeginForeignModify(ModifyTableState *mtstate,
-						   ResultRelInfo *resultRelInfo,
-						   List *fdw_private,
-						   int subplan_index,
-						   int eflags)
+static void
+dynamodb_release_analyze_state(void *arg)
 {
-	DynamoDBFdwModifyState *fmstate;
-	char	   *query;
-	List	   *target_attrs;
-	bool		has_returning;
-	List	   *retrieved_attrs;
-	RangeTblEntry *rte;
+	DynamoDBAnalyzeState *astate = (DynamoDBAnalyzeState *) arg;
+	int			i;
+
+	for (i = 0; i < DYNAMODB_ANALYZE_SEGMENTS_IN_FLIGHT; i++)
+		dynamodb_close_analyze_segment(astate, i);
+
+	if (astate->attr_map != NULL)
+	{
+		delete astate->attr_map;
+		astate->attr_map = NULL;
+	}
+}
+
+/*
+ * Collect sample rows from the items of a page, one item per call.
+ *		 - Use all tuples in sample until target # of samples are collected.
+ *		 - Subsequently, replace already-sampled tuples randomly.
+ */
+static void
+analyze_row_processor(const DynamoDBItems &items,
+					  unsigned int *row_index,
+					  DynamoDBAnalyzeState *astate)
+{
+	int			targrows = astate->targrows;
+	int			pos;			/* array index to store tuple in */
+
+	/* First, count the row */
+	astate->samplerows += 1;
 
 	/*
-	 * Do nothing in EXPLAIN (no ANALYZE) case.  resultRelInfo->ri_FdwState
-	 * stays NULL.
+	 * Determine the slot where this sample row should be stored.  Set pos to
+	 * negative value to indicate the row should be skipped.
 	 */
-	if (eflags & EXEC_FLAG_EXPLAIN_ONLY)
-		return;
+	if (astate->numrows < targrows)
+	{
+		/* First targrows rows are always included into the sample */
+		pos = astate->numrows++;
+	}
+	else
+	{
+		/*
+		 * Now we start replacing tuples in the sample until we reach the end
+		 * of the relation.  Same algorithm as in acquire_sample_rows in
+		 * analyze.c; see Jeff Vitter's paper.
+		 */
+		if (astate->rowstoskip < 0)
+			astate->rowstoskip = reservoir_get_next_S(&astate->rstate, astate->samplerows, targrows);
 
-	/* Deconstruct fdw_private data. */
-	query = strVal(list_nth(fdw_private, FdwModifyPrivateUpdateSql));
-	target_attrs = (List *) list_nth(fdw_private, FdwModifyPrivateTargetAttnums);
-#if PG_VERSION_NUM >= 150000
-	has_returning = boolVal(list_nth(fdw_private, FdwModifyPrivateHasReturning));
-#else
-	has_returning = intVal(list_nth(fdw_private, FdwModifyPrivateHasReturning));
-#endif
-	retrieved_attrs = (List *) list_nth(fdw_private, FdwModifyPrivateRetrievedAttrs);
+		if (astate->rowstoskip <= 0)
+		{
+			/* Choose a random reservoir element to replace. */
+			pos = (int) (targrows * dynamodb_analyze_random_fract(astate));
+			Assert(pos >= 0 && pos < targrows);
+			heap_freetuple(astate->rows[pos]);
+		}
+		else
+		{
+			/* Skip this tuple. */
+			pos = -1;
+		}
 
-	/* Find RTE. */
-	rte = exec_rt_fetch(resultRelInfo->ri_RangeTableIndex,
-						mtstate->ps.state);
+		astate->rowstoskip -= 1;
+	}
 
-	/* Construct an execution state. */
-	fmstate = dynamodb_create_foreign_modify(mtstate->ps.state,
-									rte,
-									resultRelInfo,
-									mtstate->operation,
-#if (PG_VERSION_NUM >= 140000)
-									outerPlanState(mtstate)->plan,
-#else
-									mtstate->mt_plans[subplan_index]->plan,
-#endif
-									query,
-									target_attrs,
-									has_returning,
-									retrieved_attrs);
+	if (pos >= 0)
+	{
+		MemoryContext oldcontext;
 
-	resultRelInfo->ri_FdwState = fmstate;
+		/*
+		 * Create sample tuple from current result row, and store it in the
+		 * position determined above.  The tuple has to be created in anl_cxt.
+		 */
+		oldcontext = MemoryContextSwitchTo(astate->anl_cxt);
+
+		astate->rows[pos] = make_tuple_from_result_row(items, row_index,
+													   astate->rel,
+													   astate->attr_map,
+													   astate->converters,
+													   NULL,
+													   astate->temp_cxt);
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+	else
+		(*row_index)++;
 }
 
 /*
- * Create cursor for node's query with current parameter values.
+ * dynamodb_analyze_random_fract
+ *		Get a random number in [0, 1) from the sampling state of ANALYZE.
  */
-static void
-create_cursor(ForeignScanState *node)
+static double
+dynamodb_analyze_random_fract(DynamoDBAnalyzeState *astate)
 {
-	DynamoDBFdwScanState *fsstate = (DynamoDBFdwScanState *) node->fdw_state;
-
-	/* Mark the cursor as created, and show no tuples have been retrieved */
-	fsstate->cursor_exists = true;
-	fsstate->tuples = NULL;
-	fsstate->eof_reached = false;
-	fsstate->first_fetch = true;
-	fsstate->next_token = NULL;
-	fsstate->next_fetch_ready = true;
-	fsstate->row_index = 0;
-	fsstate->num_rows = 0;
+#if PG_VERSION_NUM >= 150000
+	return sampler_random_fract(&astate->rstate.randstate);
+#else
+	return sampler_random_fract(astate->rstate.randstate);
+#endif
 }
 
+#if PG_VERSION_NUM >= 140000
 /*
- * Fetch some more rows from the node's cursor.
+ * find_modifytable_subplan
+ *		Helper routine for dynamodbPlanDirectModify to find the
+ *		ModifyTable subplan node that scans the specified RTI.
+ *
+ * Returns NULL if the subplan couldn't be identified.  That's not a fatal
+ * error condition, we just abandon trying to do the update directly.
  */
-extern void
-fetch_more_data(ForeignScanState *node)
+static ForeignScan *
+find_modifytable_subplan(PlannerInfo *root,
+						 ModifyTable *plan,
+						 Index rtindex,
+						 int subplan_index)
 {
-	DynamoDBFdwScanState *fsstate = (DynamoDBFdwScanState *) node->fdw_state;
-	MemoryContext oldcontext;
+	Plan	   *subplan = outerPlan(plan);
 
 	/*
-	 * We'll store the tuples in the batch_cxt.  First, flush the previous
-	 * batch.
+	 * The cases we support are (1) the desired ForeignScan is the immediate
+	 * child of ModifyTable, or (2) it is the subplan_index'th child of an
+	 * Append node that is the immediate child of ModifyTable.  There is no
+	 * point in looking further down, as that would mean that local joins are
+	 * involved, so we can't do the update directly.
+	 *
+	 * There could be a Result atop the Append too, acting to compute the
+	 * UPDATE targetlist values.  We ignore that here; the tlist will be
+	 * checked by our caller.
 	 */
-	MemoryContextReset(fsstate->batch_cxt);
-	oldcontext = MemoryContextSwitchTo(fsstate->batch_cxt);
+	if (IsA(subplan, Append))
+	{
+		Append	   *appendplan = (Append *) subplan;
 
-	PG_TRY();
+		if (subplan_index < list_length(appendplan->appendplans))
+			subplan = (Plan *) list_nth(appendplan->appendplans, subplan_index);
+	}
+	else if (IsA(subplan, Result) &&
+			 outerPlan(subplan) != NULL &&
+			 IsA(outerPlan(subplan), Append))
 	{
-		DynamoDBClient  *conn = fsstate->conn;
-		bool	has_more_rows = true;
+		Append	   *appendplan = (Append *) outerPlan(subplan);
 
-		/*
-		 * Only send request in 2 cases:
-		 * 1. The first time fetching data: next_fetch_ready and first_fetch are true
-		 * 2. Not the first time fetching data and there is more data to fetch in DynamoDB:
-		 * next_fetch_ready is true, first_fetch is false and next_token is not empty
-		 *
-		 * If not the first time and next_token is empty, it means there is no more data
-		 * in DynamoDB to fetch, the FDW stop fetching.
-		 */
-		if (fsstate->next_fetch_ready)
-		{
-			if (fsstate->first_fetch)
-				fsstate->first_fetch = false;
-			else if (!fsstate->next_token)
-				has_more_rows = false;
+		if (subplan_index < list_length(appendplan->appendplans))
+			subplan = (Plan *) list_nth(appendplan->appendplans, subplan_index);
+	}
 
-			if (has_more_rows)
-			{
-				Model::ExecuteStatementRequest req;
-				Aws::DynamoDB::Model::ExecuteStatementOutcome outcome;
-				std::shared_ptr<Aws::DynamoDB::Model::ExecuteStatementResult> result;
+	/* Now, have we got a ForeignScan on the desired rel? */
+	if (IsA(subplan, ForeignScan))
+	{
+		ForeignScan *fscan = (ForeignScan *) subplan;
 
-				req.SetStatement(fsstate->query);
+#if PG_VERSION_NUM >= 160000
+		if (bms_is_member(rtindex, fscan->fs_base_relids))
+#else
+		if (bms_is_member(rtindex, fscan->fs_relids))
+#endif
+			return fscan;
+	}
 
-				/*
-				 * Set next token to fetch the remaining data in DynamoDB.
-				 * Only set next token if it is not empty.
-				 */
-				if (fsstate->next_token != NULL)
-					req.SetNextToken(fsstate->next_token);
+	return NULL;
+}
+#endif
 
-				outcome = conn->ExecuteStatement(req);
-				if (!outcome.IsSuccess())
-					dynamodb_report_error(ERROR, outcome.GetError().GetMessage(), fsstate->query);
+/*
+ * dynamodb_conds_pin_item
+ *		Check whether the given conditions compare each key column of the
+ *		table to a constant, exactly once.
+ *
+ * DynamoDB only runs a PartiQL UPDATE or DELETE whose WHERE clause picks a
+ * single item that way; any other condition just has to hold for the item.
+ */
+static bool
+dynamodb_conds_pin_item(Oid foreigntableid, Index relid, List *conds,
+						const char *partition_key, const char *sort_key)
+{
+	int			npartition = 0;
+	int			nsort = 0;
+	ListCell   *lc;
 
-				result = Aws::MakeShared<Aws::DynamoDB::Model::ExecuteStatementResult>(DYNAMODB_ALLOCATION_TAG, outcome.GetResult());
+	if (IS_KEY_EMPTY(partition_key))
+		return false;
 
-				if (result->GetItems().size() == 0)
-					has_more_rows = false;
+	foreach(lc, conds)
+	{
+		Expr	   *expr = (Expr *) lfirst(lc);
+		OpExpr	   *op;
+		Node	   *left;
+		Node	   *right;
+		Var		   *var;
+		Const	   *c;
+		char	   *colname;
 
-				/* Save next_token value for next fetch or reset if next_token is empty */
-				if (result->GetNextToken().empty())
-					fsstate->next_token = NULL;
-				else
-					fsstate->next_token = (char *) result->GetNextToken().c_str();
+		if (!IsA(expr, OpExpr))
+			continue;
 
-				fsstate->next_fetch_ready = false;
-				fsstate->row_index = 0;
-				fsstate->num_rows = result->GetItems().size();
-				fsstate->result = std::move(result);
-			}
-		}
+		op = (OpExpr *) expr;
+		if (list_length(op->args) != 2 ||
+			strcmp(get_opname(op->opno), "=") != 0)
+			continue;
 
-		/*
-		 * Get one row per iterate.
-		 */
-		if (has_more_rows)
+		left = (Node *) linitial(op->args);
+		right = (Node *) lsecond(op->args);
+		if (IsA(left, Var) && IsA(right, Const))
 		{
-			Assert(IsA(node->ss.ps.plan, ForeignScan));
-
-			fsstate->tuples = make_tuple_from_result_row (fsstate->result, &fsstate->row_index,
-														fsstate->rel, fsstate->retrieved_attrs,
-														node, fsstate->temp_cxt);
+			var = (Var *) left;
+			c = (Const *) right;
 		}
-
-		/* Ready for next fetch if all rows has been processed */
-		if (fsstate->row_index == fsstate->num_rows)
+		else if (IsA(left, Const) && IsA(right, Var))
 		{
-			fsstate->next_fetch_ready = true;
-
-			/* Must be EOF when there is no more data to fetch */
-			if (fsstate->next_token == NULL)
-				fsstate->eof_reached = true;
+			var = (Var *) right;
+			c = (Const *) left;
 		}
+		else
+			continue;
+
+		if (var->varno != relid || var->varlevelsup != 0 ||
+			var->varattno <= InvalidAttrNumber || c->constisnull)
+			continue;
+
+		colname = get_attname(foreigntableid, var->varattno, false);
+		if (IS_KEY_COLUMN(colname, partition_key))
+			npartition++;
+		else if (IS_KEY_COLUMN(colname, sort_key))
+			nsort++;
 	}
-	PG_CATCH();
-	{
-		MemoryContextSwitchTo(oldcontext);
-		PG_RE_THROW();
-	}
-	PG_END_TRY();
 
-	MemoryContextSwitchTo(oldcontext);
+	if (npartition != 1)
+		return false;
 
+	return IS_KEY_EMPTY(sort_key) ? nsort == 0 : nsort == 1;
 }
 
-static HeapTuple
-make_tuple_from_result_row(std::shared_ptr<Aws::DynamoDB::Model::ExecuteStatementResult> result,
-							unsigned int *row_index,
-							Relation rel,
-							List *retrieved_attrs,
-							ForeignScanState *fsstate,
-							MemoryContext temp_context)
+/*
+ * dynamodbPlanDirectModify
+ *		Consider a direct foreign table modification
+ *
+ * Decide whether it is safe to modify a foreign table directly, and if so,
+ * rewrite subplan accordingly.
+ *
+ * DynamoDB runs a PartiQL UPDATE or DELETE on a single item, so the scan
+ * must check all its conditions remotely and pin down the whole primary key
+ * with equality conditions.  The new values of an UPDATE are sent as
+ * parameters, hence they must not depend on the row being updated.
+ */
+extern "C" bool
+dynamodbPlanDirectModify(PlannerInfo *root,
+						 ModifyTable *plan,
+						 Index resultRelation,
+						 int subplan_index)
 {
-	HeapTuple	tuple;
-	TupleDesc	tupdesc;
-	Datum	   *values;
-	bool	   *nulls;
-	MemoryContext oldcontext;
-	ListCell   *lc;
-	const Aws::Vector<Aws::Map<Aws::String, Aws::DynamoDB::Model::AttributeValue>>& items = result->GetItems();
-
-	Assert(*row_index < items.size());
+	CmdType		operation = plan->operation;
+	RelOptInfo *foreignrel;
+	RangeTblEntry *rte;
+	DynamoDBFdwRelationInfo *fpinfo;
+	Relation	rel;
+	StringInfoData sql;
+	ForeignScan *fscan;
+	List	   *processed_tlist = NIL;
+	List	   *targetAttrs = NIL;
+	List	   *remote_exprs;
+	List	   *params_list = NIL;
+	char	   *partition_key;
+	char	   *sort_key;
+	ListCell   *lc,
+			   *lc2;
 
 	/*
-	 * Do the following work in a temp context that we reset after each tuple.
-	 * This cleans up not only the data we have direct access to, but any
-	 * cruft the I/O functions might leak.
+	 * Decide whether it is safe to modify a foreign table directly.
 	 */
-	oldcontext = MemoryContextSwitchTo(temp_context);
 
 	/*
-	 * Get the tuple descriptor for the row.  Use the rel's tupdesc if rel is
-	 * provided, otherwise look to the scan node's ScanTupleSlot.
+	 * The table modification must be an UPDATE or DELETE.
 	 */
-	if (fsstate)
-		tupdesc = fsstate->ss.ss_ScanTupleSlot->tts_tupleDescriptor;
-	else
-		tupdesc = RelationGetDescr(rel);
-
-	values = (Datum *) palloc0(tupdesc->natts * sizeof(Datum));
-	nulls = (bool *) palloc(tupdesc->natts * sizeof(bool));
-	/* Initialize to nulls for any columns not present in result */
-	memset(nulls, true, tupdesc->natts * sizeof(bool));
+	if (operation != CMD_UPDATE && operation != CMD_DELETE)
+		return false;
 
-	/* Get the row based on row index */
-	auto row = items.at(*row_index);
-
-	lc = list_head(retrieved_attrs);
+	/*
+	 * RETURNING is left to the regular path, which builds the returned rows.
+	 */
+	if (plan->returningLists)
+		return false;
 
-	while (lc != NULL)
+	/*
+	 * Try to locate the ForeignScan subplan that's scanning resultRelation.
+	 */
+#if PG_VERSION_NUM >= 140000
+	fscan = find_modifytable_subplan(root, plan, resultRelation, subplan_index);
+	if (!fscan)
+		return false;
+#else
 	{
-		Oid			pgtype;
-		int32		pgtypmod;
-		const char *attname;
-		int			attnum;
+		Plan	   *subplan = (Plan *) list_nth(plan->plans, subplan_index);
 
-		/*
-		 * Attribute information are retrieved by a pair: first is attribute name,
-		 * next is attribute number.
-		 */
-		attname = strVal(lfirst(lc));
-		lc = lnext(retrieved_attrs, lc);
-		attnum = intVal(lfirst(lc)) - 1;
+		if (!IsA(subplan, ForeignScan))
+			return false;
+		fscan = (ForeignScan *) subplan;
+	}
+#endif
 
-		/*
-		 * Skip columns which are not returned from DynamoDB.
-		 * Those columns are null by default.
-		 */
-		for (const auto& column : row)
-		{
-			if (strcmp(attname, column.first.c_str()) != 0)
-				continue;
+	/*
+	 * It's unsafe to modify a foreign table directly if there are any quals
+	 * that should be evaluated locally.
+	 */
+	if (fscan->scan.plan.qual != NIL)
+		return false;
 
-			pgtype = TupleDescAttr(tupdesc, attnum)->atttypid;
-			pgtypmod = TupleDescAttr(tupdesc, attnum)->atttypmod;
+	/* dynamodb_fdw does not push down joins */
+	if (fscan->scan.scanrelid == 0)
+		return false;
 
-			if (column.second.GetType() != Aws::DynamoDB::Model::ValueType::NULLVALUE)
-			{
-				nulls[attnum] = false;
-				values[attnum] = dynamodb_convert_to_pg(pgtype,
-														pgtypmod,
-														column.second);
-			}
-		}
-		lc = lnext(retrieved_attrs, lc);
-	}
+	/* Safe to fetch data about the target foreign rel */
+	foreignrel = root->simple_rel_array[resultRelation];
+	rte = root->simple_rte_array[resultRelation];
+	fpinfo = (DynamoDBFdwRelationInfo *) foreignrel->fdw_private;
+	partition_key = fpinfo->options->svr_partition_key;
+	sort_key = fpinfo->options->svr_sort_key;
 
-	/* Increase row index to prepare for next fetch */
-	(*row_index)++;
+	/*
+	 * The conditions must pick a single item.
+	 */
+	remote_exprs = fpinfo->final_remote_exprs;
+	if (!dynamodb_conds_pin_item(rte->relid, resultRelation, remote_exprs,
+								 partition_key, sort_key))
+		return false;
 
 	/*
-	 * Build the result tuple in caller's memory context.
+	 * The scan checks its conditions again locally when a parameter is NULL,
+	 * which a direct modification can't do.
 	 */
-	MemoryContextSwitchTo(oldcontext);
+	if (dynamodb_contain_param_expr((Node *) remote_exprs))
+		return false;
 
-	tuple = heap_form_tuple(tupdesc, values, nulls);
+	/*
+	 * For UPDATE, it's unsafe to perform the update directly if any
+	 * expressions to assign to the target columns depend on the row, or if a
+	 * key column is assigned, which DynamoDB does not allow.
+	 */
+	if (operation == CMD_UPDATE)
+	{
+#if PG_VERSION_NUM >= 140000
+		/*
+		 * The expressions of concern are the first N columns of the processed
+		 * targetlist, where N is the length of the rel's update_colnos.
+		 */
+		get_translated_update_targetlist(root, resultRelation,
+										 &processed_tlist, &targetAttrs);
+#else
+		Plan	   *subplan = (Plan *) fscan;
+		int			col = -1;
 
-	/* Clean up */
-	MemoryContextReset(temp_context);
+		/* We transmit only columns that were explicitly targets of the UPDATE */
+		while ((col = bms_next_member(rte->updatedCols, col)) >= 0)
+		{
+			/* bit numbers are offset by FirstLowInvalidHeapAttributeNumber */
+			AttrNumber	attno = col + FirstLowInvalidHeapAttributeNumber;
+			TargetEntry *tle;
 
-	return tuple;
-}
+			if (attno <= InvalidAttrNumber) /* shouldn't happen */
+				elog(ERROR, "dynamodb_fdw: system-column update is not supported");
 
-/*
- * dynamodb_create_foreign_modify
- *
- * Construct an execution state of a foreign insert/update/delete
- * operation
- */
-extern DynamoDBFdwModifyState *
-dynamodb_create_foreign_modify(EState *estate,
-					  RangeTblEntry *rte,
-					  ResultRelInfo *resultRelInfo,
-					  CmdType operation,
-					  Plan *subplan,
-					  char *query,
-					  List *target_attrs,
-					  bool has_returning,
-					  List *retrieved_attrs)
-{
-	DynamoDBFdwModifyState *fmstate;
-	Relation	rel = resultRelInfo->ri_RelationDesc;
-	Oid			userid;
-	ForeignTable *table;
-	UserMapping *user;
-	Oid			foreignTableId = RelationGetRelid(rel);
-	int			i;
+			tle = get_tle_by_resno(subplan->targetlist, attno);
+			if (!tle)
+				elog(ERROR, "dynamodb_fdw: attribute number %d not found in subplan targetlist",
+					 attno);
 
-	/* Begin constructing DynamoDBFdwModifyState. */
-	fmstate = (DynamoDBFdwModifyState *) palloc0(sizeof(DynamoDBFdwModifyState));
-	fmstate->rel = rel;
-#if (PG_VERSION_NUM >= 160000)
-	/* Identify which user to do the remote access as. */
-	userid = ExecGetResultRelCheckAsUser(resultRelInfo, estate);
-#else
-	/*
-	 * Identify which user to do the remote access as.  This should match what
-	 * ExecCheckRTEPerms() does.
-	 */
-	userid = rte->checkAsUser ? rte->checkAsUser : GetUserId();
+			processed_tlist = lappend(processed_tlist, tle);
+			targetAttrs = lappend_int(targetAttrs, attno);
+		}
 #endif
-	/* Get info about foreign table. */
-	table = GetForeignTable(RelationGetRelid(rel));
-	user = GetUserMapping(userid, table->serverid);
-
-	/* Open connection; report that we'll create a prepared statement. */
-	fmstate->conn = dynamodb_get_connection(user);
-	fmstate->p_name = NULL;		/* prepared statement not made yet */
+		forboth(lc, processed_tlist, lc2, targetAttrs)
+		{
+			TargetEntry *tle = lfirst_node(TargetEntry, lc);
+			AttrNumber	attno = lfirst_int(lc2);
+			char	   *colname;
 
-	/* Set up remote query information. */
-	fmstate->query = query;
-	fmstate->target_attrs = target_attrs;
-	fmstate->has_returning = has_returning;
-	fmstate->retrieved_attrs = retrieved_attrs;
+			/* update's new-value expressions shouldn't be resjunk */
+			Assert(!tle->resjunk);
 
-	/* Create context for per-tuple temp workspace. */
-	fmstate->temp_cxt = AllocSetContextCreate(estate->es_query_cxt,
-											  "dynamodb_fdw temporary data",
-											  ALLOCSET_SMALL_SIZES);
+			if (attno <= InvalidAttrNumber) /* shouldn't happen */
+				elog(ERROR, "dynamodb_fdw: system-column update is not supported");
 
-	/* Initialize auxiliary state */
-	fmstate->aux_fmstate = NULL;
+			colname = get_attname(rte->relid, attno, false);
+			if (IS_KEY_COLUMN(colname, partition_key) ||
+				IS_KEY_COLUMN(colname, sort_key))
+				return false;
 
-	fmstate->junk_idx = (AttrNumber *) palloc0(RelationGetDescr(rel)->natts * sizeof(AttrNumber));
-	/* loop through table columns */
-	for (i = 0; i < RelationGetDescr(rel)->natts; ++i)
-	{
-		/*
-		 * for partition key and sort key columns, get the resjunk attribute number and store
-		 * it
-		 */
-		fmstate->junk_idx[i] =
-			ExecFindJunkAttributeInTlist(subplan->targetlist,
-										 get_attname(foreignTableId, i + 1, false));
+			if (IsA(tle->expr, SubscriptingRef) ||
+				contain_var_clause((Node *) tle->expr) ||
+				contain_subplans((Node *) tle->expr) ||
+				contain_volatile_functions((Node *) tle->expr))
+				return false;
+		}
 	}
 
-	return fmstate;
-}
-
-/*
- * Force assorted GUC parameters to settings that ensure that we'll output
- * data values in a form that is unambiguous to the remote server.
- *
- * This is rather expensive and annoying to do once per row, but there's
- * little choice if we want to be sure values are transmitted accurately;
- * we can't leave the settings in place between rows for fear of affecting
- * user-visible computations.
- *
- * We use the equivalent of a function SET option to allow the settings to
- * persist only until the caller calls reset_transmission_modes().  If an
- * error is thrown in between, guc.c will take care of undoing the settings.
- *
- * The return value is the nestlevel that must be passed to
- * reset_transmission_modes() to undo things.
- */
-int
-dynamodb_set_transmission_modes(void)
-{
-	int			nestlevel = NewGUCNestLevel();
+	/*
+	 * Ok, rewrite subplan so as to modify the foreign table directly.
+	 */
+	initStringInfo(&sql);
 
 	/*
-	 * The values set here should match what pg_dump does.  See also
-	 * configure_remote_session in connection.c.
+	 * Core code already has some lock on each rel being planned, so we can
+	 * use NoLock here.
 	 */
-	if (DateStyle != USE_ISO_DATES)
-		(void) set_config_option("datestyle", "ISO",
-								 PGC_USERSET, PGC_S_SESSION,
-								 GUC_ACTION_SAVE, true, 0, false);
+	rel = table_open(rte->relid, NoLock);
 
-	if (IntervalStyle != INTSTYLE_POSTGRES)
-		(void) set_config_option("intervalstyle", "postgres",
-								 PGC_USERSET, PGC_S_SESSION,
-								 GUC_ACTION_SAVE, true, 0, false);
-	if (extra_float_digits < 3)
-		(void) set_config_option("extra_float_digits", "3",
-								 PGC_USERSET, PGC_S_SESSION,
-								 GUC_ACTION_SAVE, true, 0, false);
+	/*
+	 * Construct the SQL command string.
+	 */
+	switch (operation)
+	{
+		case CMD_UPDATE:
+			dynamodb_deparse_direct_update_sql(&sql, root, resultRelation, rel,
+											   foreignrel,
+											   processed_tlist,
+											   targetAttrs,
+											   remote_exprs, &params_list);
+			break;
+		case CMD_DELETE:
+			dynamodb_deparse_direct_delete_sql(&sql, root, resultRelation, rel,
+											   foreignrel,
+											   remote_exprs);
+			break;
+		default:
+			elog(ERROR, "dynamodb_fdw: unexpected operation: %d", (int) operation);
+			break;
+	}
 
 	/*
-	 * In addition force restrictive search_path, in case there are any
-	 * regproc or similar constants to be printed.
+	 * Update the operation and target relation info.
 	 */
-	(void) set_config_option("search_path", "pg_catalog",
-							 PGC_USERSET, PGC_S_SESSION,
-							 GUC_ACTION_SAVE, true, 0, false);
+	fscan->operation = operation;
+#if PG_VERSION_NUM >= 140000
+	fscan->resultRelation = resultRelation;
+#endif
 
-	return nestlevel;
-}
+	/*
+	 * Update the fdw_exprs list that will be available to the executor.
+	 */
+	fscan->fdw_exprs = params_list;
 
-/*
- * Undo the effects of set_transmission_modes().
- */
-void
-dynamodb_reset_transmission_modes(int nestlevel)
-{
-	AtEOXact_GUC(true, nestlevel);
-}
+	/*
+	 * Update the fdw_private list that will be available to the executor.
+	 * Items in the list must match enum FdwDirectModifyPrivateIndex, above.
+	 */
+	fscan->fdw_private = list_make2(makeString(sql.data),
+#if PG_VERSION_NUM >= 150000
+									makeBoolean(plan->canSetTag));
+#else
+									makeInteger(plan->canSetTag));
+#endif
 
+#if PG_VERSION_NUM >= 140000
+	/*
+	 * Finally, unset the async-capable flag if it is set, as we currently
+	 * don't support asynchronous execution of direct modifications.
+	 */
+	if (fscan->scan.plan.async_capable)
+		fscan->scan.plan.async_capable = false;
+#endif
 
-Aws::DynamoDB::Model::ExecuteStatementOutcome
-dynamodbOutcome(Aws::DynamoDB::DynamoDBClient *conn, 
-	Aws::DynamoDB::Model::ExecuteStatementRequest req)
-{
-	Aws::DynamoDB::Model::ExecuteStatementOutcome outcome;
-	outcome = conn->ExecuteStatement(req);
-	return outcome;
+	table_close(rel, NoLock);
+	return true;
 }
 
 /*
- * dynamodb_execute_foreign_modify
- *
- * Perform foreign-table modification as required, and fetch RETURNING
- * result if any.  (This is the shared guts of dynamodbExecForeignInsert,
- * dynamodbExecForeignUpdate, and dynamodbExecForeignDelete.)
+ * dynamodbBeginDirectModify
+ *		Prepare a direct foreign table modification
  */
-extern "C" TupleTableSlot *
-dynamodb_execute_foreign_modify(EState *estate,
- 					   ResultRelInfo *resultRelInfo,
- 					   CmdType operation,
- 					   TupleTableSlot *slot,
- 					   TupleTableSlot *planSlot)
+extern "C" void
+dynamodbBeginDirectModify(ForeignScanState *node, int eflags)
 {
- 	DynamoDBFdwModifyState *fmstate = (DynamoDBFdwModifyState *) resultRelInfo->ri_FdwState;
+	ForeignScan *fsplan = (ForeignScan *) node->ss.ps.plan;
+	EState	   *estate = node->ss.ps.state;
+	DynamoDBFdwDirectModifyState *dmstate;
+	Index		rtindex;
+	Oid			userid;
+	ForeignTable *table;
+	UserMapping *user;
 	ListCell   *lc;
-	Datum		value = 0;
-	int			bindnum = 0;
-	Relation    rel = resultRelInfo->ri_RelationDesc;
-    Oid         foreignTableId = RelationGetRelid(rel);
-	Aws::DynamoDB::Model::ExecuteStatementRequest req;
-	Aws::Vector<Aws::DynamoDB::Model::AttributeValue> values;
-	Aws::DynamoDB::Model::AttributeValue bindval;
-	Aws::DynamoDB::Model::ExecuteStatementOutcome outcome;
 
-	Form_pg_attribute	att;
-	Oid					type;
-	Oid					userid;
-	dynamodb_opt	   *opt;
-	char			   *partition_key;
-	char			   *sort_key;
+	/*
+	 * Do nothing in EXPLAIN (no ANALYZE) case.  node->fdw_state stays NULL.
+	 */
+	if (eflags & EXEC_FLAG_EXPLAIN_ONLY)
+		return;
 
-#if PG_VERSION_NUM < 160000
-	RangeTblEntry  *rte;
+	/*
+	 * We'll save private state in node->fdw_state.
+	 */
+	dmstate = (DynamoDBFdwDirectModifyState *) palloc0(sizeof(DynamoDBFdwDirectModifyState));
+	node->fdw_state = (void *) dmstate;
 
-	rte = exec_rt_fetch(resultRelInfo->ri_RangeTableIndex, estate);
-	userid = rte->checkAsUser ? rte->checkAsUser : GetUserId();
+#if PG_VERSION_NUM >= 140000
+	rtindex = node->resultRelInfo->ri_RangeTableIndex;
 #else
-	userid = ExecGetResultRelCheckAsUser(resultRelInfo, estate);
+	rtindex = estate->es_result_relation_info->ri_RangeTableIndex;
 #endif
-
-	opt = dynamodb_get_options(foreignTableId, userid);
-	partition_key = opt->svr_partition_key;
-	sort_key = opt -> svr_sort_key;
-
-	/* Binding values */
-	foreach(lc, fmstate->target_attrs)
+#if (PG_VERSION_NUM >= 160000)
+	/*
+	 * Identify which user to do the remote access as.  This should match what
+	 * ExecCheckPermissions() does.
+	 */
+	userid = OidIsValid(fsplan->checkAsUser) ? fsplan->checkAsUser : GetUserId();
+#else
 	{
-		int		attnum = lfirst_int(lc) - 1;
-		Oid		atttypid = TupleDescAttr(slot->tts_tupleDescriptor, attnum)->atttypid;
-		bool	isnull;
-
-		value = slot_getattr(slot, attnum + 1, &isnull);
-		bindval = dynamodb_bind_sql_var(atttypid, bindnum, value, fmstate->query, isnull);
-		values.push_back(bindval);
-		bindnum++;
-	}
-
-	/* Bind where condition using junk column */
- 	if (operation == CMD_UPDATE || operation == CMD_DELETE)
- 	{
-		if (IS_KEY_EMPTY(partition_key))
-			elog(ERROR, "dynamodb_fdw: The partition_key option has not been set");
-		for (int i = 0; i < slot->tts_tupleDescriptor->natts ; i++)
-		{
-			att = TupleDescAttr(slot->tts_tupleDescriptor, i);
-			if (strcmp(opt->svr_partition_key, NameStr(att->attname)) == 0 ||
-				IS_KEY_COLUMN(NameStr(att->attname), sort_key))
-			{
-				bool 		isnull;
-
-				/* Get the id that was passed up as a resjunk column */
-				value = ExecGetJunkAttribute(planSlot, fmstate->junk_idx[i], &isnull);
-				type = att->atttypid;
+		/*
+		 * Identify which user to do the remote access as.  This should match
+		 * what ExecCheckRTEPerms() does.
+		 */
+		RangeTblEntry *rte = exec_rt_fetch(rtindex, estate);
 
-				bindval = dynamodb_bind_sql_var(type, bindnum, value, fmstate->query, isnull);
-				values.push_back(bindval);
-				bindnum++;
-			}
-		}
+		userid = rte->checkAsUser ? rte->checkAsUser : GetUserId();
 	}
+#endif
 
-	/* Execute the query */
-	req.SetStatement(fmstate->query);
-	req.SetParameters(values);
-	outcome = dynamodbOutcome(fmstate->conn, req);
-	if (!outcome.IsSuccess())
-		dynamodb_report_error(ERROR, outcome.GetError().GetMessage(), fmstate->query);
-
-	/* Check number of rows affected, and fetch RETURNING tuple if any */
-	if (fmstate->has_returning)
-	{
-		std::shared_ptr<Aws::DynamoDB::Model::ExecuteStatementResult> result(new Aws::DynamoDB::Model::ExecuteStatementResult());
-
-		*result = outcome.GetResult();
-		dynamodb_store_returning_result(fmstate, slot, result);
-	}
+	/* Get info about foreign table. */
+	dmstate->rel = node->ss.ss_currentRelation;
+	table = GetForeignTable(RelationGetRelid(dmstate->rel));
+	user = GetUserMapping(userid, table->serverid);
 
-	MemoryContextReset(fmstate->temp_cxt);
-	return slot;
-}
+	/*
+	 * Get connection to the foreign server.  Connection manager will
+	 * establish new connection if necessary.
+	 */
+	dmstate->conn = dynamodb_get_connection(user);
 
-/*
- * store_returning_result
- *		Store the result of a RETURNING clause
- *
- * On error, be sure to release the PGresult on the way out.  Callers do not
- * have PG_TRY blocks to ensure this happens.
- */
-static void
-dynamodb_store_returning_result(DynamoDBFdwModifyState *fmstate,
-								TupleTableSlot *slot,
-								std::shared_ptr<Aws::DynamoDB::Model::ExecuteStatementResult> result)
-{
-	HeapTuple	newtup;
-	unsigned int index = 0;
+	/* Get private info created by planner functions. */
+	dmstate->query = strVal(list_nth(fsplan->fdw_private,
+									 FdwDirectModifyPrivateUpdateSql));
+#if PG_VERSION_NUM >= 150000
+	dmstate->set_processed = boolVal(list_nth(fsplan->fdw_private,
+											  FdwDirectModifyPrivateSetProcessed));
+#else
+	dmstate->set_processed = intVal(list_nth(fsplan->fdw_private,
+											 FdwDirectModifyPrivateSetProcessed));
+#endif
 
-	newtup = make_tuple_from_result_row(result, &index,
-										fmstate->rel,
-										fmstate->retrieved_attrs,
-										NULL,
-										fmstate->temp_cxt);
+	/* Create context for per-tuple temp workspace. */
+	dmstate->temp_cxt = AllocSetContextCreate(estate->es_query_cxt,
+											  "dynamodb_fdw temporary data",
+											  ALLOCSET_SMALL_SIZES);
 
 	/*
-	 * The returning slot will not necessarily be suitable to store
-	 * heaptuples directly, so allow for conversion.
+	 * Prepare for processing of parameters used in remote query, if any.
 	 */
-	ExecForceStoreHeapTuple(newtup, slot, true);
+	dmstate->param_exprs = ExecInitExprList(fsplan->fdw_exprs, (PlanState *) node);
+	dmstate->param_types = NIL;
+	foreach(lc, fsplan->fdw_exprs)
+		dmstate->param_types = lappend_oid(dmstate->param_types,
+										   exprType((Node *) lfirst(lc)));
+
+	dmstate->num_tuples = -1;	/* -1 means not set yet */
 }
 
 /*
- * dynamodbExecForeignInsert
- *
- * Insert one row into a foreign table
+ * dynamodbIterateDirectModify
+ *		Execute a direct foreign table modification
  */
 extern "C" TupleTableSlot *
-dynamodbExecForeignInsert(EState *estate,
-						  ResultRelInfo *resultRelInfo,
-						  TupleTableSlot *slot,
-						  TupleTableSlot *planSlot)
+dynamodbIterateDirectModify(ForeignScanState *node)
 {
-	DynamoDBFdwModifyState *fmstate = (DynamoDBFdwModifyState *) resultRelInfo->ri_FdwState;
-	TupleTableSlot *rslot;
+	DynamoDBFdwDirectModifyState *dmstate = (DynamoDBFdwDirectModifyState *) node->fdw_state;
+	EState	   *estate = node->ss.ps.state;
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+	Instrumentation *instr = node->ss.ps.instrument;
 
 	/*
-	 * If the fmstate has aux_fmstate set, use the aux_fmstate (see
-	 * dynamodbBeginForeignInsert())
+	 * If this is the first call after Begin, execute the statement.
 	 */
-	if (fmstate->aux_fmstate)
-		resultRelInfo->ri_FdwState = fmstate->aux_fmstate;
-	rslot = dynamodb_execute_foreign_modify(estate, resultRelInfo, CMD_INSERT, slot, planSlot);
-	/* Revert that change */
-	if (fmstate->aux_fmstate)
-		resultRelInfo->ri_FdwState = fmstate;
+	if (dmstate->num_tuples == -1)
+		dynamodb_execute_dml_stmt(node);
 
-	return rslot;
-}
+	/* Increment the command es_processed count if necessary. */
+	if (dmstate->set_processed)
+		estate->es_processed += dmstate->num_tuples;
 
-extern "C" TupleTableSlot *
-dynamodbExecForeignUpdate(EState *estate,
-						  ResultRelInfo *resultRelInfo,
-						  TupleTableSlot *slot,
-						  TupleTableSlot *planSlot)
-{
-	return dynamodb_execute_foreign_modify(estate, resultRelInfo, CMD_UPDATE, slot, planSlot);
+	/* Increment the tuple count for EXPLAIN ANALYZE if necessary. */
+	if (instr)
+		instr->tuplecount += dmstate->num_tuples;
+
+	return ExecClearTuple(slot);
 }
 
 /*
- * dynamodbExecForeignDelete
- *		Delete one row from a foreign table
+ * dynamodbEndDirectModify
+ *		Finish a direct foreign table modification
  */
-extern "C" TupleTableSlot *
-dynamodbExecForeignDelete(EState *estate,
-						  ResultRelInfo *resultRelInfo,
-						  TupleTableSlot *slot,
-						  TupleTableSlot *planSlot)
+extern "C" void
+dynamodbEndDirectModify(ForeignScanState *node)
 {
-	return dynamodb_execute_foreign_modify(estate, resultRelInfo, CMD_DELETE,
-								  		   slot, planSlot);
+	DynamoDBFdwDirectModifyState *dmstate = (DynamoDBFdwDirectModifyState *) node->fdw_state;
+
+	/* if dmstate is NULL, we are in EXPLAIN; nothing to do */
+	if (dmstate == NULL)
+		return;
+
+	/* Release remote connection */
+	dynamodb_release_connection(dmstate->conn);
+	dmstate->conn = NULL;
+
+	/* MemoryContext will be deleted automatically. */
 }
+
 /*
- * dynamodbEndForeignModify
- *		Finish an insert/update/delete operation on a foreign table
+ * dynamodb_execute_dml_stmt
+ *
+ * Send the UPDATE/DELETE statement of a direct modification, with the new
+ * values of its target columns as parameters.
+ *
+ * The statement returns the old item, if there was one.  DynamoDB fails an
+ * UPDATE, or a DELETE with additional conditions, with a conditional check
+ * failure when the item does not match the WHERE clause: that is no error
+ * for PostgreSQL, just no row.
  */
-extern "C" void
-dynamodbEndForeignModify(EState *estate,
-						 ResultRelInfo *resultRelInfo)
+static void
+dynamodb_execute_dml_stmt(ForeignScanState *node)
 {
-	DynamoDBFdwModifyState *fmstate = (DynamoDBFdwModifyState *) resultRelInfo->ri_FdwState;
-
-	/* If fmstate is NULL, we are in EXPLAIN; nothing to do */
-	if (fmstate == NULL)
-		return;
+	DynamoDBFdwDirectModifyState *dmstate = (DynamoDBFdwDirectModifyState *) node->fdw_state;
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+	Aws::DynamoDB::Model::ExecuteStatementRequest req;
+	Aws::Vector<Aws::DynamoDB::Model::AttributeValue> values;
+	Aws::DynamoDB::Model::ExecuteStatementOutcome outcome;
+	MemoryContext oldcontext;
+	ListCell   *lc,
+			   *lc2;
+	int			bindnum = 0;
 
-	/* Destroy the execution state */
-	if (fmstate && fmstate->query)
+	/* Evaluate the new values in the per-tuple memory context */
+	oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+	forboth(lc, dmstate->param_exprs, lc2, dmstate->param_types)
 	{
-		fmstate->query = NULL;
+		ExprState  *expr_state = (ExprState *) lfirst(lc);
+		Oid			type = lfirst_oid(lc2);
+		Datum		value;
+		bool		isnull;
+
+		value = ExecEvalExpr(expr_state, econtext, &isnull);
+		values.push_back(dynamodb_bind_sql_var(type, bindnum, value, dmstate->query, isnull));
+		bindnum++;
 	}
-}
+	MemoryContextSwitchTo(oldcontext);
 
-extern "C" void
-dynamodbBeginForeignInsert(ModifyTableState *mtstate,
-							ResultRelInfo *resultRelInfo)
-{
-	ereport(ERROR,
-            (errcode(ERRCODE_FDW_UNABLE_TO_CREATE_EXECUTION),
-             errmsg("COPY and foreign partition routing not supported in dynamodb_fdw")));
-}
+	/* Execute the query */
+	req.SetStatement(dmstate->query);
+	req.SetParameters(values);
+	outcome = dmstate->conn->ExecuteStatement(req);
+	if (!outcome.IsSuccess())
+	{
+		if (outcome.GetError().GetErrorType() != Aws::DynamoDB::DynamoDBErrors::CONDITIONAL_CHECK_FAILED)
+			dynamodb_report_error(ERROR, outcome.GetError().GetMessage(), dmstate->query);
+		dmstate->num_tuples = 0;
+	}
+	else
+		dmstate->num_tuples = outcome.GetResult().GetItems().size();
 
-extern "C" void
-dynamodbEndForeignInsert(EState *estate,
-						ResultRelInfo *resultRelInfo)
-{
-	ereport(ERROR,
-            (errcode(ERRCODE_FDW_UNABLE_TO_CREATE_EXECUTION),
-             errmsg("COPY and foreign partition routing not supported in dynamodb_fdw")));
+	ResetExprContext(econtext);
 }
 
 /*
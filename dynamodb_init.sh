@@ -28,6 +28,7 @@ aws dynamodb delete-table --table-name testjsonb --endpoint-url $DYNAMODB_ENDPOI
 aws dynamodb delete-table --table-name students --endpoint-url $DYNAMODB_ENDPOINT
 aws dynamodb delete-table --table-name onek --endpoint-url $DYNAMODB_ENDPOINT
 aws dynamodb delete-table --table-name foo_select --endpoint-url $DYNAMODB_ENDPOINT
+aws dynamodb delete-table --table-name number_conv --endpoint-url $DYNAMODB_ENDPOINT
 aws dynamodb delete-table --table-name update_test --endpoint-url $DYNAMODB_ENDPOINT
 aws dynamodb delete-table --table-name classes --endpoint-url $DYNAMODB_ENDPOINT
 aws dynamodb delete-table --table-name J1_TBL --endpoint-url $DYNAMODB_ENDPOINT
@@ -50,11 +51,12 @@ aws dynamodb --endpoint-url $DYNAMODB_ENDPOINT put-item --table-name connection_
 aws dynamodb --endpoint-url $DYNAMODB_ENDPOINT put-item --table-name connection_tbl --item $'{"artist":{"S":"No One You Know"}, "songtitle":{"S":"Scared of My Shadow"}, "albumtitle":{"S":"Blue Sky Blues"}}'
 
 
-# for server_options.sql test
+# for server_options.sql, scan.sql, analyze.sql and pushdown.sql tests
 aws dynamodb --endpoint-url $DYNAMODB_ENDPOINT \
         create-table --table-name server_option_tbl \
-        --attribute-definitions AttributeName=artist,AttributeType=S AttributeName=songtitle,AttributeType=S \
+        --attribute-definitions AttributeName=artist,AttributeType=S AttributeName=songtitle,AttributeType=S AttributeName=albumtitle,AttributeType=S \
         --key-schema AttributeName=artist,KeyType=HASH AttributeName=songtitle,KeyType=RANGE \
+        --global-secondary-indexes 'IndexName=album_index,KeySchema=[{AttributeName=albumtitle,KeyType=HASH}],Projection={ProjectionType=KEYS_ONLY},ProvisionedThroughput={ReadCapacityUnits=1,WriteCapacityUnits=1}' \
         --provisioned-throughput ReadCapacityUnits=1,WriteCapacityUnits=1
 
 aws dynamodb --endpoint-url $DYNAMODB_ENDPOINT put-item --table-name server_option_tbl --item $'{"artist":{"S":"No One You Know"}, "songtitle":{"S":"Call Me Today"}, "albumtitle":{"S":"Somewhat Famous"}}'
@@ -506,6 +508,25 @@ aws dynamodb --endpoint-url $DYNAMODB_ENDPOINT put-item --table-name foo_select
 aws dynamodb --endpoint-url $DYNAMODB_ENDPOINT put-item --table-name foo_select --item $'{"key_dy": {"N": "6"}, "f1": {"NULL": true}}'
 aws dynamodb --endpoint-url $DYNAMODB_ENDPOINT put-item --table-name foo_select --item $'{"key_dy": {"N": "7"}, "f1": {"N": "1"}}'
 
+# n holds a number and s the same digits as a string, for the conversion of
+# numbers in extra/select.sql
+aws dynamodb --endpoint-url $DYNAMODB_ENDPOINT \
+        create-table --table-name number_conv \
+        --attribute-definitions AttributeName=id,AttributeType=N \
+        --key-schema AttributeName=id,KeyType=HASH \
+        --provisioned-throughput ReadCapacityUnits=1,WriteCapacityUnits=1
+
+aws dynamodb --endpoint-url $DYNAMODB_ENDPOINT put-item --table-name number_conv --item $'{"id": {"N": "1"}, "n": {"N": "0.1"}, "s": {"S": "0.1"}}'
+aws dynamodb --endpoint-url $DYNAMODB_ENDPOINT put-item --table-name number_conv --item $'{"id": {"N": "2"}, "n": {"N": "-2.5"}, "s": {"S": "-2.5"}}'
+aws dynamodb --endpoint-url $DYNAMODB_ENDPOINT put-item --table-name number_conv --item $'{"id": {"N": "3"}, "n": {"N": "-0"}, "s": {"S": "-0"}}'
+aws dynamodb --endpoint-url $DYNAMODB_ENDPOINT put-item --table-name number_conv --item $'{"id": {"N": "4"}, "n": {"N": "40000"}, "s": {"S": "40000"}}'
+aws dynamodb --endpoint-url $DYNAMODB_ENDPOINT put-item --table-name number_conv --item $'{"id": {"N": "5"}, "n": {"N": "3000000000"}, "s": {"S": "3000000000"}}'
+aws dynamodb --endpoint-url $DYNAMODB_ENDPOINT put-item --table-name number_conv --item $'{"id": {"N": "6"}, "n": {"N": "12345678901234567890"}, "s": {"S": "12345678901234567890"}}'
+aws dynamodb --endpoint-url $DYNAMODB_ENDPOINT put-item --table-name number_conv --item $'{"id": {"N": "7"}, "n": {"N": "16777217"}, "s": {"S": "16777217"}}'
+aws dynamodb --endpoint-url $DYNAMODB_ENDPOINT put-item --table-name number_conv --item $'{"id": {"N": "8"}, "n": {"N": "9007199254740993"}, "s": {"S": "9007199254740993"}}'
+aws dynamodb --endpoint-url $DYNAMODB_ENDPOINT put-item --table-name number_conv --item $'{"id": {"N": "9"}, "n": {"N": "0.00000123457"}, "s": {"S": "0.00000123457"}}'
+aws dynamodb --endpoint-url $DYNAMODB_ENDPOINT put-item --table-name number_conv --item $'{"id": {"N": "10"}, "n": {"N": "0.00000000000000000000001"}, "s": {"S": "0.00000000000000000000001"}}'
+
 
 # for extra/update.sql test
 aws dynamodb --endpoint-url $DYNAMODB_ENDPOINT \
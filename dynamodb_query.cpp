@@ -21,147 +21,148 @@ extern "C"
 {
 #include "postgres.h"
 
+#include "access/tupmacros.h"
 #include "commands/defrem.h"
 #include "commands/vacuum.h"
 #include "dynamodb_fdw.h"
-#include "jansson.h"
+#include "miscadmin.h"
 #include "string.h"
 
+#include "utils/array.h"
+
 #include "utils/json.h"
+#include "utils/jsonb.h"
 #include "utils/jsonfuncs.h"
 #include "utils/lsyscache.h"
+#include "utils/numeric.h"
 #include "utils/syscache.h"
 }
 
 static void dynamodb_get_datatype_for_conversion(Oid pg_type, regproc *typeinput,
-								   				int *typemod);
-static ArrayType *dynamodb_convert_set_to_array(const Aws::Vector<Aws::String>, regproc *typeinput,
-												int *typemod, Oid pgtyp);
+												Oid *typioparam, int *typemod);
+static bool is_compatible_type(Oid pg_type, Aws::DynamoDB::Model::ValueType dynamodb_type);
+static ArrayType *dynamodb_convert_set_to_array(const DynamoDBColumnConverter *conv,
+												const Aws::Vector<Aws::String> &val);
 static void dynamodb_convert_nested_object_to_json_string(StringInfo output,
-												Aws::DynamoDB::Model::AttributeValue dynamodbVal);
-static char *dynamodb_convert_bytebuf_to_string(Aws::Utils::ByteBuffer bytebuf);
-static Aws::Utils::ByteBuffer dynamodb_convert_string_to_bytebuf(const char* str);
-static char *dynamodb_convert_byte_datum_to_string(Datum value);
+												const Aws::DynamoDB::Model::AttributeValue &dynamodbVal);
+static JsonbValue *dynamodb_push_jsonb_value(JsonbParseState **state,
+											 JsonbIteratorToken token,
+											 const Aws::DynamoDB::Model::AttributeValue &dynamodbVal);
+static bytea *dynamodb_convert_bytebuf_to_bytea(const Aws::Utils::ByteBuffer &bytebuf);
+static Aws::Utils::ByteBuffer dynamodb_convert_bytea_to_bytebuf(Datum value);
+static void dynamodb_bind_bytea_array(Datum value,
+									  Aws::Vector<Aws::Utils::ByteBuffer> *vectorValues);
+
+/*
+ * dynamodb_alloc_array
+ *
+ * Allocate a one-dimensional array of nitems elements without nulls, whose
+ * datasize bytes of data are zeroed, to be filled by the caller.
+ */
+static ArrayType *
+dynamodb_alloc_array(Oid elmtype, int nitems, Size datasize)
+{
+	Size		nbytes = ARR_OVERHEAD_NONULLS(1) + datasize;
+	ArrayType  *result = (ArrayType *) palloc0(nbytes);
+
+	SET_VARSIZE(result, nbytes);
+	result->ndim = 1;
+	result->dataoffset = 0;
+	result->elemtype = elmtype;
+	ARR_DIMS(result)[0] = nitems;
+	ARR_LBOUND(result)[0] = 1;
+
+	return result;
+}
 
 /*
  * dynamodb_convert_set_to_array
  *
  * Convert SET data type of DynamoDB to Array type of Postgres
+ *
+ * Arrays of by-value elements, i.e. integers and floats, and text arrays
+ * are built in place in one pass, the numbers being parsed as for number
+ * columns.  Other elements are built by their input function, then copied
+ * into the array by construct_array.
  */
 static ArrayType *
-dynamodb_convert_set_to_array(const Aws::Vector<Aws::String> val,
-					regproc *typeinput, int *typemod, Oid pgtyp)
+dynamodb_convert_set_to_array(const DynamoDBColumnConverter *conv,
+							  const Aws::Vector<Aws::String> &val)
 {
+	int			nitems = (int) val.size();
+	ArrayType  *result;
+	char	   *ptr;
 	Datum	   *datumArr;
-	size_t		size = val.size();
 	int			i = 0;
-	Datum		valueDatum = 0;
-	Oid			elmtype;
-	int			elmlen;
-	bool		elmbyval;
-	char		elmalign;
 
-	datumArr = (Datum *) palloc0(sizeof(Datum) * size);
-	switch (pgtyp)
+	if (nitems == 0)
+		return construct_empty_array(conv->elmtype);
+
+	if (conv->elmbyval)
 	{
-		case INT2ARRAYOID:
-			{
-				elmtype = INT2OID;
-				elmlen = sizeof(int16_t);
-				elmbyval = true;
-				elmalign = 's';
-				break;
-			}
-		case INT4ARRAYOID:
-			{
-				elmtype = INT4OID;
-				elmlen = sizeof(int32_t);
-				elmbyval = true;
-				elmalign = 'i';
-				break;
-			}
-		case INT8ARRAYOID:
-			{
-				elmtype = INT8OID;
-				elmlen = sizeof(int64_t);
-				elmbyval = true;
-				elmalign = 'd';
-				break;
-			}
-		case FLOAT4ARRAYOID:
-			{
-				elmtype = FLOAT4OID;
-				elmlen = sizeof(float4);
-				elmbyval = true;
-				elmalign = TYPALIGN_INT;
-				break;
-			}
-		case FLOAT8ARRAYOID:
-			{
-				elmtype = FLOAT8OID;
-				elmlen = sizeof(float8);
-				elmbyval = true;
-				elmalign = 'd';
-				break;
-			}
-		case NUMERICARRAYOID:
-			{
-				elmtype = NUMERICOID;
-				elmlen = sizeof(float8);
-				elmbyval = true;
-				elmalign = 'd';
-				break;
-			}
-		case BYTEAARRAYOID:
-			{
-				elmtype = BYTEAOID;
-				elmlen = -1;
-				elmbyval = false;
-				elmalign = 'i';
-				break;
-			}
-		default:
-			{
-				elmtype = TEXTOID;
-				elmlen = -1;
-				elmbyval = false;
-				elmalign = 'i';
-				break;
-			}
-	}
+		/* The length of these types is a multiple of their alignment */
+		Assert(att_align_nominal(conv->elmlen, conv->elmalign) == conv->elmlen);
 
-	dynamodb_get_datatype_for_conversion(elmtype, typeinput, typemod);
+		result = dynamodb_alloc_array(conv->elmtype, nitems,
+									  (Size) nitems * conv->elmlen);
+		ptr = ARR_DATA_PTR(result);
+		for (const auto &item : val)
+		{
+			Datum		value = conv->elmparse(&conv->elminput, conv->elmioparam,
+											   conv->elmtypmod, item);
 
-	for (const auto &item : val)
+			store_att_byval(ptr, value, conv->elmlen);
+			ptr += conv->elmlen;
+		}
+
+		return result;
+	}
+
+	if (conv->elmtype == TEXTOID)
 	{
-		char *var_str = pstrdup(item.c_str());
-		valueDatum = CStringGetDatum(var_str);
-		datumArr[i] = OidFunctionCall3(*typeinput, valueDatum,
-											ObjectIdGetDatum(InvalidOid),
-											Int32GetDatum(*typemod));
-		i++;
+		int		   *lengths = (int *) palloc(sizeof(int) * nitems);
+		Size		datasize = 0;
+
+		/* As for text columns, a string ends at its first zero byte */
+		for (const auto &item : val)
+		{
+			lengths[i] = strlen(item.c_str());
+			datasize += INTALIGN(VARHDRSZ + lengths[i]);
+			i++;
+		}
+
+		result = dynamodb_alloc_array(conv->elmtype, nitems, datasize);
+		ptr = ARR_DATA_PTR(result);
+		i = 0;
+		for (const auto &item : val)
+		{
+			SET_VARSIZE(ptr, VARHDRSZ + lengths[i]);
+			memcpy(VARDATA(ptr), item.c_str(), lengths[i]);
+			ptr += INTALIGN(VARHDRSZ + lengths[i]);
+			i++;
+		}
+		pfree(lengths);
+
+		return result;
 	}
-	return construct_array(datumArr, size, elmtype,
-							elmlen, elmbyval, elmalign);
+
+	datumArr = (Datum *) palloc(sizeof(Datum) * nitems);
+	for (const auto &item : val)
+		datumArr[i++] = conv->elmparse(&conv->elminput, conv->elmioparam,
+									   conv->elmtypmod, item);
+
+	return construct_array(datumArr, nitems, conv->elmtype,
+						   conv->elmlen, conv->elmbyval, conv->elmalign);
 }
 
+/*
+ * Append a string as a JSON string literal.  Control characters are escaped
+ * too, so that the JSON text built from an item is always valid.
+ */
 static void
 dynamodb_append_string_literal_value(StringInfo output, const char *val)
 {
-	const char *valptr;
-
-	appendStringInfoChar(output, '\"');
-	for (valptr = val; *valptr; valptr++)
-	{
-		char		ch = *valptr;
-
-		if ((ch) == '\"')
-			appendStringInfoChar(output, '\\');
-		else if ( (ch) == '\\')
-			appendStringInfoChar(output, ch);
-		appendStringInfoChar(output, ch);
-	}
-	appendStringInfoChar(output, '\"');
+	escape_json(output, val);
 }
 
 /*
@@ -171,7 +172,7 @@ dynamodb_append_string_literal_value(StringInfo output, const char *val)
  */
 static void
 dynamodb_convert_nested_object_to_json_string(StringInfo output,
-									Aws::DynamoDB::Model::AttributeValue dynamodbVal)
+									const Aws::DynamoDB::Model::AttributeValue &dynamodbVal)
 {
 	switch (dynamodbVal.GetType())
 	{
@@ -265,7 +266,8 @@ dynamodb_convert_nested_object_to_json_string(StringInfo output,
 					if (!first)
 						appendStringInfoChar(output, ',');
 
-					appendStringInfo(output, "\"%s\":", item.first.c_str());
+					dynamodb_append_string_literal_value(output, item.first.c_str());
+					appendStringInfoChar(output, ':');
 					dynamodb_convert_nested_object_to_json_string(output, *item.second);
 
 					first = false;
@@ -326,13 +328,172 @@ dynamodb_convert_nested_object_to_json_string(StringInfo output,
 	}
 }
 
+/*
+ * dynamodb_jsonb_string
+ *
+ * Make a jsonb string.  The string is not copied; it must live until the
+ * jsonb has been built.
+ */
+static void
+dynamodb_jsonb_string(JsonbValue *jbv, const char *str, size_t len)
+{
+	if (len > JENTRY_OFFLENMASK)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("dynamodb_fdw: string too long to represent as jsonb string"),
+				 errdetail("Due to an implementation restriction, jsonb strings cannot exceed %d bytes.",
+						   JENTRY_OFFLENMASK)));
+
+	jbv->type = jbvString;
+	jbv->val.string.val = (char *) str;
+	jbv->val.string.len = (int) len;
+}
+
+/*
+ * dynamodb_jsonb_number
+ *
+ * Make a jsonb number from the text of a DynamoDB number.
+ */
+static void
+dynamodb_jsonb_number(JsonbValue *jbv, const char *str)
+{
+	jbv->type = jbvNumeric;
+	jbv->val.numeric = DatumGetNumeric(DirectFunctionCall3(numeric_in,
+														   CStringGetDatum(str),
+														   ObjectIdGetDatum(InvalidOid),
+														   Int32GetDatum(-1)));
+}
+
+/*
+ * dynamodb_jsonb_bytes
+ *
+ * Make a jsonb string from a binary value, in the bytea output format as
+ * in the JSON text of an item.
+ */
+static void
+dynamodb_jsonb_bytes(JsonbValue *jbv, const Aws::Utils::ByteBuffer &bytebuf)
+{
+	size_t		size = bytebuf.GetLength();
+	bytea	   *valueDatum = (bytea *) palloc(size + VARHDRSZ);
+	char	   *outputString;
+
+	memcpy(VARDATA(valueDatum), (void *) bytebuf.GetUnderlyingData(), size);
+	SET_VARSIZE(valueDatum, size + VARHDRSZ);
+
+	outputString = DatumGetCString(DirectFunctionCall1(byteaout,
+													   PointerGetDatum(valueDatum)));
+	dynamodb_jsonb_string(jbv, outputString, strlen(outputString));
+}
+
+/*
+ * dynamodb_push_jsonb_value
+ *
+ * Recursive function to push a DynamoDB value into a jsonb being built, as
+ * the given token.  Maps become objects, lists and sets become arrays.
+ * Returns the jsonb value once the outermost one has been pushed.
+ */
+static JsonbValue *
+dynamodb_push_jsonb_value(JsonbParseState **state, JsonbIteratorToken token,
+						  const Aws::DynamoDB::Model::AttributeValue &dynamodbVal)
+{
+	JsonbValue	jbv;
+
+	check_stack_depth();
+
+	switch (dynamodbVal.GetType())
+	{
+		case Aws::DynamoDB::Model::ValueType::NUMBER:
+			dynamodb_jsonb_number(&jbv, dynamodbVal.GetN().c_str());
+			break;
+		case Aws::DynamoDB::Model::ValueType::STRING:
+			{
+				const Aws::String &val = dynamodbVal.GetS();
+
+				dynamodb_jsonb_string(&jbv, val.c_str(), val.size());
+				break;
+			}
+		case Aws::DynamoDB::Model::ValueType::BOOL:
+			jbv.type = jbvBool;
+			jbv.val.boolean = dynamodbVal.GetBool();
+			break;
+		case Aws::DynamoDB::Model::ValueType::NULLVALUE:
+			jbv.type = jbvNull;
+			break;
+		case Aws::DynamoDB::Model::ValueType::BYTEBUFFER:
+			dynamodb_jsonb_bytes(&jbv, dynamodbVal.GetB());
+			break;
+		case Aws::DynamoDB::Model::ValueType::NUMBER_SET:
+			{
+				pushJsonbValue(state, WJB_BEGIN_ARRAY, NULL);
+				for (const auto &item : dynamodbVal.GetNS())
+				{
+					dynamodb_jsonb_number(&jbv, item.c_str());
+					pushJsonbValue(state, WJB_ELEM, &jbv);
+				}
+				return pushJsonbValue(state, WJB_END_ARRAY, NULL);
+			}
+		case Aws::DynamoDB::Model::ValueType::STRING_SET:
+			{
+				pushJsonbValue(state, WJB_BEGIN_ARRAY, NULL);
+				for (const auto &item : dynamodbVal.GetSS())
+				{
+					dynamodb_jsonb_string(&jbv, item.c_str(), item.size());
+					pushJsonbValue(state, WJB_ELEM, &jbv);
+				}
+				return pushJsonbValue(state, WJB_END_ARRAY, NULL);
+			}
+		case Aws::DynamoDB::Model::ValueType::BYTEBUFFER_SET:
+			{
+				pushJsonbValue(state, WJB_BEGIN_ARRAY, NULL);
+				for (const auto &item : dynamodbVal.GetBS())
+				{
+					dynamodb_jsonb_bytes(&jbv, item);
+					pushJsonbValue(state, WJB_ELEM, &jbv);
+				}
+				return pushJsonbValue(state, WJB_END_ARRAY, NULL);
+			}
+		case Aws::DynamoDB::Model::ValueType::ATTRIBUTE_LIST:
+			{
+				pushJsonbValue(state, WJB_BEGIN_ARRAY, NULL);
+				for (const auto &item : dynamodbVal.GetL())
+					dynamodb_push_jsonb_value(state, WJB_ELEM, *item);
+				return pushJsonbValue(state, WJB_END_ARRAY, NULL);
+			}
+		case Aws::DynamoDB::Model::ValueType::ATTRIBUTE_MAP:
+			{
+				pushJsonbValue(state, WJB_BEGIN_OBJECT, NULL);
+				for (const auto &item : dynamodbVal.GetM())
+				{
+					dynamodb_jsonb_string(&jbv, item.first.c_str(), item.first.size());
+					pushJsonbValue(state, WJB_KEY, &jbv);
+					dynamodb_push_jsonb_value(state, WJB_VALUE, *item.second);
+				}
+				return pushJsonbValue(state, WJB_END_OBJECT, NULL);
+			}
+		default:
+			/* Should not happen */
+			elog(ERROR, "dynamodb_fdw: unsupported data type %d of DynamoDB", (int) dynamodbVal.GetType());
+	}
+
+	/* A scalar at the top level is a jsonb of its own */
+	if (*state == NULL)
+	{
+		JsonbValue *result = (JsonbValue *) palloc(sizeof(JsonbValue));
+
+		*result = jbv;
+		return result;
+	}
+
+	return pushJsonbValue(state, token, &jbv);
+}
+
 /*
  * Search system cache and get types for output function.
  * They are used for data type conversion.
  */
 static void
 dynamodb_get_datatype_for_conversion(Oid pg_type, regproc *typeinput,
-								   int *typemod)
+									 Oid *typioparam, int *typemod)
 {
 	HeapTuple	hptuple;
 
@@ -341,6 +502,7 @@ dynamodb_get_datatype_for_conversion(Oid pg_type, regproc *typeinput,
 		elog(ERROR, "dynamodb_fdw: cache lookup failed for type%u", pg_type);
 
 	*typeinput = ((Form_pg_type) GETSTRUCT(hptuple))->typinput;
+	*typioparam = getTypeIOParam(hptuple);
 	*typemod = ((Form_pg_type) GETSTRUCT(hptuple))->typtypmod;
 	ReleaseSysCache(hptuple);
 }
@@ -431,253 +593,727 @@ is_compatible_type(Oid pg_type, Aws::DynamoDB::Model::ValueType dynamodb_type)
 }
 
 /*
- * dynamodb_convert_to_pg: Convert DynamoDB data into PostgreSQL's compatible data types
+ * Native parsing of DynamoDB numbers for integer and floating point columns.
+ *
+ * DynamoDB numbers mostly come in a plain form such as "-12" or "3.25",
+ * which is parsed here straight from the SDK string.  Anything else, e.g. an
+ * exponent, too many digits or a value out of range, is rejected and left to
+ * the type's input function, which also reports the errors.
+ */
+
+/* Powers of ten which are exactly representable as a double */
+static const double dynamodb_exact_powers_of_ten[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/*
+ * Parse an optionally negative string of digits into an int64.  Returns
+ * false if the string is anything else, or out of range.
  */
-Datum
-dynamodb_convert_to_pg(Oid pgtyp, int pgtypmod, Aws::DynamoDB::Model::AttributeValue dynamodbVal)
+static bool
+dynamodb_parse_int64(const Aws::String &str, int64 *result)
 {
-	Datum		valueDatum = 0;
-	Datum		returnDatum = 0;
-	regproc		typeinput;
-	int			typemod;
+	const char *ptr = str.c_str();
+	const char *end = ptr + str.size();
+	bool		neg = false;
+	uint64		value = 0;
 
-	switch (dynamodbVal.GetType())
+	if (ptr < end && *ptr == '-')
 	{
-		case Aws::DynamoDB::Model::ValueType::BOOL:
-			{
-				bool val = dynamodbVal.GetBool();
+		neg = true;
+		ptr++;
+	}
 
-				if (is_compatible_type(pgtyp, dynamodbVal.GetType()))
-					return BoolGetDatum(val);
-				else
-				{
-					StringInfo	buffer = makeStringInfo();
+	/* 19 digits cannot overflow an uint64, the range is checked below */
+	if (ptr == end || end - ptr > 19)
+		return false;
 
-					dynamodb_convert_nested_object_to_json_string(buffer, dynamodbVal);
-					valueDatum = CStringGetDatum(buffer->data);
-				}
+	for (; ptr < end; ptr++)
+	{
+		unsigned int digit = (unsigned char) *ptr - '0';
 
-				break;
-			}
-		case Aws::DynamoDB::Model::ValueType::BYTEBUFFER:
-			{
-				if (is_compatible_type(pgtyp, dynamodbVal.GetType()))
-				{
-					const Aws::Utils::ByteBuffer bytebuf = dynamodbVal.GetB();
+		if (digit > 9)
+			return false;
+		value = value * 10 + digit;
+	}
 
-					size_t 	size = bytebuf.GetLength();
-					valueDatum = (Datum)palloc0(size + VARHDRSZ);
-					memcpy(VARDATA(valueDatum), (void *)bytebuf.GetUnderlyingData(), size);
-					SET_VARSIZE(valueDatum, size + VARHDRSZ);
-					return valueDatum;
-				}
-				else
-				{
-					StringInfo buffer = makeStringInfo();
+	if (neg)
+	{
+		if (value > (uint64) PG_INT64_MAX + 1)
+			return false;
+		*result = (int64) (0 - value);
+	}
+	else
+	{
+		if (value > (uint64) PG_INT64_MAX)
+			return false;
+		*result = (int64) value;
+	}
 
-					dynamodb_convert_nested_object_to_json_string(buffer, dynamodbVal);
-					valueDatum = CStringGetDatum(buffer->data);
-				}
-				break;
-			}
-		case Aws::DynamoDB::Model::ValueType::NUMBER:
-			{
-				if (is_compatible_type(pgtyp, dynamodbVal.GetType()))
-				{
-					char *val = pstrdup(dynamodbVal.GetN().c_str());
-					valueDatum = CStringGetDatum(val);
-				}
-				else
-				{
-					StringInfo	buffer = makeStringInfo();
+	return true;
+}
 
-					dynamodb_convert_nested_object_to_json_string(buffer, dynamodbVal);
-					valueDatum = CStringGetDatum(buffer->data);
-				}
-				break;
-			}
-		case Aws::DynamoDB::Model::ValueType::STRING:
-			{
-				if (is_compatible_type(pgtyp, dynamodbVal.GetType()))
-				{
-					char *val = pstrdup(dynamodbVal.GetS().c_str());
+/*
+ * Parse an optionally negative decimal number, with or without a fraction,
+ * into a double.
+ *
+ * The digits are read as an integer mantissa, divided by 10^scale.  As long
+ * as the mantissa is at most max_mantissa and the scale at most max_scale,
+ * both are exact and the single division rounds correctly,
+ * giving the same result as strtod().  With a mantissa of at most 2^24 and a
+ * power of at most 10^10, both are exact as floats too, and rounding the
+ * double to a float gives the same result as strtof().  Returns false for
+ * any other number.
+ */
+static bool
+dynamodb_parse_double(const Aws::String &str, uint64 max_mantissa,
+					  int max_scale, double *result)
+{
+	const char *ptr = str.c_str();
+	const char *end = ptr + str.size();
+	bool		neg = false;
+	bool		has_digits = false;
+	bool		in_fraction = false;
+	uint64		mantissa = 0;
+	int			ndigits = 0;	/* significant digits in mantissa */
+	int			scale = 0;		/* digits after the decimal point */
+	double		value;
+
+	if (ptr < end && *ptr == '-')
+	{
+		neg = true;
+		ptr++;
+	}
 
-					valueDatum = CStringGetDatum(val);
-				}
-				else
-				{
-					StringInfo	buffer = makeStringInfo();
+	for (; ptr < end; ptr++)
+	{
+		unsigned int digit = (unsigned char) *ptr - '0';
 
-					dynamodb_convert_nested_object_to_json_string(buffer, dynamodbVal);
-					valueDatum = CStringGetDatum(buffer->data);
-				}
-				break;
-			}
-		case Aws::DynamoDB::Model::ValueType::NUMBER_SET:
+		if (digit > 9)
+		{
+			if (*ptr == '.' && !in_fraction)
 			{
-				const Aws::Vector<Aws::String> val = dynamodbVal.GetNS();
-				ArrayType  *arr;
-
-				if (is_compatible_type(pgtyp, dynamodbVal.GetType()))
-				{
-					arr = dynamodb_convert_set_to_array(val, &typeinput, &typemod, pgtyp);
-					return PointerGetDatum(arr);
-				}
-				else
-				{
-					StringInfo	buffer = makeStringInfo();
-
-					dynamodb_convert_nested_object_to_json_string(buffer, dynamodbVal);
-					valueDatum = CStringGetDatum(buffer->data);
-					break;
-				}
+				in_fraction = true;
+				continue;
 			}
-		case Aws::DynamoDB::Model::ValueType::STRING_SET:
-			{
-				const Aws::Vector<Aws::String> val = dynamodbVal.GetSS();
-				ArrayType  *arr;
+			return false;
+		}
 
-				arr = dynamodb_convert_set_to_array(val, &typeinput, &typemod, pgtyp);
-				return PointerGetDatum(arr);
-			}
-		case Aws::DynamoDB::Model::ValueType::ATTRIBUTE_MAP:
-		case Aws::DynamoDB::Model::ValueType::ATTRIBUTE_LIST:
-			{
-#if PG_VERSION_NUM >= 170000
-				JsonLexContext lex;
-#else
-				JsonLexContext *lex;
-#endif
-				text	   *result;
-				StringInfo	buffer = makeStringInfo();
+		/* Leading zeros are not significant */
+		if ((mantissa != 0 || digit != 0) && ++ndigits > 19)
+			return false;
+		mantissa = mantissa * 10 + digit;
+		if (in_fraction)
+			scale++;
+		has_digits = true;
+	}
 
-				dynamodb_convert_nested_object_to_json_string(buffer, dynamodbVal);
+	if (!has_digits || mantissa > max_mantissa || scale > max_scale)
+		return false;
 
-				if (pgtyp == JSONOID)
-				{
-					result = cstring_to_text_with_len(buffer->data, buffer->len);
-#if PG_VERSION_NUM >= 170000
-					makeJsonLexContext(&lex, result, false);
-					pg_parse_json(&lex, &nullSemAction);
-					freeJsonLexContext(&lex);
-#else
-					lex = makeJsonLexContext(result, false);
-					pg_parse_json(lex, &nullSemAction);
-#endif
-					return PointerGetDatum(result);
-				}
-				else if (pgtyp == JSONBOID)
-					return DirectFunctionCall1(jsonb_in, PointerGetDatum(buffer->data));
-				else
-					valueDatum = CStringGetDatum(buffer->data);
+	value = (double) mantissa;
+	if (scale > 0)
+		value /= dynamodb_exact_powers_of_ten[scale];
+	*result = neg ? -value : value;
 
-				break;
-			}
-		case Aws::DynamoDB::Model::ValueType::BYTEBUFFER_SET:
-			{
-				const Aws::Vector<Aws::Utils::ByteBuffer> bytebuff = dynamodbVal.GetBS();
-				Aws::Vector<Aws::String> val;
-				ArrayType *arr;
+	return true;
+}
 
-				for (const auto &item : bytebuff)
-				{
-					char *buff = dynamodb_convert_bytebuf_to_string(item);
-					val.push_back(buff);
-				}
+/*
+ * Parse the text of a number into a value of a given type.  Integers and
+ * floats are parsed natively unless the input function is needed.  These
+ * are used for number columns as well as for the elements of sets.
+ */
+static Datum
+dynamodb_parse_via_input(const FmgrInfo *input, Oid typioparam, int32 typmod,
+						 const Aws::String &str)
+{
+	return InputFunctionCall((FmgrInfo *) input, (char *) str.c_str(),
+							 typioparam, typmod);
+}
 
-				arr = dynamodb_convert_set_to_array(val, &typeinput, &typemod, BYTEAARRAYOID);
-				return PointerGetDatum(arr);
-			}
-		default:
-			{
-				/* Should not happen */
-				elog(ERROR, "dynamodb_fdw: unsupported data type %d of DynamoDB", (int) dynamodbVal.GetType());
-			}
-	}
+static Datum
+dynamodb_parse_int2(const FmgrInfo *input, Oid typioparam, int32 typmod,
+					const Aws::String &str)
+{
+	int64		value;
 
-	dynamodb_get_datatype_for_conversion(pgtyp, &typeinput, &typemod);
-	returnDatum = OidFunctionCall3(typeinput, valueDatum,
-								   ObjectIdGetDatum(pgtyp),
-								   Int32GetDatum(typemod));
+	if (dynamodb_parse_int64(str, &value) &&
+		value >= PG_INT16_MIN && value <= PG_INT16_MAX)
+		return Int16GetDatum((int16) value);
 
-	return returnDatum;
+	return dynamodb_parse_via_input(input, typioparam, typmod, str);
 }
 
-static Aws::DynamoDB::Model::AttributeValue
-dynamodb_bind_json_value(json_t *root, char* key_name)
+static Datum
+dynamodb_parse_int4(const FmgrInfo *input, Oid typioparam, int32 typmod,
+					const Aws::String &str)
+{
+	int64		value;
+
+	if (dynamodb_parse_int64(str, &value) &&
+		value >= PG_INT32_MIN && value <= PG_INT32_MAX)
+		return Int32GetDatum((int32) value);
+
+	return dynamodb_parse_via_input(input, typioparam, typmod, str);
+}
+
+static Datum
+dynamodb_parse_int8(const FmgrInfo *input, Oid typioparam, int32 typmod,
+					const Aws::String &str)
+{
+	int64		value;
+
+	if (dynamodb_parse_int64(str, &value))
+		return Int64GetDatum(value);
+
+	return dynamodb_parse_via_input(input, typioparam, typmod, str);
+}
+
+static Datum
+dynamodb_parse_float4(const FmgrInfo *input, Oid typioparam, int32 typmod,
+					  const Aws::String &str)
+{
+	double		value;
+
+	if (dynamodb_parse_double(str, UINT64CONST(1) << 24, 10, &value))
+		return Float4GetDatum((float4) value);
+
+	return dynamodb_parse_via_input(input, typioparam, typmod, str);
+}
+
+static Datum
+dynamodb_parse_float8(const FmgrInfo *input, Oid typioparam, int32 typmod,
+					  const Aws::String &str)
+{
+	double		value;
+
+	if (dynamodb_parse_double(str, UINT64CONST(1) << 53, 22, &value))
+		return Float8GetDatum(value);
+
+	return dynamodb_parse_via_input(input, typioparam, typmod, str);
+}
+
+/* Select the routine parsing numbers into values of type pgtype */
+static DynamoDBParseFunc
+dynamodb_select_parser(Oid pgtype)
+{
+	switch (pgtype)
+	{
+		case INT2OID:
+			return dynamodb_parse_int2;
+		case INT4OID:
+			return dynamodb_parse_int4;
+		case INT8OID:
+			return dynamodb_parse_int8;
+		case FLOAT4OID:
+			return dynamodb_parse_float4;
+		case FLOAT8OID:
+			return dynamodb_parse_float8;
+		default:
+			return dynamodb_parse_via_input;
+	}
+}
+
+/*
+ * Conversion routines, selected per column and DynamoDB value type by
+ * dynamodb_init_column_converter.
+ */
+
+/* Value of a type which is not compatible with the column: go through JSON */
+static Datum
+dynamodb_convert_via_json(const DynamoDBColumnConverter *conv,
+						  const Aws::DynamoDB::Model::AttributeValue &dynamodbVal)
+{
+	StringInfoData buffer;
+
+	initStringInfo(&buffer);
+	dynamodb_convert_nested_object_to_json_string(&buffer, dynamodbVal);
+
+	return InputFunctionCall((FmgrInfo *) &conv->typinput, buffer.data,
+							 conv->typioparam, conv->typmod);
+}
+
+static Datum
+dynamodb_convert_bool(const DynamoDBColumnConverter *conv,
+					  const Aws::DynamoDB::Model::AttributeValue &dynamodbVal)
+{
+	return BoolGetDatum(dynamodbVal.GetBool());
+}
+
+static Datum
+dynamodb_convert_bytea(const DynamoDBColumnConverter *conv,
+					   const Aws::DynamoDB::Model::AttributeValue &dynamodbVal)
+{
+	return PointerGetDatum(dynamodb_convert_bytebuf_to_bytea(dynamodbVal.GetB()));
+}
+
+static Datum
+dynamodb_convert_number(const DynamoDBColumnConverter *conv,
+						const Aws::DynamoDB::Model::AttributeValue &dynamodbVal)
+{
+	return conv->parse(&conv->typinput, conv->typioparam, conv->typmod,
+					   dynamodbVal.GetN());
+}
+
+static Datum
+dynamodb_convert_string(const DynamoDBColumnConverter *conv,
+						const Aws::DynamoDB::Model::AttributeValue &dynamodbVal)
+{
+	return InputFunctionCall((FmgrInfo *) &conv->typinput,
+							 (char *) dynamodbVal.GetS().c_str(),
+							 conv->typioparam, conv->typmod);
+}
+
+/*
+ * Strings into text, varchar and bpchar columns.  Without a typmod, their
+ * input functions only copy the string.
+ */
+static Datum
+dynamodb_convert_string_to_text(const DynamoDBColumnConverter *conv,
+								const Aws::DynamoDB::Model::AttributeValue &dynamodbVal)
+{
+	return PointerGetDatum(cstring_to_text(dynamodbVal.GetS().c_str()));
+}
+
+static Datum
+dynamodb_convert_number_set(const DynamoDBColumnConverter *conv,
+							const Aws::DynamoDB::Model::AttributeValue &dynamodbVal)
+{
+	return PointerGetDatum(dynamodb_convert_set_to_array(conv, dynamodbVal.GetNS()));
+}
+
+static Datum
+dynamodb_convert_string_set(const DynamoDBColumnConverter *conv,
+							const Aws::DynamoDB::Model::AttributeValue &dynamodbVal)
+{
+	return PointerGetDatum(dynamodb_convert_set_to_array(conv, dynamodbVal.GetSS()));
+}
+
+/*
+ * The elements of a binary set are the bytes of the bytea elements, as
+ * written by dynamodb_bind_bytea_array, so they are not parsed by byteain.
+ */
+static Datum
+dynamodb_convert_bytebuf_set(const DynamoDBColumnConverter *conv,
+							 const Aws::DynamoDB::Model::AttributeValue &dynamodbVal)
+{
+	const Aws::Vector<Aws::Utils::ByteBuffer> &bytebuff = dynamodbVal.GetBS();
+	Datum	   *datumArr;
+	int			i = 0;
+
+	datumArr = (Datum *) palloc(sizeof(Datum) * bytebuff.size());
+	for (const auto &item : bytebuff)
+		datumArr[i++] = PointerGetDatum(dynamodb_convert_bytebuf_to_bytea(item));
+
+	return PointerGetDatum(construct_array(datumArr, i, conv->elmtype,
+										   conv->elmlen, conv->elmbyval,
+										   conv->elmalign));
+}
+
+/*
+ * The JSON text built from an item is valid by construction, so unlike
+ * json_in, it is not parsed again.
+ */
+static Datum
+dynamodb_convert_to_json(const DynamoDBColumnConverter *conv,
+						 const Aws::DynamoDB::Model::AttributeValue &dynamodbVal)
+{
+	StringInfoData buffer;
+
+	initStringInfo(&buffer);
+	dynamodb_convert_nested_object_to_json_string(&buffer, dynamodbVal);
+
+	return PointerGetDatum(cstring_to_text_with_len(buffer.data, buffer.len));
+}
+
+/*
+ * Build a jsonb from a DynamoDB value, without going through its JSON text.
+ */
+static Datum
+dynamodb_convert_to_jsonb(const DynamoDBColumnConverter *conv,
+						  const Aws::DynamoDB::Model::AttributeValue &dynamodbVal)
+{
+	JsonbParseState *state = NULL;
+	JsonbValue *result;
+
+	result = dynamodb_push_jsonb_value(&state, WJB_ELEM, dynamodbVal);
+
+	return JsonbPGetDatum(JsonbValueToJsonb(result));
+}
+
+static Datum
+dynamodb_convert_unsupported(const DynamoDBColumnConverter *conv,
+							 const Aws::DynamoDB::Model::AttributeValue &dynamodbVal)
+{
+	/* Should not happen */
+	elog(ERROR, "dynamodb_fdw: unsupported data type %d of DynamoDB", (int) dynamodbVal.GetType());
+	return (Datum) 0;
+}
+
+/*
+ * dynamodb_init_column_converter
+ *
+ * Select the conversion routines of a column of type pgtyp and typmod
+ * pgtypmod, and look up the input functions they use.  The lookups are done
+ * in the current memory context, which must live as long as the scan.
+ */
+void
+dynamodb_init_column_converter(DynamoDBColumnConverter *conv, Oid pgtyp,
+							   int32 pgtypmod)
+{
+	regproc		typeinput;
+	int			typemod;
+	int			i;
+
+	memset(conv, 0, sizeof(DynamoDBColumnConverter));
+	conv->pgtype = pgtyp;
+
+	dynamodb_get_datatype_for_conversion(pgtyp, &typeinput,
+										 &conv->typioparam, &typemod);
+	fmgr_info(typeinput, &conv->typinput);
+	conv->typmod = pgtypmod;
+
+	/* By default, values are converted through their JSON representation */
+	for (i = 0; i < DYNAMODB_NUM_VALUE_TYPES; i++)
+		conv->convert[i] = dynamodb_convert_via_json;
+	conv->convert[(int) Aws::DynamoDB::Model::ValueType::NULLVALUE] = dynamodb_convert_unsupported;
+
+	if (is_compatible_type(pgtyp, Aws::DynamoDB::Model::ValueType::BOOL))
+		conv->convert[(int) Aws::DynamoDB::Model::ValueType::BOOL] = dynamodb_convert_bool;
+	if (is_compatible_type(pgtyp, Aws::DynamoDB::Model::ValueType::BYTEBUFFER))
+		conv->convert[(int) Aws::DynamoDB::Model::ValueType::BYTEBUFFER] = dynamodb_convert_bytea;
+	if (is_compatible_type(pgtyp, Aws::DynamoDB::Model::ValueType::NUMBER))
+	{
+		conv->parse = dynamodb_select_parser(pgtyp);
+		conv->convert[(int) Aws::DynamoDB::Model::ValueType::NUMBER] = dynamodb_convert_number;
+	}
+	if (is_compatible_type(pgtyp, Aws::DynamoDB::Model::ValueType::STRING))
+	{
+		if (pgtyp != NAMEOID && pgtypmod < 0)
+			conv->convert[(int) Aws::DynamoDB::Model::ValueType::STRING] = dynamodb_convert_string_to_text;
+		else
+			conv->convert[(int) Aws::DynamoDB::Model::ValueType::STRING] = dynamodb_convert_string;
+	}
+
+	if (pgtyp == JSONOID)
+	{
+		conv->convert[(int) Aws::DynamoDB::Model::ValueType::ATTRIBUTE_MAP] = dynamodb_convert_to_json;
+		conv->convert[(int) Aws::DynamoDB::Model::ValueType::ATTRIBUTE_LIST] = dynamodb_convert_to_json;
+	}
+	else if (pgtyp == JSONBOID)
+	{
+		/* Any value, not only maps and lists, can be built as jsonb */
+		for (i = 0; i < DYNAMODB_NUM_VALUE_TYPES; i++)
+			conv->convert[i] = dynamodb_convert_to_jsonb;
+		conv->convert[(int) Aws::DynamoDB::Model::ValueType::NULLVALUE] = dynamodb_convert_unsupported;
+	}
+
+	/* Sets are converted into arrays of the column's element type */
+	switch (pgtyp)
+	{
+		case INT2ARRAYOID:
+			conv->elmtype = INT2OID;
+			break;
+		case INT4ARRAYOID:
+			conv->elmtype = INT4OID;
+			break;
+		case INT8ARRAYOID:
+			conv->elmtype = INT8OID;
+			break;
+		case FLOAT4ARRAYOID:
+			conv->elmtype = FLOAT4OID;
+			break;
+		case FLOAT8ARRAYOID:
+			conv->elmtype = FLOAT8OID;
+			break;
+		case NUMERICARRAYOID:
+			conv->elmtype = NUMERICOID;
+			break;
+		case BYTEAARRAYOID:
+			conv->elmtype = BYTEAOID;
+			break;
+		case TEXTARRAYOID:
+		case VARCHARARRAYOID:
+		case BPCHARARRAYOID:
+			conv->elmtype = TEXTOID;
+			break;
+		default:
+			return;
+	}
+
+	get_typlenbyvalalign(conv->elmtype, &conv->elmlen, &conv->elmbyval,
+						 &conv->elmalign);
+	dynamodb_get_datatype_for_conversion(conv->elmtype, &typeinput,
+										 &conv->elmioparam, &typemod);
+	fmgr_info(typeinput, &conv->elminput);
+	conv->elmtypmod = typemod;
+	conv->elmparse = dynamodb_select_parser(conv->elmtype);
+
+	if (is_compatible_type(pgtyp, Aws::DynamoDB::Model::ValueType::NUMBER_SET))
+		conv->convert[(int) Aws::DynamoDB::Model::ValueType::NUMBER_SET] = dynamodb_convert_number_set;
+	if (is_compatible_type(pgtyp, Aws::DynamoDB::Model::ValueType::STRING_SET))
+		conv->convert[(int) Aws::DynamoDB::Model::ValueType::STRING_SET] = dynamodb_convert_string_set;
+	if (is_compatible_type(pgtyp, Aws::DynamoDB::Model::ValueType::BYTEBUFFER_SET))
+		conv->convert[(int) Aws::DynamoDB::Model::ValueType::BYTEBUFFER_SET] = dynamodb_convert_bytebuf_set;
+}
+
+/*
+ * dynamodb_bind_jsonb_value
+ *
+ * Convert a jsonb value into a DynamoDB value.  Objects become maps, and
+ * arrays become lists.
+ */
+static Aws::DynamoDB::Model::AttributeValue
+dynamodb_bind_jsonb_value(JsonbValue *jbv)
 {
 	Aws::DynamoDB::Model::AttributeValue bindValue;
 
-	switch(root->type)
-		{
-			case JSON_STRING:
-			{
-				bindValue.SetS(json_string_value(root));
-				break;
-			}
-			case JSON_INTEGER:
-			{
-				bindValue.SetN((int) json_integer_value(root));
-				break;
-			}
-			case JSON_REAL:
-			{
-				bindValue.SetN(json_real_value(root));
-				break;
-			}
-			case JSON_TRUE:
-			{
-				bindValue.SetBool(true);
-				break;
-			}
-			case JSON_FALSE:
-			{
-				bindValue.SetBool(false);
-				break;
-			}
-			case JSON_NULL:
-			{
-				bindValue.SetNull(true);
-				break;
-			}
-			case JSON_ARRAY:
+	switch (jbv->type)
+	{
+		case jbvNull:
+			bindValue.SetNull(true);
+			break;
+		case jbvString:
+			bindValue.SetS(Aws::String(jbv->val.string.val, jbv->val.string.len));
+			break;
+		case jbvNumeric:
+			bindValue.SetN(DatumGetCString(DirectFunctionCall1(numeric_out,
+															   NumericGetDatum(jbv->val.numeric))));
+			break;
+		case jbvBool:
+			bindValue.SetBool(jbv->val.boolean);
+			break;
+		case jbvBinary:
 			{
-				Aws::Vector<std::shared_ptr<Aws::DynamoDB::Model::AttributeValue>> listAtt;
-				unsigned int	i;
-				json_t *value;
+				JsonbIterator *it = JsonbIteratorInit(jbv->val.binary.data);
+				JsonbIteratorToken token;
+				JsonbValue	v;
 
-				json_array_foreach(root, i, value)
-				{
-					Aws::DynamoDB::Model::AttributeValue attVal;
+				check_stack_depth();
 
-					attVal = dynamodb_bind_json_value(value, NULL);
-					listAtt.push_back(std::make_shared<Aws::DynamoDB::Model::AttributeValue>(attVal));
+				/* Nested containers are returned as jbvBinary, and recursed into */
+				token = JsonbIteratorNext(&it, &v, true);
+				if (token == WJB_BEGIN_ARRAY && v.val.array.rawScalar)
+				{
+					token = JsonbIteratorNext(&it, &v, true);
+					Assert(token == WJB_ELEM);
+					bindValue = dynamodb_bind_jsonb_value(&v);
 				}
-				bindValue.SetL(listAtt);
-				break;
-			}
-			case JSON_OBJECT:
-			{
-				Aws::Map<Aws::String, const std::shared_ptr<Aws::DynamoDB::Model::AttributeValue>> mapAtt;
-				const char *key = NULL;
-				json_t *element = NULL;
-
-				json_object_foreach(root, key, element)
+				else if (token == WJB_BEGIN_ARRAY)
 				{
-					Aws::DynamoDB::Model::AttributeValue attVal;
+					Aws::Vector<std::shared_ptr<Aws::DynamoDB::Model::AttributeValue>> listAtt;
 
-					attVal = dynamodb_bind_json_value(element, NULL);
-					mapAtt.insert(mapAtt.begin(), std::pair<Aws::String,
-								const std::shared_ptr<Aws::DynamoDB::Model::AttributeValue>>
-								(key, std::make_shared<Aws::DynamoDB::Model::AttributeValue>(attVal)));
+					while ((token = JsonbIteratorNext(&it, &v, true)) == WJB_ELEM)
+						listAtt.push_back(std::make_shared<Aws::DynamoDB::Model::AttributeValue>(dynamodb_bind_jsonb_value(&v)));
+					bindValue.SetL(listAtt);
+				}
+				else
+				{
+					Aws::Map<Aws::String, const std::shared_ptr<Aws::DynamoDB::Model::AttributeValue>> mapAtt;
+
+					Assert(token == WJB_BEGIN_OBJECT);
+					while ((token = JsonbIteratorNext(&it, &v, true)) == WJB_KEY)
+					{
+						Aws::String key(v.val.string.val, v.val.string.len);
+
+						token = JsonbIteratorNext(&it, &v, true);
+						Assert(token == WJB_VALUE);
+						mapAtt.emplace(key, std::make_shared<Aws::DynamoDB::Model::AttributeValue>(dynamodb_bind_jsonb_value(&v)));
+					}
+					bindValue.SetM(mapAtt);
 				}
-				bindValue.SetM(mapAtt);
 				break;
 			}
-		}
+		default:
+			elog(ERROR, "dynamodb_fdw: unexpected jsonb value type %d", (int) jbv->type);
+	}
+
 	return bindValue;
 }
 
+/*
+ * The callbacks of the json parser return a status from PostgreSQL 16.
+ */
+#if PG_VERSION_NUM >= 160000
+typedef JsonParseErrorType dynamodb_json_action_result;
+#define DYNAMODB_JSON_ACTION_SUCCESS	return JSON_SUCCESS
+#else
+typedef void dynamodb_json_action_result;
+#define DYNAMODB_JSON_ACTION_SUCCESS	return
+#endif
+
+/* A json array or object being converted */
+typedef struct DynamoDBJsonContainer
+{
+	bool		is_object;
+	Aws::String field_name;		/* name of the next field of an object */
+	Aws::Vector<std::shared_ptr<Aws::DynamoDB::Model::AttributeValue>> list;
+	Aws::Map<Aws::String, const std::shared_ptr<Aws::DynamoDB::Model::AttributeValue>> map;
+} DynamoDBJsonContainer;
+
+/* State of the conversion of a json text, while it is being parsed */
+typedef struct DynamoDBJsonBindState
+{
+	Aws::Vector<DynamoDBJsonContainer> stack;	/* enclosing containers,
+												 * innermost last */
+	Aws::DynamoDB::Model::AttributeValue result;
+} DynamoDBJsonBindState;
+
+/* Add a converted value to the container being built, or return it */
+static void
+dynamodb_json_add_value(DynamoDBJsonBindState *state,
+						const Aws::DynamoDB::Model::AttributeValue &value)
+{
+	if (state->stack.empty())
+	{
+		state->result = value;
+		return;
+	}
+
+	DynamoDBJsonContainer &container = state->stack.back();
+
+	if (container.is_object)
+	{
+		/* Like jsonb, keep the last value of a duplicate key */
+		container.map.erase(container.field_name);
+		container.map.emplace(container.field_name,
+							  std::make_shared<Aws::DynamoDB::Model::AttributeValue>(value));
+	}
+	else
+		container.list.push_back(std::make_shared<Aws::DynamoDB::Model::AttributeValue>(value));
+}
+
+static dynamodb_json_action_result
+dynamodb_json_object_start(void *semstate)
+{
+	DynamoDBJsonBindState *state = (DynamoDBJsonBindState *) semstate;
+
+	state->stack.emplace_back();
+	state->stack.back().is_object = true;
+	DYNAMODB_JSON_ACTION_SUCCESS;
+}
+
+static dynamodb_json_action_result
+dynamodb_json_array_start(void *semstate)
+{
+	DynamoDBJsonBindState *state = (DynamoDBJsonBindState *) semstate;
+
+	state->stack.emplace_back();
+	state->stack.back().is_object = false;
+	DYNAMODB_JSON_ACTION_SUCCESS;
+}
+
+static dynamodb_json_action_result
+dynamodb_json_container_end(void *semstate)
+{
+	DynamoDBJsonBindState *state = (DynamoDBJsonBindState *) semstate;
+	Aws::DynamoDB::Model::AttributeValue value;
+
+	if (state->stack.back().is_object)
+		value.SetM(state->stack.back().map);
+	else
+		value.SetL(state->stack.back().list);
+	state->stack.pop_back();
+
+	dynamodb_json_add_value(state, value);
+	DYNAMODB_JSON_ACTION_SUCCESS;
+}
+
+static dynamodb_json_action_result
+dynamodb_json_object_field_start(void *semstate, char *fname, bool isnull)
+{
+	DynamoDBJsonBindState *state = (DynamoDBJsonBindState *) semstate;
+
+	state->stack.back().field_name = fname;
+	DYNAMODB_JSON_ACTION_SUCCESS;
+}
+
+static dynamodb_json_action_result
+dynamodb_json_scalar(void *semstate, char *token, JsonTokenType tokentype)
+{
+	DynamoDBJsonBindState *state = (DynamoDBJsonBindState *) semstate;
+	Aws::DynamoDB::Model::AttributeValue value;
+
+	switch (tokentype)
+	{
+		case JSON_TOKEN_STRING:
+			value.SetS(token);
+			break;
+		case JSON_TOKEN_NUMBER:
+			value.SetN(Aws::String(token));
+			break;
+		case JSON_TOKEN_TRUE:
+			value.SetBool(true);
+			break;
+		case JSON_TOKEN_FALSE:
+			value.SetBool(false);
+			break;
+		default:
+			value.SetNull(true);
+			break;
+	}
+
+	dynamodb_json_add_value(state, value);
+	DYNAMODB_JSON_ACTION_SUCCESS;
+}
+
+/*
+ * dynamodb_bind_json_text
+ *
+ * Convert a json text into a DynamoDB value.  The values are built while
+ * the text is parsed, so it is read only once.
+ *
+ * The parser reports errors with ereport, for instance on a \u0000 escape
+ * which json_in accepts, so the state is allocated with new and deleted
+ * before the error is rethrown: a longjmp would skip the destructors of
+ * its containers.
+ */
+static Aws::DynamoDB::Model::AttributeValue
+dynamodb_bind_json_text(text *json)
+{
+#if PG_VERSION_NUM >= 170000
+	JsonLexContext lex;
+#else
+	JsonLexContext *lex;
+#endif
+	JsonSemAction sem;
+	DynamoDBJsonBindState *state = new DynamoDBJsonBindState();
+
+	memset(&sem, 0, sizeof(sem));
+	sem.semstate = (void *) state;
+	sem.object_start = dynamodb_json_object_start;
+	sem.object_end = dynamodb_json_container_end;
+	sem.array_start = dynamodb_json_array_start;
+	sem.array_end = dynamodb_json_container_end;
+	sem.object_field_start = dynamodb_json_object_field_start;
+	sem.scalar = dynamodb_json_scalar;
+
+	PG_TRY();
+	{
+#if PG_VERSION_NUM >= 170000
+		makeJsonLexContext(&lex, json, true);
+		pg_parse_json_or_ereport(&lex, &sem);
+		freeJsonLexContext(&lex);
+#else
+		lex = makeJsonLexContext(json, true);
+		pg_parse_json_or_ereport(lex, &sem);
+#endif
+	}
+	PG_CATCH();
+	{
+		delete state;
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	Aws::DynamoDB::Model::AttributeValue result(std::move(state->result));
+
+	delete state;
+	return result;
+}
+
 void
 dynamodb_bind_array(Oid element_type, Datum value, Aws::Vector<Aws::String> *vectorValues)
 {
@@ -710,10 +1346,6 @@ dynamodb_bind_array(Oid element_type, Datum value, Aws::Vector<Aws::String> *vec
 			else
 				outputString = TextDatumGetCString(values[i]);
 		}
-		else if (element_type == BYTEAOID)
-		{
-			outputString = dynamodb_convert_byte_datum_to_string(values[i]);
-		}
 		else
 		{
 			getTypeOutputInfo(element_type, &outputFunctionId, &typeVarLength);
@@ -757,8 +1389,10 @@ dynamodb_bind_sql_var(Oid type, int attnum, Datum value, const char *query, bool
 	 		}
 	 	case INT8OID:
 	 		{
-	 			int32		dat = DatumGetInt32(value);
-				value1.SetN(dat);
+	 			char		dat[MAXINT8LEN + 1];
+
+				snprintf(dat, sizeof(dat), INT64_FORMAT, DatumGetInt64(value));
+				value1.SetN(Aws::String(dat));
 	 			break;
 	 		}
 
@@ -861,47 +1495,31 @@ dynamodb_bind_sql_var(Oid type, int attnum, Datum value, const char *query, bool
 	 			break;
 	 		}
 		case JSONOID:
+			{
+				value1 = dynamodb_bind_json_text(DatumGetTextPP(value));
+				break;
+			}
 		case JSONBOID:
 			{
-				char		   *outputString = NULL;
-				Oid				outputFunctionId = InvalidOid;
-				bool			typeVarLength = false;
-				json_t		   *root;
-				json_error_t	error;
-
-				getTypeOutputInfo(type, &outputFunctionId, &typeVarLength);
-				outputString = OidOutputFunctionCall(outputFunctionId, value);
-
-				root = json_loads(outputString, JSON_DECODE_ANY, &error);
+				Jsonb	   *jb = DatumGetJsonbP(value);
+				JsonbValue	jbv;
 
-				value1 = dynamodb_bind_json_value(root, NULL);
+				jbv.type = jbvBinary;
+				jbv.val.binary.data = &jb->root;
+				jbv.val.binary.len = VARSIZE(jb) - VARHDRSZ;
+				value1 = dynamodb_bind_jsonb_value(&jbv);
 				break;
 			}
 			case BYTEAOID:
 			{
-				Aws::Utils::ByteBuffer bytebuf;
-				char 	*bufptr = dynamodb_convert_byte_datum_to_string(value);
-
-				/* Convert string to bytebuf */
-				bytebuf = dynamodb_convert_string_to_bytebuf(bufptr);
-
-				value1.SetB(bytebuf);
+				value1.SetB(dynamodb_convert_bytea_to_bytebuf(value));
 				break;
 			}
 			case BYTEAARRAYOID:
 			{
-				Aws::Vector<Aws::String> vectorValues;
 				Aws::Vector<Aws::Utils::ByteBuffer> vectorBinaryValues;
 
-				dynamodb_bind_array(BYTEAOID, value, &vectorValues);
-
-				/* Convert string vector to byte buffer vector */
-				for (const auto &item : vectorValues)
-				{
-					Aws::Utils::ByteBuffer bytebuf = dynamodb_convert_string_to_bytebuf(item.c_str());
-					vectorBinaryValues.push_back(bytebuf);
-				}
-
+				dynamodb_bind_bytea_array(value, &vectorBinaryValues);
 				value1.SetBS(vectorBinaryValues);
 				break;
 			}
@@ -917,73 +1535,128 @@ dynamodb_bind_sql_var(Oid type, int attnum, Datum value, const char *query, bool
 }
 
 /*
- * dynamodb_convert_bytebuf_to_string
- *
- * Convert a byte buffer to a string
+ * dynamodb_bind_param
  *
+ * Bind the value of a "?" parameter of a remote query.  A value of a type
+ * which dynamodb_bind_sql_var does not convert is sent as a string, as
+ * dynamodb_deparse_const writes a constant of that type.
  */
-static char *dynamodb_convert_bytebuf_to_string(Aws::Utils::ByteBuffer bytebuf)
+Aws::DynamoDB::Model::AttributeValue
+dynamodb_bind_param(Oid type, Datum value, const char *query, bool isnull)
 {
-	size_t 	size = bytebuf.GetLength();
-	char 	*buff = (char *)palloc0(size + 1);
+	Aws::DynamoDB::Model::AttributeValue value1;
+	char	   *outputString;
+	Oid			outputFunctionId;
+	bool		typeVarLength;
 
-	/* Convert unsigned char array to char array */
-	for (size_t i = 0; i < size; i++)
+	switch (type)
 	{
-		buff[i] = bytebuf.GetItem(i);
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case FLOAT4OID:
+		case FLOAT8OID:
+		case NUMERICOID:
+		case BOOLOID:
+		case NUMERICARRAYOID:
+		case FLOAT4ARRAYOID:
+		case FLOAT8ARRAYOID:
+		case INT2ARRAYOID:
+		case INT4ARRAYOID:
+		case INT8ARRAYOID:
+		case TEXTARRAYOID:
+		case VARCHARARRAYOID:
+		case BPCHARARRAYOID:
+		case TEXTOID:
+		case VARCHAROID:
+		case BPCHAROID:
+		case JSONOID:
+		case JSONBOID:
+		case BYTEAOID:
+		case BYTEAARRAYOID:
+			return dynamodb_bind_sql_var(type, 0, value, query, isnull);
+		default:
+			break;
 	}
-	buff[size] = 0;
 
-	return buff;
+	if (isnull)
+	{
+		value1.SetNull(true);
+		return value1;
+	}
+
+	getTypeOutputInfo(type, &outputFunctionId, &typeVarLength);
+	outputString = OidOutputFunctionCall(outputFunctionId, value);
+	value1.SetS(outputString);
+	pfree(outputString);
+
+	return value1;
 }
 
 /*
- * dynamodb_convert_string_to_bytebuf
+ * dynamodb_convert_bytebuf_to_bytea
  *
- * Convert a string to byte buffer
+ * Build a bytea holding the bytes of a byte buffer, with a single copy
  *
  */
-static Aws::Utils::ByteBuffer dynamodb_convert_string_to_bytebuf(const char* str)
+static bytea *
+dynamodb_convert_bytebuf_to_bytea(const Aws::Utils::ByteBuffer &bytebuf)
 {
-	size_t 	size = strlen(str);
-	unsigned char 	*uchar = (unsigned char*) palloc0(size + 1);
+	size_t		size = bytebuf.GetLength();
+	bytea	   *result = (bytea *) palloc(size + VARHDRSZ);
 
-	/* Convert char array to unsigned char array */
-	for (size_t i = 0; i < size; i++)
-	{
-		uchar[i] = str[i];
-	}
-	uchar[size] = 0;
+	memcpy(VARDATA(result), (void *) bytebuf.GetUnderlyingData(), size);
+	SET_VARSIZE(result, size + VARHDRSZ);
 
-	return Aws::Utils::ByteBuffer(uchar, size);
+	return result;
 }
 
 /*
- * dynamodb_convert_byte_datum_to_string
+ * dynamodb_convert_bytea_to_bytebuf
  *
- * Convert a bytea datum to string
+ * Build a byte buffer holding the bytes of a bytea datum.  The length
+ * comes from the varlena header, so zero bytes are kept.
  *
  */
-static char *dynamodb_convert_byte_datum_to_string(Datum value)
+static Aws::Utils::ByteBuffer
+dynamodb_convert_bytea_to_bytebuf(Datum value)
 {
-	int 	len;
-	char 	*dat = NULL;
-	char 	*bufptr;
-	char 	*result = DatumGetPointer(value);
+	bytea	   *dat = DatumGetByteaPP(value);
 
-	if (VARATT_IS_1B(result))
-	{
-		len = VARSIZE_1B(result) - VARHDRSZ_SHORT;
-		dat = VARDATA_1B(result);
-	}
-	else
-	{
-		len = VARSIZE_4B(result) - VARHDRSZ;
-		dat = VARDATA_4B(result);
-	}
+	return Aws::Utils::ByteBuffer((unsigned char *) VARDATA_ANY(dat),
+								  VARSIZE_ANY_EXHDR(dat));
+}
+
+/*
+ * dynamodb_bind_bytea_array
+ *
+ * Build the byte buffers of a binary set from the elements of a bytea[]
+ *
+ */
+static void
+dynamodb_bind_bytea_array(Datum value, Aws::Vector<Aws::Utils::ByteBuffer> *vectorValues)
+{
+	ArrayType  *arr;
+	Datum      *values;
+	bool       *nulls;
+	int         num;
+	int16		elmlen;
+	bool		elmbyval;
+	char		elmalign;
 
-	bufptr = (char *)palloc0(len + 1);
-	memcpy(bufptr, (char *)dat, len);
+	arr = DatumGetArrayTypeP(value);
+	get_typlenbyvalalign(BYTEAOID, &elmlen, &elmbyval, &elmalign);
+
+	deconstruct_array(arr, BYTEAOID, elmlen, elmbyval, elmalign, &values, &nulls, &num);
+
+	if (num == 0)
+		elog(ERROR, "DynamoDB does not support empty set");
 
-	return bufptr;
+	for (int i = 0; i < num; i++)
+	{
+		if (nulls[i])
+			vectorValues->push_back(Aws::Utils::ByteBuffer());
+		else
+			vectorValues->push_back(dynamodb_convert_bytea_to_bytebuf(values[i]));
+	}
 }
@@ -19,8 +19,67 @@ extern "C"
 #include <aws/core/Aws.h>
 #include <aws/dynamodb/DynamoDBClient.h>
 
-Datum
-dynamodb_convert_to_pg(Oid pgtyp, int pgtypmod, Aws::DynamoDB::Model::AttributeValue dynamodbVal);
+struct DynamoDBColumnConverter;
+
+/* Conversion of a DynamoDB value of a given type into a column's type */
+typedef Datum (*DynamoDBConvertFunc) (const struct DynamoDBColumnConverter *conv,
+									 const Aws::DynamoDB::Model::AttributeValue &dynamodbVal);
+
+/*
+ * Parsing of the text of a DynamoDB number, or of a set element, into a
+ * value of a given type, with the type's input function as the fallback
+ */
+typedef Datum (*DynamoDBParseFunc) (const FmgrInfo *input, Oid typioparam,
+									int32 typmod, const Aws::String &str);
+
+/* Number of DynamoDB value types, NULLVALUE being the last one */
+#define DYNAMODB_NUM_VALUE_TYPES ((int) Aws::DynamoDB::Model::ValueType::NULLVALUE + 1)
+
+/*
+ * DynamoDBColumnConverter
+ *
+ * How to convert the values of a column fetched from DynamoDB.  The type of
+ * a DynamoDB value is only known when it is read, so a routine is selected
+ * for each DynamoDB value type when the scan starts, and the input functions
+ * they need are looked up once.
+ */
+typedef struct DynamoDBColumnConverter
+{
+	Oid			pgtype;			/* type of the column */
+	FmgrInfo	typinput;		/* input function of the column's type */
+	Oid			typioparam;
+	int32		typmod;			/* typmod of the column */
+	DynamoDBParseFunc parse;	/* parses numbers into the column's type */
+
+	/* element of the array built from a DynamoDB set, if any */
+	Oid			elmtype;
+	int16		elmlen;
+	bool		elmbyval;
+	char		elmalign;
+	FmgrInfo	elminput;
+	Oid			elmioparam;
+	int32		elmtypmod;
+	DynamoDBParseFunc elmparse;	/* parses the elements of sets */
+
+	DynamoDBConvertFunc convert[DYNAMODB_NUM_VALUE_TYPES];
+} DynamoDBColumnConverter;
+
+void
+dynamodb_init_column_converter(DynamoDBColumnConverter *conv, Oid pgtyp,
+							   int32 pgtypmod);
+
+/*
+ * dynamodb_convert_to_pg: Convert DynamoDB data into PostgreSQL's compatible data types
+ */
+static inline Datum
+dynamodb_convert_to_pg(const DynamoDBColumnConverter *conv,
+					   const Aws::DynamoDB::Model::AttributeValue &dynamodbVal)
+{
+	return conv->convert[(int) dynamodbVal.GetType()](conv, dynamodbVal);
+}
+
+Aws::DynamoDB::Model::AttributeValue
+dynamodb_bind_sql_var(Oid type, int attnum, Datum value, const char * query, bool isnull);
 
 Aws::DynamoDB::Model::AttributeValue
-dynamodb_bind_sql_var(Oid type, int attnum, Datum value, const char * query, bool isnull);
\ No newline at end of file
+dynamodb_bind_param(Oid type, Datum value, const char *query, bool isnull);
\ No newline at end of file
@@ -0,0 +1,315 @@
+/*-------------------------------------------------------------------------
+ *
+ * dynamodb_write.cpp
+ *		  Background batch writes for dynamodb_fdw
+ *
+ * Nothing in this file may call into PostgreSQL: the writer's workers run
+ * outside the backend's main thread.  Errors are handed back to the backend,
+ * which reports them from the main thread.
+ *
+ * Portions Copyright (c) 2021, TOSHIBA CORPORATION
+ *
+ * IDENTIFICATION
+ *		  contrib/dynamodb_fdw/dynamodb_write.cpp
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <chrono>
+#include <exception>
+#include <pthread.h>
+#include <signal.h>
+
+#include <aws/core/utils/StringUtils.h>
+
+#include "dynamodb_write.hpp"
+
+using namespace Aws::DynamoDB;
+
+/*
+ * Statements which failed because of throttling are sent again, after an
+ * exponential backoff, at most this many times.
+ */
+#define DYNAMODB_WRITE_MAX_RETRIES		10
+#define DYNAMODB_WRITE_RETRY_BASE_MS	50
+
+static bool dynamodb_batch_error_is_retryable(Model::BatchStatementErrorCodeEnum code);
+
+DynamoDBBatchWriter::DynamoDBBatchWriter(DynamoDBClient *conn, int max_in_flight)
+	: conn(conn), max_in_flight(max_in_flight > 0 ? max_in_flight : 1),
+	  sending(0), failed(false), cancelled(false)
+{
+	current.reserve(DYNAMODB_MAX_BATCH_STATEMENTS);
+}
+
+/*
+ * Stop the workers.  The requests already sent are completed first, the
+ * queued ones are dropped.
+ */
+DynamoDBBatchWriter::~DynamoDBBatchWriter()
+{
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+
+		cancelled = true;
+	}
+	not_empty.notify_all();
+	changed.notify_all();
+
+	for (auto &worker : workers)
+	{
+		if (worker.joinable())
+			worker.join();
+	}
+}
+
+/*
+ * Launch the worker threads.  May throw std::system_error.
+ */
+void
+DynamoDBBatchWriter::start()
+{
+	for (size_t i = 0; i < max_in_flight; i++)
+		workers.push_back(std::thread(&DynamoDBBatchWriter::worker_main, this));
+}
+
+/*
+ * wait_ready
+ *
+ * Wait up to timeout_ms until the queue has room for one more batch, so
+ * that add() does not let it grow without bound.
+ */
+DynamoDBWriteStatus
+DynamoDBBatchWriter::wait_ready(Aws::String &message, long timeout_ms)
+{
+	std::unique_lock<std::mutex> guard(mutex);
+
+	if (!changed.wait_for(guard, std::chrono::milliseconds(timeout_ms),
+						  [this] { return failed || queue.size() < max_in_flight; }))
+		return DYNAMODB_WRITE_PENDING;
+
+	if (failed)
+	{
+		message = error;
+		return DYNAMODB_WRITE_ERROR;
+	}
+
+	return DYNAMODB_WRITE_READY;
+}
+
+/*
+ * add
+ *
+ * Add a statement to the current batch, and queue the batch once it is
+ * full.
+ */
+void
+DynamoDBBatchWriter::add(const Model::BatchStatementRequest &statement)
+{
+	current.push_back(statement);
+
+	if (current.size() >= DYNAMODB_MAX_BATCH_STATEMENTS)
+		flush();
+}
+
+/*
+ * flush
+ *
+ * Queue the current batch, even if it is not full.
+ */
+void
+DynamoDBBatchWriter::flush()
+{
+	if (current.empty())
+		return;
+
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+
+		queue.push_back(std::move(current));
+	}
+	not_empty.notify_one();
+
+	current = DynamoDBStatementBatch();
+	current.reserve(DYNAMODB_MAX_BATCH_STATEMENTS);
+}
+
+/*
+ * wait_done
+ *
+ * Wait up to timeout_ms until all the queued batches have been written.
+ */
+DynamoDBWriteStatus
+DynamoDBBatchWriter::wait_done(Aws::String &message, long timeout_ms)
+{
+	std::unique_lock<std::mutex> guard(mutex);
+
+	if (!changed.wait_for(guard, std::chrono::milliseconds(timeout_ms),
+						  [this] { return failed || (queue.empty() && sending == 0); }))
+		return DYNAMODB_WRITE_PENDING;
+
+	if (failed)
+	{
+		message = error;
+		return DYNAMODB_WRITE_ERROR;
+	}
+
+	return DYNAMODB_WRITE_READY;
+}
+
+void
+DynamoDBBatchWriter::worker_main()
+{
+	sigset_t	sigs;
+
+	/* Signals must only be handled by the backend's main thread. */
+	sigfillset(&sigs);
+	pthread_sigmask(SIG_BLOCK, &sigs, NULL);
+
+	for (;;)
+	{
+		DynamoDBStatementBatch batch;
+		Aws::String message;
+		bool		ok;
+
+		{
+			std::unique_lock<std::mutex> guard(mutex);
+
+			not_empty.wait(guard, [this] { return cancelled || !queue.empty(); });
+			if (cancelled)
+				return;
+
+			batch = std::move(queue.front());
+			queue.pop_front();
+			sending++;
+		}
+		changed.notify_all();
+
+		/*
+		 * An exception must not escape the thread, which would terminate the
+		 * whole backend: it fails the write like a failed request does.
+		 */
+		try
+		{
+			ok = send_batch(batch, message);
+		}
+		catch (const std::exception &e)
+		{
+			ok = false;
+			message = e.what();
+		}
+		catch (...)
+		{
+			ok = false;
+			message = "unexpected exception while writing a batch";
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+
+			sending--;
+			if (!ok && !failed)
+			{
+				failed = true;
+				error = message;
+				queue.clear();
+			}
+		}
+		changed.notify_all();
+	}
+}
+
+/*
+ * send_batch
+ *
+ * Send one BatchExecuteStatement request.  DynamoDB reports the result of
+ * each statement separately, in the order of the request; the statements
+ * which were throttled are sent again, any other failure is an error.
+ */
+bool
+DynamoDBBatchWriter::send_batch(DynamoDBStatementBatch &batch, Aws::String &message)
+{
+	long		delay_ms = DYNAMODB_WRITE_RETRY_BASE_MS;
+
+	for (int attempt = 1;; attempt++)
+	{
+		Model::BatchExecuteStatementRequest req;
+		Model::BatchExecuteStatementOutcome outcome;
+		DynamoDBStatementBatch unprocessed;
+
+		req.SetStatements(batch);
+		outcome = conn->BatchExecuteStatement(req);
+		if (!outcome.IsSuccess())
+		{
+			message = outcome.GetError().GetMessage();
+			return false;
+		}
+
+		const Aws::Vector<Model::BatchStatementResponse> &responses =
+			outcome.GetResult().GetResponses();
+
+		for (size_t i = 0; i < responses.size() && i < batch.size(); i++)
+		{
+			if (!responses[i].ErrorHasBeenSet())
+				continue;
+
+			const Model::BatchStatementError &stmt_error = responses[i].GetError();
+
+			if (!dynamodb_batch_error_is_retryable(stmt_error.GetCode()))
+			{
+				message = stmt_error.GetMessage();
+				return false;
+			}
+			unprocessed.push_back(batch[i]);
+		}
+
+		if (unprocessed.empty())
+			return true;
+
+		if (attempt > DYNAMODB_WRITE_MAX_RETRIES)
+		{
+			message = "could not write " +
+				Aws::Utils::StringUtils::to_string(unprocessed.size()) +
+				" items after " + Aws::Utils::StringUtils::to_string(attempt) +
+				" attempts, the provisioned write capacity of the table may be too low";
+			return false;
+		}
+
+		/* Back off before sending the throttled statements again */
+		{
+			std::unique_lock<std::mutex> guard(mutex);
+
+			if (changed.wait_for(guard, std::chrono::milliseconds(delay_ms),
+								 [this] { return cancelled; }))
+			{
+				message = "cancelled";
+				return false;
+			}
+		}
+		delay_ms *= 2;
+
+		batch = std::move(unprocessed);
+	}
+}
+
+/*
+ * dynamodb_batch_error_is_retryable
+ *
+ * Can a statement of a batch which failed with this error be sent again?
+ * Only throttling guarantees that the statement was not executed.  After
+ * an internal server error or a transaction conflict, the INSERT may have
+ * been applied, and sending it again would fail on the duplicate key.
+ */
+static bool
+dynamodb_batch_error_is_retryable(Model::BatchStatementErrorCodeEnum code)
+{
+	switch (code)
+	{
+		case Model::BatchStatementErrorCodeEnum::ProvisionedThroughputExceeded:
+		case Model::BatchStatementErrorCodeEnum::RequestLimitExceeded:
+		case Model::BatchStatementErrorCodeEnum::ThrottlingError:
+			return true;
+		default:
+			return false;
+	}
+}
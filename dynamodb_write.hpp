@@ -0,0 +1,88 @@
+/*-------------------------------------------------------------------------
+ *
+ * dynamodb_write.hpp
+ *		  Background batch writes for dynamodb_fdw
+ *
+ * Portions Copyright (c) 2021, TOSHIBA CORPORATION
+ *
+ * IDENTIFICATION
+ *		  contrib/dynamodb_fdw/dynamodb_write.hpp
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __DYNAMODB_WRITE_HPP__
+#define __DYNAMODB_WRITE_HPP__
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <aws/core/Aws.h>
+#include <aws/dynamodb/DynamoDBClient.h>
+#include <aws/dynamodb/model/BatchExecuteStatementRequest.h>
+
+/* Maximum number of statements in a BatchExecuteStatement request */
+#define DYNAMODB_MAX_BATCH_STATEMENTS	25
+
+typedef Aws::Vector<Aws::DynamoDB::Model::BatchStatementRequest> DynamoDBStatementBatch;
+
+/* Result of waiting for the batch writer */
+typedef enum DynamoDBWriteStatus
+{
+	DYNAMODB_WRITE_READY,		/* the writer can take more statements, or
+								 * all of them have been written */
+	DYNAMODB_WRITE_PENDING,		/* timed out, the writer is still busy */
+	DYNAMODB_WRITE_ERROR		/* a statement failed */
+} DynamoDBWriteStatus;
+
+/*
+ * DynamoDBBatchWriter
+ *
+ * Group statements into BatchExecuteStatement requests, and send them from
+ * worker threads, so that several requests are in flight while the backend
+ * produces the next rows.  The statements which DynamoDB throttles are sent
+ * again after a backoff.
+ *
+ * At most "max_in_flight" requests are sent at the same time, and as many
+ * more wait in the queue.  The worker threads only touch AWS SDK objects;
+ * they must never call into the backend (palloc, elog, ...).  Once a
+ * statement has failed, the statements which were not sent yet are dropped.
+ */
+class DynamoDBBatchWriter
+{
+public:
+	DynamoDBBatchWriter(Aws::DynamoDB::DynamoDBClient *conn, int max_in_flight);
+	~DynamoDBBatchWriter();
+
+	void		start();
+	DynamoDBWriteStatus wait_ready(Aws::String &message, long timeout_ms);
+	void		add(const Aws::DynamoDB::Model::BatchStatementRequest &statement);
+	void		flush();
+	DynamoDBWriteStatus wait_done(Aws::String &message, long timeout_ms);
+
+private:
+	void		worker_main();
+	bool		send_batch(DynamoDBStatementBatch &batch, Aws::String &message);
+
+	Aws::DynamoDB::DynamoDBClient *conn;
+	size_t		max_in_flight;
+
+	DynamoDBStatementBatch current;		/* batch being filled, only used by
+										 * the backend */
+
+	std::mutex	mutex;
+	std::condition_variable not_empty;	/* signalled when a batch is queued */
+	std::condition_variable changed;	/* signalled when a batch is taken or
+										 * done */
+	std::deque<DynamoDBStatementBatch> queue;
+	size_t		sending;				/* number of batches being sent */
+	bool		failed;					/* a statement failed */
+	bool		cancelled;				/* the writer is being destroyed */
+	Aws::String error;
+
+	std::vector<std::thread> workers;
+};
+
+#endif /* __DYNAMODB_WRITE_HPP__ */
@@ -20,7 +20,9 @@
 #include "commands/extension.h"
 #include "dynamodb_fdw.h"
 #include "miscadmin.h"
+#include "parser/scansup.h"
 #include "utils/builtins.h"
+#include "utils/guc.h"
 #include "utils/varlena.h"
 #include "utils/lsyscache.h"
 
@@ -37,6 +39,8 @@ struct DynamodbFdwOption
  * Helper functions
  */
 static bool is_valid_option(const char *option, Oid context);
+static char *dynamodb_index_token(const char *value, const char **ptr, bool *is_ident);
+static void dynamodb_invalid_indexes(const char *value) pg_attribute_noreturn();
 /*
  * Valid options for dynamodb_fdw.
  */
@@ -51,6 +55,26 @@ static struct DynamodbFdwOption valid_options[] =
 	{"password", UserMappingRelationId},
 	{"table_name", ForeignTableRelationId},
 	{"column_name", AttributeRelationId},
+	/* Secondary indexes which the planner may read instead of the table */
+	{"indexes", ForeignTableRelationId},
+	/* Prefetch options, a table-level value overrides the server one */
+	{"prefetch_depth", ForeignServerRelationId},
+	{"prefetch_depth", ForeignTableRelationId},
+	{"prefetch_memory_limit", ForeignServerRelationId},
+	{"prefetch_memory_limit", ForeignTableRelationId},
+	/* Number of workers of a parallel scan */
+	{"parallel_workers", ForeignTableRelationId},
+	/* Asynchronous execution, a table-level value overrides the server one */
+	{"async_capable", ForeignServerRelationId},
+	{"async_capable", ForeignTableRelationId},
+	/* Remote size estimates, a table-level value overrides the server one */
+	{"use_remote_estimate", ForeignServerRelationId},
+	{"use_remote_estimate", ForeignTableRelationId},
+	{"remote_estimate_ttl", ForeignServerRelationId},
+	{"remote_estimate_ttl", ForeignTableRelationId},
+	/* Number of rows inserted per batch, a table-level value overrides the server one */
+	{"batch_size", ForeignServerRelationId},
+	{"batch_size", ForeignTableRelationId},
 	/* Sentinel */
 	{NULL, InvalidOid}
 };
@@ -131,6 +155,68 @@ dynamodb_fdw_validator(PG_FUNCTION_ARGS)
 					 : errhint("There are no valid options in this context.")));
 #endif
 		}
+
+		if (strcmp(def->defname, "prefetch_depth") == 0 ||
+			strcmp(def->defname, "parallel_workers") == 0)
+		{
+			int			val;
+
+			if (!parse_int(defGetString(def), &val, 0, NULL) || val < 0)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("dynamodb_fdw: invalid value for option \"%s\": \"%s\"",
+								def->defname, defGetString(def)),
+						 errhint("Valid values are non-negative integers.")));
+		}
+		else if (strcmp(def->defname, "batch_size") == 0)
+		{
+			int			val;
+
+			if (!parse_int(defGetString(def), &val, 0, NULL) || val <= 0)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("dynamodb_fdw: invalid value for option \"%s\": \"%s\"",
+								def->defname, defGetString(def)),
+						 errhint("Valid values are positive integers.")));
+		}
+		else if (strcmp(def->defname, "async_capable") == 0 ||
+				 strcmp(def->defname, "use_remote_estimate") == 0)
+		{
+			/* these accept only boolean values */
+			(void) defGetBoolean(def);
+		}
+		else if (strcmp(def->defname, "indexes") == 0)
+		{
+			/* raises an error if the value is malformed */
+			(void) dynamodb_parse_indexes(defGetString(def));
+		}
+		else if (strcmp(def->defname, "prefetch_memory_limit") == 0)
+		{
+			int			limit;
+			const char *hintmsg;
+
+			/* Accept memory units the same way as work_mem does */
+			if (!parse_int(defGetString(def), &limit, GUC_UNIT_KB, &hintmsg) || limit <= 0)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("dynamodb_fdw: invalid value for option \"%s\": \"%s\"",
+								def->defname, defGetString(def)),
+						 hintmsg ? errhint("%s", _(hintmsg)) : 0));
+		}
+		else if (strcmp(def->defname, "remote_estimate_ttl") == 0)
+		{
+			int			ttl;
+			const char *hintmsg;
+
+			/* Accept time units, in seconds by default */
+			if (!parse_int(defGetString(def), &ttl, GUC_UNIT_S, &hintmsg) || ttl < 0)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("dynamodb_fdw: invalid value for option \"%s\": \"%s\"",
+								def->defname, defGetString(def)),
+						 hintmsg ? errhint("%s", _(hintmsg)) :
+						 errhint("Valid values are non-negative durations.")));
+		}
 	}
 	PG_RETURN_VOID();
 }
@@ -178,14 +264,31 @@ dynamodb_opt *dynamodb_get_options(Oid foreignoid, Oid userid)
 	}
 	PG_END_TRY();
 
+	/*
+	 * Table options come last so that they override the server ones for the
+	 * options which are accepted at both levels.
+	 */
 	options = NIL;
-	if (f_table)
-		options = list_concat(options, f_table->options);
 	options = list_concat(options, f_server->options);
 
 	f_mapping = GetUserMapping(userid, f_server->serverid);
 	options = list_concat(options, f_mapping->options);
 
+	if (f_table)
+		options = list_concat(options, f_table->options);
+
+	/* Default values of the prefetch options */
+	opt->prefetch_depth = 0;
+	opt->prefetch_memory_limit = 64 * 1024;
+
+	/* Let the planner choose the number of parallel workers by default */
+	opt->parallel_workers = -1;
+	opt->async_capable = false;
+
+	/* DescribeTable is only called if asked to, and reused for 5 minutes */
+	opt->use_remote_estimate = false;
+	opt->remote_estimate_ttl = 300;
+
 	/* Loop through the options, and get the server/port */
 	foreach(lc, options)
 	{
@@ -205,6 +308,29 @@ dynamodb_opt *dynamodb_get_options(Oid foreignoid, Oid userid)
 		
 		if (strcmp(def->defname, "sort_key") == 0)
 			opt->svr_sort_key = defGetString(def);
+
+		if (strcmp(def->defname, "prefetch_depth") == 0)
+			(void) parse_int(defGetString(def), &opt->prefetch_depth, 0, NULL);
+
+		if (strcmp(def->defname, "prefetch_memory_limit") == 0)
+			(void) parse_int(defGetString(def), &opt->prefetch_memory_limit,
+							 GUC_UNIT_KB, NULL);
+
+		if (strcmp(def->defname, "parallel_workers") == 0)
+			(void) parse_int(defGetString(def), &opt->parallel_workers, 0, NULL);
+
+		if (strcmp(def->defname, "async_capable") == 0)
+			opt->async_capable = defGetBoolean(def);
+
+		if (strcmp(def->defname, "indexes") == 0)
+			opt->indexes = dynamodb_parse_indexes(defGetString(def));
+
+		if (strcmp(def->defname, "use_remote_estimate") == 0)
+			opt->use_remote_estimate = defGetBoolean(def);
+
+		if (strcmp(def->defname, "remote_estimate_ttl") == 0)
+			(void) parse_int(defGetString(def), &opt->remote_estimate_ttl,
+							 GUC_UNIT_S, NULL);
 	}
 
 	/* Default values, if required */
@@ -213,3 +339,206 @@ dynamodb_opt *dynamodb_get_options(Oid foreignoid, Oid userid)
 
 	return opt;
 }
+
+/*
+ * Fetch the batch_size option of a foreign table.
+ *
+ * Unlike dynamodb_get_options, this does not need a user mapping, so that
+ * it can be used by EXPLAIN.
+ */
+int
+dynamodb_get_batch_size_option(Oid foreigntableid)
+{
+	ForeignTable *table = GetForeignTable(foreigntableid);
+	ForeignServer *server = GetForeignServer(table->serverid);
+	List	   *options;
+	ListCell   *lc;
+
+	/* By default, rows are inserted one at a time */
+	int			batch_size = 1;
+
+	/* The table option overrides the server one */
+	options = NIL;
+	options = list_concat(options, server->options);
+	options = list_concat(options, table->options);
+
+	foreach(lc, options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "batch_size") == 0)
+			(void) parse_int(defGetString(def), &batch_size, 0, NULL);
+	}
+
+	return batch_size;
+}
+
+/*
+ * Parse the value of the "indexes" option, a comma-separated list of
+ *
+ *		name (partition_key [, sort_key]) [ALL | KEYS_ONLY | INCLUDE (attribute [, ...])]
+ *
+ * which gives the secondary indexes of the table, their keys and the
+ * attributes projected into them, ALL by default.  Names are case-sensitive,
+ * and may be double-quoted.
+ *
+ * Returns a list of DynamoDBIndex, or raises an ERROR if the value is
+ * malformed.
+ */
+List *
+dynamodb_parse_indexes(const char *value)
+{
+	List	   *indexes = NIL;
+	const char *ptr = value;
+	char	   *token;
+	bool		is_ident;
+
+	for (;;)
+	{
+		DynamoDBIndex *index = (DynamoDBIndex *) palloc0(sizeof(DynamoDBIndex));
+
+		/* name (partition_key [, sort_key]) */
+		index->name = dynamodb_index_token(value, &ptr, &is_ident);
+		if (index->name == NULL || !is_ident)
+			dynamodb_invalid_indexes(value);
+
+		token = dynamodb_index_token(value, &ptr, &is_ident);
+		if (token == NULL || is_ident || strcmp(token, "(") != 0)
+			dynamodb_invalid_indexes(value);
+
+		index->partition_key = dynamodb_index_token(value, &ptr, &is_ident);
+		if (index->partition_key == NULL || !is_ident)
+			dynamodb_invalid_indexes(value);
+
+		token = dynamodb_index_token(value, &ptr, &is_ident);
+		if (token != NULL && !is_ident && strcmp(token, ",") == 0)
+		{
+			index->sort_key = dynamodb_index_token(value, &ptr, &is_ident);
+			if (index->sort_key == NULL || !is_ident)
+				dynamodb_invalid_indexes(value);
+			token = dynamodb_index_token(value, &ptr, &is_ident);
+		}
+		if (token == NULL || is_ident || strcmp(token, ")") != 0)
+			dynamodb_invalid_indexes(value);
+
+		/* [ALL | KEYS_ONLY | INCLUDE (attribute [, ...])] */
+		index->projection = DYNAMODB_PROJECTION_ALL;
+		token = dynamodb_index_token(value, &ptr, &is_ident);
+		if (token != NULL && is_ident)
+		{
+			if (pg_strcasecmp(token, "ALL") == 0)
+				index->projection = DYNAMODB_PROJECTION_ALL;
+			else if (pg_strcasecmp(token, "KEYS_ONLY") == 0)
+				index->projection = DYNAMODB_PROJECTION_KEYS_ONLY;
+			else if (pg_strcasecmp(token, "INCLUDE") == 0)
+			{
+				index->projection = DYNAMODB_PROJECTION_INCLUDE;
+
+				token = dynamodb_index_token(value, &ptr, &is_ident);
+				if (token == NULL || is_ident || strcmp(token, "(") != 0)
+					dynamodb_invalid_indexes(value);
+
+				do
+				{
+					token = dynamodb_index_token(value, &ptr, &is_ident);
+					if (token == NULL || !is_ident)
+						dynamodb_invalid_indexes(value);
+					index->include_attrs = lappend(index->include_attrs,
+												   makeString(token));
+
+					token = dynamodb_index_token(value, &ptr, &is_ident);
+					if (token == NULL || is_ident)
+						dynamodb_invalid_indexes(value);
+				} while (strcmp(token, ",") == 0);
+
+				if (strcmp(token, ")") != 0)
+					dynamodb_invalid_indexes(value);
+			}
+			else
+				dynamodb_invalid_indexes(value);
+
+			token = dynamodb_index_token(value, &ptr, &is_ident);
+		}
+
+		indexes = lappend(indexes, index);
+
+		/* Another index follows a comma */
+		if (token == NULL)
+			break;
+		if (is_ident || strcmp(token, ",") != 0)
+			dynamodb_invalid_indexes(value);
+	}
+
+	return indexes;
+}
+
+/*
+ * Return the next token of the "indexes" option value at *ptr, and advance
+ * *ptr past it, or return NULL at the end of the value.  A token is either
+ * a name, possibly double-quoted, or one of the characters "(", ")" and ",".
+ */
+static char *
+dynamodb_index_token(const char *value, const char **ptr, bool *is_ident)
+{
+	const char *p = *ptr;
+	StringInfoData buf;
+
+	while (scanner_isspace(*p))
+		p++;
+
+	if (*p == '\0')
+	{
+		*ptr = p;
+		return NULL;
+	}
+
+	initStringInfo(&buf);
+	if (*p == '(' || *p == ')' || *p == ',')
+	{
+		*is_ident = false;
+		appendStringInfoChar(&buf, *p++);
+	}
+	else if (*p == '"')
+	{
+		/* A doubled quote stands for a quote in a quoted name */
+		*is_ident = true;
+		for (p++;; p++)
+		{
+			if (*p == '\0')
+				dynamodb_invalid_indexes(value);
+			if (*p == '"')
+			{
+				if (p[1] != '"')
+					break;
+				p++;
+			}
+			appendStringInfoChar(&buf, *p);
+		}
+		p++;
+		if (buf.len == 0)
+			dynamodb_invalid_indexes(value);
+	}
+	else
+	{
+		*is_ident = true;
+		while (*p != '\0' && !scanner_isspace(*p) &&
+			   *p != '(' && *p != ')' && *p != ',' && *p != '"')
+			appendStringInfoChar(&buf, *p++);
+	}
+
+	*ptr = p;
+	return buf.data;
+}
+
+/*
+ * Complain about a malformed value of the "indexes" option.
+ */
+static void
+dynamodb_invalid_indexes(const char *value)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			 errmsg("dynamodb_fdw: invalid value for option \"indexes\": \"%s\"",
+					value),
+			 errhint("Each index is given as: name (partition_key [, sort_key]) [ALL | KEYS_ONLY | INCLUDE (attribute [, ...])]")));
+}
@@ -2094,6 +2094,165 @@ SELECT belem, barray FROM binary_type; -- failed
 --Testcase 706:
 DROP FOREIGN TABLE binary_type;
 
+-- Tables of server_option_tbl, shared by the tests below.  The sort key of
+-- server_option_sorted has the "C" collation, so it compares as DynamoDB does.
+--Testcase 713:
+CREATE FOREIGN TABLE server_option_tbl (artist text, songtitle text, albumtitle text)
+  SERVER dynamodb_server OPTIONS (table_name 'server_option_tbl', partition_key 'artist', sort_key 'songtitle');
+--Testcase 714:
+CREATE FOREIGN TABLE server_option_sorted (artist text, songtitle text COLLATE "C", albumtitle text)
+  SERVER dynamodb_server OPTIONS (table_name 'server_option_tbl', partition_key 'artist', sort_key 'songtitle');
+
+-- Lookups by primary key with GetItem and BatchGetItem
+--Testcase 715:
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT artist, songtitle, albumtitle FROM server_option_tbl WHERE artist = 'Acme Band' AND songtitle = 'Happy Day';
+--Testcase 716:
+SELECT artist, songtitle, albumtitle FROM server_option_tbl WHERE artist = 'Acme Band' AND songtitle = 'Happy Day';
+--Testcase 717:
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT artist, songtitle, albumtitle FROM server_option_tbl WHERE artist IN ('Acme Band', 'No One You Know', 'Nobody') AND songtitle IN ('Happy Day', 'Call Me Today');
+--Testcase 718:
+SELECT artist, songtitle, albumtitle FROM server_option_tbl WHERE artist IN ('Acme Band', 'No One You Know', 'Nobody') AND songtitle IN ('Happy Day', 'Call Me Today') ORDER BY 1, 2;
+
+-- Parameterized scans of nested-loop joins on the key
+--Testcase 719:
+CREATE TABLE local_keys (artist text, songtitle text);
+--Testcase 720:
+INSERT INTO local_keys VALUES ('Acme Band', 'Happy Day'), ('No One You Know', 'Call Me Today'), ('No One You Know', 'Call Me Today');
+--Testcase 721:
+ANALYZE local_keys;
+--Testcase 722:
+SET enable_hashjoin = off;
+--Testcase 723:
+SET enable_mergejoin = off;
+--Testcase 724:
+SET enable_material = off;
+--Testcase 726:
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT k.artist, t.songtitle, t.albumtitle FROM local_keys k JOIN server_option_tbl t ON t.artist = k.artist;
+--Testcase 727:
+SELECT k.artist, t.songtitle, t.albumtitle FROM local_keys k JOIN server_option_tbl t ON t.artist = k.artist ORDER BY 1, 2;
+--Testcase 728:
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT k.artist, t.songtitle, t.albumtitle FROM local_keys k JOIN server_option_tbl t ON t.artist = k.artist AND t.songtitle = k.songtitle;
+--Testcase 729:
+SELECT k.artist, t.songtitle, t.albumtitle FROM local_keys k JOIN server_option_tbl t ON t.artist = k.artist AND t.songtitle = k.songtitle ORDER BY 1, 2;
+--Testcase 731:
+RESET enable_material;
+--Testcase 732:
+RESET enable_mergejoin;
+--Testcase 733:
+RESET enable_hashjoin;
+--Testcase 734:
+DROP TABLE local_keys;
+
+-- Parameters and stable expressions sent as ? parameters
+--Testcase 735:
+SET plan_cache_mode = force_generic_plan;
+--Testcase 736:
+PREPARE song(text, text) AS
+SELECT artist, songtitle, albumtitle FROM server_option_tbl WHERE artist = $1 AND songtitle = $2;
+--Testcase 737:
+EXPLAIN (VERBOSE, COSTS OFF) EXECUTE song('Acme Band', 'Happy Day');
+--Testcase 738:
+EXECUTE song('Acme Band', 'Happy Day');
+--Testcase 739:
+EXECUTE song('Acme Band', NULL);
+--Testcase 740:
+PREPARE artists(text, text) AS
+SELECT artist, songtitle, albumtitle FROM server_option_tbl WHERE artist IN ($1, $2) ORDER BY 1, 2;
+--Testcase 741:
+EXPLAIN (VERBOSE, COSTS OFF) EXECUTE artists('No One You Know', NULL);
+--Testcase 742:
+EXECUTE artists('No One You Know', NULL);
+--Testcase 743:
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT artist, songtitle, albumtitle FROM server_option_tbl WHERE albumtitle <> now()::text;
+--Testcase 744:
+SELECT artist, songtitle, albumtitle FROM server_option_tbl WHERE albumtitle <> now()::text ORDER BY 1, 2;
+--Testcase 745:
+DEALLOCATE song;
+--Testcase 746:
+DEALLOCATE artists;
+--Testcase 747:
+RESET plan_cache_mode;
+
+-- Reads of a secondary index
+--Testcase 748:
+CREATE FOREIGN TABLE server_option_idx (artist text, songtitle text, albumtitle text, genre text)
+  SERVER dynamodb_server OPTIONS (table_name 'server_option_tbl', partition_key 'artist', sort_key 'songtitle',
+                                 indexes 'album_index (albumtitle) KEYS_ONLY');
+--Testcase 749:
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT artist, songtitle FROM server_option_idx WHERE albumtitle = 'Somewhat Famous';
+--Testcase 750:
+SELECT artist, songtitle FROM server_option_idx WHERE albumtitle = 'Somewhat Famous';
+--Testcase 751:
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT artist, genre FROM server_option_idx WHERE albumtitle = 'Somewhat Famous';
+--Testcase 752:
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT artist, songtitle FROM server_option_idx WHERE artist = 'Acme Band' AND albumtitle = 'Songs About Life';
+--Testcase 753:
+DROP FOREIGN TABLE server_option_idx;
+
+-- ORDER BY on the sort key pushed down
+--Testcase 754:
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT artist, songtitle, albumtitle FROM server_option_sorted WHERE artist = 'No One You Know' ORDER BY songtitle;
+--Testcase 755:
+SELECT artist, songtitle, albumtitle FROM server_option_sorted WHERE artist = 'No One You Know' ORDER BY songtitle;
+--Testcase 756:
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT artist, songtitle, albumtitle FROM server_option_sorted WHERE artist = 'No One You Know' ORDER BY songtitle DESC;
+--Testcase 757:
+SELECT artist, songtitle, albumtitle FROM server_option_sorted WHERE artist = 'No One You Know' ORDER BY songtitle DESC;
+--Testcase 758:
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT artist, songtitle, albumtitle FROM server_option_tbl WHERE artist = 'No One You Know' ORDER BY songtitle;
+
+-- LIMIT applied by the scan
+--Testcase 759:
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT artist, songtitle, albumtitle FROM server_option_sorted WHERE artist = 'No One You Know' ORDER BY songtitle DESC LIMIT 1;
+--Testcase 760:
+SELECT artist, songtitle, albumtitle FROM server_option_sorted WHERE artist = 'No One You Know' ORDER BY songtitle DESC LIMIT 1;
+--Testcase 761:
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT artist, songtitle FROM server_option_tbl WHERE albumtitle <> 'Blue Sky Blues' LIMIT 1 OFFSET 1;
+--Testcase 762:
+SELECT count(*) FROM (SELECT artist, songtitle FROM server_option_tbl WHERE albumtitle <> 'Blue Sky Blues' LIMIT 1 OFFSET 1) t;
+--Testcase 763:
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT artist, songtitle FROM server_option_tbl WHERE songtitle > 'A' LIMIT 1;
+
+-- count() pushed down as a Select=COUNT request
+--Testcase 764:
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT count(*) FROM server_option_tbl WHERE artist = 'No One You Know';
+--Testcase 765:
+SELECT count(*) FROM server_option_tbl WHERE artist = 'No One You Know';
+--Testcase 766:
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT count(albumtitle) FROM server_option_tbl WHERE albumtitle <> 'Blue Sky Blues';
+--Testcase 767:
+SELECT count(albumtitle) FROM server_option_tbl WHERE albumtitle <> 'Blue Sky Blues';
+
+-- Aggregates computed by the scan
+--Testcase 768:
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT artist, count(*), min(songtitle), max(albumtitle) FROM server_option_tbl GROUP BY artist ORDER BY artist;
+--Testcase 769:
+SELECT artist, count(*), min(songtitle), max(albumtitle) FROM server_option_tbl GROUP BY artist ORDER BY artist;
+--Testcase 770:
+SELECT count(*), max(songtitle) FROM server_option_tbl WHERE albumtitle = 'No Such Album';
+
+--Testcase 771:
+DROP FOREIGN TABLE server_option_sorted;
+--Testcase 772:
+DROP FOREIGN TABLE server_option_tbl;
+
 --Testcase 668:
 DROP USER MAPPING FOR public SERVER dynamodb_server;
 --Testcase 669:
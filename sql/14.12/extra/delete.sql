@@ -72,6 +72,15 @@ SELECT id, a, char_length(b) FROM delete_test;
 --Testcase 20:
 SELECT id, a, char_length(b) FROM delete_test;
 
+-- Direct delete of one item, given by its primary key
+--Testcase 24:
+EXPLAIN (VERBOSE, COSTS OFF)
+DELETE FROM delete_test WHERE id = 1;
+--Testcase 25:
+DELETE FROM delete_test WHERE id = 1;
+--Testcase 26:
+SELECT id, a, char_length(b) FROM delete_test;
+
 --Testcase 21:
 DROP FOREIGN TABLE delete_test;
 
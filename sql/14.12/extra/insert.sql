@@ -118,10 +118,58 @@ select col1, col2, char_length(col3) from inserttest;
 --Testcase 32:
 select col1, col2, char_length(col3) from inserttest;
 
+-- Batch insert, several rows per BatchExecuteStatement request
+--Testcase 36:
+ALTER FOREIGN TABLE inserttest OPTIONS (ADD batch_size '2');
+--Testcase 37:
+EXPLAIN (VERBOSE, COSTS OFF)
+INSERT INTO inserttest VALUES (101, 1, 2, 'BATCH INSERTED'), (102, 3, 4, 'BATCH INSERTED'), (103, 5, 6, 'BATCH INSERTED');
+--Testcase 38:
+INSERT INTO inserttest VALUES (101, 1, 2, 'BATCH INSERTED'), (102, 3, 4, 'BATCH INSERTED'), (103, 5, 6, 'BATCH INSERTED');
+--Testcase 39:
+SELECT * FROM inserttest WHERE col3 = 'BATCH INSERTED' ORDER BY 1;
+--Testcase 40:
+DELETE FROM inserttest WHERE col3 = 'BATCH INSERTED';
+--Testcase 41:
+ALTER FOREIGN TABLE inserttest OPTIONS (DROP batch_size);
+
+-- COPY FROM, through the batched insert path
+--Testcase 42:
+COPY inserttest FROM stdin;
+104	7	8	ROWS COPIED
+105	9	10	ROWS COPIED
+106	11	12	ROWS COPIED
+\.
+--Testcase 43:
+SELECT * FROM inserttest WHERE col3 = 'ROWS COPIED' ORDER BY 1;
+--Testcase 44:
+DELETE FROM inserttest WHERE col3 = 'ROWS COPIED';
+
 
 --Testcase 33:
 drop foreign table inserttest;
 
+-- bytea and bytea[] values keep their zero bytes and backslashes
+--Testcase 45:
+CREATE FOREIGN TABLE bytea_tbl (id int, belem bytea, barray bytea[])
+ SERVER dynamodb_server OPTIONS (table_name 'binary_type', partition_key 'id');
+--Testcase 46:
+INSERT INTO bytea_tbl VALUES (4, '\x610062', ARRAY['\x00', '\x5c', '\x615c00']::bytea[]);
+--Testcase 47:
+SELECT belem, barray, belem = '\x610062' AS belem_same,
+       barray = ARRAY['\x00', '\x5c', '\x615c00']::bytea[] AS barray_same
+  FROM bytea_tbl WHERE id = 4;
+--Testcase 48:
+SET bytea_output = 'escape';
+--Testcase 49:
+SELECT belem, barray FROM bytea_tbl WHERE id = 4;
+--Testcase 50:
+RESET bytea_output;
+--Testcase 51:
+DELETE FROM bytea_tbl WHERE id = 4;
+--Testcase 52:
+DROP FOREIGN TABLE bytea_tbl;
+
 --Testcase 34:
 DROP USER MAPPING FOR public SERVER dynamodb_server;
 --Testcase 35:
@@ -0,0 +1,33 @@
+\set ECHO none
+\ir sql/parameters.conf
+\set ECHO all
+
+
+--Testcase 1:
+CREATE EXTENSION IF NOT EXISTS dynamodb_fdw;
+--Testcase 2:
+CREATE SERVER dynamodb_server FOREIGN DATA WRAPPER dynamodb_fdw
+  OPTIONS (endpoint :DYNAMODB_ENDPOINT);
+--Testcase 3:
+CREATE USER MAPPING FOR public SERVER dynamodb_server 
+  OPTIONS (user :DYNAMODB_USER, password :DYNAMODB_PASSWORD);
+
+-- Sample the items of a table read as Scan segments
+--Testcase 6:
+CREATE FOREIGN TABLE server_option_tbl (artist text, songtitle text, albumtitle text)
+  SERVER dynamodb_server OPTIONS (table_name 'server_option_tbl', partition_key 'artist', sort_key 'songtitle');
+--Testcase 7:
+ALTER FOREIGN TABLE server_option_tbl ALTER COLUMN albumtitle SET STATISTICS 0;
+--Testcase 8:
+ANALYZE server_option_tbl;
+--Testcase 9:
+SELECT reltuples FROM pg_class WHERE relname = 'server_option_tbl';
+--Testcase 10:
+SELECT attname, n_distinct FROM pg_stats WHERE tablename = 'server_option_tbl' ORDER BY attname;
+--Testcase 11:
+DROP FOREIGN TABLE server_option_tbl;
+
+--Testcase 4:
+DROP USER MAPPING FOR public SERVER dynamodb_server;
+--Testcase 5:
+DROP EXTENSION dynamodb_fdw CASCADE;
@@ -362,6 +362,22 @@ SELECT json_object_agg(name, type) FROM foo;
 --Testcase 78:
 SELECT json_object_agg(name, type) FROM foo;
 
+-- A json object keeps the last of duplicate keys, as jsonb does
+--Testcase 81:
+CREATE FOREIGN TABLE json_dup_key_tbl ("ID" int, x json)
+ SERVER dynamodb_server OPTIONS (table_name 'repeat_json_tbl', partition_key 'ID');
+--Testcase 82:
+INSERT INTO json_dup_key_tbl VALUES (0, '{"a":1,"b":{"c":1,"c":2},"a":3}');
+--Testcase 83:
+SELECT x FROM json_dup_key_tbl;
+--Testcase 84:
+DELETE FROM json_dup_key_tbl;
+-- json_in accepts \u0000, but the value cannot be bound as text
+--Testcase 85:
+INSERT INTO json_dup_key_tbl VALUES (0, '{ "a":  "null \u0000 escape" }');
+--Testcase 86:
+DROP FOREIGN TABLE json_dup_key_tbl;
+
 --Testcase 79:
 DROP USER MAPPING FOR public SERVER dynamodb_server;
 --Testcase 80:
@@ -311,6 +311,19 @@ INSERT INTO upsert_test VALUES (2, 'Brox') ON CONFLICT(a)
 DROP FOREIGN TABLE upsert_test;
 */
 
+-- Direct update of one item, given by its primary key
+--Testcase 79:
+INSERT INTO update_test VALUES (100, 1, 2, 'direct');
+--Testcase 80:
+EXPLAIN (VERBOSE, COSTS OFF)
+UPDATE update_test SET c = 'DIRECT UPDATED' WHERE "ID" = 100;
+--Testcase 81:
+UPDATE update_test SET c = 'DIRECT UPDATED' WHERE "ID" = 100;
+--Testcase 82:
+SELECT * FROM update_test WHERE "ID" = 100;
+--Testcase 83:
+DELETE FROM update_test WHERE "ID" = 100;
+
 --Testcase 75:
 DROP FOREIGN TABLE update_test;
 
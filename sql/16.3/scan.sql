@@ -0,0 +1,67 @@
+\set ECHO none
+\ir sql/parameters.conf
+\set ECHO all
+
+
+--Testcase 1:
+CREATE EXTENSION IF NOT EXISTS dynamodb_fdw;
+--Testcase 2:
+CREATE SERVER dynamodb_server FOREIGN DATA WRAPPER dynamodb_fdw
+  OPTIONS (endpoint :DYNAMODB_ENDPOINT);
+--Testcase 3:
+CREATE USER MAPPING FOR public SERVER dynamodb_server 
+  OPTIONS (user :DYNAMODB_USER, password :DYNAMODB_PASSWORD);
+
+--Testcase 6:
+CREATE FOREIGN TABLE server_option_tbl (artist text, songtitle text, albumtitle text)
+  SERVER dynamodb_server OPTIONS (table_name 'server_option_tbl', partition_key 'artist', sort_key 'songtitle');
+
+-- Scan through the prefetch queue, with a table option over the server ones
+--Testcase 7:
+ALTER SERVER dynamodb_server OPTIONS (ADD prefetch_depth '2', ADD prefetch_memory_limit '8MB');
+--Testcase 8:
+ALTER FOREIGN TABLE server_option_tbl OPTIONS (ADD prefetch_depth '4');
+--Testcase 9:
+SELECT artist, songtitle, albumtitle FROM server_option_tbl ORDER BY 1, 2;
+--Testcase 10:
+ALTER FOREIGN TABLE server_option_tbl OPTIONS (DROP prefetch_depth);
+--Testcase 11:
+ALTER SERVER dynamodb_server OPTIONS (DROP prefetch_depth, DROP prefetch_memory_limit);
+
+-- Parallel scan, reading the table as Scan segments
+--Testcase 12:
+ALTER FOREIGN TABLE server_option_tbl OPTIONS (ADD parallel_workers '2');
+--Testcase 13:
+SET parallel_setup_cost = 0;
+--Testcase 14:
+SET parallel_tuple_cost = 0;
+--Testcase 15:
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT artist, songtitle, albumtitle FROM server_option_tbl;
+--Testcase 16:
+SELECT artist, songtitle, albumtitle FROM server_option_tbl ORDER BY 1, 2;
+--Testcase 17:
+RESET parallel_setup_cost;
+--Testcase 18:
+RESET parallel_tuple_cost;
+--Testcase 19:
+ALTER FOREIGN TABLE server_option_tbl OPTIONS (DROP parallel_workers);
+
+-- Asynchronous execution of the scans under an Append
+--Testcase 20:
+ALTER SERVER dynamodb_server OPTIONS (ADD async_capable 'true');
+--Testcase 21:
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT artist FROM server_option_tbl UNION ALL SELECT artist FROM server_option_tbl;
+--Testcase 22:
+SELECT artist, songtitle FROM server_option_tbl UNION ALL SELECT artist, songtitle FROM server_option_tbl ORDER BY 1, 2;
+--Testcase 23:
+ALTER SERVER dynamodb_server OPTIONS (DROP async_capable);
+
+--Testcase 24:
+DROP FOREIGN TABLE server_option_tbl;
+
+--Testcase 4:
+DROP USER MAPPING FOR public SERVER dynamodb_server;
+--Testcase 5:
+DROP EXTENSION dynamodb_fdw CASCADE;
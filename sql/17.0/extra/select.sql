@@ -466,6 +466,72 @@ SELECT 1 AS x ORDER BY x;
 --Testcase 100:
 SELECT 1 AS x ORDER BY x;
 
+-- Conversion of numbers
+--Testcase 103:
+CREATE FOREIGN TABLE mixed_numbers (id int8, score real)
+  SERVER dynamodb_server OPTIONS (table_name 'mixed_types', partition_key 'id');
+--Testcase 104:
+SELECT id, score FROM mixed_numbers ORDER BY id;
+--Testcase 105:
+ALTER FOREIGN TABLE mixed_numbers ALTER COLUMN score TYPE int;
+--Testcase 106:
+SELECT id, score FROM mixed_numbers WHERE id = 212;
+--Testcase 107:
+DROP FOREIGN TABLE mixed_numbers;
+
+-- Conversion of sets
+--Testcase 108:
+CREATE FOREIGN TABLE mixed_sets (id int8, numbers real[], color int2[], events varchar[])
+  SERVER dynamodb_server OPTIONS (table_name 'mixed_types', partition_key 'id');
+--Testcase 109:
+SELECT numbers, color, events FROM mixed_sets WHERE id = 212;
+--Testcase 110:
+DROP FOREIGN TABLE mixed_sets;
+
+-- Conversion of strings into columns with a length
+--Testcase 111:
+CREATE FOREIGN TABLE mixed_strings (id int8, name char(5), description varchar(10))
+  SERVER dynamodb_server OPTIONS (table_name 'mixed_types', partition_key 'id');
+--Testcase 112:
+SELECT name, octet_length(name) FROM mixed_strings WHERE id = 212;
+--Testcase 113:
+SELECT description FROM mixed_strings WHERE id = 212;
+--Testcase 114:
+DROP FOREIGN TABLE mixed_strings;
+
+-- Conversion of numbers, natively or by the input function, which must agree:
+-- negative zero, integers out of range, more than 19 digits, mantissas above
+-- 2^24 and 2^53, more fraction digits than 10 and 22
+--Testcase 115:
+CREATE FOREIGN TABLE number_conv (id int, n float8, s text)
+  SERVER dynamodb_server OPTIONS (table_name 'number_conv', partition_key 'id');
+--Testcase 116:
+SELECT id, s, n, n = s::float8 AS same FROM number_conv ORDER BY id;
+--Testcase 117:
+ALTER FOREIGN TABLE number_conv ALTER COLUMN n TYPE real;
+--Testcase 118:
+SELECT id, s, n, n = s::real AS same FROM number_conv ORDER BY id;
+--Testcase 119:
+ALTER FOREIGN TABLE number_conv ALTER COLUMN n TYPE int8;
+--Testcase 120:
+SELECT id, s, n, n = s::int8 AS same FROM number_conv WHERE id IN (3, 4, 5) ORDER BY id;
+--Testcase 121:
+SELECT n FROM number_conv WHERE id = 6;
+--Testcase 122:
+ALTER FOREIGN TABLE number_conv ALTER COLUMN n TYPE int;
+--Testcase 123:
+SELECT id, s, n, n = s::int AS same FROM number_conv WHERE id IN (3, 4) ORDER BY id;
+--Testcase 124:
+SELECT n FROM number_conv WHERE id = 5;
+--Testcase 125:
+ALTER FOREIGN TABLE number_conv ALTER COLUMN n TYPE int2;
+--Testcase 126:
+SELECT id, s, n, n = s::int2 AS same FROM number_conv WHERE id = 3 ORDER BY id;
+--Testcase 127:
+SELECT n FROM number_conv WHERE id = 4;
+--Testcase 128:
+DROP FOREIGN TABLE number_conv;
+
 --Testcase 101:
 DROP USER MAPPING FOR public SERVER dynamodb_server;
 --Testcase 102:
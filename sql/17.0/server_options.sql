@@ -39,12 +39,95 @@ DELETE FROM server_option_tbl WHERE artist = '0000';
 --Testcase 12:
 SELECT artist, songtitle, albumtitle FROM server_option_tbl ORDER BY 1, 2;
 
--- Cleanup
+-- Validate prefetch options
 --Testcase 13:
-DROP FOREIGN TABLE server_option_tbl;
+ALTER SERVER dynamodb_server OPTIONS (ADD prefetch_depth '-1');
 --Testcase 14:
-DROP USER MAPPING FOR public SERVER dynamodb_server;
+ALTER SERVER dynamodb_server OPTIONS (ADD prefetch_memory_limit '0');
 --Testcase 15:
-DROP SERVER dynamodb_server;
+ALTER SERVER dynamodb_server OPTIONS (ADD prefetch_depth '2', ADD prefetch_memory_limit '8MB');
 --Testcase 16:
+ALTER FOREIGN TABLE server_option_tbl OPTIONS (ADD prefetch_depth '4');
+--Testcase 17:
+ALTER FOREIGN TABLE server_option_tbl OPTIONS (DROP prefetch_depth);
+--Testcase 18:
+ALTER SERVER dynamodb_server OPTIONS (DROP prefetch_depth, DROP prefetch_memory_limit);
+
+-- Validate parallel scan options
+--Testcase 19:
+ALTER FOREIGN TABLE server_option_tbl OPTIONS (ADD parallel_workers '-1');
+--Testcase 20:
+ALTER FOREIGN TABLE server_option_tbl OPTIONS (ADD parallel_workers '2');
+--Testcase 21:
+ALTER FOREIGN TABLE server_option_tbl OPTIONS (DROP parallel_workers);
+
+-- Validate asynchronous execution options
+--Testcase 22:
+ALTER SERVER dynamodb_server OPTIONS (ADD async_capable 'maybe');
+--Testcase 23:
+ALTER SERVER dynamodb_server OPTIONS (ADD async_capable 'true');
+--Testcase 24:
+ALTER SERVER dynamodb_server OPTIONS (DROP async_capable);
+
+-- Validate batch insert options
+--Testcase 25:
+ALTER FOREIGN TABLE server_option_tbl OPTIONS (ADD batch_size '0');
+--Testcase 26:
+ALTER FOREIGN TABLE server_option_tbl OPTIONS (ADD batch_size '2');
+--Testcase 27:
+ALTER FOREIGN TABLE server_option_tbl OPTIONS (DROP batch_size);
+
+-- Validate the indexes option
+--Testcase 28:
+CREATE FOREIGN TABLE server_option_idx (artist text, songtitle text, albumtitle text, genre text)
+  SERVER dynamodb_server OPTIONS (table_name 'server_option_tbl', partition_key 'artist', sort_key 'songtitle',
+                                 indexes 'album_index (albumtitle) KEYS_ONLY');
+--Testcase 29:
+ALTER FOREIGN TABLE server_option_idx OPTIONS (SET indexes 'album_index albumtitle');
+--Testcase 30:
+ALTER FOREIGN TABLE server_option_idx OPTIONS (SET indexes 'album_index (albumtitle) INCLUDE ()');
+--Testcase 31:
+DROP FOREIGN TABLE server_option_idx;
+
+-- Validate remote estimate options
+--Testcase 32:
+ALTER SERVER dynamodb_server OPTIONS (ADD use_remote_estimate 'maybe');
+--Testcase 33:
+ALTER SERVER dynamodb_server OPTIONS (ADD remote_estimate_ttl '-1');
+-- The row estimate of a never analyzed table: a default of 10 pages without
+-- use_remote_estimate, the item count of DescribeTable with it
+--Testcase 34:
+CREATE FUNCTION dynamodb_estimated_rows(query text) RETURNS int
+LANGUAGE plpgsql AS
+$$
+DECLARE
+    ln text;
+BEGIN
+    FOR ln IN EXECUTE format('EXPLAIN %s', query)
+    LOOP
+        RETURN substring(ln FROM 'rows=(\d+)')::int;
+    END LOOP;
+END;
+$$;
+--Testcase 35:
+SELECT dynamodb_estimated_rows('SELECT * FROM server_option_tbl') AS estimated;
+--Testcase 36:
+ALTER FOREIGN TABLE server_option_tbl OPTIONS (ADD use_remote_estimate 'true', ADD remote_estimate_ttl '5min');
+--Testcase 37:
+SELECT dynamodb_estimated_rows('SELECT * FROM server_option_tbl') AS estimated;
+--Testcase 38:
+SELECT albumtitle FROM server_option_tbl WHERE artist = 'Acme Band' AND songtitle = 'Happy Day';
+--Testcase 39:
+ALTER FOREIGN TABLE server_option_tbl OPTIONS (DROP use_remote_estimate, DROP remote_estimate_ttl);
+--Testcase 40:
+DROP FUNCTION dynamodb_estimated_rows(text);
+
+-- Cleanup
+--Testcase 41:
+DROP FOREIGN TABLE server_option_tbl;
+--Testcase 42:
+DROP USER MAPPING FOR public SERVER dynamodb_server;
+--Testcase 43:
+DROP SERVER dynamodb_server;
+--Testcase 44:
 DROP EXTENSION dynamodb_fdw;
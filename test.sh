@@ -3,7 +3,7 @@
 rm -rf init.log || true
 ./dynamodb_init.sh > init.log
 
-sed -i 's/REGRESS =.*/REGRESS = server_options connection_validation dynamodb_fdw pushdown extra\/delete extra\/insert extra\/json extra\/jsonb extra\/select extra\/update /' Makefile
+sed -i 's/REGRESS =.*/REGRESS = server_options connection_validation dynamodb_fdw pushdown scan analyze extra\/delete extra\/insert extra\/json extra\/jsonb extra\/select extra\/update /' Makefile
 
 make clean
 make